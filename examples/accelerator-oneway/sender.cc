@@ -164,6 +164,7 @@ private:
 
                                    if (len > 0)
                                    {
+                                     m_packet.resize(len);
                                      m_encoder(std::move(m_packet));
                                      m_packet.resize(buffer_size);
                                    }
@@ -1,9 +1,12 @@
 #include <chrono>
+#include <cstdint>
+#include <cstdlib> // strtoul
 #include <cstring> // strncmp
 #include <iostream>
 
 #include <boost/asio.hpp>
 
+#include "accelerator/pipeline.hh"
 #include "accelerator/transcoder.hh"
 
 /*------------------------------------------------------------------------------------------------*/
@@ -17,12 +20,39 @@ main(int argc, char** argv)
   const auto usage = [&]
   {
     std::cerr << "Usage\n";
-    std::cerr << argv[0] << " server server_port app_ip app_port\n";
-    std::cerr << argv[0] << " client app_port server_ip server_port\n";
+    std::cerr << argv[0] << " [--threads] [--session id] server server_port app_ip app_port\n";
+    std::cerr << argv[0] << " [--threads] [--session id] client app_port server_ip server_port\n";
     std::exit(1);
   };
 
-  if (argc != 5)
+  // With --threads, each stage of the tunnel runs on its own core. With --session, packets carry
+  // a session identifier, so that the server can be a gateway for many clients.
+  auto threaded = false;
+  auto session = std::uint32_t{0};
+  auto has_session = false;
+  auto args = argv;
+  auto nb_args = argc;
+  while (nb_args > 1 and std::strncmp(args[1], "--", 2) == 0)
+  {
+    if (std::strncmp(args[1], "--threads", 10) == 0)
+    {
+      threaded = true;
+    }
+    else if (std::strncmp(args[1], "--session", 10) == 0 and nb_args > 2)
+    {
+      session = static_cast<std::uint32_t>(std::strtoul(args[2], nullptr, 10));
+      has_session = true;
+      ++args;
+      --nb_args;
+    }
+    else
+    {
+      usage();
+    }
+    ++args;
+    --nb_args;
+  }
+  if (nb_args != 5)
   {
     usage();
   }
@@ -40,11 +70,11 @@ main(int argc, char** argv)
 
     // The transcoder is fully symmetric as it handles two-ways communications. Still, UDP
     // requires a client and a server.
-    if (std::strncmp(argv[1], "server", 7) == 0)
+    if (std::strncmp(args[1], "server", 7) == 0)
     {
-      const auto server_port = static_cast<unsigned short>(std::atoi(argv[2]));
-      const auto app_url = argv[3];
-      const auto app_port = argv[4];
+      const auto server_port = static_cast<unsigned short>(std::atoi(args[2]));
+      const auto app_url = args[3];
+      const auto app_port = args[4];
 
       app_socket = udp::socket{io, udp::endpoint(udp::v4(), 0)}; // a client socket
       app_socket.set_option(boost::asio::socket_base::receive_buffer_size{8192*64});
@@ -57,11 +87,11 @@ main(int argc, char** argv)
       udp::resolver resolver(io);
       app_endpoint = *resolver.resolve({udp::v4(), app_url, app_port});
     }
-    else if (std::strncmp(argv[1], "client", 7) == 0)
+    else if (std::strncmp(args[1], "client", 7) == 0)
     {
-      const auto app_port = static_cast<unsigned short>(std::atoi(argv[2]));
-      const auto server_url = argv[3];
-      const auto server_port = argv[4];
+      const auto app_port = static_cast<unsigned short>(std::atoi(args[2]));
+      const auto server_url = args[3];
+      const auto server_port = args[4];
 
       app_socket = udp::socket{io, udp::endpoint{udp::v4(), app_port}}; // a server socket
       app_socket.set_option(boost::asio::socket_base::receive_buffer_size{8192*64});
@@ -79,12 +109,29 @@ main(int argc, char** argv)
       usage();
     }
 
-    // Create and configure the transcoder that handles encoding/decoding. The client/server status
-    // is completely transparent to the transcoder.
-    transcoder t{io, app_socket, app_endpoint, socket, endpoint};
-
-    // Launch the event loop (runs forever).
-    io.run();
+    if (threaded)
+    {
+      // The sockets are used synchronously by the threads of the pipeline, not by the event loop.
+      pipeline p{app_socket, app_endpoint, socket, endpoint};
+      if (has_session)
+      {
+        p.set_session(session);
+      }
+      p.run();
+    }
+    else
+    {
+      // Create and configure the transcoder that handles encoding/decoding. The client/server
+      // status is completely transparent to the transcoder.
+      transcoder t{io, app_socket, app_endpoint, socket, endpoint};
+      if (has_session)
+      {
+        t.set_session(session);
+      }
+
+      // Launch the event loop (runs forever).
+      io.run();
+    }
   }
   catch (const std::exception& e)
   {
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdlib> // atoi
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h> // send
+
+#include <netcode/transport/udp_gateway.hh>
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Give decoded data of all sessions of a worker to the application
+struct app_handler
+{
+  int fd;
+
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    // The application might not listen (yet), it's not a reason to stop the gateway.
+    static_cast<void>(::send(fd, data, sz, MSG_DONTWAIT));
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, char** argv)
+{
+  const auto usage = [&]
+  {
+    std::cerr << "Usage\n";
+    std::cerr << argv[0] << " server_port nb_workers app_ip app_port\n";
+    std::cerr << "Clients are started with: accelerator --session id client ...\n";
+    std::exit(1);
+  };
+
+  if (argc != 5)
+  {
+    usage();
+  }
+  try
+  {
+    using gateway_type = ntc::udp_gateway<app_handler>;
+
+    const auto server_port = static_cast<std::uint16_t>(std::atoi(argv[1]));
+    const auto nb_workers = static_cast<std::size_t>(std::atoi(argv[2]));
+    const auto app_port = static_cast<std::uint16_t>(std::atoi(argv[4]));
+    if (nb_workers == 0)
+    {
+      usage();
+    }
+
+    // Each worker has its own socket to the application, workers share nothing.
+    auto app_sockets = std::vector<std::unique_ptr<ntc::udp_socket>>{};
+    for (auto i = 0ul; i < nb_workers; ++i)
+    {
+      app_sockets.emplace_back(new ntc::udp_socket{"0.0.0.0", 0});
+      app_sockets.back()->connect(argv[3], app_port);
+    }
+
+    gateway_type gateway{ "0.0.0.0", server_port, nb_workers, 8, ntc::in_order::yes
+                        , [&](std::size_t w, std::uint32_t session, gateway_type::encoder_type&)
+                          {
+                            std::cout << "worker " << w << ": new session " << session << std::endl;
+                            return app_handler{app_sockets[w]->native_handle()};
+                          }};
+    gateway.start();
+
+    // Workers run forever.
+    for (;;)
+    {
+      std::this_thread::sleep_for(std::chrono::hours{1});
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << '\n';
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm> // copy_n, max
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <pthread.h> // pthread_setaffinity_np
+#include <unistd.h>  // dup
+
+#include <boost/asio.hpp>
+
+#include <netcode/detail/packet_type.hh>
+#include <netcode/decoder.hh>
+#include <netcode/encoder.hh>
+#include <netcode/errors.hh>
+#include <netcode/mpsc_queue.hh>
+#include <netcode/pooled_queue.hh>
+#include <netcode/spsc_queue.hh>
+
+#include "accelerator/transcoder.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An endpoint learned by a thread and read by other ones
+///
+/// Readers only take the lock when the endpoint has changed since they last read it.
+class shared_endpoint
+{
+public:
+
+  /// @brief Constructor, a default endpoint is unknown
+  explicit shared_endpoint(const udp::endpoint& endpoint)
+    : m_mutex()
+    , m_endpoint(endpoint)
+    , m_version{endpoint == udp::endpoint{} ? 0u : 1u}
+  {}
+
+  /// @brief Change the endpoint
+  void
+  set(const udp::endpoint& endpoint)
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_endpoint = endpoint;
+    m_version.fetch_add(1, std::memory_order_release);
+  }
+
+  /// @brief Update the copy of a reader
+  /// @param endpoint The copy of the reader
+  /// @param version The version of the copy of the reader, 0 initially
+  /// @return false if the endpoint is still unknown
+  bool
+  get(udp::endpoint& endpoint, unsigned int& version)
+  {
+    const auto current = m_version.load(std::memory_order_acquire);
+    if (current != version)
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      endpoint = m_endpoint;
+      version = current;
+    }
+    return version != 0;
+  }
+
+private:
+
+  /// @brief Protect the endpoint
+  std::mutex m_mutex;
+
+  /// @brief The endpoint
+  udp::endpoint m_endpoint;
+
+  /// @brief Incremented each time the endpoint changes
+  std::atomic<unsigned int> m_version;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called by decoder when a data has been decoded or received
+class app_data_handler
+{
+public:
+
+  app_data_handler(udp::socket& socket, shared_endpoint& endpoint)
+    : m_socket(socket), m_shared_endpoint(endpoint), m_endpoint(), m_version{0}
+  {}
+
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    if (m_shared_endpoint.get(m_endpoint, m_version))
+    {
+      // The application might not listen (yet), it's not a reason to stop the tunnel.
+      auto err = boost::system::error_code{};
+      m_socket.send_to(boost::asio::buffer(data, sz), m_endpoint, 0, err);
+    }
+  }
+
+private:
+
+  udp::socket& m_socket;
+  shared_endpoint& m_shared_endpoint;
+  udp::endpoint m_endpoint;
+  unsigned int m_version;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A side of the encoded tunnel, whose stages run on their own cores
+///
+/// It does the same as transcoder, with the following threads connected by lock-free queues:
+/// - the application receiver gives data to the encoder;
+/// - the encoder gives its packets to the network sender;
+/// - the network receiver gives acks to the encoder, and sources and repairs to the decoder;
+/// - the decoder gives data to the application, and its acks to the network sender;
+/// - the network sender sends packets, then gives them back to the encoder and to the decoder.
+///
+/// Packets going to the network are thus re-used once sent. The other ones are kept by the encoder
+/// and the decoder, so new ones are allocated to receive, with the size of the largest datagram
+/// received so far rather than the largest possible one. The encoder and the decoder share the
+/// queue to the network sender, it's the only one with two producers.
+///
+/// An asio socket can't be used by two threads at once: the threads which send on a socket use
+/// another socket object on a duplicate of its descriptor, thus packets still leave from the port
+/// on which the other side sends.
+class pipeline
+{
+public:
+
+  /// @brief The packet handler of the encoder and of the decoder
+  using packet_handler = ntc::queue_packet_handler<ntc::mpsc_queue<ntc::packet>>;
+
+  /// @brief Constructor
+  pipeline( udp::socket& app_socket
+          , const udp::endpoint& app_endpoint
+          , udp::socket& socket
+          , const udp::endpoint& endpoint)
+    : m_app_socket(app_socket)
+    , m_app_endpoint(app_endpoint)
+    , m_app_sender(duplicate(app_socket))
+    , m_socket(socket)
+    , m_endpoint(endpoint)
+    , m_sender(duplicate(socket))
+    , m_app_data(queue_size)
+    , m_acks(queue_size)
+    , m_packets(queue_size)
+    , m_out_packets(queue_size)
+    , m_decoder(8, ntc::in_order::yes, packet_handler(m_out_packets)
+                                     , app_data_handler(m_app_sender, m_app_endpoint))
+    , m_encoder(8, packet_handler(m_out_packets))
+    , m_other_side_seen(false)
+  {
+    // Deactivate automatic sending of ack by the library, we'll take care of it.
+    m_decoder.set_ack_period(std::chrono::milliseconds{0});
+    m_encoder.set_window_size(32)
+             .set_adaptive(true);
+  }
+
+  /// @brief Put a session identifier in all sent packets, see ntc::encoder::set_session
+  void
+  set_session(std::uint32_t id)
+  {
+    m_encoder.set_session(id);
+    m_decoder.set_session(id);
+  }
+
+  /// @brief Start all threads, and wait for them (runs forever)
+  void
+  run()
+  {
+    auto threads = std::vector<std::thread>{};
+    threads.emplace_back([this]{receive_app();});
+    threads.emplace_back([this]{encode();});
+    threads.emplace_back([this]{decode();});
+    threads.emplace_back([this]{receive_network();});
+    threads.emplace_back([this]{send_network();});
+
+    // Pin each thread to its own core, if there are enough of them.
+    const auto nb_cores = std::max(1u, std::thread::hardware_concurrency());
+    for (auto i = 0u; i < threads.size(); ++i)
+    {
+      ::cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(i % nb_cores, &set);
+      ::pthread_setaffinity_np(threads[i].native_handle(), sizeof(set), &set);
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+  }
+
+private:
+
+  /// @brief The capacity of each queue
+  static constexpr auto queue_size = 1024ul;
+
+  /// @brief How many values a thread takes from a queue before looking at the other ones
+  static constexpr auto batch_size = 32u;
+
+  /// @brief The initial size of buffers to receive datagrams
+  static constexpr auto initial_receive_size = 2048ul;
+
+  /// @brief Make another socket object on a duplicate of the descriptor of @p socket
+  static
+  udp::socket
+  duplicate(udp::socket& socket)
+  {
+    const auto fd = ::dup(socket.native_handle());
+    if (fd < 0)
+    {
+      throw boost::system::system_error{errno, boost::system::system_category(), "dup"};
+    }
+    return udp::socket{socket.get_executor(), socket.local_endpoint().protocol(), fd};
+  }
+
+  /// @brief Receive a datagram in a buffer of the size of the largest one received so far
+  /// @param size The size of the largest datagram received so far, updated
+  /// @param spill Where the end of a larger datagram goes before being appended to @p buffer
+  template <typename Buffer>
+  static
+  std::size_t
+  receive( udp::socket& socket, Buffer& buffer, udp::endpoint& endpoint, std::size_t& size
+         , std::vector<char>& spill)
+  {
+    buffer.resize(size);
+    const auto buffers = std::array<boost::asio::mutable_buffer, 2>{{ boost::asio::buffer(buffer)
+                                                                    , boost::asio::buffer(spill)}};
+    const auto len = socket.receive_from(buffers, endpoint);
+    buffer.resize(len);
+    if (len > size)
+    {
+      std::copy_n(spill.data(), len - size, buffer.data() + size);
+      size = len;
+    }
+    return len;
+  }
+
+  /// @brief Receive data from the application
+  void
+  receive_app()
+  {
+    auto endpoint = udp::endpoint{};
+    auto last_endpoint = udp::endpoint{};
+    auto size = initial_receive_size;
+    auto spill = std::vector<char>(buffer_size);
+    for (;;)
+    {
+      auto data = ntc::data{};
+      if (receive(m_app_socket, data, endpoint, size, spill) > 0)
+      {
+        m_app_data.push(std::move(data));
+      }
+      if (endpoint != last_endpoint)
+      {
+        m_app_endpoint.set(endpoint);
+        last_endpoint = endpoint;
+      }
+    }
+  }
+
+  /// @brief Encode data, and handle acks
+  void
+  encode()
+  {
+    auto data = ntc::data{};
+    auto ack = ntc::packet{};
+    auto stats = std::chrono::steady_clock::now();
+    for (;;)
+    {
+      auto busy = false;
+      for (auto i = 0u; i < batch_size and m_app_data.try_pop(data); ++i)
+      {
+        m_encoder(std::move(data));
+        busy = true;
+      }
+      for (auto i = 0u; i < batch_size and m_acks.try_pop(ack); ++i)
+      {
+        m_encoder(std::move(ack));
+        busy = true;
+      }
+      if (std::chrono::steady_clock::now() - stats >= std::chrono::seconds(5))
+      {
+        stats = std::chrono::steady_clock::now();
+        std::ostringstream os;
+        os << "-- Encoder --\n"
+           << "in  acks   : " << m_encoder.nb_received_acks() << '\n'
+           << "out repairs: " << m_encoder.nb_sent_repairs() << '\n'
+           << "out sources: " << m_encoder.nb_sent_sources() << '\n'
+           << "window : " << m_encoder.window() << '\n'
+           << "rate : " << m_encoder.rate() << '\n'
+           << '\n';
+        std::cout << os.str() << std::flush;
+      }
+      if (not busy)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /// @brief Decode sources and repairs, and generate an ack every 100 ms
+  void
+  decode()
+  {
+    auto packet = ntc::packet{};
+    auto ack = std::chrono::steady_clock::now();
+    auto stats = ack;
+    for (;;)
+    {
+      auto busy = false;
+      for (auto i = 0u; i < batch_size and m_packets.try_pop(packet); ++i)
+      {
+        m_decoder(std::move(packet));
+        busy = true;
+      }
+      const auto now = std::chrono::steady_clock::now();
+      if (now - ack >= std::chrono::milliseconds(100))
+      {
+        ack = now;
+        if (m_other_side_seen.load(std::memory_order_relaxed))
+        {
+          m_decoder.generate_ack();
+        }
+      }
+      if (now - stats >= std::chrono::seconds(5))
+      {
+        stats = now;
+        std::ostringstream os;
+        os << "-- Decoder --\n"
+           << "out acks   : " << m_decoder.nb_sent_acks() << '\n'
+           << "in  repairs: " << m_decoder.nb_received_repairs() << '\n'
+           << "in  sources: " << m_decoder.nb_received_sources() << '\n'
+           << "decoded: " << m_decoder.nb_decoded() << '\n'
+           << "failed : " << m_decoder.nb_failed_full_decodings() << '\n'
+           << "useless: " << m_decoder.nb_useless_repairs() << '\n'
+           << "missing: " << m_decoder.nb_missing_sources() << '\n'
+           << '\n';
+        std::cout << os.str() << std::flush;
+      }
+      if (not busy)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /// @brief Receive packets from the other side, and give them to the encoder or to the decoder
+  void
+  receive_network()
+  {
+    auto endpoint = udp::endpoint{};
+    auto last_endpoint = udp::endpoint{};
+    auto size = initial_receive_size;
+    auto spill = std::vector<char>(buffer_size);
+    for (;;)
+    {
+      auto packet = ntc::packet{};
+      const auto len = receive(m_socket, packet, endpoint, size, spill);
+      m_other_side_seen.store(true, std::memory_order_relaxed);
+      if (endpoint != last_endpoint)
+      {
+        m_endpoint.set(endpoint);
+        last_endpoint = endpoint;
+      }
+      if (len == 0)
+      {
+        continue;
+      }
+      try
+      {
+        if (ntc::detail::get_packet_type(packet) == ntc::detail::packet_type::ack)
+        {
+          m_acks.push(std::move(packet));
+        }
+        else
+        {
+          m_packets.push(std::move(packet));
+        }
+      }
+      catch (const ntc::packet_type_error&)
+      {
+        // Not a packet of the tunnel.
+      }
+    }
+  }
+
+  /// @brief Send the packets of the encoder and of the decoder to the other side
+  void
+  send_network()
+  {
+    auto packet = ntc::packet{};
+    auto endpoint = udp::endpoint{};
+    auto version = 0u;
+    for (;;)
+    {
+      auto busy = false;
+      for (auto i = 0u; i < batch_size and m_out_packets.try_pop(packet); ++i)
+      {
+        // Packets are dropped until the other side is known, lost ones are repaired.
+        if (m_endpoint.get(endpoint, version))
+        {
+          auto err = boost::system::error_code{};
+          m_sender.send_to(boost::asio::buffer(packet), endpoint, 0, err);
+        }
+        m_out_packets.release(std::move(packet));
+        busy = true;
+      }
+      if (not busy)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+private:
+
+  /// @brief The proxied application's socket, used by the application receiver
+  udp::socket& m_app_socket;
+
+  /// @brief The proxied application communication point
+  shared_endpoint m_app_endpoint;
+
+  /// @brief The proxied application's socket, used by the decoder's thread to send data
+  udp::socket m_app_sender;
+
+  /// @brief The encoded tunnel socket, used by the network receiver
+  udp::socket& m_socket;
+
+  /// @brief The encoded tunnel communication point
+  shared_endpoint m_endpoint;
+
+  /// @brief The encoded tunnel socket, used by the network sender
+  udp::socket m_sender;
+
+  /// @brief Data from the application receiver to the encoder
+  ntc::spsc_queue<ntc::data> m_app_data;
+
+  /// @brief Acks from the network receiver to the encoder
+  ntc::spsc_queue<ntc::packet> m_acks;
+
+  /// @brief Sources and repairs from the network receiver to the decoder
+  ntc::spsc_queue<ntc::packet> m_packets;
+
+  /// @brief Packets from the encoder and the decoder to the network sender, and back
+  packet_handler::queue_type m_out_packets;
+
+  /// @brief The decoder on this side of the tunnel
+  ntc::decoder<packet_handler, app_data_handler> m_decoder;
+
+  /// @brief The encoder on this side of the tunnel
+  ntc::encoder<packet_handler> m_encoder;
+
+  /// @brief Set the first time a packet has been received from the other side of the tunnel
+  std::atomic<bool> m_other_side_seen;
+};
+
+/*------------------------------------------------------------------------------------------------*/
@@ -137,6 +137,14 @@ public:
     start_stats_timer_handler();
   }
 
+  /// @brief Put a session identifier in all sent packets, see ntc::encoder::set_session
+  void
+  set_session(std::uint32_t id)
+  {
+    m_encoder.set_session(id);
+    m_decoder.set_session(id);
+  }
+
 private:
 
   /// @brief Listen for incomging packets from the other side (decoder or encoder)
@@ -159,7 +167,10 @@ private:
                                      // The received packet might be for the encoder or the decoder.
                                      // The netcode library provides the following function to
                                      // dispatch to the appropriate component using the packet's
-                                     // type (source, ack or repair).
+                                     // type (source, ack or repair). Trailing fields are read
+                                     // up to the end of the packet: it must have the size of the
+                                     // received datagram.
+                                     m_packet.resize(len);
                                      ntc::dispatch(m_encoder, m_decoder, std::move(m_packet));
 
                                      m_packet.resize(buffer_size);
@@ -64,3 +64,21 @@ noexcept
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_set_deficit_feedback(ntc_decoder_t* dec, bool feedback)
+noexcept
+{
+  dec->set_deficit_feedback(feedback);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_decoder_set_session(ntc_decoder_t* dec, uint32_t session)
+noexcept
+{
+  dec->set_session(session);
+}
+
+/*------------------------------------------------------------------------------------------------*/
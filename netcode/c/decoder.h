@@ -31,6 +31,7 @@ typedef enum {ntc_in_order_yes, ntc_in_order_no} ntc_ordering_type;
 
 /// @ingroup c_decoder
 /// @return A new decoder if allocation suceeded; a null pointer otherwise
+/// @note @p galois_field_size is 4, 8, 16 or 32, or 1 for a binary (xor-only) code
 ntc_decoder_t*
 ntc_new_decoder( uint8_t galois_field_size, ntc_ordering_type order
                , ntc_packet_handler packet_handler, ntc_data_handler data_handler)
@@ -96,6 +97,30 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_decoder
+/// @brief Configure if acknowledgments report how many repairs are still needed
+/// @param dec The decoder to configure
+/// @param feedback Set to true if acknowledgments should carry this information
+/// @note A decoder doesn't report this information by default
+void
+ntc_decoder_set_deficit_feedback(ntc_decoder_t* dec, bool feedback)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_decoder
+/// @brief Configure the session identifier put at the end of all sent acks
+/// @param dec The decoder to configure
+/// @param session The identifier of the session this decoder belongs to
+/// @note Many flows can then share the same socket
+void
+ntc_decoder_set_session(ntc_decoder_t* dec, uint32_t session)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
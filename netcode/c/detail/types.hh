@@ -4,6 +4,7 @@
 #include "netcode/decoder.hh"
 #include "netcode/encoder.hh"
 #include "netcode/packet.hh"
+#include "netcode/recoder.hh"
 #include "netcode/c/detail/handlers.hh"
 
 /*------------------------------------------------------------------------------------------------*/
@@ -29,3 +30,9 @@ using ntc_decoder_t = ntc::decoder<ntc::detail::c_packet_handler, ntc::detail::c
 using ntc_encoder_t = ntc::encoder<ntc::detail::c_packet_handler>;
 
 /*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The type of a recoder for C handlers.
+using ntc_recoder_t = ntc::recoder<ntc::detail::c_packet_handler>;
+
+/*------------------------------------------------------------------------------------------------*/
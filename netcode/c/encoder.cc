@@ -1,4 +1,7 @@
+#include <chrono>
+#include <limits> // numeric_limits
 #include <new> // nothrow
+#include <vector>
 
 #include "netcode/c/detail/check_error.hh"
 #include "netcode/c/encoder.h"
@@ -51,6 +54,58 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+bool
+ntc_encoder_generate_repair_range( ntc_encoder_t* enc, uint32_t first_id, uint32_t last_id
+                                 , ntc_error* error)
+noexcept
+{
+  return ntc::detail::check_error([&]{return enc->generate_repair(first_id, last_id);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+ntc_encoder_generate_repair_subset( ntc_encoder_t* enc, const uint32_t* ids, size_t nb_ids
+                                  , ntc_error* error)
+noexcept
+{
+  return ntc::detail::check_error
+    ( [&]{return enc->generate_repair(std::vector<std::uint32_t>(ids, ids + nb_ids));}
+    , error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+ntc_encoder_poll(ntc_encoder_t* enc, ntc_error* error)
+noexcept
+{
+  return ntc::detail::check_error([&]{return enc->poll();}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+size_t
+ntc_encoder_next_deadline(ntc_encoder_t* enc)
+noexcept
+{
+  const auto deadline = enc->next_deadline();
+  if (deadline == std::chrono::steady_clock::time_point::max())
+  {
+    return std::numeric_limits<size_t>::max();
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (deadline <= now)
+  {
+    return 0;
+  }
+  // Round up to not wake up before the deadline.
+  const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+  return static_cast<size_t>(ms.count()) + (deadline - now > ms ? 1 : 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 size_t
 ntc_encoder_window(ntc_encoder_t* enc)
 noexcept
@@ -69,6 +124,28 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+ntc_encoder_set_coefficients(ntc_encoder_t* enc, ntc_coefficients coefficients)
+noexcept
+{
+  switch (coefficients)
+  {
+    case ntc_coefficients_xorshift:
+      enc->set_coefficients(ntc::coefficient_generator::xorshift);
+      break;
+
+    case ntc_coefficients_cauchy:
+      enc->set_coefficients(ntc::coefficient_generator::cauchy);
+      break;
+
+    default:
+      enc->set_coefficients(ntc::coefficient_generator::arithmetic);
+      break;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 ntc_encoder_set_rate(ntc_encoder_t* enc, size_t rate)
 noexcept
@@ -87,6 +164,60 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+ntc_encoder_set_coding_window(ntc_encoder_t* enc, size_t size)
+noexcept
+{
+  enc->set_coding_window(size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_density(ntc_encoder_t* enc, double density)
+noexcept
+{
+  enc->set_density(density);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_max_window_bytes(ntc_encoder_t* enc, size_t nb)
+noexcept
+{
+  enc->set_max_window_bytes(nb);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_max_source_age(ntc_encoder_t* enc, size_t age)
+noexcept
+{
+  enc->set_max_source_age(std::chrono::milliseconds{age});
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+size_t
+ntc_encoder_nb_evicted_sources(ntc_encoder_t* enc)
+noexcept
+{
+  return enc->nb_evicted_sources();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_repair_period(ntc_encoder_t* enc, size_t period)
+noexcept
+{
+  enc->set_repair_period(std::chrono::milliseconds{period});
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 ntc_encoder_set_adaptive(ntc_encoder_t* enc, bool adaptive)
 noexcept
@@ -96,3 +227,39 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+ntc_encoder_set_on_demand_repairs(ntc_encoder_t* enc, bool on_demand)
+noexcept
+{
+  enc->set_on_demand_repairs(on_demand);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_fountain(ntc_encoder_t* enc, bool fountain)
+noexcept
+{
+  enc->set_fountain(fountain);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_encoder_set_block_code(ntc_encoder_t* enc, size_t k, size_t m, ntc_error* error)
+noexcept
+{
+  ntc::detail::check_error([&]{enc->set_block_code(k, m);}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+
+void
+ntc_encoder_set_session(ntc_encoder_t* enc, uint32_t session)
+noexcept
+{
+  enc->set_session(session);
+}
+
+/*------------------------------------------------------------------------------------------------*/
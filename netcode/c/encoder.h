@@ -28,10 +28,16 @@ typedef struct ntc_encoder_t ntc_encoder_t;
 /// @brief Describe if an encoder uses a systematic code or not
 typedef enum {ntc_systematic_yes, ntc_systematic_no} ntc_code_type;
 
+/// @ingroup c_encoder
+/// @brief Describe how the coefficients of repairs are generated
+typedef enum { ntc_coefficients_arithmetic, ntc_coefficients_xorshift
+             , ntc_coefficients_cauchy} ntc_coefficients;
+
 /*------------------------------------------------------------------------------------------------*/
 
 /// @ingroup c_encoder
 /// @return A new decoder if allocation suceeded; a null pointer otherwise
+/// @note @p galois_field_size is 4, 8, 16 or 32, or 1 for a binary (xor-only) code
 ntc_encoder_t*
 ntc_new_encoder(uint8_t galois_field_size, ntc_packet_handler handler)
 noexcept;
@@ -90,6 +96,60 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Force an encoder to generate a repair which encodes a range of data
+/// @param enc The encoder to force
+/// @param first_id The identifier of the first data to encode
+/// @param last_id The identifier of the last data to encode
+/// @param error The reported error, if any
+/// @return false if no data in [first_id, last_id] is still held by the encoder
+bool
+ntc_encoder_generate_repair_range( ntc_encoder_t* enc, uint32_t first_id, uint32_t last_id
+                                 , ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Force an encoder to generate a repair which encodes a subset of data
+/// @param enc The encoder to force
+/// @param ids The sorted identifiers of the data to encode
+/// @param nb_ids The number of identifiers in @p ids
+/// @param error The reported error, if any
+/// @return false if none of @p ids is still held by the encoder
+bool
+ntc_encoder_generate_repair_subset( ntc_encoder_t* enc, const uint32_t* ids, size_t nb_ids
+                                  , ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Generate a repair if the repair period has elapsed
+/// @param enc The encoder to poll
+/// @param error The reported error, if any
+/// @return true if a repair was generated
+/// @see ntc_encoder_set_repair_period
+bool
+ntc_encoder_poll(ntc_encoder_t* enc, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Get the number of milliseconds before ntc_encoder_poll should be called
+/// @param enc The encoder to query
+/// @return 0 if ntc_encoder_poll should be called now, SIZE_MAX if there is no need to call it
+size_t
+ntc_encoder_next_deadline(ntc_encoder_t* enc)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Get the current number of data an encoder still holds
 /// @param enc The encoder to query
@@ -113,6 +173,18 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Configure how the coefficients of repairs are generated
+/// @param enc The encoder to configure
+/// @param coefficients The generator of coefficients
+/// @note The default generator is ntc_coefficients_arithmetic
+void
+ntc_encoder_set_coefficients(ntc_encoder_t* enc, ntc_coefficients coefficients)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Configure the code rate of an encoder
 /// @param enc The encoder to configure
@@ -138,6 +210,76 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Configure the maximal number of data encoded by a repair
+/// @param enc The encoder to configure
+/// @param size The required maximal number of data
+/// @pre @p size > 0
+void
+ntc_encoder_set_coding_window(ntc_encoder_t* enc, size_t size)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the probability for a data to be encoded by a repair
+/// @param enc The encoder to configure
+/// @param density The required probability
+/// @pre 0 < @p density <= 1
+/// @note The default density is 1, that is all data are encoded by a repair
+void
+ntc_encoder_set_density(ntc_encoder_t* enc, double density)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the maximal number of bytes to keep before discarding oldest data
+/// @param enc The encoder to configure
+/// @param nb The required maximal number of bytes
+/// @pre @p nb > 0
+void
+ntc_encoder_set_max_window_bytes(ntc_encoder_t* enc, size_t nb)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the maximal age of data to keep before discarding them
+/// @param enc The encoder to configure
+/// @param age The required maximal age in milliseconds, if 0, deactivate this feature
+void
+ntc_encoder_set_max_source_age(ntc_encoder_t* enc, size_t age)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Get the number of data discarded by an encoder before being acknowledged
+/// @param enc The encoder to query
+size_t
+ntc_encoder_nb_evicted_sources(ntc_encoder_t* enc)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the maximal time a data can wait for a repair
+/// @param enc The encoder to configure
+/// @param period The requested period in milliseconds, if 0, deactivate this feature
+/// @note Repairs are generated by ntc_encoder_poll
+void
+ntc_encoder_set_repair_period(ntc_encoder_t* enc, size_t period)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @ingroup c_encoder
 /// @brief Configure the adaptive mode
 /// @param enc The encoder to configure
@@ -150,6 +292,58 @@ __attribute__((nonnull));
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @ingroup c_encoder
+/// @brief Configure if repairs are sent as soon as the decoder reports it needs some
+/// @param enc The encoder to configure
+/// @param on_demand Set to true if on-demand repairs are desired
+/// @note An encoder doesn't send on-demand repairs by default
+/// @see ntc_decoder_set_deficit_feedback
+void
+ntc_encoder_set_on_demand_repairs(ntc_encoder_t* enc, bool on_demand)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure if repairs are generated as the ones of a rateless (fountain) code
+/// @param enc The encoder to configure
+/// @param fountain Set to true to generate repairs as a fountain code
+/// @note An encoder doesn't use a fountain code by default
+void
+ntc_encoder_set_fountain(ntc_encoder_t* enc, bool fountain)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure an encoder to use a systematic block code rather than a sliding window
+/// @param enc The encoder to configure
+/// @param k The number of sources of a block, 0 to go back to the sliding window
+/// @param m The number of repairs sent for each block
+/// @param error The reported error, if any
+/// @note The Galois field size shall be 4, 8 or 16, and @p k and @p m shall not exceed 2^(w-1)
+/// @note The repairs of a pending block are sent first
+void
+ntc_encoder_set_block_code(ntc_encoder_t* enc, size_t k, size_t m, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_encoder
+/// @brief Configure the session identifier put at the end of all sent packets
+/// @param enc The encoder to configure
+/// @param session The identifier of the session this encoder belongs to
+/// @note Many flows can then share the same socket
+void
+ntc_encoder_set_session(ntc_encoder_t* enc, uint32_t session)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,62 @@
+#include <new> // nothrow
+
+#include "netcode/c/detail/check_error.hh"
+#include "netcode/c/recoder.h"
+#include "netcode/errors.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+ntc_recoder_t*
+ntc_new_recoder(uint8_t galois_field_size, ntc_packet_handler packet_handler, uint16_t node_id)
+noexcept
+{
+  return new (std::nothrow) ntc_recoder_t{ galois_field_size
+                                         , ntc::detail::c_packet_handler{packet_handler}, node_id};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_delete_recoder(ntc_recoder_t* rec)
+noexcept
+{
+  delete rec;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+size_t
+ntc_recoder_add_packet(ntc_recoder_t* rec, ntc_packet_t* packet, ntc_error* error)
+noexcept
+{
+  return ntc::detail::check_error([&]{return (*rec)(std::move(*packet));}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+ntc_recoder_generate_repair(ntc_recoder_t* rec, ntc_error* error)
+noexcept
+{
+  return ntc::detail::check_error([&]{return rec->generate_repair();}, error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_recoder_set_window_size(ntc_recoder_t* rec, size_t size)
+noexcept
+{
+  rec->set_window_size(size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+ntc_recoder_set_session(ntc_recoder_t* rec, uint32_t session)
+noexcept
+{
+  rec->set_session(session);
+}
+
+/*------------------------------------------------------------------------------------------------*/
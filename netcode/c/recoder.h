@@ -0,0 +1,98 @@
+#pragma once
+
+#ifdef __cplusplus
+#include "netcode/c/detail/types.hh"
+#endif
+
+#include "netcode/c/detail/noexcept.hh"
+#include "netcode/c/error.h"
+#include "netcode/c/handlers.h"
+#include "netcode/c/packet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifndef __cplusplus
+/// @brief The type of a recoder
+/// @ingroup c_recoder
+typedef struct ntc_recoder_t ntc_recoder_t;
+#endif
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_recoder
+/// @return A new recoder if allocation suceeded; a null pointer otherwise
+/// @note @p galois_field_size is 4, 8 or 16, or 1 for a binary (xor-only) code
+/// @note @p node_id is lower than 32768, and different for all recoders whose repairs might reach
+/// the same decoder
+ntc_recoder_t*
+ntc_new_recoder(uint8_t galois_field_size, ntc_packet_handler packet_handler, uint16_t node_id)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_recoder
+/// @brief Release the memory of a recoder
+/// @param rec The recoder to delete
+void
+ntc_delete_recoder(ntc_recoder_t* rec)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_recoder
+/// @brief Notify a recoder with a new incoming packet
+/// @param rec The recoder to notify
+/// @param packet The incoming packet
+/// @param error The reported error, if any
+/// @return The number of read bytes from packet
+/// @note The returned value is invalid if an error occurred
+/// @post @p packet is invalid
+/// @note It's possible to put @p packet back in an usable state by calling ntc_packet_resize()
+size_t
+ntc_recoder_add_packet(ntc_recoder_t* rec, ntc_packet_t* packet, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_recoder
+/// @brief Force a recoder to send a new repair
+/// @param rec The recoder to force
+/// @param error The reported error, if any
+/// @return false if the recoder holds nothing to recode
+bool
+ntc_recoder_generate_repair(ntc_recoder_t* rec, ntc_error* error)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_recoder
+/// @brief Configure the maximal number of sources, and of repairs, a recoder buffers
+/// @pre @p size > 0
+void
+ntc_recoder_set_window_size(ntc_recoder_t* rec, size_t size)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @ingroup c_recoder
+/// @brief Configure the session identifier put at the end of all recoded repairs
+/// @param rec The recoder to configure
+/// @param session The identifier of the session of the encoder whose packets are recoded
+void
+ntc_recoder_set_session(ntc_recoder_t* rec, uint32_t session)
+noexcept
+__attribute__((nonnull));
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Describe how the coefficients of repairs are generated
+/// @see encoder::set_coefficients
+/// @ingroup ntc_encoder
+///
+/// The generator used by a repair is carried by the repair itself, thus a decoder can receive
+/// repairs from encoders using different generators.
+/// @note With a 32 bits Galois field, coefficients are always generated with
+/// coefficient_generator::arithmetic.
+enum class coefficient_generator : std::uint8_t
+{
+  /// @brief A cheap arithmetic formula of the identifiers of the repair and of the source
+  ///
+  /// It's the default generator. It might produce singular matrices, in which case a decoder has
+  /// to drop a repair.
+  arithmetic = 0,
+
+  /// @brief A xorshift pseudo-random generator seeded by the identifiers of the repair and of the
+  /// source
+  xorshift = 1,
+
+  /// @brief A Cauchy matrix
+  ///
+  /// Any square matrix of such coefficients can be inverted, as long as the identifiers of the
+  /// repairs and of the sources it contains span less than 2^(w-1) values, w being the size of the
+  /// Galois field.
+  cauchy = 2,
+
+  /// @brief A Cauchy matrix which only depends on the position of repairs and sources in a block
+  ///
+  /// It's used by the block code (see encoder::set_block_code): all blocks share the same matrix,
+  /// thus a decoder can re-use the inverse computed for a previous block which lost the same
+  /// sources and repairs.
+  block = 3,
+
+  /// @brief Coefficients carried by the repair itself, one for each source it encodes
+  ///
+  /// It's used by repairs generated by a recoder, which are linear combinations of other sources
+  /// and repairs.
+  recoded = 4,
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -6,6 +6,12 @@
 #endif
 
 #include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory> // shared_ptr
+#include <vector>
+
+#include <boost/optional.hpp>
 
 #include "netcode/detail/decoder.hh"
 #include "netcode/detail/packet_type.hh"
@@ -15,6 +21,7 @@
 #include "netcode/detail/visibility.hh"
 #include "netcode/errors.hh"
 #include "netcode/in_order.hh"
+#include "netcode/parallel_executor.hh"
 
 namespace ntc {
 
@@ -48,6 +55,8 @@ public:
   decoder& operator=(decoder&&) = delete;
 
   /// @brief Constructor.
+  /// @note @p galois_field_size is 4, 8, 16 or 32, or 1 for a binary code; it must be the same as
+  /// the encoder's one.
   template <typename PacketHandler_, typename DataHandler_>
   decoder( std::uint8_t galois_field_size, in_order ordered, PacketHandler_&& packet_handler
          , DataHandler_&& data_handler)
@@ -55,6 +64,7 @@ public:
     , m_ack_period{std::chrono::milliseconds{100}}
     , m_ack_nb_packets{50}
     , m_last_ack_date(std::chrono::steady_clock::now())
+    , m_deficit_feedback{false}
     , m_ack{}
     , m_decoder{ m_galois_field_size
                  // The real decoder needs to know how to handle decoded or received sources.
@@ -62,7 +72,8 @@ public:
                , ordered}
     , m_packet_handler(std::forward<PacketHandler_>(packet_handler))
     , m_data_handler(std::forward<DataHandler_>(data_handler))
-    , m_packetizer{m_packet_handler}
+    , m_packetizer{m_packet_handler, galois_field_size}
+    , m_path_counts{}
     , m_nb_received_repairs{0}
     , m_nb_received_sources{0}
     , m_nb_sent_ack{0}
@@ -121,6 +132,39 @@ public:
     }
   }
 
+  /// @brief Notify the decoder of an incoming packet received on one of several paths
+  /// @param p The incoming packet
+  /// @param path The index of the path @p p was received on
+  /// @pre @p path < 255
+  ///
+  /// Packets of all paths are merged into this decoder. Acks then also carry the number of packets
+  /// received on each path, from which a multipath_encoder learns the losses of each path.
+  std::size_t
+  operator()(const packet& p, std::size_t path)
+  {
+    return operator()(packet{p}, path);
+  }
+
+  /// @brief Notify the decoder of an incoming packet received on one of several paths
+  /// @param p The incoming packet
+  /// @param path The index of the path @p p was received on
+  /// @pre @p path < 255
+  std::size_t
+  operator()(packet&& p, std::size_t path)
+  {
+    assert(path < std::numeric_limits<std::uint8_t>::max());
+    if (path >= m_path_counts.size())
+    {
+      m_path_counts.resize(path + 1, 0);
+    }
+    // Count it before an ack is possibly sent while processing it.
+    if (detail::get_packet_type(p) != detail::packet_type::ack)
+    {
+      ++m_path_counts[path];
+    }
+    return operator()(std::move(p));
+  }
+
   /// @brief Get the data handler.
   const packet_handler_type&
   packet_handler()
@@ -219,6 +263,15 @@ public:
       m_ack.source_ids().insert(m_ack.source_ids().end(), id_src.first);
     }
 
+    // Tell the encoder how many packets were received on each path.
+    m_ack.path_counts().assign(m_path_counts.begin(), m_path_counts.end());
+
+    // Tell the encoder how many repairs are still needed.
+    if (m_deficit_feedback)
+    {
+      m_decoder.deficits(m_ack.deficits());
+    }
+
     // Ask packetizer to handle the bytes of the new ack (will be routed to user's handler).
     m_packetizer.write_ack(m_ack);
     ++m_nb_sent_ack;
@@ -286,6 +339,92 @@ public:
     return m_ack_nb_packets;
   }
 
+  /// @brief Set if acks report how many repairs are still needed to rebuild lost sources.
+  ///
+  /// For each cluster of lost sources, an ack will carry the number of missing sources minus the
+  /// number of usable repairs. An encoder with on-demand repairs (see
+  /// encoder::set_on_demand_repairs) will then send exactly this number of repairs.
+  decoder&
+  set_deficit_feedback(bool feedback)
+  noexcept
+  {
+    m_deficit_feedback = feedback;
+    return *this;
+  }
+
+  /// @brief Get if acks report how many repairs are still needed to rebuild lost sources.
+  bool
+  deficit_feedback()
+  const noexcept
+  {
+    return m_deficit_feedback;
+  }
+
+  /// @brief Set the session identifier to put in all sent acks
+  /// @see encoder::set_session
+  decoder&
+  set_session(std::uint32_t id)
+  noexcept
+  {
+    m_packetizer.set_session(id);
+    return *this;
+  }
+
+  /// @brief Get the session identifier put in all sent acks, if any
+  boost::optional<std::uint32_t>
+  session()
+  const noexcept
+  {
+    return m_packetizer.session();
+  }
+
+  /// @brief Set the executor which splits the decoding of large symbols
+  /// @param executor Can be shared with other encoders and decoders, or a null pointer to decode
+  /// on a single thread.
+  ///
+  /// With jumbo symbols, each decoded source is computed stripe by stripe on the threads of the
+  /// executor, as well as the removal of received sources from repairs. Large systems are also
+  /// solved on these threads.
+  /// @see parallel_executor
+  /// @see set_parallel_dimension
+  decoder&
+  set_parallel_executor(std::shared_ptr<ntc::parallel_executor> executor)
+  noexcept
+  {
+    m_decoder.set_executor(std::move(executor));
+    return *this;
+  }
+
+  /// @brief Get the executor which splits the decoding of large symbols, if any
+  const std::shared_ptr<ntc::parallel_executor>&
+  parallel_executor()
+  const noexcept
+  {
+    return m_decoder.executor();
+  }
+
+  /// @brief Set the minimal number of sources decoded together to solve them with the executor
+  ///
+  /// After a long outage, hundreds of sources might have to be decoded at once. When there are at
+  /// least @p dimension of them, both the inversion of the matrix of coefficients and the decoding
+  /// of symbols are shared between the threads of the executor set by set_parallel_executor. The
+  /// default is 64.
+  decoder&
+  set_parallel_dimension(std::size_t dimension)
+  noexcept
+  {
+    m_decoder.set_parallel_dimension(dimension);
+    return *this;
+  }
+
+  /// @brief Get the minimal number of sources decoded together to solve them with the executor
+  std::size_t
+  parallel_dimension()
+  const noexcept
+  {
+    return m_decoder.parallel_dimension();
+  }
+
 private:
 
   /// @brief Callback given to the real encoder to be notified when a source is processed.
@@ -313,6 +452,9 @@ private:
   /// @brief The last time an ack was sent.
   std::chrono::steady_clock::time_point m_last_ack_date;
 
+  /// @brief Tell if acks report how many repairs are still needed.
+  bool m_deficit_feedback;
+
   /// @brief Re-use the same memory to prepare an ack packet.
   detail::ack m_ack;
 
@@ -328,6 +470,9 @@ private:
   /// @brief How to read and write packets.
   detail::packetizer<packet_handler_type> m_packetizer;
 
+  /// @brief The number of packets received on each path.
+  std::vector<std::uint32_t> m_path_counts;
+
   /// @brief The counter of received repairs.
   std::size_t m_nb_received_repairs;
 
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
+#include "netcode/detail/deficit.hh"
 #include "netcode/detail/source_id_list.hh"
 
 namespace ntc { namespace detail {
@@ -28,12 +32,24 @@ public:
   ack()
     : m_source_ids{}
     , m_nb_packets{0}
+    , m_deficits{}
+    , m_path_counts{}
   {}
 
   /// @brief Constructor.
   explicit ack(source_id_list&& source_ids, std::uint16_t nb_packets)
     : m_source_ids{std::move(source_ids)}
     , m_nb_packets{nb_packets}
+    , m_deficits{}
+    , m_path_counts{}
+  {}
+
+  /// @brief Constructor.
+  ack(source_id_list&& source_ids, std::uint16_t nb_packets, std::vector<deficit>&& deficits)
+    : m_source_ids{std::move(source_ids)}
+    , m_nb_packets{nb_packets}
+    , m_deficits{std::move(deficits)}
+    , m_path_counts{}
   {}
 
   /// @brief Get the list of acknowledged sources.
@@ -61,6 +77,8 @@ public:
   {
     m_source_ids.clear();
     m_nb_packets = 0;
+    m_deficits.clear();
+    m_path_counts.clear();
   }
 
   /// @brief Get the number of packets received by the decoder since the last ack.
@@ -79,6 +97,38 @@ public:
     return m_nb_packets;
   }
 
+  /// @brief Get the repairs still needed by the decoder, per cluster of lost sources.
+  const std::vector<deficit>&
+  deficits()
+  const noexcept
+  {
+    return m_deficits;
+  }
+
+  /// @brief Get the repairs still needed by the decoder, per cluster of lost sources.
+  std::vector<deficit>&
+  deficits()
+  noexcept
+  {
+    return m_deficits;
+  }
+
+  /// @brief Get the number of packets received by the decoder on each path since its creation.
+  const std::vector<std::uint32_t>&
+  path_counts()
+  const noexcept
+  {
+    return m_path_counts;
+  }
+
+  /// @brief Get the number of packets received by the decoder on each path since its creation.
+  std::vector<std::uint32_t>&
+  path_counts()
+  noexcept
+  {
+    return m_path_counts;
+  }
+
 private:
 
   /// @brief The list of acknowledged sources.
@@ -86,6 +136,12 @@ private:
 
   /// @brief The number of received packet since the last ack.
   std::uint16_t m_nb_packets;
+
+  /// @brief The repairs still needed by the decoder, empty if not reported.
+  std::vector<deficit> m_deficits;
+
+  /// @brief The number of packets received on each path, empty if the decoder is not told paths.
+  std::vector<std::uint32_t> m_path_counts;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The size of a cache line on common architectures.
+static constexpr std::size_t cache_line_size = 64;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Bytes which keep the members written by a thread away from the ones of another thread.
+///
+/// Unlike alignas, it works with objects allocated on the heap, as C++11 doesn't honor extended
+/// alignments there.
+struct cache_line_pad
+{
+  char bytes[cache_line_size];
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
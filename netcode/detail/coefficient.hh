@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm> // lower_bound
+#include <cassert>
+#include <cstdint>
+
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/coefficient_generator.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Get the coefficient used by a repair to encode a source.
+/// @tparam Repair Either encoder_repair or decoder_repair.
+///
+/// The coefficients of a block code depend on the position of the repair in its block and on the
+/// position of the source from the start of the block, which is the repair's window start. The
+/// coefficients of a recoded repair are carried by the repair.
+template <typename Repair>
+std::uint32_t
+coefficient(galois_field& gf, const Repair& r, std::uint32_t src_id)
+noexcept
+{
+  switch (r.generator())
+  {
+    case coefficient_generator::block:
+    {
+      return gf.coefficient(r.generator(), r.block_row(), src_id - r.window_start());
+    }
+
+    case coefficient_generator::recoded:
+    {
+      const auto search = std::lower_bound( r.coefficients().begin(), r.coefficients().end()
+                                          , src_id
+                                          , [](const coefficients_type::value_type& c
+                                              , std::uint32_t id)
+                                            {
+                                              return c.first < id;
+                                            });
+      assert(search != r.coefficients().end() and search->first == src_id);
+      return search->second;
+    }
+
+    default:
+    {
+      return gf.coefficient(r.generator(), r.id(), src_id);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
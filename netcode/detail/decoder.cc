@@ -1,7 +1,9 @@
-#include <algorithm>  // all_of
+#include <algorithm>  // all_of, max, min, sort
 #include <cassert>
+#include <limits>
 #include <vector>
 
+#include "netcode/detail/coefficient.hh"
 #include "netcode/detail/decoder.hh"
 #include "netcode/detail/invert_matrix.hh"
 
@@ -23,9 +25,15 @@ decoder::decoder( std::uint8_t galois_field_size, std::function<void(const decod
   , m_nb_useless_repairs{0}
   , m_nb_failed_full_decodings{0}
   , m_nb_decoded{0}
-  , m_coefficients{32}
-  , m_inv{32}
+  , m_coefficients{0}
+  , m_inv{0}
   , m_index()
+  , m_inverses()
+  , m_inverse_key()
+  , m_nb_cached_inverses_hits{0}
+  , m_parallel_dimension{default_parallel_dimension}
+  , m_decoded{}
+  , m_terms{}
 {}
 
 /*------------------------------------------------------------------------------------------------*/
@@ -69,10 +77,9 @@ decoder::operator()(decoder_repair&& incoming_r)
     return;
   }
 
-  // Remove sources with an id strictly less than the smallest the current repair encodes.
-  // Remove repairs which encodes sources with an id smaller than the smallest the current repair
-  // encodes.
-  drop_outdated(*incoming_r.source_ids().begin());
+  // Remove sources with an id strictly less than the oldest source still held by the encoder.
+  // Remove repairs which encodes sources with an id smaller than this oldest source.
+  drop_outdated(incoming_r.window_start());
 
   // Check if incoming_r is useless. Indeed, if all sources it references were correctly
   // received, then it's useless to remove them from this repair, which is a costly operation.
@@ -136,10 +143,9 @@ decoder::operator()(decoder_repair&& incoming_r)
     // Create missing source.
     auto src = create_source_from_repair(r);
 
-    // Source is no longer missing.
-    m_missing_sources.erase(src.id());
-
-    // This repair is no longer needed.
+    // This repair is no longer needed. Other repairs which encode the decoded source are still
+    // linked to it, add_source_recursive() will remove it from them.
+    m_missing_sources[src.id()].erase(r_cit);
     m_repairs.erase(r_cit);
 
     // This newly decode source might trigger the decoding of several other sources.
@@ -161,7 +167,7 @@ noexcept
   const auto src_id = *r.source_ids().begin();
 
   // The inverse of the coefficient which was used to encode the missing source.
-  const auto inv = m_gf.invert(m_gf.coefficient(r.id(), src_id));
+  const auto inv = m_gf.invert(coefficient(m_gf, r, src_id));
 
   // Reconstruct size.
   const auto src_sz = m_gf.multiply_size(r.encoded_size(), inv);
@@ -237,6 +243,15 @@ const noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+std::size_t
+decoder::nb_cached_inverses_hits()
+const noexcept
+{
+  return m_nb_cached_inverses_hits;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 std::size_t
 decoder::nb_decoded()
 const noexcept
@@ -246,6 +261,104 @@ const noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+void
+decoder::deficits(std::vector<deficit>& res)
+const
+{
+  res.clear();
+
+  if (m_sources.empty() and m_missing_sources.empty())
+  {
+    return;
+  }
+
+  // Bounds of the range of sources which could still be rebuilt.
+  const auto lower = m_last_id
+                   ? *m_last_id
+                   : m_sources.empty()
+                   ? m_missing_sources.begin()->first
+                   : m_missing_sources.empty()
+                   ? m_sources.begin()->first
+                   : std::min(m_sources.begin()->first, m_missing_sources.begin()->first);
+  const auto upper = m_sources.empty()
+                   ? m_missing_sources.rbegin()->first
+                   : m_missing_sources.empty()
+                   ? m_sources.rbegin()->first
+                   : std::max(m_sources.rbegin()->first, m_missing_sources.rbegin()->first);
+
+  // A range of identifiers with the number of lost sources and of repairs it contains.
+  struct cluster
+  {
+    std::uint32_t first_id;
+    std::uint32_t last_id;
+    std::uint32_t nb_lost;
+    std::uint32_t nb_repairs;
+  };
+  auto clusters = std::vector<cluster>{};
+
+  // Holes between received sources.
+  auto expected = lower;
+  for (const auto& id_src : m_sources)
+  {
+    if (id_src.first > expected)
+    {
+      clusters.push_back(cluster{expected, id_src.first - 1, id_src.first - expected, 0});
+    }
+    expected = id_src.first + 1;
+  }
+  if (m_sources.empty() or m_sources.rbegin()->first < upper)
+  {
+    // Missing sources referenced by repairs after the last received source.
+    clusters.push_back(cluster{expected, upper, upper - expected + 1, 0});
+  }
+
+  if (clusters.empty())
+  {
+    // No hole, thus no repair.
+    return;
+  }
+
+  // Repairs only reference missing sources, they link the holes they span.
+  for (const auto& id_repair : m_repairs)
+  {
+    const auto& ids = id_repair.second.source_ids();
+    clusters.push_back(cluster{*ids.begin(), *ids.rbegin(), 0, 1});
+  }
+
+  std::sort( clusters.begin(), clusters.end()
+           , [](const cluster& lhs, const cluster& rhs){return lhs.first_id < rhs.first_id;});
+
+  const auto flush = [&](const cluster& c)
+  {
+    if (c.nb_lost > c.nb_repairs)
+    {
+      const auto max = static_cast<std::uint32_t>(std::numeric_limits<std::uint16_t>::max());
+      const auto nb = std::min(c.nb_lost - c.nb_repairs, max);
+      res.push_back(deficit{c.first_id, c.last_id, static_cast<std::uint16_t>(nb)});
+    }
+  };
+
+  // Merge overlapping ranges.
+  auto current = clusters.front();
+  for (auto cit = std::next(clusters.begin()), end = clusters.end(); cit != end; ++cit)
+  {
+    if (cit->first_id <= current.last_id)
+    {
+      current.last_id = std::max(current.last_id, cit->last_id);
+      current.nb_lost += cit->nb_lost;
+      current.nb_repairs += cit->nb_repairs;
+    }
+    else
+    {
+      flush(current);
+      current = *cit;
+    }
+  }
+  flush(current);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
 decoder::add_source_recursive(decoder_source&& src)
 {
@@ -329,7 +442,14 @@ decoder::add_source_recursive(decoder_source&& src)
   const auto insertion = m_sources.emplace(src_id, std::move(src));
   assert(insertion.second && "source already added");
 
-  if (m_in_order and insertion.first->second.id() > m_first_missing_source_in_order)
+  if (m_in_order and insertion.first->second.id() == m_first_missing_source_in_order)
+  {
+    // The older sources this one was waiting for were decoded by the recursion.
+    m_callback(insertion.first->second);
+    m_first_missing_source_in_order += 1;
+    flush_ordered_sources();
+  }
+  else if (m_in_order and insertion.first->second.id() > m_first_missing_source_in_order)
   {
     // We can't send the current source as there are some older sources which have not been sent.
     m_ordered_sources.emplace(insertion.first->second.id(), &insertion.first->second);
@@ -397,7 +517,7 @@ noexcept
   assert(r.source_ids().size() > 1 && "Repair encodes only one source");
   assert(src.symbol_size() <= r.symbol_size());
 
-  const auto coeff = m_gf.coefficient(r.id(), src.id());
+  const auto coeff = coefficient(m_gf, r, src.id());
 
   // Remove source size.
   r.encoded_size()
@@ -417,70 +537,148 @@ decoder::attempt_full_decoding()
     return;
   }
 
-  // Do we have enough repairs to try to decode missing sources?
-  if (m_missing_sources.size() > m_repairs.size())
+  // Sort repairs by the first source they reference.
+  m_index.clear();
+  m_index.reserve(m_repairs.size());
+  for (auto r_cit = m_repairs.begin(), r_end = m_repairs.end(); r_cit != r_end; ++r_cit)
   {
-    return;
+    m_index.emplace_back(r_cit);
   }
+  std::sort( m_index.begin(), m_index.end()
+           , [](repairs_set_type::iterator lhs, repairs_set_type::iterator rhs)
+             {
+               return *lhs->second.source_ids().begin() < *rhs->second.source_ids().begin();
+             });
+
+  // Look for groups of repairs referencing overlapping ranges of sources. As a missing source
+  // always belongs to the range of the repairs which reference it, such groups are independent.
+  for (auto group_begin = m_index.begin(), index_end = m_index.end(); group_begin != index_end;)
+  {
+    const auto first_id = *(*group_begin)->second.source_ids().begin();
+    auto last_id = *(*group_begin)->second.source_ids().rbegin();
+    auto group_end = std::next(group_begin);
+    for (; group_end != index_end and *(*group_end)->second.source_ids().begin() <= last_id
+         ; ++group_end)
+    {
+      last_id = std::max(last_id, *(*group_end)->second.source_ids().rbegin());
+    }
+
+    // Do we have enough repairs to try to decode the missing sources of this group?
+    const auto miss_begin = m_missing_sources.lower_bound(first_id);
+    const auto miss_end = m_missing_sources.upper_bound(last_id);
+    if (std::distance(miss_begin, miss_end) == std::distance(group_begin, group_end))
+    {
+      decode_group(group_begin, group_end, miss_begin, miss_end);
+    }
+
+    group_begin = group_end;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decoder::decode_group( repairs_index_type::iterator r_begin, repairs_index_type::iterator r_end
+                     , missing_sources_type::iterator miss_begin
+                     , missing_sources_type::iterator miss_end)
+{
+  const auto nb_repairs = static_cast<std::size_t>(std::distance(r_begin, r_end));
+  assert(nb_repairs > 1 && "Trying to create a matrix for only one missing source.");
 
-  assert(m_missing_sources.size() == m_repairs.size() && "More repairs than missing sources");
-  assert(m_missing_sources.size() > 1 && "Trying to create a matrix for only one missing source.");
+  // Large systems are solved on the threads of the executor, if any.
+  const auto parallel = m_gf.executor() and nb_repairs >= m_parallel_dimension;
 
   // Build coefficient matrix.
-  m_coefficients.resize(m_repairs.size());
+  m_coefficients.resize(nb_repairs);
   auto col = 0ul;
-  for (const auto& r : m_repairs)
+  for (auto r_cit = r_begin; r_cit != r_end; ++r_cit)
   {
+    const auto& r = (*r_cit)->second;
     auto row = 0ul;
-    for (const auto& missing : m_missing_sources)
+    for (auto miss_cit = miss_begin; miss_cit != miss_end; ++miss_cit)
     {
-      m_coefficients(row, col) = r.second.source_ids().count(missing.first)
-                               ? m_gf.coefficient(r.first, missing.first)
+      m_coefficients(row, col) = r.source_ids().count(miss_cit->first)
+                               ? coefficient(m_gf, r, miss_cit->first)
                                : 0u; // repair doesn't encode the missing source.
       ++row;
     }
     ++col;
   }
 
-  // Invert it.
-  m_inv.resize(m_coefficients.dimension());
-  const auto r_col = invert(m_gf, m_coefficients, m_inv);
+  // The matrices of a block code only depend on the positions of lost sources and of received
+  // repairs in their block, thus the same inverse can be used for several blocks.
+  const auto cacheable = std::all_of( r_begin, r_end
+                                    , [](repairs_set_type::iterator r)
+                                      {
+                                        return r->second.generator()
+                                            == coefficient_generator::block;
+                                      });
+  auto cached = m_inverses.end();
+  if (cacheable)
+  {
+    m_inverse_key.assign(m_coefficients.column(0), m_coefficients.column(nb_repairs));
+    cached = m_inverses.find(m_inverse_key);
+  }
+
+  // Invert it, unless it was already done.
+  auto r_col = boost::optional<std::size_t>{};
+  if (cached != m_inverses.end())
+  {
+    m_inv = cached->second;
+    m_nb_cached_inverses_hits += 1;
+  }
+  else
+  {
+    m_inv.resize(m_coefficients.dimension());
+    r_col = parallel ? invert(m_gf, m_coefficients, m_inv, *m_gf.executor())
+                     : invert(m_gf, m_coefficients, m_inv);
+    if (cacheable and not r_col)
+    {
+      if (m_inverses.size() == max_cached_inverses)
+      {
+        m_inverses.clear();
+      }
+      m_inverses.emplace(m_inverse_key, m_inv);
+    }
+  }
+
   if (r_col)
   {
     // Inversion failed, remove the faulty repair.
     m_nb_failed_full_decodings += 1;
 
     // Find the repair corresponding to r_col.
-    auto r_cit = m_repairs.begin();
     // To avoid a conversion warning with clang's -Wconversion.
-    using difference_type = std::iterator_traits<decltype(r_cit)>::difference_type;
-    std::advance(r_cit, static_cast<difference_type>(*r_col));
+    using difference_type = std::iterator_traits<repairs_index_type::iterator>::difference_type;
+    const auto faulty = *std::next(r_begin, static_cast<difference_type>(*r_col));
 
     // Remove repair from missing sources that reference it.
-    for (const auto src : r_cit->second.source_ids())
+    for (const auto src : faulty->second.source_ids())
     {
-      m_missing_sources[src].erase(r_cit);
+      m_missing_sources[src].erase(faulty);
     }
 
     // We can now effectively remove the repair.
-    m_repairs.erase(r_cit);
+    m_repairs.erase(faulty);
     return;
   }
 
   // Matrix successfully inverted, we can now decode missing sources. Phew!
 
-  // Build an index for fast retrieving of repairs from the inverted matrix.
-  m_index.clear();
-  m_index.reserve(m_repairs.size());
-  for (auto& rid_repair : m_repairs)
+  // For fast retrieving of repairs from the inverted matrix.
+  const auto group = &*r_begin;
+
+  // First, decode the sizes of all sources and find which repairs they are made of.
+  const auto nb_sources = static_cast<std::size_t>(std::distance(miss_begin, miss_end));
+  m_decoded.clear();
+  m_decoded.reserve(nb_sources);
+  if (m_terms.size() < nb_sources)
   {
-    m_index.emplace_back(&rid_repair.second);
+    m_terms.resize(nb_sources);
   }
-
   auto src_col = 0u;
-  for (const auto& miss : m_missing_sources)
+  for (auto miss_cit = miss_begin; miss_cit != miss_end; ++miss_cit)
   {
-    // First, decode the size of the source.
     const auto src_sz = [&,this]
     {
       auto res = std::uint16_t{0};
@@ -489,53 +687,63 @@ decoder::attempt_full_decoding()
         const auto coeff = m_inv(repair_row, src_col);
         if (coeff != 0)
         {
-          const auto tmp = m_gf.multiply_size(m_index[repair_row]->encoded_size(), coeff);
+          const auto tmp = m_gf.multiply_size(group[repair_row]->second.encoded_size(), coeff);
           res = static_cast<std::uint16_t>(tmp) ^ res;
         }
       }
       return res;
     }();
 
-    // Now, decode symbol.
     // When sources are directly received from the network, they are constructed in a such way that
     // there is a padding before the symbol and the headers (to avoid copy). Here, we have to
     // construct the source in the same way.
-    auto src = decoder_source{ miss.first, packet( src_sz + packet::alignment
-                                                 , 0 /* zero out the buffer */)
-                             , src_sz};
-    auto repair_row = 0ul;
-    auto coeff = 0u;
-
-    // Find first non-zero coefficient.
-    for (; repair_row < repairs().size(); ++repair_row)
-    {
-      coeff = m_inv(repair_row, src_col);
-      if (coeff != 0)
-      {
-        break;
-      }
-    }
-    assert(repair_row != m_repairs.size() && "No coefficients for missing source");
+    m_decoded.emplace_back( miss_cit->first, packet( src_sz + packet::alignment
+                                                   , 0 /* zero out the buffer */)
+                          , src_sz);
 
     // Repair's buffer might be smaller than the size of the source to decode, or it could be
     // the opposite situation. Thus, we need to make sure that we only read the right number of
     // bytes.
-    auto sz = std::min(src_sz, static_cast<std::uint16_t>(m_index[repair_row]->symbol_size()));
-    m_gf.multiply(m_index[repair_row]->symbol(), src.symbol(), sz, coeff);
-
-    for (++repair_row; repair_row < m_inv.dimension(); ++repair_row)
+    auto& terms = m_terms[src_col];
+    terms.clear();
+    for (auto repair_row = 0ul; repair_row < m_inv.dimension(); ++repair_row)
     {
-      coeff = m_inv(repair_row, src_col);
+      const auto coeff = m_inv(repair_row, src_col);
       if (coeff != 0)
       {
-        sz = std::min(src_sz, static_cast<std::uint16_t>(m_index[repair_row]->symbol_size()));
-        m_gf.multiply_add(m_index[repair_row]->symbol(), src.symbol(), sz, coeff);
+        const auto& r = group[repair_row]->second;
+        const auto sz = std::min(src_sz, static_cast<std::uint16_t>(r.symbol_size()));
+        terms.push_back(region_term{r.symbol(), sz, coeff});
       }
     }
+    assert(not terms.empty() && "No coefficients for missing source");
     ++src_col;
+  }
+
+  // Now, decode symbols, all repairs of a source are summed in a single pass. Sources are
+  // independent, thus large groups are decoded on the threads of the executor.
+  const auto decode_symbol = [this](std::size_t i)
+  {
+    auto& src = m_decoded[i];
+    m_gf.combine(m_terms[i], src.symbol(), src.symbol_size());
+  };
+  if (parallel)
+  {
+    m_gf.executor()->for_each(nb_sources, decode_symbol);
+  }
+  else
+  {
+    for (auto i = 0ul; i < nb_sources; ++i)
+    {
+      decode_symbol(i);
+    }
+  }
 
+  for (auto& src : m_decoded)
+  {
     // Source decoded, add it to the set of known sources.
-    const auto insertion = m_sources.emplace(miss.first, std::move(src));
+    const auto id = src.id();
+    const auto insertion = m_sources.emplace(id, std::move(src));
     assert(insertion.second && "source already added");
 
     const auto& inserted_src = insertion.first->second;
@@ -558,11 +766,15 @@ decoder::attempt_full_decoding()
     }
   }
 
-  m_nb_decoded += m_missing_sources.size();
+  m_decoded.clear();
+  m_nb_decoded += nb_repairs;
 
   // Cleanup.
-  m_repairs.clear();
-  m_missing_sources.clear();
+  for (auto r_cit = r_begin; r_cit != r_end; ++r_cit)
+  {
+    m_repairs.erase(*r_cit);
+  }
+  m_missing_sources.erase(miss_begin, miss_end);
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -6,6 +6,7 @@
 #include <boost/container/map.hpp>
 #include <boost/optional.hpp>
 
+#include "netcode/detail/deficit.hh"
 #include "netcode/detail/galois_field.hh"
 #include "netcode/detail/repair.hh"
 #include "netcode/detail/source.hh"
@@ -52,12 +53,61 @@ public:
   /// contain them.
   using missing_sources_type = boost::container::map<std::uint32_t, repairs_iterators_type>;
 
+private:
+
+  /// @brief Type of a container of repair iterators.
+  using repairs_index_type = std::vector<repairs_set_type::iterator>;
+
+  /// @brief Type of a cache of inverted matrices, indexed by the coefficients of the matrices.
+  using inverses_type = boost::container::map<std::vector<std::uint32_t>, square_matrix>;
+
+  /// @brief The maximal number of inverted matrices to keep.
+  static constexpr std::size_t max_cached_inverses = 64;
+
+public:
+
+  /// @brief The default minimal number of sources decoded together to solve them on several
+  /// threads.
+  static constexpr std::size_t default_parallel_dimension = 64;
+
 public:
 
   /// @brief Constructor.
   decoder( std::uint8_t galois_field_size, std::function<void(const decoder_source&)> h
          , in_order order);
 
+  /// @brief Set the executor which splits the symbols of large sources and repairs.
+  void
+  set_executor(std::shared_ptr<parallel_executor> executor)
+  noexcept
+  {
+    m_gf.set_executor(std::move(executor));
+  }
+
+  /// @brief Get the executor which splits the symbols of large sources and repairs, if any.
+  const std::shared_ptr<parallel_executor>&
+  executor()
+  const noexcept
+  {
+    return m_gf.executor();
+  }
+
+  /// @brief Set the minimal number of sources decoded together to solve them with the executor.
+  void
+  set_parallel_dimension(std::size_t dimension)
+  noexcept
+  {
+    m_parallel_dimension = dimension;
+  }
+
+  /// @brief Get the minimal number of sources decoded together to solve them with the executor.
+  std::size_t
+  parallel_dimension()
+  const noexcept
+  {
+    return m_parallel_dimension;
+  }
+
   /// @brief What to do when a source is received.
   void
   operator()(decoder_source&& src);
@@ -103,11 +153,25 @@ public:
   nb_failed_full_decodings()
   const noexcept;
 
+  /// @brief Get the number of times an inverse computed for a previous block was re-used.
+  std::size_t
+  nb_cached_inverses_hits()
+  const noexcept;
+
   /// @brief Get the number of decoded packets.
   std::size_t
   nb_decoded()
   const noexcept;
 
+  /// @brief Compute how many repairs are still needed for each cluster of lost sources.
+  /// @param res Where to put the result; it's cleared first.
+  ///
+  /// Lost sources are the holes between received sources, as well as the missing sources
+  /// referenced by received repairs. Holes linked together by a repair belong to the same cluster.
+  void
+  deficits(std::vector<deficit>& res)
+  const;
+
 private:
 
   /// @brief Recursively decode any repair that encodes only one source.
@@ -132,9 +196,25 @@ private:
   noexcept;
 
   /// @brief Try to construct missing sources from the set of repairs.
+  ///
+  /// Repairs which reference overlapping ranges of sources are grouped together. Each group which
+  /// has as many repairs as missing sources is then decoded on its own, thus a repair which
+  /// encodes only a few lost sources can be used without waiting for the whole set of missing
+  /// sources to be covered.
   void
   attempt_full_decoding();
 
+  /// @brief Try to construct the missing sources of a group of repairs.
+  /// @param r_begin The first repair of the group.
+  /// @param r_end The end of the group of repairs.
+  /// @param miss_begin The first missing source referenced by the group.
+  /// @param miss_end The end of the missing sources referenced by the group.
+  /// @pre There are as many repairs as missing sources.
+  void
+  decode_group( repairs_index_type::iterator r_begin, repairs_index_type::iterator r_end
+              , missing_sources_type::iterator miss_begin
+              , missing_sources_type::iterator miss_end);
+
   /// @brief Give to callback ordered sources, if possible.
   void
   flush_ordered_sources();
@@ -183,13 +263,32 @@ private:
   std::size_t m_nb_decoded;
 
   /// @brief Re-use the same memory for the matrix of coefficients.
+  /// @note Empty until a first group of sources has to be decoded.
   square_matrix m_coefficients;
 
   /// @brief Re-use the same memory for the inverted matrix of coefficients.
   square_matrix m_inv;
 
-  /// @brief Re-use the same memory for the index of repairs in the inverted matrix.
-  std::vector<decoder_repair*> m_index;
+  /// @brief Re-use the same memory for the index of repairs, sorted by their first source.
+  repairs_index_type m_index;
+
+  /// @brief The inverses of the matrices of block codes, for each erasure pattern.
+  inverses_type m_inverses;
+
+  /// @brief Re-use the same memory for the key of the cache of inverses.
+  std::vector<std::uint32_t> m_inverse_key;
+
+  /// @brief The number of times an inverse was found in the cache.
+  std::size_t m_nb_cached_inverses_hits;
+
+  /// @brief The minimal number of sources decoded together to solve them on several threads.
+  std::size_t m_parallel_dimension;
+
+  /// @brief Re-use the same memory for the sources decoded together.
+  std::vector<decoder_source> m_decoded;
+
+  /// @brief Re-use the same memory for the repairs to sum in each decoded source.
+  std::vector<std::vector<region_term>> m_terms;
 };
 
 /*------------------------------------------------------------------------------------------------*/
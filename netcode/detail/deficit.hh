@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The number of repairs a decoder still needs to rebuild a cluster of lost sources.
+///
+/// A cluster is a range of source identifiers which contains lost sources, possibly linked together
+/// by repairs already received by the decoder.
+struct deficit
+{
+  /// @brief The identifier of the first source of the cluster.
+  std::uint32_t first_id;
+
+  /// @brief The identifier of the last source of the cluster.
+  std::uint32_t last_id;
+
+  /// @brief The number of missing sources minus the number of usable repairs.
+  std::uint16_t nb_repairs;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -1,6 +1,10 @@
+#include <algorithm> // find, sort
 #include <cstdint>
+#include <iterator> // distance, next
 
+#include "netcode/detail/coefficient.hh"
 #include "netcode/detail/encoder.hh"
+#include "netcode/detail/mix.hh"
 
 namespace ntc { namespace detail {
 
@@ -8,6 +12,8 @@ namespace ntc { namespace detail {
 
 encoder::encoder(std::uint8_t galois_field_size)
   : m_gf{galois_field_size}
+  , m_positions{}
+  , m_terms{}
 {}
 
 /*------------------------------------------------------------------------------------------------*/
@@ -16,50 +22,242 @@ void
 encoder::operator()(encoder_repair& repair, source_list& sources)
 {
   assert(sources.size() && "Empty source list");
+  operator()(repair, sources.cbegin(), sources.cend());
+}
 
-  auto cit = sources.cbegin();
-  const auto src_end = sources.cend();
+/*------------------------------------------------------------------------------------------------*/
 
-  assert((reinterpret_cast<std::uintptr_t>(cit->symbol().data()) % 16) == 0);
+template <typename Iterator>
+void
+encoder::operator()(encoder_repair& repair, Iterator cit, Iterator src_end)
+{
+  assert(cit != src_end && "Empty range of sources");
+  for (; cit != src_end; ++cit)
+  {
+    add_source(repair, *cit);
+  }
+  encode_symbols(repair);
+}
 
-  // Resize the repair's symbol buffer to fit the first source symbol buffer.
-  repair.symbol().resize(cit->size());
+/*------------------------------------------------------------------------------------------------*/
 
-  // Add the current source id to the list of encoded sources by this repair.
-  repair.source_ids().insert(repair.source_ids().end(), cit->id());
+template <typename Iterator>
+void
+encoder::operator()(encoder_repair& repair, Iterator cit, Iterator src_end, double density)
+{
+  assert(cit != src_end && "Empty range of sources");
+  assert(density > 0 and density <= 1);
 
-  // The coefficient for this repair and source.
-  auto c = m_gf.coefficient(repair.id(), cit->id());
+  // A source is chosen when the 32 most significant bits of its mix with the repair are below
+  // this threshold.
+  const auto threshold = static_cast<std::uint64_t>(density * 4294967296.0 /* 2^32 */);
+  for (; cit != src_end; ++cit)
+  {
+    if (std::next(cit) == src_end or (mix(repair.id(), cit->id()) >> 32) < threshold)
+    {
+      add_source(repair, *cit);
+    }
+  }
+  encode_symbols(repair);
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-  // Only multiply for the first source, no need to add with repair.
-  m_gf.multiply(cit->symbol().data(), repair.symbol().data(), cit->size(), c);
+template <typename Iterator>
+void
+encoder::operator()( encoder_repair& repair, Iterator cit, Iterator src_end
+                   , const soliton_distribution& degrees)
+{
+  assert(cit != src_end && "Empty range of sources");
+  const auto k = static_cast<std::size_t>(std::distance(cit, src_end));
+  assert(degrees.size() == k);
 
-  // Initialize the user's size.
-  repair.encoded_size() = m_gf.multiply_size(cit->size(), c);
+  // A stream of pseudo-random values which only depends on the repair's identifier.
+  auto counter = std::uint32_t{0};
+  const auto random = [&]{return mix(repair.id(), counter++);};
 
-  // Then, for each remaining source, multiply it with a coefficient and add it with
-  // current repair.
-  for (++cit; cit != src_end; ++cit)
+  // Choose degree distinct positions among k with Floyd's algorithm.
+  const auto degree = degrees(random());
+  m_positions.clear();
+  for (auto j = k - degree; j < k; ++j)
   {
-    // The current repair's symbol buffer might be too small for the current source.
-    if (cit->size() > repair.symbol().size())
+    const auto t = static_cast<std::size_t>(random() % (j + 1));
+    if (std::find(m_positions.begin(), m_positions.end(), t) == m_positions.end())
     {
-      repair.symbol().resize(cit->size());
+      m_positions.push_back(t);
     }
+    else
+    {
+      m_positions.push_back(j);
+    }
+  }
+  std::sort(m_positions.begin(), m_positions.end());
 
-    // The coefficient for this repair and source.
-    c = m_gf.coefficient(repair.id(), cit->id());
+  auto pos = std::size_t{0};
+  for (const auto p : m_positions)
+  {
+    std::advance(cit, static_cast<std::ptrdiff_t>(p - pos));
+    pos = p;
+    add_source(repair, *cit);
+  }
+  encode_symbols(repair);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+// The ranges of sources of the encoder's thread and of snapshots encoded on another thread.
+template void
+encoder::operator()(encoder_repair&, source_list::const_iterator, source_list::const_iterator);
+
+template void
+encoder::operator()( encoder_repair&, std::vector<source_view>::const_iterator
+                   , std::vector<source_view>::const_iterator);
 
-    // Add the current source id to the list of encoded sources by this repair.
-    repair.source_ids().insert(repair.source_ids().end(), cit->id());
+template void
+encoder::operator()( encoder_repair&, source_list::const_iterator, source_list::const_iterator
+                   , double);
 
-    // Multiply and add for all following sources.
-    m_gf.multiply_add(cit->symbol().data(), repair.symbol().data(), cit->size(), c);
+template void
+encoder::operator()( encoder_repair&, std::vector<source_view>::const_iterator
+                   , std::vector<source_view>::const_iterator, double);
+
+template void
+encoder::operator()( encoder_repair&, source_list::const_iterator, source_list::const_iterator
+                   , const soliton_distribution&);
+
+template void
+encoder::operator()( encoder_repair&, std::vector<source_view>::const_iterator
+                   , std::vector<source_view>::const_iterator, const soliton_distribution&);
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::operator()( encoder_repair& repair, const source_list& sources
+                   , const std::vector<std::uint32_t>& ids)
+{
+  // Both sources and ids are sorted by identifier.
+  auto id_cit = ids.begin();
+  const auto id_end = ids.end();
+  for (auto cit = sources.cbegin(), src_end = sources.cend(); cit != src_end and id_cit != id_end
+      ; ++cit)
+  {
+    // Skip identifiers of sources which are no longer in the list.
+    while (id_cit != id_end and *id_cit < cit->id())
+    {
+      ++id_cit;
+    }
+    if (id_cit != id_end and *id_cit == cit->id())
+    {
+      add_source(repair, *cit);
+    }
+  }
+  encode_symbols(repair);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::operator()( encoder_repair& repair, const source_list& sources
+                   , const std::vector<std::uint32_t>& ids, double density)
+{
+  assert(density > 0 and density <= 1);
+
+  // The choice of a source is only known once the next one is found, as the last one is always
+  // encoded.
+  const auto threshold = static_cast<std::uint64_t>(density * 4294967296.0 /* 2^32 */);
+  const encoder_source* previous = nullptr;
+  auto id_cit = ids.begin();
+  const auto id_end = ids.end();
+  for (auto cit = sources.cbegin(), src_end = sources.cend(); cit != src_end and id_cit != id_end
+      ; ++cit)
+  {
+    while (id_cit != id_end and *id_cit < cit->id())
+    {
+      ++id_cit;
+    }
+    if (id_cit != id_end and *id_cit == cit->id())
+    {
+      if (previous and (mix(repair.id(), previous->id()) >> 32) < threshold)
+      {
+        add_source(repair, *previous);
+      }
+      previous = &*cit;
+    }
+  }
+  if (previous)
+  {
+    add_source(repair, *previous);
+  }
+  encode_symbols(repair);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::add_source(encoder_repair& repair, const encoder_source& src)
+{
+  add_source(repair, src.id(), src.symbol().data(), src.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::add_source(encoder_repair& repair, const source_view& src)
+{
+  add_source(repair, src.id(), src.symbol(), src.size());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::add_source( encoder_repair& repair, std::uint32_t id, const char* symbol
+                   , std::uint16_t size)
+{
+  assert((reinterpret_cast<std::uintptr_t>(symbol) % 16) == 0);
+
+  // The coefficient for this repair and source.
+  const auto c = coefficient(m_gf, repair, id);
+
+  if (repair.source_ids().empty())
+  {
+    // Resize the repair's symbol buffer to fit the first source symbol buffer. The first source is
+    // only multiplied, no need to add with repair.
+    m_terms.clear();
+    repair.symbol().resize(size);
+
+    // Initialize the user's size.
+    repair.encoded_size() = m_gf.multiply_size(size, c);
+  }
+  else
+  {
+    // The current repair's symbol buffer might be too small for the current source.
+    if (size > repair.symbol().size())
+    {
+      repair.symbol().resize(size);
+    }
 
     // Finally, add the user size.
     // Cast is necessary to inhibit conversion warning as xor implicitly convert to a signed value.
     repair.encoded_size()
-      = static_cast<std::uint16_t>(m_gf.multiply_size(cit->size(), c) ^ repair.encoded_size());
+      = static_cast<std::uint16_t>(m_gf.multiply_size(size, c) ^ repair.encoded_size());
+  }
+
+  // Multiply and add the symbol later, with the ones of all other sources.
+  m_terms.push_back(region_term{symbol, size, c});
+
+  // Add the current source id to the list of encoded sources by this repair.
+  repair.source_ids().insert(repair.source_ids().end(), id);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encoder::encode_symbols(encoder_repair& repair)
+{
+  if (not m_terms.empty())
+  {
+    m_gf.combine(m_terms, repair.symbol().data(), repair.symbol().size());
+    m_terms.clear();
   }
 }
 
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <memory>  // shared_ptr
+#include <utility> // move
+#include <vector>
+
 #include "netcode/detail/galois_field.hh"
 #include "netcode/detail/repair.hh"
+#include "netcode/detail/soliton.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_list.hh"
 
@@ -18,16 +23,119 @@ public:
   /// @brief Constructor.
   explicit encoder(std::uint8_t galois_field_size);
 
+  /// @brief Set the executor which splits the symbols of large repairs.
+  void
+  set_executor(std::shared_ptr<parallel_executor> executor)
+  noexcept
+  {
+    m_gf.set_executor(std::move(executor));
+  }
+
+  /// @brief Get the executor which splits the symbols of large repairs, if any.
+  const std::shared_ptr<parallel_executor>&
+  executor()
+  const noexcept
+  {
+    return m_gf.executor();
+  }
+
   /// @brief Fill a @ref detail::repair from a set of detail::source.
   /// @param repair The repair to fill.
   /// @param sources The container of @ref detail::source to build the repair from.
   void
   operator()(encoder_repair& repair, source_list& sources);
 
+  /// @brief Fill a @ref detail::repair from a range of detail::source.
+  /// @param repair The repair to fill.
+  /// @param cit The first source to build the repair from.
+  /// @param end The end of the range of sources.
+  /// @pre The range is not empty.
+  ///
+  /// The range is either one of a source_list, or one of source_view, which encodes a snapshot of
+  /// the window on another thread.
+  template <typename Iterator>
+  void
+  operator()(encoder_repair& repair, Iterator cit, Iterator end);
+
+  /// @brief Fill a @ref detail::repair from a pseudo-random subset of a range of detail::source.
+  /// @param repair The repair to fill.
+  /// @param cit The first source to build the repair from.
+  /// @param end The end of the range of sources.
+  /// @param density The probability for a source to be encoded, in ]0, 1].
+  /// @pre The range is not empty.
+  ///
+  /// The choice of a source only depends on its identifier and on the repair's identifier. The last
+  /// source of the range is always encoded, thus the repair is never empty.
+  template <typename Iterator>
+  void
+  operator()(encoder_repair& repair, Iterator cit, Iterator end, double density);
+
+  /// @brief Fill a @ref detail::repair from a subset of a range of detail::source, as a fountain
+  /// code does.
+  /// @param repair The repair to fill.
+  /// @param cit The first source to build the repair from.
+  /// @param end The end of the range of sources.
+  /// @param degrees The distribution of the number of sources to encode.
+  /// @pre The range is not empty and @p degrees was computed for its size.
+  ///
+  /// The number of sources and the sources themselves only depend on the repair's identifier.
+  template <typename Iterator>
+  void
+  operator()( encoder_repair& repair, Iterator cit, Iterator end
+            , const soliton_distribution& degrees);
+
+  /// @brief Fill a @ref detail::repair from a subset of detail::source.
+  /// @param repair The repair to fill.
+  /// @param sources The container of @ref detail::source to pick sources from.
+  /// @param ids The sorted identifiers of the sources to build the repair from.
+  ///
+  /// Identifiers which don't belong to @p sources are ignored. Thus, @p repair might encode no
+  /// source at all.
+  void
+  operator()( encoder_repair& repair, const source_list& sources
+            , const std::vector<std::uint32_t>& ids);
+
+  /// @brief Fill a @ref detail::repair from a pseudo-random subset of some detail::source.
+  /// @param repair The repair to fill.
+  /// @param sources The container of @ref detail::source to pick sources from.
+  /// @param ids The sorted identifiers of the sources to choose from.
+  /// @param density The probability for a source to be encoded, in ]0, 1].
+  ///
+  /// The last source of @p ids held by @p sources is always encoded.
+  void
+  operator()( encoder_repair& repair, const source_list& sources
+            , const std::vector<std::uint32_t>& ids, double density);
+
+private:
+
+  /// @brief Add a source to a repair.
+  void
+  add_source(encoder_repair& repair, const encoder_source& src);
+
+  /// @brief Add a source seen from another thread to a repair.
+  void
+  add_source(encoder_repair& repair, const source_view& src);
+
+  /// @brief Add a symbol to a repair.
+  ///
+  /// Only the size and the identifier are added, the symbol is added by encode_symbols.
+  void
+  add_source(encoder_repair& repair, std::uint32_t id, const char* symbol, std::uint16_t size);
+
+  /// @brief Compute the symbol of a repair from the symbols of its sources, in a single pass.
+  void
+  encode_symbols(encoder_repair& repair);
+
 private:
 
   /// @brief The implementation of a Galois field.
   detail::galois_field m_gf;
+
+  /// @brief Re-use the same memory for the positions of the sources chosen by a fountain code.
+  std::vector<std::size_t> m_positions;
+
+  /// @brief Re-use the same memory for the symbols to sum in a repair.
+  std::vector<region_term> m_terms;
 };
 
 /*------------------------------------------------------------------------------------------------*/
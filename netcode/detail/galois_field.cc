@@ -0,0 +1,41 @@
+#include <array>
+#include <mutex>
+#include <stdexcept>
+
+#include "netcode/detail/galois_field.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::shared_ptr<gf_t>
+shared_tables(std::uint8_t w)
+{
+  assert(w == 4 or w == 8 or w == 16 or w == 32);
+
+  static std::mutex mutex;
+  static std::array<std::weak_ptr<gf_t>, 33> tables;
+
+  std::lock_guard<std::mutex> lock{mutex};
+  auto res = tables[w].lock();
+  if (not res)
+  {
+    std::unique_ptr<gf_t> gf{new gf_t()}; // '()' to avoid warning about members uninitialized
+    if (gf_init_easy(gf.get(), static_cast<int>(w)) == 0)
+    {
+      throw std::runtime_error("Can't allocate galois field");
+    }
+    res.reset( gf.release()
+             , [](gf_t* f)
+               {
+                 gf_free(f, 0 /* non-recursive */);
+                 delete f;
+               });
+    tables[w] = res;
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -1,20 +1,59 @@
 #pragma once
 
+#include <algorithm> // min
 #include <cassert>
 #include <cstddef> // size_t
 #include <cstdint>
-#include <stdexcept>
+#include <cstring> // memcpy, memset
+#include <memory>  // shared_ptr
+#include <utility> // move
+#include <vector>
 
 extern "C" {
 #include <gf_complete.h>
 }
 
+#include "netcode/detail/mix.hh"
+#include "netcode/detail/xor_region.hh"
+#include "netcode/coefficient_generator.hh"
+#include "netcode/parallel_executor.hh"
+
 namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief Get the tables of a field of size @p w, shared by all fields of this size.
+/// @throw std::runtime_error if the tables can't be allocated.
+///
+/// Tables are built on first use and freed when no field uses them anymore. Once built, gf-complete
+/// only reads them, thus fields in different threads can share them.
+std::shared_ptr<gf_t>
+shared_tables(std::uint8_t w);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A region to multiply with a constant, to sum with galois_field::combine.
+struct region_term
+{
+  /// @brief The region.
+  const char* src;
+
+  /// @brief The size of the region.
+  std::size_t len;
+
+  /// @brief The constant.
+  std::uint32_t coeff;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @internal
 /// @brief A Galois field.
+///
+/// When w = 1, the field is GF(2): all coefficients are 1, thus repairs are plain sums (xor) of
+/// sources and gf-complete is not used.
 class galois_field
 {
 public:
@@ -32,21 +71,23 @@ public:
   galois_field& operator=(galois_field&&) = delete;
 
   /// @brief Constructor.
+  /// @throw std::runtime_error if the field's tables can't be allocated.
   explicit galois_field(std::uint8_t w)
-    : m_gf() // '()' to avoid warning about members uninitialized
+    : m_tables{w == 1 ? nullptr : shared_tables(w)}
+    , m_gf{m_tables.get()}
     , m_w{w}
+    , m_executor{nullptr}
   {
-    assert(w== 4 or w == 8 or w == 16 or w == 32);
-    if (gf_init_easy(&m_gf, static_cast<int>(m_w)) == 0)
-    {
-      throw std::runtime_error("Can't allocate galois field");
-    }
+    assert(w == 1 or w == 4 or w == 8 or w == 16 or w == 32);
   }
 
-  /// @brief Destructor.
-  ~galois_field()
+  /// @brief Get the underlying gf-complete field, shared by all fields of the same size.
+  /// @note A null pointer for a binary field.
+  const gf_t*
+  implementation()
+  const noexcept
   {
-    gf_free(&m_gf, 0 /* non-recursive */);
+    return m_gf;
   }
 
   /// @brief Get the size of this Galois field
@@ -57,6 +98,23 @@ public:
     return m_w;
   }
 
+  /// @brief Set the executor which splits the operations on large regions.
+  /// @param executor Can be a null pointer to compute all operations on the calling thread.
+  void
+  set_executor(std::shared_ptr<parallel_executor> executor)
+  noexcept
+  {
+    m_executor = std::move(executor);
+  }
+
+  /// @brief Get the executor which splits the operations on large regions, if any.
+  const std::shared_ptr<parallel_executor>&
+  executor()
+  const noexcept
+  {
+    return m_executor;
+  }
+
   /// @brief Multiply a region with a constant.
   /// @param src The region to multiply.
   /// @param dst Where to put the result.
@@ -66,12 +124,17 @@ public:
   multiply(const char* src, char* dst, std::size_t len, std::uint32_t coeff)
   noexcept
   {
-    m_gf.multiply_region.w32( &m_gf
-                            , const_cast<char*>(src)
-                            , dst
-                            , coeff
-                            , static_cast<int>(len)
-                            , 0 /* don't add to src */);
+    if (m_executor and len >= m_executor->threshold())
+    {
+      (*m_executor)(len, [&](std::size_t begin, std::size_t end)
+      {
+        multiply_region(src + begin, dst + begin, end - begin, coeff, false);
+      });
+    }
+    else
+    {
+      multiply_region(src, dst, len, coeff, false);
+    }
   }
 
   /// @brief Multiply a region with a constant, add the result with the source.
@@ -83,12 +146,53 @@ public:
   multiply_add(const char* src, char* dst, std::size_t len, std::uint32_t coeff)
   noexcept
   {
-    m_gf.multiply_region.w32( &m_gf
-                            , const_cast<char*>(src)
-                            , dst
-                            , coeff
-                            , static_cast<int>(len)
-                            , 1 /* add to src */);
+    if (m_executor and len >= m_executor->threshold())
+    {
+      (*m_executor)(len, [&](std::size_t begin, std::size_t end)
+      {
+        multiply_region(src + begin, dst + begin, end - begin, coeff, true);
+      });
+    }
+    else
+    {
+      multiply_region(src, dst, len, coeff, true);
+    }
+  }
+
+  /// @brief Sum regions multiplied with constants.
+  /// @param terms The regions and their constants, none is larger than @p dst.
+  /// @param dst Where to put the result.
+  /// @param len The size of @p dst.
+  /// @pre @p terms is not empty, bytes of @p dst after the first region are 0.
+  ///
+  /// With an executor, all regions are summed stripe by stripe, thus a stripe of the result stays
+  /// in the cache of its thread and the threads are only synchronized once.
+  void
+  combine(const std::vector<region_term>& terms, char* dst, std::size_t len)
+  noexcept
+  {
+    assert(not terms.empty());
+    const auto stripe = [&](std::size_t begin, std::size_t end)
+    {
+      auto add = false;
+      for (const auto& t : terms)
+      {
+        if (begin < t.len)
+        {
+          multiply_region( t.src + begin, dst + begin, std::min(end, t.len) - begin, t.coeff
+                         , add);
+        }
+        add = true;
+      }
+    };
+    if (m_executor and len >= m_executor->threshold())
+    {
+      (*m_executor)(len, stripe);
+    }
+    else
+    {
+      stripe(0, len);
+    }
   }
 
   /// @brief Multiply a size with a coefficient.
@@ -97,7 +201,8 @@ public:
   multiply_size(std::uint16_t size, std::uint32_t coeff)
   noexcept
   {
-    assert(  (((m_w == 4 or m_w == 8 or m_w == 16 ) and coeff < (1u << m_w)) or (m_w == 32))
+    assert(  (((m_w == 1 or m_w == 4 or m_w == 8 or m_w == 16 ) and coeff < (1u << m_w))
+             or (m_w == 32))
           && "Invalid coefficient");
 
     if (size == 0 or coeff == 0)
@@ -105,6 +210,11 @@ public:
       return 0;
     }
 
+    if (m_w == 1)
+    {
+      return size;
+    }
+
     if (m_w <= 8) // 4 or 8
     {
       __attribute__((aligned(16))) std::uint16_t res;
@@ -115,7 +225,7 @@ public:
     }
     else // w = 16 or 32
     {
-      return static_cast<std::uint16_t>(m_gf.multiply.w32(&m_gf, size, coeff));
+      return static_cast<std::uint16_t>(m_gf->multiply.w32(m_gf, size, coeff));
     }
   }
 
@@ -126,7 +236,7 @@ public:
   {
     return (x == 0 or y == 0)
          ? 0
-         : m_gf.multiply.w32(&m_gf, x, y);
+         : m_w == 1 ? 1 : m_gf->multiply.w32(m_gf, x, y);
   }
 
   /// @brief Invert a coeeficient.
@@ -135,7 +245,7 @@ public:
   noexcept
   {
     assert(coef != 0);
-    return m_gf.divide.w32(&m_gf, 1, coef);
+    return m_w == 1 ? 1 : m_gf->divide.w32(m_gf, 1, coef);
   }
 
   /// @brief Get the coefficient for a repair and a source.
@@ -144,7 +254,11 @@ public:
   coefficient(std::uint32_t repair_id, std::uint32_t src_id)
   const noexcept
   {
-    if (m_w == 32)
+    if (m_w == 1)
+    {
+      return 1;
+    }
+    else if (m_w == 32)
     {
       // Unsigned integer overflow is well defined: http://stackoverflow.com/q/18195715/21584
       const auto res = ((repair_id + 1) + (src_id + 1)) * (repair_id + 1);
@@ -157,13 +271,96 @@ public:
     }
   }
 
+  /// @brief Get the coefficient for a repair and a source, with a given generator.
+  /// @note The result is guaranted to be different from 0.
+  /// @note For coefficient_generator::block, @p repair_id and @p src_id are the positions of the
+  /// repair and of the source in their block.
+  ///
+  /// With a binary field, all coefficients are 1. With a 32 bits field, the arithmetic generator
+  /// is always used: encoded sizes are carried on 16 bits, which can only be decoded with the small
+  /// coefficients it generates.
+  std::uint32_t
+  coefficient(coefficient_generator gen, std::uint32_t repair_id, std::uint32_t src_id)
+  noexcept
+  {
+    switch (m_w == 1 or m_w == 32 ? coefficient_generator::arithmetic : gen)
+    {
+      case coefficient_generator::xorshift:
+      {
+        // One round of xorshift64* from a seed which depends on both identifiers.
+        auto x = mix(repair_id, src_id) | 1u;
+        x ^= x >> 12;
+        x ^= x << 25;
+        x ^= x >> 27;
+        const auto res = static_cast<std::uint32_t>((x * 0x2545f4914f6cdd1dull) >> 32);
+        const auto masked = res & ((1u << m_w) - 1);
+        return masked == 0 ? 1 : masked;
+      }
+
+      case coefficient_generator::cauchy:
+      case coefficient_generator::block:
+      {
+        // 1 / (x + y), where x has its most significant bit set and y hasn't, thus x + y != 0.
+        const auto high_bit = 1u << (m_w - 1);
+        const auto x = (repair_id & (high_bit - 1)) | high_bit;
+        const auto y = src_id & (high_bit - 1);
+        return invert(x ^ y);
+      }
+
+      default: // coefficient_generator::arithmetic
+      {
+        return coefficient(repair_id, src_id);
+      }
+    }
+  }
+
 private:
 
+  /// @brief Multiply a region with a constant on the calling thread.
+  void
+  multiply_region(const char* src, char* dst, std::size_t len, std::uint32_t coeff, bool add)
+  noexcept
+  {
+    if (m_w == 1)
+    {
+      if (add)
+      {
+        if (coeff != 0)
+        {
+          xor_region(src, dst, len);
+        }
+      }
+      else if (coeff == 0)
+      {
+        std::memset(dst, 0, len);
+      }
+      else if (src != dst)
+      {
+        std::memcpy(dst, src, len);
+      }
+      return;
+    }
+    m_gf->multiply_region.w32( m_gf
+                            , const_cast<char*>(src)
+                            , dst
+                            , coeff
+                            , static_cast<int>(len)
+                            , add ? 1 : 0);
+  }
+
+private:
+
+  /// @brief Keep the shared tables alive.
+  std::shared_ptr<gf_t> m_tables;
+
   /// @brief The real underlying galois field.
-  gf_t m_gf;
+  gf_t* m_gf;
 
   /// @brief This field size.
   std::uint8_t  m_w;
+
+  /// @brief Split the operations on large regions, if any.
+  std::shared_ptr<parallel_executor> m_executor;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -1,3 +1,4 @@
+#include <algorithm> // min
 #include <cassert>
 
 #include "netcode/detail/invert_matrix.hh"
@@ -6,110 +7,153 @@ namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
-boost::optional<std::size_t>
-invert(galois_field& gf, square_matrix& mat, square_matrix& inv)
+namespace /* unnamed */ {
+
+/// @brief The number of rows or of columns handled by a task of a parallel inversion.
+static constexpr std::size_t block_size = 16;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The number of blocks of @p n rows or columns.
+std::size_t
+nb_blocks(std::size_t n)
 noexcept
 {
-  assert(mat.dimension() == inv.dimension());
+  return (n + block_size - 1) / block_size;
+}
 
-  const auto cols = mat.dimension();
-  const auto rows = mat.dimension();
+/*------------------------------------------------------------------------------------------------*/
 
-  for (auto i = 0ul; i < rows; ++i)
+/// @brief Set @p inv to the identity.
+void
+identity(square_matrix& inv)
+noexcept
+{
+  const auto n = inv.dimension();
+  for (auto i = 0ul; i < n; ++i)
   {
-    for (auto j = 0ul; j < cols; ++j)
+    for (auto j = 0ul; j < n; ++j)
     {
       inv(i,j) = (i == j) ? 1 : 0;
     }
   }
+}
 
-  // Convert into upper triangular
-  for (auto i = 0ul; i < cols; ++i)
-  {
-    const auto row_start = i * cols;
+/*------------------------------------------------------------------------------------------------*/
 
-    // Swap rows if we have a zero i,i element.
-    // If we can't swap, then the matrix was not invertible.
-    if (mat[row_start + i] == 0)
+/// @brief Make element i,i of @p mat equal to 1, the rows after i are already reduced.
+/// @return false if the matrix is not invertible.
+bool
+make_pivot(galois_field& gf, square_matrix& mat, square_matrix& inv, std::size_t i)
+noexcept
+{
+  const auto cols = mat.dimension();
+  const auto rows = mat.dimension();
+  const auto row_start = i * cols;
+
+  // Swap rows if we have a zero i,i element.
+  // If we can't swap, then the matrix was not invertible.
+  if (mat[row_start + i] == 0)
+  {
+    auto j = 0ul;
+    for (j = i + 1; j < rows and mat[(cols * j) + i] == 0; ++j)
     {
-      auto j = 0ul;
-      for (j = i + 1; j < rows and mat[(cols * j) + i] == 0; ++j)
-      {
-      }
+    }
 
-      if (j == rows)
-      {
-        // Failure, matrix is not invertible.
-        return {j - 1};
-      }
+    if (j == rows)
+    {
+      return false;
+    }
 
-      const auto row_start2 = j * cols;
-      for (auto k = 0ul; k < cols; ++k)
-      {
-        auto tmp = mat[row_start + k];
-        mat[row_start + k] = mat[row_start2 + k];
-        mat[row_start2 + k] = tmp;
+    const auto row_start2 = j * cols;
+    for (auto k = 0ul; k < cols; ++k)
+    {
+      auto tmp = mat[row_start + k];
+      mat[row_start + k] = mat[row_start2 + k];
+      mat[row_start2 + k] = tmp;
 
-        tmp = inv[row_start + k];
-        inv[row_start + k] = inv[row_start2 + k];
-        inv[row_start2 + k] = tmp;
-      }
+      tmp = inv[row_start + k];
+      inv[row_start + k] = inv[row_start2 + k];
+      inv[row_start2 + k] = tmp;
     }
- 
-    // Multiply the row by 1/element i,i
-    const auto tmp = mat[row_start + i];
-    if (tmp != 1)
+  }
+
+  // Multiply the row by 1/element i,i
+  const auto tmp = mat[row_start + i];
+  if (tmp != 1)
+  {
+    const auto inverse = gf.invert(tmp);
+    for (auto j = 0ul; j < cols; j++)
     {
-      const auto inverse = gf.invert(tmp);
-      for (auto j = 0ul; j < cols; j++)
-      {
-        mat[row_start + j] = gf.multiply(mat[row_start + j], inverse);
-        inv[row_start + j] = gf.multiply(inv[row_start + j], inverse);
-      }
+      mat[row_start + j] = gf.multiply(mat[row_start + j], inverse);
+      inv[row_start + j] = gf.multiply(inv[row_start + j], inverse);
     }
+  }
+  return true;
+}
 
-    // Now for each j > i, add A_ji * Ai to Aj
-    auto k = row_start + i;
-    for (auto j = i + 1; j != cols; ++j)
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Add A_ji * Ai to Aj, for each j in [begin, end[.
+void
+eliminate(galois_field& gf, square_matrix& mat, square_matrix& inv, std::size_t i
+         , std::size_t begin, std::size_t end)
+noexcept
+{
+  const auto cols = mat.dimension();
+  const auto row_start = i * cols;
+  for (auto j = begin; j != end; ++j)
+  {
+    const auto k = cols * j + i;
+    if (mat[k] != 0)
     {
-      k += cols;
-      if (mat[k] != 0)
+      if (mat[k] == 1)
       {
-        if (mat[k] == 1)
+        const auto row_start2 = cols * j;
+        for (auto x = 0ul; x < cols; ++x)
         {
-          const auto row_start2 = cols * j;
-          for (auto x = 0ul; x < cols; ++x)
-          {
-            mat[row_start2 + x] ^= mat[row_start + x];
-            inv[row_start2 + x] ^= inv[row_start + x];
-          }
+          mat[row_start2 + x] ^= mat[row_start + x];
+          inv[row_start2 + x] ^= inv[row_start + x];
         }
-        else
+      }
+      else
+      {
+        const auto mat_k = mat[k];
+        const auto rs2 = cols * j;
+        for (auto x = 0ul; x < cols; ++x)
         {
-          const auto mat_k = mat[k];
-          const auto rs2 = cols * j;
-          for (auto x = 0ul; x < cols; ++x)
-          {
-            mat[rs2 + x] ^= gf.multiply(mat_k, mat[row_start + x]);
-            inv[rs2 + x] ^= gf.multiply(mat_k, inv[row_start + x]);
-          }
+          mat[rs2 + x] ^= gf.multiply(mat_k, mat[row_start + x]);
+          inv[rs2 + x] ^= gf.multiply(mat_k, inv[row_start + x]);
         }
       }
     }
   }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Back substitution of an upper triangular @p mat, restricted to the columns [begin, end[
+/// of @p inv, which are independent.
+/// @note @p mat is only read, call clear_upper once all columns are done.
+void
+substitute(galois_field& gf, const square_matrix& mat, square_matrix& inv, std::size_t begin
+          , std::size_t end)
+noexcept
+{
+  const auto cols = mat.dimension();
+  const auto rows = mat.dimension();
 
-  // Now the matrix is upper triangular. Start at the top and multiply down.
+  // Start at the top and multiply down.
   for (auto i = rows - 1; ; --i)
   {
     auto row_start = i * cols;
     for (auto j = 0ul; j < i; ++j)
     {
       const auto rs2 = j * cols;
-      if (mat[rs2+i] != 0)
+      const auto tmp = mat[rs2 + i];
+      if (tmp != 0)
       {
-        const auto tmp = mat[rs2+i];
-        mat[rs2 + i] = 0;
-        for (auto k = 0ul; k < cols; ++k)
+        for (auto k = begin; k < end; ++k)
         {
           inv[rs2 + k] ^= gf.multiply(tmp, inv[row_start + k]);
         }
@@ -121,6 +165,54 @@ noexcept
       break;
     }
   }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Make a substituted @p mat the identity.
+void
+clear_upper(square_matrix& mat)
+noexcept
+{
+  const auto n = mat.dimension();
+  for (auto i = 1ul; i < n; ++i)
+  {
+    for (auto j = 0ul; j < i; ++j)
+    {
+      mat[j * n + i] = 0;
+    }
+  }
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+boost::optional<std::size_t>
+invert(galois_field& gf, square_matrix& mat, square_matrix& inv)
+noexcept
+{
+  assert(mat.dimension() == inv.dimension());
+
+  const auto n = mat.dimension();
+  identity(inv);
+
+  // Convert into upper triangular
+  for (auto i = 0ul; i < n; ++i)
+  {
+    if (not make_pivot(gf, mat, inv, i))
+    {
+      // Failure, matrix is not invertible.
+      return {n - 1};
+    }
+
+    // Now for each j > i, add A_ji * Ai to Aj
+    eliminate(gf, mat, inv, i, i + 1, n);
+  }
+
+  // Now the matrix is upper triangular.
+  substitute(gf, mat, inv, 0, n);
+  clear_upper(mat);
 
   // Everything went OK.
   return {};
@@ -128,4 +220,42 @@ noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+boost::optional<std::size_t>
+invert(galois_field& gf, square_matrix& mat, square_matrix& inv, parallel_executor& executor)
+noexcept
+{
+  assert(mat.dimension() == inv.dimension());
+
+  const auto n = mat.dimension();
+  identity(inv);
+
+  for (auto i = 0ul; i < n; ++i)
+  {
+    if (not make_pivot(gf, mat, inv, i))
+    {
+      return {n - 1};
+    }
+
+    // Rows after the pivot are reduced by blocks. As some rows don't need to be reduced, blocks
+    // don't have the same cost.
+    executor.for_each(nb_blocks(n - i - 1), [&](std::size_t block)
+    {
+      const auto begin = i + 1 + block * block_size;
+      eliminate(gf, mat, inv, i, begin, std::min(begin + block_size, n));
+    });
+  }
+
+  // Columns of the inverse are substituted by blocks, all at once.
+  executor.for_each(nb_blocks(n), [&](std::size_t block)
+  {
+    const auto begin = block * block_size;
+    substitute(gf, mat, inv, begin, std::min(begin + block_size, n));
+  });
+  clear_upper(mat);
+
+  return {};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
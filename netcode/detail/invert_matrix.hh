@@ -4,6 +4,7 @@
 
 #include "netcode/detail/galois_field.hh"
 #include "netcode/detail/square_matrix.hh"
+#include "netcode/parallel_executor.hh"
 
 namespace ntc { namespace detail {
 
@@ -22,4 +23,19 @@ noexcept;
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief Invert a matrix using a Galois field, on the threads of an executor.
+/// @attention @p mat will be overwritten
+/// @related square_matrix
+/// @return Same as the sequential invert.
+///
+/// For each pivot, the following rows are reduced by blocks of rows. Then, as columns of the
+/// inverse are independent during the back substitution, they are substituted by blocks of columns
+/// in a single pass. Blocks are balanced between threads by work stealing.
+boost::optional<std::size_t>
+invert(galois_field& gf, square_matrix& mat, square_matrix& inv, parallel_executor& executor)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Mix the bits of a 64 bits integer.
+///
+/// It's the finalizer of SplitMix64: each bit of the input affects all bits of the output, thus
+/// consecutive inputs give uncorrelated outputs.
+inline
+std::uint64_t
+mix(std::uint64_t x)
+noexcept
+{
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Mix a repair identifier with a source identifier.
+inline
+std::uint64_t
+mix(std::uint32_t repair_id, std::uint32_t src_id)
+noexcept
+{
+  return mix((static_cast<std::uint64_t>(repair_id) << 32) | src_id);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <algorithm> // copy_n
+#include <cassert>
+#include <cstdint>
+
+#include <boost/endian/conversion.hpp>
+
 #include "netcode/errors.hh"
 #include "netcode/packet.hh"
 
@@ -12,13 +18,30 @@ enum class packet_type : std::uint8_t {ack = 0, repair = 1, source = 2};
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief The bit of the first byte telling that a packet ends with a session identifier.
+///
+/// The identifier is put at the end of packets so that the symbols of sources and repairs stay
+/// aligned, and so that it can be read without parsing the rest of the packet.
+constexpr std::uint8_t session_flag = 0x80;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The bit of the first byte telling that an ack or a repair ends with the fields of the
+/// current format (deficits and path counts of acks, window start and generator of repairs, ...).
+///
+/// Repairs of older encoders end with a copy of their symbol instead, which must not be parsed, and
+/// acks of older decoders end with their identifiers.
+constexpr std::uint8_t trailer_flag = 0x40;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief Get the type of a raw packet by looking at its first byte.
 /// @throw packet_type_error if the type could not have been read.
 inline
 packet_type
 get_packet_type(const packet& p)
 {
-  const auto ty = *reinterpret_cast<const std::uint8_t*>(p.data());
+  const auto ty = *reinterpret_cast<const std::uint8_t*>(p.data()) & ~(session_flag | trailer_flag);
   switch (ty)
   {
     case 0:
@@ -37,4 +60,45 @@ get_packet_type(const packet& p)
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Tell if a raw packet ends with a session identifier.
+inline
+bool
+has_session(const packet& p)
+noexcept
+{
+  return p.size() != 0 and (*reinterpret_cast<const std::uint8_t*>(p.data()) & session_flag);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if a raw ack or repair ends with the fields of the current format.
+inline
+bool
+has_trailer(const packet& p)
+noexcept
+{
+  return p.size() != 0 and (*reinterpret_cast<const std::uint8_t*>(p.data()) & trailer_flag);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Get the session identifier at the end of a raw packet.
+/// @pre has_session(p)
+/// @throw overflow_error if the packet is too small to hold a session identifier.
+inline
+std::uint32_t
+get_session(const packet& p)
+{
+  assert(has_session(p));
+  if (p.size() < sizeof(std::uint8_t) + sizeof(std::uint32_t))
+  {
+    throw overflow_error{};
+  }
+  auto id = std::uint32_t{0};
+  std::copy_n(p.data() + p.size() - sizeof(id), sizeof(id), reinterpret_cast<char*>(&id));
+  return boost::endian::big_to_native(id);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 }} // namespace ntc::detail
@@ -9,9 +9,11 @@
 #include <vector>
 
 #include <boost/endian/conversion.hpp>
+#include <boost/optional.hpp>
 
 #include "netcode/detail/ack.hh"
 #include "netcode/detail/buffer.hh"
+#include "netcode/detail/deficit.hh"
 #include "netcode/detail/packet_type.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_id_list.hh"
@@ -31,24 +33,46 @@ namespace ntc { namespace detail {
 /// is, in combination with @ref packet, to have the symbol aligned on a 16-bytes boundary directly
 /// when received from the network by putting a fixed-size padding in @ref packet in front of the
 /// symbol.
+/// @note Fields appended at the end of acks and repairs are only read when their first byte carries
+/// trailer_flag. Older decoders wrote nothing after the identifiers of acks, and older encoders
+/// ended repairs with a copy of their symbol: their packets can still be read.
 template <typename PacketHandler>
 class packetizer final
 {
 public:
 
   /// @brief Constructor.
-  explicit packetizer(PacketHandler& h)
+  /// @param h The handler of serialized packets.
+  /// @param galois_field_size The size of the field of the coefficients carried by read repairs.
+  explicit packetizer(PacketHandler& h, std::uint8_t galois_field_size = 32)
     : m_packet_handler(h)
-    , m_difference_buffer(32)
-    , m_rle_buffer(32)
+    , m_difference_buffer{}
+    , m_rle_buffer{}
+    , m_session{}
+    , m_galois_field_size{galois_field_size}
   {}
 
+  /// @brief Set the session identifier to put at the end of written packets.
+  void
+  set_session(std::uint32_t id)
+  noexcept
+  {
+    m_session = id;
+  }
+
+  /// @brief Get the session identifier put at the end of written packets, if any.
+  const boost::optional<std::uint32_t>&
+  session()
+  const noexcept
+  {
+    return m_session;
+  }
+
   void
   write_ack(const ack& a)
   {
-    // Write packet type.
-    static const auto packet_ty = static_cast<std::uint8_t>(packet_type::ack);
-    write<std::uint8_t>(packet_ty);
+    // Write packet type, telling that the fields of the current format follow the identifiers.
+    write_type(packet_type::ack, trailer_flag);
 
     // Write the number of packets received since last ack.
     write<std::uint16_t>(a.nb_packets());
@@ -56,6 +80,23 @@ public:
     // Write source identifiers.
     write(a.source_ids());
 
+    // Write the repairs still needed by the decoder.
+    write<std::uint16_t>(a.deficits().size());
+    for (const auto& d : a.deficits())
+    {
+      write<std::uint32_t>(d.first_id);
+      write<std::uint32_t>(d.last_id);
+      write<std::uint16_t>(d.nb_repairs);
+    }
+
+    // Write the number of packets received on each path, 0 if the decoder doesn't know paths.
+    assert(a.path_counts().size() <= std::numeric_limits<std::uint8_t>::max());
+    write<std::uint8_t>(a.path_counts().size());
+    for (const auto count : a.path_counts())
+    {
+      write<std::uint32_t>(count);
+    }
+
     // End of data.
     mark_end();
   }
@@ -69,7 +110,8 @@ public:
 
     const char* data = p.data();
     // To prevent overrun
-    auto max_len = p.size();
+    auto max_len = payload_size(p);
+    const auto session_size = p.size() - max_len;
 
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
@@ -83,8 +125,36 @@ public:
     // Read source identifiers
     auto ids = read_ids(data, max_len);
 
-    return std::make_pair( ack{std::move(ids), nb_packets}
-                         , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
+    // Read the repairs still needed by the decoder and the number of packets received on each
+    // path, only written by current decoders.
+    const auto trailer = has_trailer(p);
+    auto deficits = std::vector<deficit>{};
+    if (trailer)
+    {
+      const auto nb_deficits = read<std::uint16_t>(data, max_len);
+      deficits.reserve(nb_deficits);
+      for (auto i = 0u; i < nb_deficits; ++i)
+      {
+        const auto first_id = read<std::uint32_t>(data, max_len);
+        const auto last_id = read<std::uint32_t>(data, max_len);
+        const auto nb_repairs = read<std::uint16_t>(data, max_len);
+        deficits.push_back(deficit{first_id, last_id, nb_repairs});
+      }
+    }
+    auto a = ack{std::move(ids), nb_packets, std::move(deficits)};
+
+    if (trailer)
+    {
+      const auto nb_paths = read<std::uint8_t>(data, max_len);
+      a.path_counts().reserve(nb_paths);
+      for (auto i = 0u; i < nb_paths; ++i)
+      {
+        a.path_counts().push_back(read<std::uint32_t>(data, max_len));
+      }
+    }
+
+    return std::make_pair( std::move(a)
+                         , reinterpret_cast<std::size_t>(data) - begin + session_size);
   }
 
   void
@@ -92,9 +162,8 @@ public:
   {
     assert(r.symbol().size() > 0 && "A repair's symbol shall not be empty");
 
-    // Write packet type.
-    static const auto packet_ty = static_cast<std::uint8_t>(packet_type::repair);
-    write<std::uint8_t>(packet_ty);
+    // Write packet type, telling that the fields of the current format follow the symbol.
+    write_type(packet_type::repair, trailer_flag);
 
     // Write packet identifier.
     write<std::uint32_t>(r.id());
@@ -111,17 +180,35 @@ public:
     // Write encoded size.
     write<std::uint16_t>(r.encoded_size());
 
-    // Write size of the repair symbol.
-    write<std::uint16_t>(r.symbol().size());
+    // Write the identifier of the oldest source held by the encoder.
+    write<std::uint32_t>(r.window_start());
 
-    // Write repair symbol.
-    write(r.symbol().data(), r.symbol().size());
+    // Write how coefficients were generated.
+    write<std::uint8_t>(static_cast<std::uint8_t>(r.generator()));
+
+    // Write the position of the repair in its block, only for a block code.
+    if (r.generator() == coefficient_generator::block)
+    {
+      write<std::uint16_t>(r.block_row());
+    }
+
+    // Write the coefficients of each source, only for a recoded repair.
+    if (r.generator() == coefficient_generator::recoded)
+    {
+      assert(r.coefficients().size() == r.source_ids().size());
+      for (const auto& c : r.coefficients())
+      {
+        write<std::uint32_t>(c.second);
+      }
+    }
 
     // End of data.
     mark_end();
   }
 
   /// @throw overflow_error
+  /// @throw packet_type_error if the repair encodes no source, or if the generator of coefficients
+  /// is unknown.
   std::pair<decoder_repair, std::size_t>
   read_repair(packet&& p)
   {
@@ -130,7 +217,8 @@ public:
 
     const char* data = p.data();
     // To prevent overrun
-    auto max_len = p.size();
+    auto max_len = payload_size(p);
+    const auto session_size = p.size() - max_len;
 
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
@@ -152,22 +240,51 @@ public:
     max_len -= symbol_size;
     data += symbol_size;
 
-    // Read source identifiers
+    // Read source identifiers, a repair encodes at least one source.
     auto ids = read_ids(data, max_len);
+    if (ids.empty())
+    {
+      throw packet_type_error{p};
+    }
 
     // Read encoded size.
     const auto encoded_sz = read<std::uint16_t>(data, max_len);
 
-    return std::make_pair( decoder_repair{id, encoded_sz, std::move(ids), std::move(p), symbol_size}
-                         , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
+    // Read the identifier of the oldest source held by the encoder and how coefficients were
+    // generated. Repairs of older encoders don't have them, what follows is ignored.
+    const auto trailer = has_trailer(p);
+    const auto window_start = trailer ? read<std::uint32_t>(data, max_len) : *ids.begin();
+    const auto generator = trailer ? read_generator(p, data, max_len)
+                                   : coefficient_generator::arithmetic;
+
+    auto r = decoder_repair{ id, encoded_sz, std::move(ids), std::move(p), symbol_size
+                           , window_start};
+    r.generator() = generator;
+
+    // Read the position of the repair in its block, only for a block code.
+    if (generator == coefficient_generator::block)
+    {
+      r.block_row() = read<std::uint16_t>(data, max_len);
+    }
+
+    // Read the coefficients of each source, only for a recoded repair.
+    if (generator == coefficient_generator::recoded)
+    {
+      r.coefficients().reserve(r.source_ids().size());
+      for (const auto id : r.source_ids())
+      {
+        r.coefficients().emplace_back(id, read_coefficient(data, max_len));
+      }
+    }
+    return std::make_pair( std::move(r)
+                         , reinterpret_cast<std::size_t>(data) - begin + session_size);
   }
 
   void
   write_source(const encoder_source& src)
   {
     // Write packet type.
-    static const auto packet_ty = static_cast<std::uint8_t>(packet_type::source);
-    write<std::uint8_t>(packet_ty);
+    write_type(packet_type::source);
 
     // Write source identifier.
     write<std::uint32_t>(src.id());
@@ -191,7 +308,8 @@ public:
 
     const char* data = p.data();
     // To prevent overrun
-    auto max_len = p.size();
+    auto max_len = payload_size(p);
+    const auto session_size = p.size() - max_len;
 
     // Keep the initial memory location.
     const auto begin = reinterpret_cast<std::size_t>(data);
@@ -214,7 +332,7 @@ public:
     data += symbol_size;
 
     return std::make_pair( decoder_source{id, std::move(p), symbol_size}
-                         , reinterpret_cast<std::size_t>(data) - begin); // Number of read bytes.
+                         , reinterpret_cast<std::size_t>(data) - begin + session_size);
   }
 
 private:
@@ -239,6 +357,37 @@ private:
     return res;
   }
 
+  /// @brief Read how the coefficients of a repair were generated.
+  /// @throw overflow_error
+  /// @throw packet_type_error if the generator is unknown.
+  static
+  coefficient_generator
+  read_generator(const packet& p, const char*& data, std::size_t& max_len)
+  {
+    const auto gen = read<std::uint8_t>(data, max_len);
+    if (gen > static_cast<std::uint8_t>(coefficient_generator::recoded))
+    {
+      throw packet_type_error{p};
+    }
+    return static_cast<coefficient_generator>(gen);
+  }
+
+  /// @brief Read a coefficient carried by a repair.
+  /// @throw overflow_error if the coefficient is 0 or doesn't belong to the Galois field.
+  ///
+  /// Such coefficients would be looked up out of the field's tables.
+  std::uint32_t
+  read_coefficient(const char*& data, std::size_t& max_len)
+  const
+  {
+    const auto c = read<std::uint32_t>(data, max_len);
+    if (c == 0 or (m_galois_field_size < 32 and c >= (1u << m_galois_field_size)))
+    {
+      throw overflow_error{};
+    }
+    return c;
+  }
+
   /// @brief Convenient method to write data using user's handler.
   void
   write(const char* data, std::size_t len)
@@ -351,11 +500,44 @@ private:
     return ids;
   }
 
+  /// @brief Write the type of a packet, with the session flag if needed and other @p flags.
+  void
+  write_type(packet_type ty, std::uint8_t flags = 0)
+  noexcept(noexcept(std::declval<PacketHandler>()(nullptr, 0ul)))
+  {
+    const auto flag = m_session ? session_flag : std::uint8_t{0};
+    write<std::uint8_t>(static_cast<std::uint8_t>(ty) | flag | flags);
+  }
+
+  /// @brief Get the number of bytes of a packet before its session identifier, if any.
+  /// @throw overflow_error
+  static
+  std::size_t
+  payload_size(const packet& p)
+  {
+    if (not has_session(p))
+    {
+      return p.size();
+    }
+    if (p.size() < sizeof(std::uint32_t))
+    {
+      throw overflow_error{};
+    }
+    return p.size() - sizeof(std::uint32_t);
+  }
+
   /// @brief Convenient method to indicate end of data to user's handler.
+  ///
+  /// The session identifier, if any, is written first.
   void
   mark_end()
-  noexcept(noexcept(std::declval<PacketHandler>()()))
+  noexcept(noexcept(std::declval<PacketHandler>()()) and
+           noexcept(std::declval<PacketHandler>()(nullptr, 0ul)))
   {
+    if (m_session)
+    {
+      write<std::uint32_t>(*m_session);
+    }
     m_packet_handler();
   }
 
@@ -371,6 +553,12 @@ private:
 
   /// @brief A pre-allocated buffer to re-use when performing the running length encoding.
   std::vector<std::pair<std::uint8_t, std::uint16_t>> m_rle_buffer;
+
+  /// @brief The session identifier to put at the end of written packets, if any.
+  boost::optional<std::uint32_t> m_session;
+
+  /// @brief The size of the field of the coefficients carried by read repairs.
+  std::uint8_t m_galois_field_size;
 };
 
 /*------------------------------------------------------------------------------------------------*/
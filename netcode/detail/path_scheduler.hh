@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm> // copy_n, max, min
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <boost/endian/conversion.hpp>
+
+#include "netcode/detail/ack.hh"
+#include "netcode/detail/packet_type.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief What is known about a path.
+struct path_state
+{
+  /// @brief The smoothed ratio of packets lost on this path.
+  double loss;
+
+  /// @brief The smoothed share of this path in the losses of all paths.
+  double loss_share;
+
+  /// @brief The smoothed round-trip time, 0 until a first sample is known.
+  std::chrono::steady_clock::duration rtt;
+
+  /// @brief The credit of the weighted round robin of sources.
+  double source_credit;
+
+  /// @brief The credit of the weighted round robin of repairs.
+  double repair_credit;
+
+  /// @brief The number of packets sent on this path (wraps around).
+  std::uint32_t nb_sent;
+
+  /// @brief The number of packets sent on this path when the last ack was received.
+  std::uint32_t nb_sent_at_last_ack;
+
+  /// @brief The number of packets received on this path reported by the last ack.
+  std::uint32_t nb_received_at_last_ack;
+
+  /// @brief The number of packets counted as lost by previous acks, which were received since.
+  std::uint32_t nb_late;
+
+  /// @brief The total number of sources sent on this path.
+  std::size_t nb_sent_sources;
+
+  /// @brief The total number of repairs sent on this path.
+  std::size_t nb_sent_repairs;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The packet handler of an encoder which distributes packets on several paths.
+///
+/// Sources and repairs are distributed with two smooth weighted round robins. The weight of a path
+/// decreases with its losses and its round-trip time. Repairs are also kept away from the paths
+/// which carried most of the recent losses, as a repair lost with the sources it should rebuild is
+/// useless.
+///
+/// A path is chosen with the first byte of a packet, which tells its type, then the packet is
+/// written directly to the handler of this path.
+template <typename PacketHandler>
+class path_scheduler final
+{
+public:
+
+  /// @brief Constructor.
+  /// @pre @p paths is not empty
+  explicit path_scheduler(std::vector<PacketHandler>&& paths)
+    : m_paths(std::move(paths))
+    , m_states(m_paths.size(), path_state{0, 0, {}, 0, 0, 0, 0, 0, 0, 0, 0})
+    , m_current{0}
+    , m_nb_written{0}
+    , m_is_source{false}
+    , m_source_id{}
+    , m_history{}
+  {
+    assert(not m_paths.empty());
+  }
+
+  /// @brief Write a part of a packet on the path chosen for it.
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    if (len == 0)
+    {
+      return;
+    }
+    if (m_nb_written == 0)
+    {
+      start(static_cast<std::uint8_t>(data[0]));
+    }
+    // Keep the identifier of a source, which follows its type.
+    if (m_is_source and m_nb_written < 1 + sizeof(std::uint32_t))
+    {
+      const auto first = std::max(m_nb_written, std::size_t{1});
+      const auto last = std::min(m_nb_written + len, 1 + sizeof(std::uint32_t));
+      for (auto pos = first; pos < last; ++pos)
+      {
+        m_source_id[pos - 1] = data[pos - m_nb_written];
+      }
+    }
+    m_nb_written += len;
+    m_paths[m_current](data, len);
+  }
+
+  /// @brief Tell the path that the packet has been written.
+  void
+  operator()()
+  {
+    assert(m_nb_written != 0);
+    if (m_is_source)
+    {
+      remember_source(m_current);
+    }
+    m_paths[m_current]();
+    m_nb_written = 0;
+  }
+
+  /// @brief Learn the losses and the round-trip times of paths from an ack.
+  void
+  notify(const ack& a)
+  {
+    if (not a.source_ids().empty())
+    {
+      sample_rtt(*a.source_ids().rbegin());
+    }
+    sample_losses(a.path_counts());
+  }
+
+  /// @brief Get the number of paths.
+  std::size_t
+  nb_paths()
+  const noexcept
+  {
+    return m_paths.size();
+  }
+
+  /// @brief Get the handler of a path.
+  const PacketHandler&
+  path(std::size_t i)
+  const noexcept
+  {
+    return m_paths[i];
+  }
+
+  /// @brief Get the handler of a path.
+  PacketHandler&
+  path(std::size_t i)
+  noexcept
+  {
+    return m_paths[i];
+  }
+
+  /// @brief Get what is known about a path.
+  const path_state&
+  state(std::size_t i)
+  const noexcept
+  {
+    return m_states[i];
+  }
+
+private:
+
+  /// @brief A source sent on a path, waiting for an ack to measure a round-trip time.
+  struct sent_source
+  {
+    std::uint32_t id;
+    std::size_t path;
+    std::chrono::steady_clock::time_point date;
+  };
+
+  /// @brief The weight of a new sample in smoothed values.
+  static constexpr double smoothing = 0.125;
+
+  /// @brief The minimal weight of a path, to keep probing paths which look bad.
+  static constexpr double min_weight = 0.01;
+
+  /// @brief The maximal number of sources waiting for an ack.
+  static constexpr std::size_t max_history = 4096;
+
+  /// @brief The weight of a path for sources.
+  double
+  source_weight(std::size_t i)
+  const noexcept
+  {
+    // Relatively to the fastest path.
+    auto min_rtt = std::chrono::steady_clock::duration::max();
+    for (const auto& st : m_states)
+    {
+      if (st.rtt.count() != 0)
+      {
+        min_rtt = std::min(min_rtt, st.rtt);
+      }
+    }
+    // A millisecond is added to both, so that jitter between fast paths doesn't matter.
+    const auto& st = m_states[i];
+    const auto ms = std::chrono::steady_clock::duration{std::chrono::milliseconds{1}};
+    const auto speed = st.rtt.count() == 0 ? 1.0
+                                           : static_cast<double>((min_rtt + ms).count())
+                                           / static_cast<double>((st.rtt + ms).count());
+    return std::max(min_weight, (1 - st.loss) * speed);
+  }
+
+  /// @brief Choose the path of a new packet.
+  /// @param first_byte The first byte of the packet, which tells its type and its flags
+  void
+  start(std::uint8_t first_byte)
+  noexcept
+  {
+    const auto type = first_byte & ~(session_flag | trailer_flag);
+    m_is_source = type == static_cast<std::uint8_t>(packet_type::source);
+    m_current = m_is_source ? choose(&path_state::source_credit, false)
+                            : choose(&path_state::repair_credit, true);
+    auto& st = m_states[m_current];
+    ++st.nb_sent;
+    if (m_is_source)
+    {
+      ++st.nb_sent_sources;
+    }
+    else
+    {
+      ++st.nb_sent_repairs;
+    }
+  }
+
+  /// @brief Choose a path with a smooth weighted round robin.
+  std::size_t
+  choose(double path_state::* credit, bool repair)
+  noexcept
+  {
+    auto best = std::size_t{0};
+    auto total = 0.0;
+    for (auto i = 0ul; i < m_states.size(); ++i)
+    {
+      auto weight = source_weight(i);
+      if (repair)
+      {
+        weight = std::max(min_weight, weight * (1 - m_states[i].loss_share));
+      }
+      m_states[i].*credit += weight;
+      total += weight;
+      if (m_states[i].*credit > m_states[best].*credit)
+      {
+        best = i;
+      }
+    }
+    m_states[best].*credit -= total;
+    return best;
+  }
+
+  /// @brief Remember when the source being sent left, and on which path.
+  void
+  remember_source(std::size_t i)
+  {
+    auto id = std::uint32_t{0};
+    std::copy_n(m_source_id.data(), sizeof(id), reinterpret_cast<char*>(&id));
+    m_history.push_back(sent_source{ boost::endian::big_to_native(id), i
+                                   , std::chrono::steady_clock::now()});
+    if (m_history.size() > max_history)
+    {
+      m_history.pop_front();
+    }
+  }
+
+  /// @brief Measure the round-trip time of the path which carried the most recent acknowledged
+  /// source.
+  void
+  sample_rtt(std::uint32_t last_id)
+  {
+    while (not m_history.empty() and m_history.front().id < last_id)
+    {
+      m_history.pop_front();
+    }
+    if (m_history.empty() or m_history.front().id != last_id)
+    {
+      return;
+    }
+    const auto sample = std::chrono::steady_clock::now() - m_history.front().date;
+    auto& rtt = m_states[m_history.front().path].rtt;
+    if (rtt.count() == 0)
+    {
+      rtt = sample;
+    }
+    else
+    {
+      rtt += std::chrono::duration_cast<std::chrono::steady_clock::duration>
+               ((sample - rtt) * smoothing);
+    }
+    m_history.pop_front();
+  }
+
+  /// @brief Compare the packets sent on each path with the ones the decoder received.
+  ///
+  /// The decoder only counts paths up to the last one it received a packet from, the following
+  /// ones didn't deliver anything.
+  void
+  sample_losses(const std::vector<std::uint32_t>& counts)
+  {
+    // An ack without counts comes from a decoder which doesn't know about paths.
+    if (counts.empty())
+    {
+      return;
+    }
+    const auto count = [&](std::size_t i)
+    {
+      return i < counts.size() ? counts[i] : std::uint32_t{0};
+    };
+
+    // An ack older than the last one is ignored. Differences handle counters wrapping around.
+    for (auto i = 0ul; i < m_states.size(); ++i)
+    {
+      if (static_cast<std::int32_t>(count(i) - m_states[i].nb_received_at_last_ack) < 0)
+      {
+        return;
+      }
+    }
+
+    auto total_lost = 0.0;
+    auto lost = std::vector<double>(m_states.size(), 0);
+    for (auto i = 0ul; i < m_states.size(); ++i)
+    {
+      auto& st = m_states[i];
+      const auto sent = static_cast<std::uint32_t>(st.nb_sent - st.nb_sent_at_last_ack);
+      const auto received = static_cast<std::uint32_t>(count(i) - st.nb_received_at_last_ack);
+      st.nb_sent_at_last_ack = st.nb_sent;
+      st.nb_received_at_last_ack = count(i);
+
+      // Packets still in flight are counted as lost now. When they are received, they compensate
+      // the next losses of the path, thus late packets don't bias its loss upwards.
+      const auto balance = static_cast<std::int64_t>(sent) - static_cast<std::int64_t>(received)
+                         - static_cast<std::int64_t>(st.nb_late);
+      st.nb_late = balance < 0 ? static_cast<std::uint32_t>(-balance) : 0;
+      if (sent == 0)
+      {
+        continue;
+      }
+      lost[i] = balance < 0 ? 0 : static_cast<double>(balance);
+      total_lost += lost[i];
+      st.loss += (lost[i] / static_cast<double>(sent) - st.loss) * smoothing;
+    }
+    if (total_lost > 0)
+    {
+      for (auto i = 0ul; i < m_states.size(); ++i)
+      {
+        m_states[i].loss_share += (lost[i] / total_lost - m_states[i].loss_share) * smoothing;
+      }
+    }
+  }
+
+private:
+
+  /// @brief The handlers of paths.
+  std::vector<PacketHandler> m_paths;
+
+  /// @brief What is known about each path.
+  std::vector<path_state> m_states;
+
+  /// @brief The path of the packet being written.
+  std::size_t m_current;
+
+  /// @brief The number of bytes of the packet being written, 0 between packets.
+  std::size_t m_nb_written;
+
+  /// @brief Tell if the packet being written is a source.
+  bool m_is_source;
+
+  /// @brief The identifier of the source being written, as written.
+  std::array<char, sizeof(std::uint32_t)> m_source_id;
+
+  /// @brief The sources sent, in order, which were not acknowledged yet.
+  std::deque<sent_source> m_history;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename PacketHandler>
+constexpr double path_scheduler<PacketHandler>::smoothing;
+
+template <typename PacketHandler>
+constexpr double path_scheduler<PacketHandler>::min_weight;
+
+template <typename PacketHandler>
+constexpr std::size_t path_scheduler<PacketHandler>::max_history;
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
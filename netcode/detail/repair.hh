@@ -1,13 +1,25 @@
 #pragma once
 
+#include <cstdint>
+#include <utility> // pair
+#include <vector>
+
 #include "netcode/detail/buffer.hh"
 #include "netcode/detail/source_id_list.hh"
+#include "netcode/coefficient_generator.hh"
 #include "netcode/packet.hh"
 
 namespace ntc { namespace detail {
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @internal
+/// @brief The coefficients carried by a repair, as pairs of a source identifier and of a
+/// coefficient, sorted by identifier.
+using coefficients_type = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @internal
 /// @brief An encoder repair packet.
 class encoder_repair final
@@ -32,6 +44,10 @@ public:
     , m_sources_ids{}
     , m_encoded_size{}
     , m_buffer{}
+    , m_window_start{0}
+    , m_generator{coefficient_generator::arithmetic}
+    , m_block_row{0}
+    , m_coefficients{}
   {}
 
   /// @brief Construct with an existing list of source identifiers and a symbol.
@@ -42,6 +58,10 @@ public:
     , m_sources_ids{std::move(ids)}
     , m_encoded_size{encoded_size}
     , m_buffer{std::move(buffer)}
+    , m_window_start{m_sources_ids.empty() ? 0 : *m_sources_ids.begin()}
+    , m_generator{coefficient_generator::arithmetic}
+    , m_block_row{0}
+    , m_coefficients{}
   {}
 
   /// @brief This repair's identifier.
@@ -119,6 +139,72 @@ public:
     return m_encoded_size;
   }
 
+  /// @brief Get the identifier of the oldest source the encoder still holds.
+  std::uint32_t
+  window_start()
+  const noexcept
+  {
+    return m_window_start;
+  }
+
+  /// @brief Get the identifier of the oldest source the encoder still holds (mutable).
+  std::uint32_t&
+  window_start()
+  noexcept
+  {
+    return m_window_start;
+  }
+
+  /// @brief Get how the coefficients of this repair are generated.
+  coefficient_generator
+  generator()
+  const noexcept
+  {
+    return m_generator;
+  }
+
+  /// @brief Get how the coefficients of this repair are generated (mutable).
+  coefficient_generator&
+  generator()
+  noexcept
+  {
+    return m_generator;
+  }
+
+  /// @brief Get the position of this repair in its block.
+  /// @note Only meaningful for coefficient_generator::block.
+  std::uint16_t
+  block_row()
+  const noexcept
+  {
+    return m_block_row;
+  }
+
+  /// @brief Get the position of this repair in its block (mutable).
+  std::uint16_t&
+  block_row()
+  noexcept
+  {
+    return m_block_row;
+  }
+
+  /// @brief Get the coefficients carried by this repair.
+  /// @note Only meaningful for coefficient_generator::recoded.
+  const coefficients_type&
+  coefficients()
+  const noexcept
+  {
+    return m_coefficients;
+  }
+
+  /// @brief Get the coefficients carried by this repair (mutable).
+  coefficients_type&
+  coefficients()
+  noexcept
+  {
+    return m_coefficients;
+  }
+
 private:
 
   /// @brief This repair's unique identifier.
@@ -132,6 +218,20 @@ private:
 
   /// @brief This repair's symbol.
   detail::zero_byte_buffer m_buffer;
+
+  /// @brief The identifier of the oldest source the encoder still holds.
+  ///
+  /// Sources older than this identifier will never be repaired again.
+  std::uint32_t m_window_start;
+
+  /// @brief How the coefficients of this repair are generated.
+  coefficient_generator m_generator;
+
+  /// @brief The position of this repair in its block.
+  std::uint16_t m_block_row;
+
+  /// @brief The coefficients carried by this repair.
+  coefficients_type m_coefficients;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -165,6 +265,25 @@ public:
     , m_encoded_size{encoded_size}
     , m_symbol_buffer{std::move(p)}
     , m_symbol_size{static_cast<std::uint16_t>(symbol_size)}
+    , m_window_start{m_sources_ids.empty() ? 0 : *m_sources_ids.begin()}
+    , m_generator{coefficient_generator::arithmetic}
+    , m_block_row{0}
+    , m_coefficients{}
+  {}
+
+  /// @brief Construct with an existing list of source identifiers, a symbol and the start of the
+  /// encoder's window.
+  decoder_repair( std::uint32_t id, std::uint16_t encoded_size, source_id_list&& ids
+                , packet&& p, std::size_t symbol_size, std::uint32_t window_start)
+    : m_id{id}
+    , m_sources_ids{std::move(ids)}
+    , m_encoded_size{encoded_size}
+    , m_symbol_buffer{std::move(p)}
+    , m_symbol_size{static_cast<std::uint16_t>(symbol_size)}
+    , m_window_start{window_start}
+    , m_generator{coefficient_generator::arithmetic}
+    , m_block_row{0}
+    , m_coefficients{}
   {}
 
   /// @brief This repair's identifier.
@@ -239,6 +358,64 @@ public:
     return m_symbol_size;
   }
 
+  /// @brief Get the identifier of the oldest source the encoder still holds.
+  std::uint32_t
+  window_start()
+  const noexcept
+  {
+    return m_window_start;
+  }
+
+  /// @brief Get how the coefficients of this repair are generated.
+  coefficient_generator
+  generator()
+  const noexcept
+  {
+    return m_generator;
+  }
+
+  /// @brief Get how the coefficients of this repair are generated (mutable).
+  coefficient_generator&
+  generator()
+  noexcept
+  {
+    return m_generator;
+  }
+
+  /// @brief Get the position of this repair in its block.
+  /// @note Only meaningful for coefficient_generator::block.
+  std::uint16_t
+  block_row()
+  const noexcept
+  {
+    return m_block_row;
+  }
+
+  /// @brief Get the position of this repair in its block (mutable).
+  std::uint16_t&
+  block_row()
+  noexcept
+  {
+    return m_block_row;
+  }
+
+  /// @brief Get the coefficients carried by this repair.
+  /// @note Only meaningful for coefficient_generator::recoded.
+  const coefficients_type&
+  coefficients()
+  const noexcept
+  {
+    return m_coefficients;
+  }
+
+  /// @brief Get the coefficients carried by this repair (mutable).
+  coefficients_type&
+  coefficients()
+  noexcept
+  {
+    return m_coefficients;
+  }
+
 private:
 
   /// @brief This repair's unique identifier.
@@ -255,6 +432,18 @@ private:
 
   /// @brief This repair's symbol size
   std::uint16_t m_symbol_size;
+
+  /// @brief The identifier of the oldest source the encoder still holds.
+  std::uint32_t m_window_start;
+
+  /// @brief How the coefficients of this repair are generated.
+  coefficient_generator m_generator;
+
+  /// @brief The position of this repair in its block.
+  std::uint16_t m_block_row;
+
+  /// @brief The coefficients carried by this repair.
+  coefficients_type m_coefficients;
 };
 
 /*------------------------------------------------------------------------------------------------*/
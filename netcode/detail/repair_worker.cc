@@ -0,0 +1,142 @@
+#include <cassert>
+#include <utility> // move
+
+#include "netcode/detail/repair_worker.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+repair_worker::repair_worker( std::uint8_t galois_field_size, std::size_t capacity
+                            , std::shared_ptr<parallel_executor> executor)
+  : m_encoder{galois_field_size}
+  , m_degrees{}
+  , m_jobs{capacity}
+  , m_done{capacity}
+  , m_free{}
+  , m_nb_pending{0}
+  , m_nb_taken{0}
+  , m_mutex{}
+  , m_cv{}
+  , m_nb_submitted{0}
+  , m_stop{false}
+  , m_thread{}
+{
+  m_encoder.set_executor(std::move(executor));
+  m_thread = std::thread{[this]{run();}};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+repair_worker::~repair_worker()
+{
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+repair_job
+repair_worker::acquire()
+{
+  if (m_free.empty())
+  {
+    return repair_job{};
+  }
+  auto job = std::move(m_free.back());
+  m_free.pop_back();
+  return job;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_worker::submit(repair_job&& job)
+{
+  assert(m_nb_pending < capacity());
+  ++m_nb_pending;
+  // Can't be full, there are less pending jobs than its capacity.
+  m_jobs.push(std::move(job));
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    ++m_nb_submitted;
+  }
+  m_cv.notify_one();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+repair_worker::try_take(repair_job& job)
+{
+  if (not m_done.try_pop(job))
+  {
+    return false;
+  }
+  --m_nb_pending;
+  ++m_nb_taken;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_worker::release(repair_job&& job)
+{
+  if (m_free.size() < capacity())
+  {
+    m_free.push_back(std::move(job));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+repair_worker::run()
+{
+  auto job = repair_job{};
+  auto nb_started = std::size_t{0};
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_cv.wait(lock, [&]{return m_stop or m_nb_submitted != nb_started;});
+      if (m_stop)
+      {
+        return;
+      }
+    }
+    // A job is pushed before the number of submitted jobs is incremented.
+    const auto popped = m_jobs.try_pop(job);
+    assert(popped);
+    static_cast<void>(popped);
+    ++nb_started;
+
+    const auto begin = job.sources.cbegin();
+    const auto end = job.sources.cend();
+    if (job.fountain)
+    {
+      m_degrees.resize(job.sources.size());
+      m_encoder(job.repair, begin, end, m_degrees);
+    }
+    else if (job.density < 1)
+    {
+      m_encoder(job.repair, begin, end, job.density);
+    }
+    else
+    {
+      m_encoder(job.repair, begin, end);
+    }
+
+    // Can't be full, there are less pending jobs than its capacity.
+    m_done.push(std::move(job));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory> // shared_ptr
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "netcode/detail/encoder.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/soliton.hh"
+#include "netcode/detail/source.hh"
+#include "netcode/spsc_queue.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A repair to compute on another thread, from a snapshot of the coding window.
+struct repair_job
+{
+  /// @brief Constructor.
+  repair_job()
+    : repair{0}
+    , sources{}
+    , density{1}
+    , fountain{false}
+  {}
+
+  /// @brief The repair to fill, its identifier and how to generate its coefficients are set.
+  encoder_repair repair;
+
+  /// @brief The sources of the coding window when the repair was requested.
+  std::vector<source_view> sources;
+
+  /// @brief The probability for a source to be encoded.
+  double density;
+
+  /// @brief Tell if the sources to encode are chosen as the ones of a fountain code.
+  bool fountain;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A thread which computes the repairs of an encoder.
+///
+/// Jobs go to the thread and come back through lock-free queues. The encoder's thread only locks
+/// to wake the worker up, once per repair.
+class repair_worker final
+{
+public:
+
+  /// @brief Can't copy-construct a worker.
+  repair_worker(const repair_worker&) = delete;
+
+  /// @brief Can't copy a worker.
+  repair_worker& operator=(const repair_worker&) = delete;
+
+  /// @brief Constructor, starts the thread.
+  /// @param galois_field_size The size of the Galois field.
+  /// @param capacity The maximal number of pending jobs, a power of two.
+  /// @param executor Split the symbols of large repairs, can be a null pointer.
+  repair_worker( std::uint8_t galois_field_size, std::size_t capacity
+               , std::shared_ptr<parallel_executor> executor);
+
+  /// @brief Destructor, stops the thread.
+  ///
+  /// Pending jobs are dropped.
+  ~repair_worker();
+
+  /// @brief Get a job to fill, which re-uses the memory of a previous one if possible.
+  repair_job
+  acquire();
+
+  /// @brief Give a job to the thread.
+  /// @pre nb_pending() < capacity()
+  void
+  submit(repair_job&& job);
+
+  /// @brief Take the oldest job whose repair is computed, if any.
+  bool
+  try_take(repair_job& job);
+
+  /// @brief Give back a job once its repair is sent.
+  void
+  release(repair_job&& job);
+
+  /// @brief Get the number of submitted jobs not yet taken.
+  std::size_t
+  nb_pending()
+  const noexcept
+  {
+    return m_nb_pending;
+  }
+
+  /// @brief Get the number of jobs that have been taken.
+  std::size_t
+  nb_taken()
+  const noexcept
+  {
+    return m_nb_taken;
+  }
+
+  /// @brief Get the maximal number of pending jobs.
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_jobs.capacity();
+  }
+
+private:
+
+  /// @brief The loop of the thread.
+  void
+  run();
+
+private:
+
+  /// @brief The coder of the thread.
+  detail::encoder m_encoder;
+
+  /// @brief The distribution of the degrees of fountain repairs.
+  soliton_distribution m_degrees;
+
+  /// @brief Jobs to compute.
+  spsc_queue<repair_job> m_jobs;
+
+  /// @brief Computed jobs.
+  spsc_queue<repair_job> m_done;
+
+  /// @brief Jobs given back, to be re-used.
+  std::vector<repair_job> m_free;
+
+  /// @brief The number of submitted jobs not yet taken.
+  std::size_t m_nb_pending;
+
+  /// @brief The number of taken jobs.
+  std::size_t m_nb_taken;
+
+  /// @brief Protect m_nb_submitted and m_stop.
+  std::mutex m_mutex;
+
+  /// @brief Wake the thread up.
+  std::condition_variable m_cv;
+
+  /// @brief The number of submitted jobs.
+  std::size_t m_nb_submitted;
+
+  /// @brief Tell the thread to stop.
+  bool m_stop;
+
+  /// @brief The thread, started once all other members are constructed.
+  std::thread m_thread;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm> // upper_bound
+#include <cassert>
+#include <cmath>     // ceil, log, sqrt
+#include <cstddef>   // size_t
+#include <cstdint>
+#include <vector>
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The robust soliton distribution of the degrees of the repairs of a fountain code.
+///
+/// Most repairs encode a few sources, thus they are cheap to compute and the decoder can often
+/// rebuild sources by peeling, while a few repairs encode many sources, so that all sources are
+/// eventually covered.
+class soliton_distribution final
+{
+public:
+
+  /// @brief Constructor.
+  /// @param c A tuning parameter, the higher, the more repairs of degree about k / R.
+  /// @param delta The allowed probability of failure of the decoding.
+  explicit soliton_distribution(double c = 0.1, double delta = 0.5)
+    : m_c{c}
+    , m_delta{delta}
+    , m_k{0}
+    , m_cdf{}
+  {}
+
+  /// @brief Compute the distribution for a number of sources.
+  /// @param k The number of sources.
+  /// @pre @p k > 0
+  ///
+  /// Nothing is done if the distribution was already computed for @p k.
+  void
+  resize(std::size_t k)
+  {
+    assert(k > 0);
+    if (k == m_k)
+    {
+      return;
+    }
+    m_k = k;
+    m_cdf.resize(k);
+
+    const auto kd = static_cast<double>(k);
+    const auto r = m_c * std::log(kd / m_delta) * std::sqrt(kd);
+    const auto spike = r > 0 ? static_cast<std::size_t>(std::ceil(kd / r)) : k;
+
+    // Ideal soliton (rho) plus the robust part (tau).
+    auto sum = 0.0;
+    for (auto d = 1ul; d <= k; ++d)
+    {
+      const auto dd = static_cast<double>(d);
+      auto p = d == 1 ? 1.0 / kd : 1.0 / (dd * (dd - 1));
+      if (d < spike)
+      {
+        p += r / (dd * kd);
+      }
+      else if (d == spike)
+      {
+        p += r * std::log(r / m_delta) / kd;
+      }
+      sum += p;
+      m_cdf[d - 1] = sum;
+    }
+    for (auto& p : m_cdf)
+    {
+      p /= sum;
+    }
+  }
+
+  /// @brief Draw a degree.
+  /// @param random A random value, uniformly distributed over 64 bits.
+  /// @return A degree in [1, k].
+  std::size_t
+  operator()(std::uint64_t random)
+  const noexcept
+  {
+    assert(m_k > 0);
+    // 53 bits give a uniform double in [0, 1).
+    const auto u = static_cast<double>(random >> 11) / 9007199254740992.0 /* 2^53 */;
+    const auto pos = std::upper_bound(m_cdf.begin(), m_cdf.end(), u) - m_cdf.begin();
+    return std::min(m_k, static_cast<std::size_t>(pos) + 1);
+  }
+
+  /// @brief Get the number of sources this distribution was computed for.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_k;
+  }
+
+private:
+
+  /// @brief The tuning parameter of the robust part.
+  double m_c;
+
+  /// @brief The allowed probability of failure of the decoding.
+  double m_delta;
+
+  /// @brief The number of sources.
+  std::size_t m_k;
+
+  /// @brief The cumulative distribution of degrees, from degree 1 to degree k.
+  std::vector<double> m_cdf;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
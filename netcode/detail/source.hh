@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "netcode/packet.hh"
 
 namespace ntc { namespace detail {
@@ -28,6 +30,7 @@ public:
   encoder_source(std::uint32_t id, detail::byte_buffer&& p)
     : m_id{id}
     , m_symbol_buffer{std::move(p)}
+    , m_date{std::chrono::steady_clock::now()}
   {}
 
   /// @brief Get this source's identifier
@@ -62,6 +65,14 @@ public:
     return static_cast<std::uint16_t>(m_symbol_buffer.size());
   }
 
+  /// @brief Get the date at which this source was created
+  std::chrono::steady_clock::time_point
+  date()
+  const noexcept
+  {
+    return m_date;
+  }
+
 private:
 
   /// @brief This source's unique identifier
@@ -69,6 +80,63 @@ private:
 
   /// @brief This source's symbol
   detail::byte_buffer m_symbol_buffer;
+
+  /// @brief The date at which this source was created
+  std::chrono::steady_clock::time_point m_date;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief A view on the symbol of an encoder's source, to encode it on another thread
+///
+/// It doesn't refer to the source itself, only to the memory of its symbol, which doesn't move
+/// when the source is moved.
+class source_view final
+{
+public:
+
+  /// @brief Constructor
+  explicit source_view(const encoder_source& src) noexcept
+    : m_id{src.id()}
+    , m_symbol{src.symbol().data()}
+    , m_size{src.size()}
+  {}
+
+  /// @brief Get the source's identifier
+  std::uint32_t
+  id()
+  const noexcept
+  {
+    return m_id;
+  }
+
+  /// @brief Get the bytes of the symbol
+  const char*
+  symbol()
+  const noexcept
+  {
+    return m_symbol;
+  }
+
+  /// @brief Get the number of bytes in the user's symbol
+  std::uint16_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+private:
+
+  /// @brief The source's identifier
+  std::uint32_t m_id;
+
+  /// @brief The bytes of the symbol
+  const char* m_symbol;
+
+  /// @brief The number of bytes in the user's symbol
+  std::uint16_t m_size;
 };
 
 /*------------------------------------------------------------------------------------------------*/
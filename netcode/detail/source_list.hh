@@ -1,6 +1,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_id_list.hh"
@@ -20,19 +21,26 @@ public:
 
 public:
 
+  /// @brief Constructor.
+  source_list()
+    : m_sources{}
+    , m_nb_bytes{0}
+    , m_retired{nullptr}
+  {}
+
   /// @brief Add a source packet in-place.
   /// @return A reference to the added source.
   const encoder_source&
   emplace(std::uint32_t id, byte_buffer&& symbol)
   {
     m_sources.emplace_back(id, std::move(symbol));
+    m_nb_bytes += m_sources.back().size();
     return m_sources.back();
   }
 
   /// @brief Remove source packets from a list of identifiers.
   void
   erase(source_id_list::const_iterator id_cit, source_id_list::const_iterator id_end)
-  noexcept
   {
     // m_sources is sorted by insertion (and thus by identifier).
     auto source_it = m_sources.begin();
@@ -42,6 +50,8 @@ public:
       if (source_it->id() == *id_cit)
       {
         // We found an identifier to erase.
+        m_nb_bytes -= source_it->size();
+        retire(*source_it);
         source_it = m_sources.erase(source_it);
         ++id_cit;
       }
@@ -67,6 +77,14 @@ public:
     return m_sources.size();
   }
 
+  /// @brief The number of bytes of all symbols.
+  std::size_t
+  nb_bytes()
+  const noexcept
+  {
+    return m_nb_bytes;
+  }
+
   /// @brief Get an iterator to the first source.
   const_iterator
   cbegin()
@@ -86,15 +104,57 @@ public:
   /// @brief Drop the first source.
   void
   pop_front()
-  noexcept
   {
+    m_nb_bytes -= m_sources.front().size();
+    retire(m_sources.front());
     m_sources.pop_front();
   }
 
+  /// @brief Drop all sources.
+  void
+  clear()
+  {
+    for (auto& src : m_sources)
+    {
+      retire(src);
+    }
+    m_sources.clear();
+    m_nb_bytes = 0;
+  }
+
+  /// @brief Give the symbols of removed sources to @p retired rather than freeing them.
+  /// @param retired Where to keep symbols, nullptr to free them.
+  ///
+  /// Symbols which are still read by another thread thus stay valid.
+  void
+  set_retired(std::vector<byte_buffer>* retired)
+  noexcept
+  {
+    m_retired = retired;
+  }
+
+private:
+
+  /// @brief Keep the symbol of a source about to be removed, if asked to.
+  void
+  retire(encoder_source& src)
+  {
+    if (m_retired)
+    {
+      m_retired->push_back(std::move(src.symbol()));
+    }
+  }
+
 private:
 
   /// @brief The real container of source packets.
   std::list<encoder_source> m_sources;
+
+  /// @brief The number of bytes of all symbols.
+  std::size_t m_nb_bytes;
+
+  /// @brief Where to keep the symbols of removed sources, if any.
+  std::vector<byte_buffer>* m_retired;
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -17,8 +17,8 @@ struct is_encoder
 
 /// @internal
 /// @brief Trait to detect if a type is ntc::encoder.
-template <typename PacketHandler>
-struct is_encoder<ntc::encoder<PacketHandler>>
+template <typename PacketHandler, typename RateController>
+struct is_encoder<ntc::encoder<PacketHandler, RateController>>
 {
   static constexpr auto value = true;
 };
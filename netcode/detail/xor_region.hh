@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint>
+#include <cstring> // memcpy
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Add (xor) a region to another one.
+/// @param src The region to add.
+/// @param dst The region to add to, where the result is put.
+/// @param len The size of @p src and @p dst regions.
+///
+/// It's the region operation of a binary field: it runs at the speed of memory. The widest vector
+/// instructions the compiler targets are used, then 64 bits words for the remaining bytes.
+inline
+void
+xor_region(const char* src, char* dst, std::size_t len)
+noexcept
+{
+  auto i = 0ul;
+
+#if defined(__AVX2__)
+  for (; i + 32 <= len; i += 32)
+  {
+    const auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    const auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(s, d));
+  }
+#endif
+
+#if defined(__SSE2__)
+  for (; i + 16 <= len; i += 16)
+  {
+    const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(s, d));
+  }
+#endif
+
+  for (; i + sizeof(std::uint64_t) <= len; i += sizeof(std::uint64_t))
+  {
+    std::uint64_t s;
+    std::uint64_t d;
+    std::memcpy(&s, src + i, sizeof(std::uint64_t));
+    std::memcpy(&d, dst + i, sizeof(std::uint64_t));
+    d ^= s;
+    std::memcpy(dst + i, &d, sizeof(std::uint64_t));
+  }
+
+  for (; i < len; ++i)
+  {
+    dst[i] = static_cast<char>(dst[i] ^ src[i]);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
@@ -8,6 +8,17 @@
 /// @defgroup ntc_decoder Decoding data
 /// @ingroup ntc
 
+/// @defgroup ntc_recoder Recoding data on intermediate nodes
+/// @ingroup ntc
+
+/// @defgroup ntc_transport Exchanging packets over UDP
+/// @ingroup ntc
+///
+/// Only available on Linux, in the ntc_transport library.
+
+/// @defgroup ntc_threads Handing off data and packets between threads
+/// @ingroup ntc
+
 /// @defgroup ntc_data Manipulating data
 /// @ingroup ntc
 
@@ -28,6 +39,9 @@
 /// @defgroup c_decoder Decoding data
 /// @ingroup c_ntc
 
+/// @defgroup c_recoder Recoding data on intermediate nodes
+/// @ingroup c_ntc
+
 /// @defgroup c_data Manipulating data
 /// @ingroup c_ntc
 
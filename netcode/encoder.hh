@@ -3,19 +3,33 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
-#include <cmath>
+#include <deque>
+#include <functional>
+#include <iterator> // distance, prev
 #include <limits> // numeric_limits
+#include <memory> // shared_ptr, unique_ptr
+#include <thread> // yield
+#include <utility> // forward, pair
+#include <vector>
+
+#include <boost/optional.hpp>
 
 #include "netcode/detail/encoder.hh"
 #include "netcode/detail/packet_type.hh"
 #include "netcode/detail/packetizer.hh"
 #include "netcode/detail/repair.hh"
+#include "netcode/detail/repair_worker.hh"
+#include "netcode/detail/soliton.hh"
 #include "netcode/detail/source.hh"
 #include "netcode/detail/source_list.hh"
 #include "netcode/detail/visibility.hh"
+#include "netcode/coefficient_generator.hh"
 #include "netcode/data.hh"
+#include "netcode/encoder_fwd.hh"
 #include "netcode/errors.hh"
 #include "netcode/packet.hh"
+#include "netcode/parallel_executor.hh"
+#include "netcode/rate_controller.hh"
 #include "netcode/systematic.hh"
 
 namespace ntc {
@@ -24,7 +38,9 @@ namespace ntc {
 
 /// @brief The class to interact with on the sender side
 /// @ingroup ntc_encoder
-template <typename PacketHandler>
+/// @tparam PacketHandler The handler of packets ready to be sent on the network
+/// @tparam RateController How the rate is computed in adaptive mode (see loss_rate_controller)
+template <typename PacketHandler, typename RateController>
 class NTC_PUBLIC encoder final
 {
 public:
@@ -32,6 +48,9 @@ public:
   /// @brief The type of the handler that processes data ready to be sent on the network
   using packet_handler_type = PacketHandler;
 
+  /// @brief The type of the component that computes the rate in adaptive mode
+  using rate_controller_type = RateController;
+
 public:
 
   /// @brief Can't copy-construct an encoder
@@ -47,13 +66,32 @@ public:
   encoder& operator=(encoder&&) = delete;
 
   /// @brief Constructor
+  /// @param galois_field_size The size of the Galois field: 4, 8, 16 or 32, or 1 for a binary code
+  /// @param packet_handler The handler of packets ready to be sent on the network
+  ///
+  /// A binary code only sums (xor) sources, which is much cheaper but less efficient: to keep
+  /// repairs independent, they encode a pseudo-random half of the coding window by default.
+  /// @see set_density
   template <typename PacketHandler_>
   encoder(std::uint8_t galois_field_size, PacketHandler_&& packet_handler)
     : m_galois_field_size{galois_field_size}
     , m_code_type{systematic::yes}
+    , m_coefficients{coefficient_generator::arithmetic}
     , m_rate{5}
     , m_window_size{std::numeric_limits<std::size_t>::max()}
+    , m_max_window_bytes{std::numeric_limits<std::size_t>::max()}
+    , m_max_source_age{0}
+    , m_coding_window{std::numeric_limits<std::size_t>::max()}
+    , m_density{galois_field_size == 1 ? 0.5 : 1}
     , m_adaptive{false}
+    , m_repair_period{0}
+    , m_on_demand_repairs{false}
+    , m_block_size{0}
+    , m_block_repairs{0}
+    , m_nb_block_sources{0}
+    , m_block_start{0}
+    , m_fountain{false}
+    , m_degrees{}
     , m_current_source_id{0}
     , m_current_repair_id{0}
     , m_sources{}
@@ -65,14 +103,25 @@ public:
     , m_nb_acks{0ul}
     , m_nb_sent_sources{0ul}
     , m_nb_sent_packets{0}
+    , m_rate_controller{}
+    , m_first_unreported_id{0}
+    , m_first_unchecked_id{0}
+    , m_covered_ends{}
+    , m_covered_end{0}
+    , m_nb_unprotected_sources{0}
+    , m_unprotected_since{}
+    , m_nb_evicted_sources{0}
+    , m_eviction_handler{}
+    , m_retired{}
+    , m_retired_batches{}
+    , m_repair_worker{}
   {
-    // Let's reserve some memory for the repair, it will most likely avoid initial memory
-    // allocations.
-    m_repair.symbol().reserve(2048);
-    // Same thing for the list of source identifiers.
-    // Uncomment the following when the undefined behavior spotted by GCC 5.1 -fsanitize=undefined
-    // is fixed. In the meantime, it's not a real problem,it will just cost a few initial
-    // allocations before the source ids list grows to a suitable size.
+    // No memory is reserved for the repair's symbol: it's allocated with the first repair, so
+    // that creating many encoders is cheap.
+    // To reserve some memory for the list of source identifiers, uncomment the following when the
+    // undefined behavior spotted by GCC 5.1 -fsanitize=undefined is fixed. In the meantime, it's
+    // not a real problem,it will just cost a few initial allocations before the source ids list
+    // grows to a suitable size.
     // m_repair.source_ids().reserve(128);
   }
 
@@ -110,6 +159,27 @@ public:
     return notify_impl(std::move(p));
   }
 
+  /// @internal
+  /// @brief Notify the encoder of an ack which has already been read
+  ///
+  /// It spares a second parsing to a wrapper which also reads acks (see multipath_encoder).
+  void
+  notify(const detail::ack& a)
+  {
+    send_ready_repairs();
+    ++m_nb_acks;
+    if (m_adaptive)
+    {
+      m_rate = m_rate_controller(mk_feedback(a));
+    }
+    m_nb_sent_packets = 0;
+    m_sources.erase(begin(a.source_ids()), end(a.source_ids()));
+    if (m_on_demand_repairs)
+    {
+      send_on_demand_repairs(a);
+    }
+  }
+
   /// @brief The number of packets which have not been acknowledged
   std::size_t
   window()
@@ -159,13 +229,118 @@ public:
   }
 
   /// @brief Force the generation of a repair
+  ///
+  /// The repair encodes the sources of the coding window. With a block code, the current block is
+  /// closed instead: its repairs are sent, even if it has less sources than the block size.
+  /// @see set_coding_window
+  /// @see set_block_code
   void
   generate_repair()
   {
-    m_repair.reset();
-    mk_repair();
-    ++m_nb_sent_packets;
-    m_packetizer.write_repair(m_repair);
+    if (m_block_size != 0)
+    {
+      close_block();
+      return;
+    }
+
+    if (m_repair_worker)
+    {
+      submit_repair();
+    }
+    else if (m_fountain)
+    {
+      const auto begin = coding_window_begin();
+      m_degrees.resize(static_cast<std::size_t>(std::distance(begin, m_sources.cend())));
+      send_repair(begin, m_sources.cend(), m_degrees);
+    }
+    else if (m_density < 1)
+    {
+      send_repair(coding_window_begin(), m_sources.cend(), m_density);
+    }
+    else
+    {
+      send_repair(coding_window_begin(), m_sources.cend());
+    }
+    protect_sources();
+  }
+
+  /// @brief Generate a repair if the repair period has elapsed
+  /// @param now The current date
+  /// @return true if a repair was generated
+  /// @see set_repair_period
+  /// @see next_deadline
+  bool
+  poll(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now())
+  {
+    send_ready_repairs();
+    evict_outdated(now);
+    if (now < next_deadline())
+    {
+      return false;
+    }
+    generate_repair();
+    return true;
+  }
+
+  /// @brief Get the date at which poll() should be called to generate a repair
+  ///
+  /// It's std::chrono::steady_clock::time_point::max() if there is no need to call poll(), that is
+  /// when there is no repair period or when all sources are protected by a repair.
+  std::chrono::steady_clock::time_point
+  next_deadline()
+  const noexcept
+  {
+    if ( m_repair_period == std::chrono::milliseconds{0} or m_nb_unprotected_sources == 0
+        or m_sources.size() == 0)
+    {
+      return std::chrono::steady_clock::time_point::max();
+    }
+    return m_unprotected_since + m_repair_period;
+  }
+
+  /// @brief Force the generation of a repair which encodes a range of sources
+  /// @param first_id The identifier of the first source to encode
+  /// @param last_id The identifier of the last source to encode
+  /// @return false if no source in [first_id, last_id] is still held by the encoder, in which
+  /// case no repair is sent
+  ///
+  /// The decoder can rebuild lost sources from such a repair by solving a system which is as small
+  /// as the range, rather than as large as the whole window. In a binary field, the repair only
+  /// encodes a pseudo-random half of the range, so that successive repairs of a range differ.
+  bool
+  generate_repair(std::uint32_t first_id, std::uint32_t last_id)
+  {
+    const auto range = sources_range(first_id, last_id);
+    if (range.first == range.second)
+    {
+      return false;
+    }
+    send_targeted_repair(range.first, range.second);
+    return true;
+  }
+
+  /// @brief Force the generation of a repair which encodes a subset of sources
+  /// @param ids The sorted identifiers of the sources to encode
+  /// @return false if none of @p ids is still held by the encoder, in which case no repair is
+  /// sent
+  ///
+  /// Identifiers of sources which are no longer held by the encoder are ignored. In a binary field,
+  /// as for a range, the repair only encodes a pseudo-random half of the sources.
+  bool
+  generate_repair(const std::vector<std::uint32_t>& ids)
+  {
+    assert(std::is_sorted(ids.begin(), ids.end()) && "Unsorted identifiers");
+    const auto found = std::find_if( m_sources.cbegin(), m_sources.cend()
+                                   , [&](const detail::encoder_source& src)
+                                     {
+                                       return std::binary_search(ids.begin(), ids.end(), src.id());
+                                     });
+    if (found == m_sources.cend())
+    {
+      return false;
+    }
+    send_targeted_repair(m_sources, ids);
+    return true;
   }
 
   /// @brief Get the Galois's field size
@@ -193,6 +368,46 @@ public:
     return m_code_type;
   }
 
+  /// @brief Set how the coefficients of repairs are generated
+  ///
+  /// The generator is sent along each repair, thus the decoder doesn't need to be configured.
+  /// @see coefficient_generator
+  encoder&
+  set_coefficients(coefficient_generator g)
+  noexcept
+  {
+    m_coefficients = g;
+    return *this;
+  }
+
+  /// @brief Get how the coefficients of repairs are generated
+  coefficient_generator
+  coefficients()
+  const noexcept
+  {
+    return m_coefficients;
+  }
+
+  /// @brief Set the session identifier to put in all sent packets
+  ///
+  /// It lets a session_table on the other side dispatch packets of many flows sharing a socket. A
+  /// decoder doesn't need to be told which session it belongs to.
+  encoder&
+  set_session(std::uint32_t id)
+  noexcept
+  {
+    m_packetizer.set_session(id);
+    return *this;
+  }
+
+  /// @brief Get the session identifier put in all sent packets, if any
+  boost::optional<std::uint32_t>
+  session()
+  const noexcept
+  {
+    return m_packetizer.session();
+  }
+
   /// @brief Set how many sources are sent before a repair is generated
   /// @pre @p rate > 0
   encoder&
@@ -231,6 +446,144 @@ public:
     return m_window_size;
   }
 
+  /// @brief Set the maximal number of sources encoded by a repair
+  /// @pre @p sz > 0
+  ///
+  /// Repairs generated by the rate, by poll() or by generate_repair() only encode the @p sz most
+  /// recent sources of the window, thus the cost of encoding and decoding them doesn't depend on
+  /// the delay of acks. Older sources are still kept until they are acknowledged, so they can be
+  /// repaired with targeted repairs (see generate_repair(std::uint32_t, std::uint32_t) and
+  /// set_on_demand_repairs).
+  encoder&
+  set_coding_window(std::size_t sz)
+  noexcept
+  {
+    assert(sz > 0);
+    m_coding_window = sz;
+    return *this;
+  }
+
+  /// @brief Get the maximal number of sources encoded by a repair
+  std::size_t
+  coding_window()
+  const noexcept
+  {
+    return m_coding_window;
+  }
+
+  /// @brief Set the probability for a source of the coding window to be encoded by a repair
+  /// @pre 0 < @p density <= 1
+  ///
+  /// With a density lower than 1 (the default), repairs generated by the rate, by poll() or by
+  /// generate_repair() only encode a pseudo-random subset of the coding window, which always
+  /// contains the most recent source. The cost of encoding is thus proportional to the density,
+  /// and the decoder has more opportunities to rebuild sources without inverting a matrix.
+  encoder&
+  set_density(double density)
+  noexcept
+  {
+    assert(density > 0 and density <= 1);
+    m_density = density;
+    return *this;
+  }
+
+  /// @brief Get the probability for a source of the coding window to be encoded by a repair
+  double
+  density()
+  const noexcept
+  {
+    return m_density;
+  }
+
+  /// @brief Set the maximal number of bytes the encoder's window can hold
+  /// @pre @p nb > 0
+  ///
+  /// The oldest sources are evicted to make room for a new one. The newest source is always kept,
+  /// even if it's larger than @p nb.
+  encoder&
+  set_max_window_bytes(std::size_t nb)
+  noexcept
+  {
+    assert(nb > 0);
+    m_max_window_bytes = nb;
+    return *this;
+  }
+
+  /// @brief Get the maximal number of bytes the encoder's window can hold
+  std::size_t
+  max_window_bytes()
+  const noexcept
+  {
+    return m_max_window_bytes;
+  }
+
+  /// @brief Get the number of bytes held by the encoder's window
+  std::size_t
+  window_bytes()
+  const noexcept
+  {
+    return m_sources.nb_bytes();
+  }
+
+  /// @brief Set the maximal age of sources held by the encoder's window
+  ///
+  /// Outdated sources are evicted when a new data is given to the encoder and when poll() is
+  /// called. If 0 (the default), sources are never evicted because of their age.
+  encoder&
+  set_max_source_age(std::chrono::milliseconds age)
+  noexcept
+  {
+    m_max_source_age = age;
+    return *this;
+  }
+
+  /// @brief Get the maximal age of sources held by the encoder's window
+  std::chrono::milliseconds
+  max_source_age()
+  const noexcept
+  {
+    return m_max_source_age;
+  }
+
+  /// @brief Get the number of sources evicted from the window before being acknowledged
+  std::size_t
+  nb_evicted_sources()
+  const noexcept
+  {
+    return m_nb_evicted_sources;
+  }
+
+  /// @brief Set a function to call with the identifier of each source evicted from the window
+  /// before being acknowledged
+  encoder&
+  set_eviction_handler(std::function<void(std::uint32_t)> handler)
+  {
+    m_eviction_handler = std::move(handler);
+    return *this;
+  }
+
+  /// @brief Set the maximal time a source can wait for a repair
+  ///
+  /// When sources have been sent since the last repair, a new repair is generated by poll() as
+  /// soon as the oldest of these sources is older than @p period. It bounds the time needed to
+  /// recover a loss when the traffic is too sparse to trigger repairs with the rate. If 0 (the
+  /// default), repairs are generated only by the rate.
+  encoder&
+  set_repair_period(std::chrono::milliseconds period)
+  noexcept
+  {
+    m_repair_period = period;
+    return *this;
+  }
+
+  /// @brief Get the maximal time a source can wait for a repair
+  std::chrono::milliseconds
+  repair_period()
+  const noexcept
+  {
+    return m_repair_period;
+  }
+
   /// @brief Set the adaptive mode of the code
   encoder&
   set_adaptive(bool adaptive)
@@ -248,22 +601,247 @@ public:
     return m_adaptive;
   }
 
+  /// @brief Get the component that computes the rate in adaptive mode
+  const rate_controller_type&
+  rate_controller()
+  const noexcept
+  {
+    return m_rate_controller;
+  }
+
+  /// @brief Get the component that computes the rate in adaptive mode
+  rate_controller_type&
+  rate_controller()
+  noexcept
+  {
+    return m_rate_controller;
+  }
+
+  /// @brief Set if repairs are sent as soon as an ack reports that the decoder needs some
+  ///
+  /// For each cluster of lost sources reported by the decoder (see
+  /// decoder::set_deficit_feedback), the encoder immediately sends as many repairs as the decoder
+  /// still needs, built only from the sources of this cluster.
+  encoder&
+  set_on_demand_repairs(bool on_demand)
+  noexcept
+  {
+    m_on_demand_repairs = on_demand;
+    return *this;
+  }
+
+  /// @brief Get if repairs are sent as soon as an ack reports that the decoder needs some
+  bool
+  on_demand_repairs()
+  const noexcept
+  {
+    return m_on_demand_repairs;
+  }
+
+  /// @brief Use a systematic block code rather than a sliding window
+  /// @param k The number of sources of a block, 0 to go back to the sliding window
+  /// @param m The number of repairs sent for each block
+  /// @pre The Galois field size is 4, 8 or 16
+  /// @pre @p k and @p m are lower than or equal to 2^(w-1), w being the size of the Galois field
+  ///
+  /// Each time @p k sources have been sent, @p m repairs which encode all of them are sent, then a
+  /// new block begins. The sources of a block are no longer held by the encoder once the next block
+  /// begins: the ones which were not acknowledged are evicted (see nb_evicted_sources). The
+  /// coefficients are those of a Cauchy matrix, thus the decoder can rebuild any @p m lost packets
+  /// of a block. A coefficient depends on the offset of its source from the start of the block,
+  /// which repairs carry as their window start: acks received in the middle of a block don't change
+  /// it, thus the same losses always give the same matrix, whose inverse the decoder re-uses. The
+  /// rate, the code type and the coefficients generator are then ignored.
+  /// @see coefficient_generator::block
+  encoder&
+  set_block_code(std::size_t k, std::size_t m)
+  {
+    assert(m_galois_field_size == 4 or m_galois_field_size == 8 or m_galois_field_size == 16);
+    assert(k <= (1u << (m_galois_field_size - 1)) and m <= (1u << (m_galois_field_size - 1)));
+    assert(k == 0 or m > 0);
+    if (m_nb_block_sources != 0)
+    {
+      close_block();
+    }
+    m_block_size = k;
+    m_block_repairs = m;
+    return *this;
+  }
+
+  /// @brief Set if repairs are generated as the ones of a rateless (fountain) code
+  ///
+  /// Each repair encodes a number of sources of the coding window drawn from a robust soliton
+  /// distribution: most repairs encode a few sources, thus they are cheap to compute and to
+  /// decode by peeling, while a few encode many sources so that all losses are eventually covered.
+  /// As a repair doesn't depend on the losses of a particular decoder, the same stream of repairs,
+  /// generated by the rate, by poll() or by generate_repair(), can be sent to many decoders without
+  /// any feedback. It overrides the density.
+  /// @see set_density
+  encoder&
+  set_fountain(bool fountain)
+  noexcept
+  {
+    m_fountain = fountain;
+    return *this;
+  }
+
+  /// @brief Get if repairs are generated as the ones of a rateless (fountain) code
+  bool
+  fountain()
+  const noexcept
+  {
+    return m_fountain;
+  }
+
+  /// @brief Set if repairs of the coding window are computed on another thread
+  ///
+  /// In this asynchronous mode, repairs generated by the rate, by poll() or by generate_repair()
+  /// are computed by a thread of this encoder, from a snapshot of the coding window. Giving a data
+  /// to the encoder thus only costs sending its source, whatever the size of the window. Repairs
+  /// are given to the packet handler on the thread of the encoder: once they are ready, by the
+  /// next data, ack, call to poll() or to wait_repairs(). If the thread is too far behind, the
+  /// encoder waits for it.
+  ///
+  /// Targeted repairs, on-demand repairs and the repairs of a block code are still computed
+  /// synchronously. Leaving this mode waits for pending repairs.
+  /// @see wait_repairs
+  encoder&
+  set_async_repairs(bool async)
+  {
+    if (async == static_cast<bool>(m_repair_worker))
+    {
+      return *this;
+    }
+    if (async)
+    {
+      m_repair_worker.reset(new detail::repair_worker{ m_galois_field_size, max_pending_repairs
+                                                     , m_encoder.executor()});
+      m_sources.set_retired(&m_retired);
+    }
+    else
+    {
+      wait_repairs();
+      m_repair_worker.reset();
+      m_sources.set_retired(nullptr);
+    }
+    return *this;
+  }
+
+  /// @brief Get if repairs of the coding window are computed on another thread
+  bool
+  async_repairs()
+  const noexcept
+  {
+    return static_cast<bool>(m_repair_worker);
+  }
+
+  /// @brief Wait for the repairs being computed in asynchronous mode, and send them
+  void
+  wait_repairs()
+  {
+    while (nb_pending_repairs() != 0)
+    {
+      std::this_thread::yield();
+      send_ready_repairs();
+    }
+  }
+
+  /// @brief Get the number of repairs being computed in asynchronous mode
+  std::size_t
+  nb_pending_repairs()
+  const noexcept
+  {
+    return m_repair_worker ? m_repair_worker->nb_pending() : 0;
+  }
+
+  /// @brief Set the executor which splits the computation of repairs of large symbols
+  /// @param executor Can be shared with other encoders and decoders, or a null pointer to compute
+  /// repairs on a single thread.
+  ///
+  /// With jumbo symbols, a repair is computed stripe by stripe on the threads of the executor.
+  /// In asynchronous mode, pending repairs are waited for and the thread which computes them then
+  /// uses the executor.
+  /// @see parallel_executor
+  encoder&
+  set_parallel_executor(std::shared_ptr<ntc::parallel_executor> executor)
+  {
+    const auto async = async_repairs();
+    set_async_repairs(false);
+    m_encoder.set_executor(std::move(executor));
+    set_async_repairs(async);
+    return *this;
+  }
+
+  /// @brief Get the executor which splits the computation of repairs of large symbols, if any
+  const std::shared_ptr<ntc::parallel_executor>&
+  parallel_executor()
+  const noexcept
+  {
+    return m_encoder.executor();
+  }
+
+  /// @brief Get the number of sources of a block, 0 if the sliding window is used
+  std::size_t
+  block_size()
+  const noexcept
+  {
+    return m_block_size;
+  }
+
+  /// @brief Get the number of repairs sent for each block
+  std::size_t
+  block_repairs()
+  const noexcept
+  {
+    return m_block_repairs;
+  }
+
 private:
 
+  /// @brief The maximal number of repairs being computed in asynchronous mode
+  static constexpr std::size_t max_pending_repairs = 64;
+
   /// @brief Create a source from the given data and generate a repair if needed
   /// @param d The data to add
   void
   commit_impl(data&& d)
   {
-    if (m_sources.size() == m_window_size)
+    evict_outdated(std::chrono::steady_clock::now());
+    while ( m_sources.size() > 0
+           and ( m_sources.size() >= m_window_size
+              or m_sources.nb_bytes() + d.size() > m_max_window_bytes))
+    {
+      evict();
+    }
+
+    // The sources of the previous blocks will never be repaired again.
+    if (m_block_size != 0 and m_nb_block_sources == 0)
     {
-      m_sources.pop_front();
+      while (m_sources.size() > 0)
+      {
+        evict();
+      }
+      m_block_start = m_current_source_id;
     }
 
     // Create a new source in-place at the end of the list of sources.
     const auto& insertion = m_sources.emplace(m_current_source_id, std::move(d));
+    if (m_nb_unprotected_sources++ == 0)
+    {
+      m_unprotected_since = insertion.date();
+    }
 
-    if (m_code_type == systematic::yes)
+    if (m_block_size != 0)
+    {
+      ++m_nb_sent_sources;
+      ++m_nb_sent_packets;
+      m_packetizer.write_source(insertion);
+      if (++m_nb_block_sources == m_block_size)
+      {
+        close_block();
+      }
+    }
+    else if (m_code_type == systematic::yes)
     {
       ++m_nb_sent_sources;
       ++m_nb_sent_packets;
@@ -276,12 +854,79 @@ private:
     }
 
     /// @todo Should we generate a repair if window_size() == 1?
-    if ((m_current_source_id + 1) % m_rate == 0)
+    if (m_block_size == 0 and (m_current_source_id + 1) % m_rate == 0)
     {
       generate_repair();
     }
 
     ++m_current_source_id;
+    send_ready_repairs();
+  }
+
+  /// @brief Send the repairs of the current block and begin a new one
+  void
+  close_block()
+  {
+    if (m_nb_block_sources == 0)
+    {
+      return;
+    }
+    // Evicted sources can make the block smaller than the number of sources it received.
+    for (auto row = 0ul; row < m_block_repairs and m_sources.size() > 0; ++row)
+    {
+      m_repair.block_row() = static_cast<std::uint16_t>(row);
+      send_repair(m_sources.cbegin(), m_sources.cend());
+    }
+    m_nb_block_sources = 0;
+    protect_sources();
+  }
+
+  /// @brief Remember that all sources sent so far are encoded by a repair
+  void
+  protect_sources()
+  {
+    m_nb_unprotected_sources = 0;
+    if (m_sources.size() == 0)
+    {
+      return;
+    }
+    const auto end = std::prev(m_sources.cend())->id() + 1;
+    if (m_covered_ends.empty() or m_covered_ends.back() != end)
+    {
+      m_covered_ends.push_back(end);
+    }
+    // Sources which left the window are no longer checked, nor are the repairs which encoded them.
+    while (not m_covered_ends.empty() and m_covered_ends.front() <= m_sources.cbegin()->id())
+    {
+      m_covered_end = m_covered_ends.front();
+      m_covered_ends.pop_front();
+    }
+  }
+
+  /// @brief Remove the oldest source of the window
+  void
+  evict()
+  {
+    const auto id = m_sources.cbegin()->id();
+    m_sources.pop_front();
+    ++m_nb_evicted_sources;
+    if (m_eviction_handler)
+    {
+      m_eviction_handler(id);
+    }
+  }
+
+  /// @brief Remove sources older than the maximal age
+  void
+  evict_outdated(std::chrono::steady_clock::time_point now)
+  {
+    if (m_max_source_age != std::chrono::milliseconds{0})
+    {
+      while (m_sources.size() > 0 and now - m_sources.cbegin()->date() >= m_max_source_age)
+      {
+        evict();
+      }
+    }
   }
 
   /// @brief Notify the encoder that some packet has been received (should be an ack)
@@ -296,51 +941,245 @@ private:
     }
     else
     {
-      ++m_nb_acks;
       const auto res = m_packetizer.read_ack(std::move(p));
-      if (m_adaptive)
-      {
-        if (m_nb_sent_packets > 0)
-        {
-          const auto loss_rate
-            = (m_nb_sent_packets - res.first.nb_packets()) / static_cast<double>(m_nb_sent_packets);
-          m_rate = rate_for_loss(loss_rate);
-        }
-        else
-        {
-          m_rate = rate_for_loss(0.0);
-        }
-      }
-      m_nb_sent_packets = 0;
-      m_sources.erase(begin(res.first.source_ids()), end(res.first.source_ids()));
+      notify(res.first);
       return res.second;
     }
   }
 
+  /// @brief Generate a repair and give it to the packetizer
+  /// @param args The sources to encode, given to detail::encoder
+  template <typename... Args>
+  void
+  send_repair(Args&&... args)
+  {
+    m_repair.reset();
+    mk_repair(std::forward<Args>(args)...);
+    ++m_nb_sent_packets;
+    m_packetizer.write_repair(m_repair);
+  }
+
+  /// @brief Generate a repair of sources chosen by the decoder or by the user
+  /// @param args The sources to encode, given to detail::encoder
+  ///
+  /// In a binary field all coefficients are 1, thus repairs of the same sources would all be the
+  /// same sum: each one encodes its own pseudo-random half of them instead.
+  template <typename... Args>
+  void
+  send_targeted_repair(Args&&... args)
+  {
+    if (m_galois_field_size == 1)
+    {
+      send_repair(std::forward<Args>(args)..., 0.5);
+    }
+    else
+    {
+      send_repair(std::forward<Args>(args)...);
+    }
+  }
+
   /// @brief Launch the generation of a repair
+  /// @param args The sources to encode, given to detail::encoder
+  template <typename... Args>
   void
-  mk_repair()
+  mk_repair(Args&&... args)
   {
     // Set the identifier of the new repair (needed by the coder to generate coefficients).
     m_repair.id() = m_current_repair_id;
 
-    // Create the repair packet from the list of sources.
+    // Tell the decoder which sources can still be repaired. With a block code, it's the start of
+    // the block, even if acks removed its first sources: coefficients depend on the position of
+    // sources in their block.
     assert(m_sources.size() > 0 && "Empty source list");
-    m_encoder(m_repair, m_sources);
+    m_repair.window_start() = m_block_size != 0 ? m_block_start : m_sources.cbegin()->id();
+
+    // Tell the coder and the decoder how to generate coefficients.
+    m_repair.generator() = m_block_size != 0 ? coefficient_generator::block : m_coefficients;
+
+    // Create the repair packet from the given sources.
+    m_encoder(m_repair, std::forward<Args>(args)...);
 
     ++m_current_repair_id;
     ++m_nb_sent_repairs;
   }
 
-  /// @brief Compute the code rate needed for a given loss rate
-  static
-  std::size_t
-  rate_for_loss(double loss)
-  noexcept
+  /// @brief Give a repair of the coding window to the repair worker
+  void
+  submit_repair()
   {
-    return loss < 0.01
-         ? 50
-         : static_cast<std::size_t>(ceil((1/loss)/2));
+    assert(m_sources.size() > 0 && "Empty source list");
+    send_ready_repairs();
+    while (m_repair_worker->nb_pending() == m_repair_worker->capacity())
+    {
+      std::this_thread::yield();
+      send_ready_repairs();
+    }
+
+    auto job = m_repair_worker->acquire();
+    job.repair.reset();
+    job.repair.id() = m_current_repair_id++;
+    job.repair.window_start() = m_sources.cbegin()->id();
+    job.repair.generator() = m_coefficients;
+    job.density = m_density;
+    job.fountain = m_fountain;
+    job.sources.clear();
+    for (auto cit = coding_window_begin(), end = m_sources.cend(); cit != end; ++cit)
+    {
+      job.sources.emplace_back(*cit);
+    }
+
+    // Symbols retired until now may still be read by the jobs submitted before this one.
+    if (not m_retired.empty())
+    {
+      m_retired_batches.emplace_back( m_repair_worker->nb_taken() + m_repair_worker->nb_pending()
+                                    , std::move(m_retired));
+      m_retired.clear();
+    }
+    m_repair_worker->submit(std::move(job));
+  }
+
+  /// @brief Send the repairs computed by the repair worker, if any
+  void
+  send_ready_repairs()
+  {
+    if (not m_repair_worker)
+    {
+      return;
+    }
+    auto job = detail::repair_job{};
+    while (m_repair_worker->try_take(job))
+    {
+      ++m_nb_sent_repairs;
+      ++m_nb_sent_packets;
+      m_packetizer.write_repair(job.repair);
+      m_repair_worker->release(std::move(job));
+    }
+
+    // Free the symbols which are no longer read by pending jobs.
+    while ( not m_retired_batches.empty()
+           and m_retired_batches.front().first <= m_repair_worker->nb_taken())
+    {
+      m_retired_batches.pop_front();
+    }
+    if (m_repair_worker->nb_pending() == 0)
+    {
+      m_retired.clear();
+    }
+  }
+
+  /// @brief Get the first source of the coding window
+  detail::source_list::const_iterator
+  coding_window_begin()
+  const noexcept
+  {
+    if (m_sources.size() <= m_coding_window)
+    {
+      return m_sources.cbegin();
+    }
+    // To avoid a conversion warning with clang's -Wconversion.
+    using iterator = detail::source_list::const_iterator;
+    using difference_type = std::iterator_traits<iterator>::difference_type;
+    return std::prev(m_sources.cend(), static_cast<difference_type>(m_coding_window));
+  }
+
+  /// @brief Get the range of sources held by the encoder with an identifier in [first_id, last_id]
+  std::pair<detail::source_list::const_iterator, detail::source_list::const_iterator>
+  sources_range(std::uint32_t first_id, std::uint32_t last_id)
+  const
+  {
+    const auto first = std::find_if( m_sources.cbegin(), m_sources.cend()
+                                   , [&](const detail::encoder_source& src)
+                                     {
+                                       return src.id() >= first_id;
+                                     });
+    const auto last = std::find_if( first, m_sources.cend()
+                                  , [&](const detail::encoder_source& src)
+                                    {
+                                      return src.id() > last_id;
+                                    });
+    return {first, last};
+  }
+
+  /// @brief Send the repairs the decoder still needs for each cluster of lost sources
+  ///
+  /// As acknowledged sources have been removed from the window, such repairs only encode the
+  /// sources of the cluster which were lost.
+  void
+  send_on_demand_repairs(const detail::ack& a)
+  {
+    for (const auto& d : a.deficits())
+    {
+      const auto range = sources_range(d.first_id, d.last_id);
+
+      // No need to send more repairs than there are sources.
+      const auto nb_sources = static_cast<std::size_t>(std::distance(range.first, range.second));
+      const auto nb_repairs = std::min(nb_sources, static_cast<std::size_t>(d.nb_repairs));
+      for (auto i = 0ul; i < nb_repairs; ++i)
+      {
+        if (m_galois_field_size == 1)
+        {
+          // All coefficients are 1: each repair leaves out one more source of the cluster, thus
+          // the repairs of a cluster are always independent.
+          send_repair(std::next(range.first, static_cast<std::ptrdiff_t>(i)), range.second);
+        }
+        else
+        {
+          send_repair(range.first, range.second);
+        }
+      }
+    }
+  }
+
+  /// @brief Gather what an ack tells about the channel
+  /// @attention Must be called before acknowledged sources are removed.
+  rate_feedback
+  mk_feedback(const detail::ack& a)
+  {
+    auto fb = rate_feedback{m_nb_sent_packets, a.nb_packets(), 0, {}};
+
+    const auto& ids = a.source_ids();
+    if (ids.empty() or *ids.rbegin() < m_first_unreported_id)
+    {
+      return fb;
+    }
+    const auto last_id = *ids.rbegin();
+    m_first_unreported_id = last_id + 1;
+
+    // Only the sources encoded by a repair sent before the most recent source reported by this ack
+    // had a chance to be decoded. The following ones are checked with a later ack.
+    while (not m_covered_ends.empty() and m_covered_ends.front() <= last_id)
+    {
+      m_covered_end = m_covered_ends.front();
+      m_covered_ends.pop_front();
+    }
+
+    // Sources which were not acknowledged while a more recent one was couldn't be decoded.
+    // Both the window and the acknowledged identifiers are sorted.
+    auto id_cit = ids.lower_bound(m_first_unchecked_id);
+    for ( auto cit = m_sources.cbegin(), end = m_sources.cend()
+        ; cit != end and cit->id() <= last_id; ++cit)
+    {
+      if (cit->id() == last_id)
+      {
+        fb.delay = std::chrono::steady_clock::now() - cit->date();
+        break;
+      }
+      if (cit->id() < m_first_unchecked_id or cit->id() >= m_covered_end)
+      {
+        continue;
+      }
+      while (id_cit != ids.end() and *id_cit < cit->id())
+      {
+        ++id_cit;
+      }
+      if (id_cit == ids.end() or *id_cit != cit->id())
+      {
+        ++fb.nb_unrecovered_sources;
+      }
+    }
+    m_first_unchecked_id = std::max(m_first_unchecked_id, m_covered_end);
+
+    return fb;
   }
 
 private:
@@ -351,15 +1190,54 @@ private:
   /// @brief Tell if the code is systematic or not
   systematic m_code_type;
 
+  /// @brief How the coefficients of repairs are generated
+  coefficient_generator m_coefficients;
+
   /// @brief How many sources to send before a repair is generated
   std::size_t m_rate;
 
   /// @brief The maximal number of sources to keep on the encoder side before discarding them
   std::size_t m_window_size;
 
+  /// @brief The maximal number of bytes to keep on the encoder side before discarding sources
+  std::size_t m_max_window_bytes;
+
+  /// @brief The maximal age of sources kept on the encoder side
+  std::chrono::milliseconds m_max_source_age;
+
+  /// @brief The maximal number of sources encoded by a repair
+  std::size_t m_coding_window;
+
+  /// @brief The probability for a source of the coding window to be encoded by a repair
+  double m_density;
+
   /// @brief Tell if the code is adaptive
   bool m_adaptive;
 
+  /// @brief The maximal time a source can wait for a repair
+  std::chrono::milliseconds m_repair_period;
+
+  /// @brief Tell if repairs are sent when the decoder reports it needs some
+  bool m_on_demand_repairs;
+
+  /// @brief The number of sources of a block, 0 if the sliding window is used
+  std::size_t m_block_size;
+
+  /// @brief The number of repairs sent for each block
+  std::size_t m_block_repairs;
+
+  /// @brief The number of sources sent in the current block
+  std::size_t m_nb_block_sources;
+
+  /// @brief The identifier of the first source of the current block
+  std::uint32_t m_block_start;
+
+  /// @brief Tell if repairs are generated as the ones of a fountain code
+  bool m_fountain;
+
+  /// @brief The distribution of the number of sources encoded by a repair of a fountain code
+  detail::soliton_distribution m_degrees;
+
   /// @brief The counter for source packets identifiers
   std::uint32_t m_current_source_id;
 
@@ -391,7 +1269,45 @@ private:
   std::size_t m_nb_sent_sources;
 
   /// @brief The number of sent packets since last ack
-  std::uint16_t m_nb_sent_packets;
+  std::size_t m_nb_sent_packets;
+
+  /// @brief The component that computes the rate in adaptive mode
+  rate_controller_type m_rate_controller;
+
+  /// @brief The identifier of the first source not yet reported by an ack
+  std::uint32_t m_first_unreported_id;
+
+  /// @brief The identifier of the first source not yet checked for decoding failures
+  std::uint32_t m_first_unchecked_id;
+
+  /// @brief The end of the sources encoded by each repair no ack could know about yet
+  std::deque<std::uint32_t> m_covered_ends;
+
+  /// @brief The end of the sources encoded by a repair the last ack could know about
+  std::uint32_t m_covered_end;
+
+  /// @brief The number of sources sent since the last repair
+  std::size_t m_nb_unprotected_sources;
+
+  /// @brief The date of the oldest source sent since the last repair
+  std::chrono::steady_clock::time_point m_unprotected_since;
+
+  /// @brief The number of sources evicted from the window before being acknowledged
+  std::size_t m_nb_evicted_sources;
+
+  /// @brief The function to call when a source is evicted
+  std::function<void(std::uint32_t)> m_eviction_handler;
+
+  /// @brief The symbols of sources removed since the last repair given to the repair worker
+  std::vector<detail::byte_buffer> m_retired;
+
+  /// @brief Older retired symbols, with the number of repairs given to the repair worker before
+  /// they were removed
+  std::deque<std::pair<std::size_t, std::vector<detail::byte_buffer>>> m_retired_batches;
+
+  /// @brief Compute repairs on another thread in asynchronous mode
+  /// @attention Declared last so that its thread stops before the symbols it reads are freed.
+  std::unique_ptr<detail::repair_worker> m_repair_worker;
 };
 
 /*------------------------------------------------------------------------------------------------*/
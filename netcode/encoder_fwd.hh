@@ -1,10 +1,12 @@
 #pragma once
 
+#include "netcode/rate_controller.hh"
+
 namespace ntc {
 
 /*------------------------------------------------------------------------------------------------*/
 
-template <typename PacketHandler>
+template <typename PacketHandler, typename RateController = loss_rate_controller>
 class encoder;
 
 /*------------------------------------------------------------------------------------------------*/
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <exception>
 
 #include "netcode/detail/visibility.hh"
@@ -31,4 +32,20 @@ struct NTC_PUBLIC overflow_error
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Exception thrown when a packet belongs to a session which is not known.
+/// @ingroup ntc_error
+struct NTC_PUBLIC unknown_session_error
+  : public std::exception
+{
+  unknown_session_error(std::uint32_t s, packet p)
+    : session{s}
+    , error_packet{std::move(p)}
+  {}
+
+  std::uint32_t session;
+  packet error_packet;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 } // namespace ntc
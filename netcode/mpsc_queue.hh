@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>  // unique_ptr
+#include <thread>  // yield
+#include <utility> // move
+
+#include "netcode/detail/cache_line.hh"
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A bounded lock-free queue with many producer threads and a single consumer thread
+/// @ingroup ntc_threads
+/// @tparam T The type of values, usually ntc::data or ntc::packet
+///
+/// It's typically used to gather the packets of an encoder and of a decoder running on different
+/// threads to a single network thread. Each slot has a sequence number which tells producers and
+/// consumers if it's free or filled. Threads only contend on the index they advance, with a
+/// compare-and-swap, and never wait for each other while a value is being moved in or out.
+///
+/// Popping from many threads is also safe, pooled_queue relies on it to give back values to many
+/// producers.
+template <typename T>
+class NTC_PUBLIC mpsc_queue final
+{
+public:
+
+  /// @brief The type of values
+  using value_type = T;
+
+  /// @brief Can't copy-construct a queue
+  mpsc_queue(const mpsc_queue&) = delete;
+
+  /// @brief Can't copy a queue
+  mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+  /// @brief Constructor
+  /// @param capacity The maximal number of values in the queue
+  /// @pre @p capacity is a power of two
+  explicit mpsc_queue(std::size_t capacity)
+    : m_slots{new slot[capacity]}
+    , m_capacity{capacity}
+    , m_mask{capacity - 1}
+    , m_pad0()
+    , m_tail{0}
+    , m_pad1()
+    , m_head{0}
+    , m_pad2()
+  {
+    assert(capacity > 0 and (capacity & (capacity - 1)) == 0);
+    for (auto i = 0ul; i < capacity; ++i)
+    {
+      m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Append a value, from any producer thread
+  /// @return false if the queue is full, in which case @p value is left untouched
+  bool
+  try_push(T&& value)
+  {
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      auto& s = m_slots[tail & m_mask];
+      const auto diff = distance(s.sequence.load(std::memory_order_acquire), tail);
+      if (diff == 0)
+      {
+        if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+        {
+          s.value = std::move(value);
+          s.sequence.store(tail + 1, std::memory_order_release);
+          return true;
+        }
+        // tail was updated by the failed compare-and-swap.
+      }
+      else if (diff < 0)
+      {
+        // The slot still holds the value of the previous round.
+        return false;
+      }
+      else
+      {
+        tail = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// @brief Append a value, from any producer thread, wait while the queue is full
+  void
+  push(T&& value)
+  {
+    while (not try_push(std::move(value)))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  /// @brief Take the oldest value, from the consumer thread
+  /// @return false if the queue is empty
+  bool
+  try_pop(T& value)
+  {
+    auto head = m_head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      auto& s = m_slots[head & m_mask];
+      const auto diff = distance(s.sequence.load(std::memory_order_acquire), head + 1);
+      if (diff == 0)
+      {
+        if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+        {
+          value = std::move(s.value);
+          s.sequence.store(head + m_capacity, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (diff < 0)
+      {
+        // The slot is not filled yet.
+        return false;
+      }
+      else
+      {
+        head = m_head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /// @brief Get the maximal number of values in the queue
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_capacity;
+  }
+
+private:
+
+  /// @brief A value and the round it belongs to
+  struct slot
+  {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  /// @brief The signed distance between a sequence number and an index, which may wrap around
+  static
+  std::ptrdiff_t
+  distance(std::size_t sequence, std::size_t index)
+  noexcept
+  {
+    return static_cast<std::ptrdiff_t>(sequence - index);
+  }
+
+private:
+
+  /// @brief The values
+  std::unique_ptr<slot[]> m_slots;
+
+  /// @brief The number of slots
+  const std::size_t m_capacity;
+
+  /// @brief The mask of indexes
+  const std::size_t m_mask;
+
+  /// @brief Keep the index of producers on its own cache line
+  detail::cache_line_pad m_pad0;
+
+  /// @brief The next slot to write, shared by producers
+  std::atomic<std::size_t> m_tail;
+
+  /// @brief Keep the index of the consumer on its own cache line
+  detail::cache_line_pad m_pad1;
+
+  /// @brief The next slot to read
+  std::atomic<std::size_t> m_head;
+
+  /// @brief Keep the index of the consumer away from the next object
+  detail::cache_line_pad m_pad2;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
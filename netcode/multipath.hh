@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <utility> // move
+#include <vector>
+
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/packetizer.hh"
+#include "netcode/detail/path_scheduler.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/data.hh"
+#include "netcode/encoder.hh"
+#include "netcode/errors.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An encoder which sends sources and repairs on several paths
+/// @ingroup ntc_encoder
+/// @tparam PacketHandler The handler of packets ready to be sent on one path
+/// @tparam RateController How the rate is computed in adaptive mode (see loss_rate_controller)
+///
+/// Sources are distributed on paths according to their losses and their round-trip times. Repairs
+/// are preferably sent on the paths which carried the fewest of the recent losses.
+///
+/// On the receiver side, packets of all paths are given to the same decoder with the index of the
+/// path they were received on (see decoder::operator()(packet&&, std::size_t)). Its acks then
+/// report how many packets were received on each path. They can come back on any path.
+template <typename PacketHandler, typename RateController = loss_rate_controller>
+class NTC_PUBLIC multipath_encoder final
+{
+public:
+
+  /// @brief The type of the handler that processes data ready to be sent on one path
+  using packet_handler_type = PacketHandler;
+
+  /// @brief The type of the underlying encoder
+  using encoder_type = ntc::encoder<detail::path_scheduler<PacketHandler>, RateController>;
+
+public:
+
+  /// @brief Can't copy-construct a multipath encoder
+  multipath_encoder(const multipath_encoder&) = delete;
+
+  /// @brief Can't copy a multipath encoder
+  multipath_encoder& operator=(const multipath_encoder&) = delete;
+
+  /// @brief Can't move-construct a multipath encoder
+  multipath_encoder(multipath_encoder&&) = delete;
+
+  /// @brief Can't move a multipath encoder
+  multipath_encoder& operator=(multipath_encoder&&) = delete;
+
+  /// @brief Constructor
+  /// @param galois_field_size The size of the Galois field, see encoder::encoder
+  /// @param paths The handlers of packets ready to be sent, one per path
+  /// @pre @p paths is not empty and has less than 255 elements
+  multipath_encoder(std::uint8_t galois_field_size, std::vector<PacketHandler> paths)
+    : m_encoder{galois_field_size, detail::path_scheduler<PacketHandler>{std::move(paths)}}
+    , m_packetizer{m_encoder.packet_handler()}
+  {}
+
+  /// @brief Give the encoder a new data
+  void
+  operator()(const data& d)
+  {
+    m_encoder(d);
+  }
+
+  /// @brief Give the encoder a new data
+  void
+  operator()(data&& d)
+  {
+    m_encoder(std::move(d));
+  }
+
+  /// @brief Notify the encoder of an incoming packet, received on any path
+  /// @return The number of bytes that have been read
+  /// @throw packet_type_error if @p p is not an ack
+  std::size_t
+  operator()(const packet& p)
+  {
+    return operator()(packet{p});
+  }
+
+  /// @brief Notify the encoder of an incoming packet, received on any path
+  /// @return The number of bytes that have been read
+  /// @throw packet_type_error if @p p is not an ack
+  std::size_t
+  operator()(packet&& p)
+  {
+    assert(p.size() != 0 && "empty packet");
+    if (detail::get_packet_type(p) != detail::packet_type::ack)
+    {
+      throw packet_type_error{p};
+    }
+    // The ack is read once, for the paths and for the encoder.
+    const auto res = m_packetizer.read_ack(std::move(p));
+    m_encoder.packet_handler().notify(res.first);
+    m_encoder.notify(res.first);
+    return res.second;
+  }
+
+  /// @brief Get the underlying encoder, to configure it
+  encoder_type&
+  encoder()
+  noexcept
+  {
+    return m_encoder;
+  }
+
+  /// @brief Get the underlying encoder
+  const encoder_type&
+  encoder()
+  const noexcept
+  {
+    return m_encoder;
+  }
+
+  /// @brief Get the number of paths
+  std::size_t
+  nb_paths()
+  const noexcept
+  {
+    return m_encoder.packet_handler().nb_paths();
+  }
+
+  /// @brief Get the packet handler of a path
+  /// @pre @p i < nb_paths()
+  const packet_handler_type&
+  path(std::size_t i)
+  const noexcept
+  {
+    return m_encoder.packet_handler().path(i);
+  }
+
+  /// @brief Get the packet handler of a path
+  /// @pre @p i < nb_paths()
+  packet_handler_type&
+  path(std::size_t i)
+  noexcept
+  {
+    return m_encoder.packet_handler().path(i);
+  }
+
+  /// @brief Get the smoothed ratio of packets lost on a path
+  /// @pre @p i < nb_paths()
+  double
+  loss(std::size_t i)
+  const noexcept
+  {
+    return m_encoder.packet_handler().state(i).loss;
+  }
+
+  /// @brief Get the smoothed share of a path in the losses of all paths
+  /// @pre @p i < nb_paths()
+  double
+  loss_share(std::size_t i)
+  const noexcept
+  {
+    return m_encoder.packet_handler().state(i).loss_share;
+  }
+
+  /// @brief Get the smoothed round-trip time of a path, 0 if it's not known yet
+  /// @pre @p i < nb_paths()
+  std::chrono::steady_clock::duration
+  rtt(std::size_t i)
+  const noexcept
+  {
+    return m_encoder.packet_handler().state(i).rtt;
+  }
+
+  /// @brief Get the total number of sources sent on a path
+  /// @pre @p i < nb_paths()
+  std::size_t
+  nb_sent_sources(std::size_t i)
+  const noexcept
+  {
+    return m_encoder.packet_handler().state(i).nb_sent_sources;
+  }
+
+  /// @brief Get the total number of repairs sent on a path
+  /// @pre @p i < nb_paths()
+  std::size_t
+  nb_sent_repairs(std::size_t i)
+  const noexcept
+  {
+    return m_encoder.packet_handler().state(i).nb_sent_repairs;
+  }
+
+private:
+
+  /// @brief The encoder which sends packets through a path scheduler
+  encoder_type m_encoder;
+
+  /// @brief Read acks for the paths and for the encoder
+  detail::packetizer<detail::path_scheduler<PacketHandler>> m_packetizer;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
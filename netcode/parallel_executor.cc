@@ -0,0 +1,297 @@
+#include <algorithm> // min
+#include <cassert>
+#include <limits>    // numeric_limits
+
+#include "netcode/parallel_executor.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief The number of times a thread checks for a new operation before sleeping.
+static constexpr auto nb_spins = 128;
+
+/// @brief Pack a range of tasks in a single word.
+std::uint64_t
+pack(std::uint64_t begin, std::uint64_t end)
+noexcept
+{
+  return end << 32 | begin;
+}
+
+/// @brief Get the first task of a packed range.
+std::size_t
+first(std::uint64_t tasks)
+noexcept
+{
+  return static_cast<std::size_t>(tasks & 0xffffffff);
+}
+
+/// @brief Get the end of a packed range.
+std::size_t
+last(std::uint64_t tasks)
+noexcept
+{
+  return static_cast<std::size_t>(tasks >> 32);
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+constexpr std::size_t parallel_executor::default_threshold;
+constexpr std::size_t parallel_executor::min_stripe_size;
+
+/*------------------------------------------------------------------------------------------------*/
+
+parallel_executor::parallel_executor(std::size_t nb_workers, std::size_t threshold)
+  : m_threshold{threshold}
+  , m_slots{new worker[nb_workers + 1]}
+  , m_busy()
+  , m_operation{0}
+  , m_task{nullptr}
+  , m_function{nullptr}
+  , m_len{0}
+  , m_stripe{0}
+  , m_nb_stealers{0}
+  , m_pad()
+  , m_nb_sleeping{0}
+  , m_mutex{}
+  , m_cv{}
+  , m_stop{false}
+  , m_workers{}
+{
+  m_busy.clear();
+  m_workers.reserve(nb_workers);
+  for (auto i = 1ul; i <= nb_workers; ++i)
+  {
+    m_workers.emplace_back([this, i]{loop(i);});
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+parallel_executor::~parallel_executor()
+{
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_stop.store(true);
+  }
+  m_cv.notify_all();
+  for (auto& t : m_workers)
+  {
+    t.join();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+parallel_executor::run(std::size_t len, task_type task, void* function)
+{
+  const auto nb_stripes = std::min(m_workers.size() + 1, len / min_stripe_size);
+  if (nb_stripes < 2 or m_busy.test_and_set(std::memory_order_acquire))
+  {
+    task(function, 0, len);
+    return;
+  }
+
+  // Round stripes up to cache lines, thus the last threads might have nothing to do.
+  const auto line = detail::cache_line_size;
+  const auto stripe = ((len + nb_stripes - 1) / nb_stripes + line - 1) / line * line;
+
+  m_task = task;
+  m_function = function;
+  m_len = len;
+  m_stripe = stripe;
+  m_nb_stealers = 0;
+  const auto nb_threads = (len + stripe - 1) / stripe;
+  start(nb_threads);
+  task(function, 0, stripe);
+  join(nb_threads);
+  m_busy.clear(std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+parallel_executor::run_tasks(std::size_t nb_tasks, task_type task, void* function)
+{
+  assert(nb_tasks <= std::numeric_limits<std::uint32_t>::max());
+  const auto nb_threads = std::min(m_workers.size() + 1, nb_tasks);
+  if (nb_threads < 2 or m_busy.test_and_set(std::memory_order_acquire))
+  {
+    task(function, 0, nb_tasks);
+    return;
+  }
+
+  // Each thread starts with a contiguous share of tasks.
+  for (auto i = 0ul; i < nb_threads; ++i)
+  {
+    m_slots[i].tasks.store(pack(i * nb_tasks / nb_threads, (i + 1) * nb_tasks / nb_threads));
+  }
+  m_task = task;
+  m_function = function;
+  m_nb_stealers = nb_threads;
+  start(nb_threads);
+  drain(0);
+  join(nb_threads);
+  m_busy.clear(std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+parallel_executor::start(std::size_t nb_threads)
+{
+  const auto operation = ++m_operation;
+  for (auto i = 1ul; i < nb_threads; ++i)
+  {
+    m_slots[i].start.store(operation);
+  }
+  // A thread counts itself as sleeping before checking for a new operation, thus either it sees
+  // this operation, or it's seen as sleeping here.
+  if (m_nb_sleeping.load() != 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock{m_mutex};
+    }
+    m_cv.notify_all();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+parallel_executor::join(std::size_t nb_threads)
+{
+  for (auto i = 1ul; i < nb_threads; ++i)
+  {
+    while (m_slots[i].done.load(std::memory_order_acquire) != m_operation)
+    {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+parallel_executor::drain(std::size_t index)
+{
+  auto& self = m_slots[index];
+  auto task = std::size_t{0};
+  for (;;)
+  {
+    while (pop(self, task))
+    {
+      m_task(m_function, task, task + 1);
+    }
+
+    // Look for a victim, starting with the next thread so that thieves spread.
+    auto stolen = false;
+    for (auto i = 1ul; i < m_nb_stealers and not stolen; ++i)
+    {
+      stolen = steal(m_slots[(index + i) % m_nb_stealers], self);
+    }
+    if (not stolen)
+    {
+      // Tasks being stolen by another thread are run by this thread.
+      return;
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+parallel_executor::pop(worker& w, std::size_t& task)
+{
+  auto tasks = w.tasks.load(std::memory_order_relaxed);
+  do
+  {
+    if (first(tasks) == last(tasks))
+    {
+      return false;
+    }
+  } while (not w.tasks.compare_exchange_weak(tasks, tasks + 1, std::memory_order_relaxed));
+  task = first(tasks);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+parallel_executor::steal(worker& victim, worker& thief)
+{
+  // A task is handed out only once, thus a range never comes back and a successful exchange
+  // can't be fooled by a range which was emptied then filled again.
+  auto tasks = victim.tasks.load(std::memory_order_relaxed);
+  auto middle = std::size_t{0};
+  do
+  {
+    if (first(tasks) == last(tasks))
+    {
+      return false;
+    }
+    middle = first(tasks) + (last(tasks) - first(tasks)) / 2;
+  } while (not victim.tasks.compare_exchange_weak( tasks, pack(first(tasks), middle)
+                                                 , std::memory_order_relaxed));
+  // The thief's range is empty, other thieves leave it alone.
+  thief.tasks.store(pack(middle, last(tasks)), std::memory_order_relaxed);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+parallel_executor::loop(std::size_t index)
+{
+  auto& w = m_slots[index];
+  auto last_operation = std::uint64_t{0};
+  while (wait(w, last_operation))
+  {
+    last_operation = w.start.load(std::memory_order_acquire);
+    if (m_nb_stealers != 0)
+    {
+      drain(index);
+    }
+    else
+    {
+      const auto begin = index * m_stripe;
+      m_task(m_function, begin, std::min(begin + m_stripe, m_len));
+    }
+    w.done.store(last_operation, std::memory_order_release);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+parallel_executor::wait(worker& w, std::uint64_t last_operation)
+{
+  for (auto i = 0; i < nb_spins; ++i)
+  {
+    if (m_stop.load(std::memory_order_relaxed))
+    {
+      return false;
+    }
+    if (w.start.load(std::memory_order_acquire) != last_operation)
+    {
+      return true;
+    }
+    std::this_thread::yield();
+  }
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+  m_nb_sleeping.fetch_add(1);
+  m_cv.wait(lock, [&]{return m_stop.load() or w.start.load() != last_operation;});
+  m_nb_sleeping.fetch_sub(1);
+  return not m_stop.load();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
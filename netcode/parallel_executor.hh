@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>  // unique_ptr
+#include <mutex>
+#include <thread>
+#include <type_traits> // remove_reference
+#include <vector>
+
+#include "netcode/detail/cache_line.hh"
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A small pool of threads which split the operations on large symbols in stripes
+/// @ingroup ntc_threads
+///
+/// Give it to an encoder or to a decoder with set_parallel_executor: the multiplications of
+/// symbols of at least threshold() bytes are then split in contiguous stripes, one per thread. The
+/// calling thread computes the first stripe. A stripe is only written by its thread, and each
+/// thread is told to start and tells it's done through its own cache line, thus threads never
+/// contend on a shared counter.
+///
+/// A decoder also uses it to solve large systems, whose tasks don't have the same cost: each
+/// thread first gets its share of tasks, then steals half of the remaining tasks of another thread
+/// once it has nothing left to do.
+///
+/// An executor can be shared by several encoders and decoders. When it's already busy with an
+/// operation of another thread, the operation is computed by the calling thread alone rather than
+/// waiting.
+class NTC_PUBLIC parallel_executor final
+{
+public:
+
+  /// @brief The default minimal size of symbols to split
+  static constexpr std::size_t default_threshold = 8192;
+
+  /// @brief The minimal size of a stripe, smaller ones don't pay off the synchronization
+  static constexpr std::size_t min_stripe_size = 2048;
+
+  /// @brief Can't copy-construct an executor
+  parallel_executor(const parallel_executor&) = delete;
+
+  /// @brief Can't copy an executor
+  parallel_executor& operator=(const parallel_executor&) = delete;
+
+  /// @brief Constructor, starts the threads
+  /// @param nb_workers The number of threads, besides the calling one
+  /// @param threshold The minimal size of symbols to split
+  explicit parallel_executor(std::size_t nb_workers, std::size_t threshold = default_threshold);
+
+  /// @brief Destructor, stops the threads
+  ~parallel_executor();
+
+  /// @brief Get the number of threads, besides the calling one
+  std::size_t
+  nb_workers()
+  const noexcept
+  {
+    return m_workers.size();
+  }
+
+  /// @brief Get the minimal size of symbols to split
+  std::size_t
+  threshold()
+  const noexcept
+  {
+    return m_threshold;
+  }
+
+  /// @brief Apply a function to the stripes of a region
+  /// @param len The size of the region
+  /// @param fn Called with the bounds [begin, end[ of each stripe, mustn't throw
+  ///
+  /// Stripes are aligned on cache lines. Returns once all stripes are done.
+  template <typename Function>
+  void
+  operator()(std::size_t len, Function&& fn)
+  {
+    using function_type = typename std::remove_reference<Function>::type;
+    run( len
+       , [](void* f, std::size_t begin, std::size_t end)
+         {
+           (*static_cast<function_type*>(f))(begin, end);
+         }
+       , const_cast<void*>(static_cast<const void*>(&fn)));
+  }
+
+  /// @brief Apply a function to a set of independent tasks, balanced by work stealing
+  /// @param nb_tasks The number of tasks
+  /// @param fn Called with the index of each task in [0, nb_tasks[, mustn't throw
+  ///
+  /// Returns once all tasks are done.
+  template <typename Function>
+  void
+  for_each(std::size_t nb_tasks, Function&& fn)
+  {
+    using function_type = typename std::remove_reference<Function>::type;
+    run_tasks( nb_tasks
+             , [](void* f, std::size_t begin, std::size_t end)
+               {
+                 for (; begin != end; ++begin)
+                 {
+                   (*static_cast<function_type*>(f))(begin);
+                 }
+               }
+             , const_cast<void*>(static_cast<const void*>(&fn)));
+  }
+
+private:
+
+  /// @brief A type-erased function on a stripe
+  using task_type = void (*)(void*, std::size_t, std::size_t);
+
+  /// @brief What a thread reads and writes, the first one is the calling thread's
+  struct worker
+  {
+    worker()
+      : start{0}
+      , done{0}
+      , tasks{0}
+      , pad()
+    {}
+
+    /// @brief The operation to run, written by the caller
+    std::atomic<std::uint64_t> start;
+
+    /// @brief The last operation done, written by the thread
+    std::atomic<std::uint64_t> done;
+
+    /// @brief The remaining tasks of the thread, the first one in the low 32 bits and the end in
+    /// the high 32 bits
+    ///
+    /// The thread takes tasks from the beginning, other threads steal them from the end.
+    std::atomic<std::uint64_t> tasks;
+
+    /// @brief Keep the members of a thread away from the ones of the next thread
+    detail::cache_line_pad pad;
+  };
+
+  /// @brief Split a region and wait for all stripes to be done
+  void
+  run(std::size_t len, task_type task, void* function);
+
+  /// @brief Share tasks between threads and wait for all of them to be done
+  void
+  run_tasks(std::size_t nb_tasks, task_type task, void* function);
+
+  /// @brief Start threads [1, nb_threads[ on the current operation
+  void
+  start(std::size_t nb_threads);
+
+  /// @brief Wait for threads [1, nb_threads[ to finish the current operation
+  void
+  join(std::size_t nb_threads);
+
+  /// @brief Run the tasks of a thread, then the ones it steals from others
+  void
+  drain(std::size_t index);
+
+  /// @brief Take the first task of a thread
+  bool
+  pop(worker& w, std::size_t& task);
+
+  /// @brief Move the last half of the remaining tasks of a thread to another one
+  bool
+  steal(worker& victim, worker& thief);
+
+  /// @brief The loop of a thread
+  void
+  loop(std::size_t index);
+
+  /// @brief Wait for an operation which is not @p last_operation, spin a bit before sleeping
+  /// @return false if the executor is stopping
+  bool
+  wait(worker& w, std::uint64_t last_operation);
+
+private:
+
+  /// @brief The minimal size of symbols to split
+  const std::size_t m_threshold;
+
+  /// @brief The members of each thread
+  std::unique_ptr<worker[]> m_slots;
+
+  /// @brief Tell if an operation is running
+  std::atomic_flag m_busy;
+
+  /// @brief The current operation
+  std::uint64_t m_operation;
+
+  /// @brief The function of the current operation
+  task_type m_task;
+
+  /// @brief The argument of the function of the current operation
+  void* m_function;
+
+  /// @brief The size of the region of the current operation
+  std::size_t m_len;
+
+  /// @brief The size of the stripes of the current operation
+  std::size_t m_stripe;
+
+  /// @brief The number of threads which share the tasks of the current operation, 0 for stripes
+  std::size_t m_nb_stealers;
+
+  /// @brief Keep the members of the caller away from the ones of sleeping threads
+  detail::cache_line_pad m_pad;
+
+  /// @brief The number of threads waiting on m_cv
+  std::atomic<std::size_t> m_nb_sleeping;
+
+  /// @brief Protect m_stop and the sleeps of threads
+  std::mutex m_mutex;
+
+  /// @brief Wake threads up
+  std::condition_variable m_cv;
+
+  /// @brief Tell threads to stop
+  std::atomic<bool> m_stop;
+
+  /// @brief The threads, started once all other members are constructed
+  std::vector<std::thread> m_workers;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
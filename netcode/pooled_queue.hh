@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm> // copy_n
+#include <cstddef>
+#include <utility>   // move
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/packet.hh"
+#include "netcode/spsc_queue.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A queue of values given to a consumer thread, and a queue of used values given back to
+/// the producers, so that their memory is re-used
+/// @ingroup ntc_threads
+/// @tparam T The type of values, usually ntc::data or ntc::packet
+/// @tparam Queue The type of both queues, spsc_queue or mpsc_queue when there are many producers
+///
+/// Once a few values have gone back and forth, producers fill buffers which already have the size
+/// they need, and nothing is allocated anymore.
+template <typename T, typename Queue = spsc_queue<T>>
+class NTC_PUBLIC pooled_queue final
+{
+public:
+
+  /// @brief The type of values
+  using value_type = T;
+
+  /// @brief The type of the underlying queues
+  using queue_type = Queue;
+
+  /// @brief Constructor
+  /// @param capacity The maximal number of values in each direction
+  /// @pre @p capacity is a power of two
+  explicit pooled_queue(std::size_t capacity)
+    : m_full(capacity)
+    , m_empty(capacity)
+  {}
+
+  /// @brief Get a value to fill, from a producer thread
+  ///
+  /// It's a value given back by the consumer if any, a new one otherwise.
+  T
+  acquire()
+  {
+    auto value = T{};
+    m_empty.try_pop(value);
+    return value;
+  }
+
+  /// @brief Give a filled value to the consumer
+  /// @return false if the queue is full, in which case @p value is left untouched
+  bool
+  try_push(T&& value)
+  {
+    return m_full.try_push(std::move(value));
+  }
+
+  /// @brief Give a filled value to the consumer, wait while the queue is full
+  void
+  push(T&& value)
+  {
+    m_full.push(std::move(value));
+  }
+
+  /// @brief Take a filled value, from the consumer thread
+  /// @return false if the queue is empty
+  bool
+  try_pop(T& value)
+  {
+    return m_full.try_pop(value);
+  }
+
+  /// @brief Give back a used value to the producers, from the consumer thread
+  ///
+  /// It's destroyed if the producers already have enough of them.
+  void
+  release(T&& value)
+  {
+    m_empty.try_push(std::move(value));
+  }
+
+private:
+
+  /// @brief The values given to the consumer
+  Queue m_full;
+
+  /// @brief The values given back to the producers
+  Queue m_empty;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A packet handler which gives complete packets to another thread through a pooled_queue
+/// @ingroup ntc_threads
+/// @tparam Queue The type of the underlying queues of the pooled_queue
+///
+/// With this handler, an encoder or a decoder runs on its own thread, while the network thread pops
+/// packets, sends them, and gives them back with pooled_queue::release(). Packets are written in
+/// place and never copied again.
+template <typename Queue = spsc_queue<packet>>
+class NTC_PUBLIC queue_packet_handler final
+{
+public:
+
+  /// @brief The type of the queue of packets
+  using queue_type = pooled_queue<packet, Queue>;
+
+  /// @brief Constructor
+  explicit queue_packet_handler(queue_type& queue)
+    : m_queue(&queue)
+    , m_packet()
+  {}
+
+  /// @brief Append a part of the packet being written
+  void
+  operator()(const char* data, std::size_t sz)
+  {
+    const auto size = m_packet.size();
+    m_packet.resize(size + sz);
+    std::copy_n(data, sz, m_packet.data() + size);
+  }
+
+  /// @brief Give the complete packet to the consumer, wait while the queue is full
+  void
+  operator()()
+  {
+    m_queue->push(std::move(m_packet));
+    m_packet = m_queue->acquire();
+    m_packet.clear();
+  }
+
+  /// @brief Get the queue of packets
+  queue_type&
+  queue()
+  noexcept
+  {
+    return *m_queue;
+  }
+
+private:
+
+  /// @brief The queue to give complete packets to
+  queue_type* m_queue;
+
+  /// @brief The packet being written
+  packet m_packet;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
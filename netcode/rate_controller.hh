@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm> // max, min
+#include <cassert>
+#include <chrono>
+#include <cmath>     // ceil
+#include <cstddef>   // size_t
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What an encoder knows about the channel each time it receives an ack
+/// @ingroup ntc_encoder
+struct rate_feedback
+{
+  /// @brief The number of packets sent by the encoder since the previous ack
+  std::size_t nb_sent_packets;
+
+  /// @brief The number of packets received by the decoder since its previous ack
+  std::size_t nb_received_packets;
+
+  /// @brief The number of sources the decoder could neither receive nor decode
+  ///
+  /// Only sources encoded by a repair sent before the most recent source reported by this ack are
+  /// considered, and each source is counted once. It's a sign that repairs were not sufficient.
+  std::size_t nb_unrecovered_sources;
+
+  /// @brief The time elapsed since the most recent source reported by this ack was sent
+  ///
+  /// It's 0 when the ack reports no new source.
+  std::chrono::steady_clock::duration delay;
+
+  /// @brief The ratio of packets lost since the previous ack
+  double
+  loss()
+  const noexcept
+  {
+    return nb_sent_packets == 0 or nb_received_packets >= nb_sent_packets
+         ? 0.0
+         : static_cast<double>(nb_sent_packets - nb_received_packets)
+         / static_cast<double>(nb_sent_packets);
+  }
+
+  /// @brief The ratio of lost packets, at least the one of sources which could not be decoded
+  ///
+  /// A source which could not be decoded was also a lost packet, thus it's not counted twice. But
+  /// it might have been lost before the previous ack: then it tells that more repairs are needed
+  /// even if few packets were lost since.
+  double
+  residual_loss()
+  const noexcept
+  {
+    return nb_sent_packets == 0
+         ? 0.0
+         : std::min( 1.0
+                   , std::max( loss()
+                             , static_cast<double>(nb_unrecovered_sources)
+                             / static_cast<double>(nb_sent_packets)));
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace detail {
+
+/// @internal
+/// @brief Compute the code rate needed for a given loss rate
+/// @param loss The ratio of lost packets
+/// @param max_rate The rate to use when there are almost no losses
+inline
+std::size_t
+rate_for_loss(double loss, std::size_t max_rate)
+noexcept
+{
+  return loss < 0.01
+       ? max_rate
+       : std::max( std::size_t{1}
+                 , std::min(max_rate, static_cast<std::size_t>(std::ceil((1/loss)/2))));
+}
+
+} // namespace detail
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A rate controller which only uses the losses reported by the last ack
+/// @ingroup ntc_encoder
+///
+/// This is the default rate controller of an encoder. A rate controller is called by an encoder in
+/// adaptive mode each time an ack is received, with a rate_feedback, and returns the number of
+/// sources to send before a repair is generated.
+/// @see encoder::set_adaptive
+class loss_rate_controller
+{
+public:
+
+  /// @brief Constructor
+  /// @param max_rate The rate to use when there are almost no losses
+  /// @pre @p max_rate > 0
+  explicit loss_rate_controller(std::size_t max_rate = 50)
+  noexcept
+    : m_max_rate{max_rate}
+  {
+    assert(max_rate > 0);
+  }
+
+  /// @brief Compute a new rate
+  std::size_t
+  operator()(const rate_feedback& fb)
+  noexcept
+  {
+    return detail::rate_for_loss(fb.loss(), m_max_rate);
+  }
+
+private:
+
+  /// @brief The rate to use when there are almost no losses
+  std::size_t m_max_rate;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A rate controller which smoothes the losses with an exponentially weighted moving
+/// average
+/// @ingroup ntc_encoder
+///
+/// Sources which could not be decoded are added to the losses. The delay reported by acks is also
+/// smoothed; when it exceeds a maximal delay, the rate is halved to rely less on acks to repair
+/// losses.
+class ewma_rate_controller
+{
+public:
+
+  /// @brief Constructor
+  /// @param weight The weight of a new sample, in ]0, 1]
+  /// @param max_rate The rate to use when there are almost no losses
+  /// @pre 0 < @p weight <= 1
+  /// @pre @p max_rate > 0
+  explicit ewma_rate_controller(double weight = 0.125, std::size_t max_rate = 50)
+  noexcept
+    : m_weight{weight}
+    , m_max_rate{max_rate}
+    , m_loss{0}
+    , m_delay{0}
+    , m_max_delay{std::chrono::steady_clock::duration::max()}
+    , m_initialized{false}
+  {
+    assert(weight > 0 and weight <= 1);
+    assert(max_rate > 0);
+  }
+
+  /// @brief Compute a new rate
+  std::size_t
+  operator()(const rate_feedback& fb)
+  noexcept
+  {
+    if (not m_initialized)
+    {
+      m_loss = fb.residual_loss();
+      m_delay = fb.delay;
+      m_initialized = true;
+    }
+    else
+    {
+      m_loss = m_weight * fb.residual_loss() + (1 - m_weight) * m_loss;
+      if (fb.delay != std::chrono::steady_clock::duration::zero())
+      {
+        m_delay += std::chrono::duration_cast<std::chrono::steady_clock::duration>
+                     ((fb.delay - m_delay) * m_weight);
+      }
+    }
+    const auto rate = detail::rate_for_loss(m_loss, m_max_rate);
+    return m_delay > m_max_delay ? std::max(std::size_t{1}, rate / 2) : rate;
+  }
+
+  /// @brief Set the delay above which repairs are sent twice as often
+  ewma_rate_controller&
+  set_max_delay(std::chrono::steady_clock::duration d)
+  noexcept
+  {
+    m_max_delay = d;
+    return *this;
+  }
+
+  /// @brief Get the current estimation of the loss rate
+  double
+  loss()
+  const noexcept
+  {
+    return m_loss;
+  }
+
+  /// @brief Get the current estimation of the delay
+  std::chrono::steady_clock::duration
+  delay()
+  const noexcept
+  {
+    return m_delay;
+  }
+
+private:
+
+  /// @brief The weight of a new sample
+  double m_weight;
+
+  /// @brief The rate to use when there are almost no losses
+  std::size_t m_max_rate;
+
+  /// @brief The smoothed loss rate
+  double m_loss;
+
+  /// @brief The smoothed delay
+  std::chrono::steady_clock::duration m_delay;
+
+  /// @brief The delay above which repairs are sent twice as often
+  std::chrono::steady_clock::duration m_max_delay;
+
+  /// @brief Tell if a first sample has been received
+  bool m_initialized;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A rate controller which models the channel with a Gilbert-Elliott model
+/// @ingroup ntc_encoder
+///
+/// The channel is either in a good state or in a bad (bursty) state. Each period between two acks
+/// is classified in one of these states, depending on its loss rate. The loss rate of each state,
+/// as well as the probabilities to go from one state to the other, are estimated with
+/// exponentially weighted moving averages. The rate is then computed from the loss rate expected
+/// for the next period, knowing the current state. Thus, the rate drops as soon as a burst begins,
+/// but doesn't stay low when bursts are short.
+class gilbert_elliott_rate_controller
+{
+public:
+
+  /// @brief Constructor
+  /// @param threshold The loss rate above which a period is considered bad
+  /// @param weight The weight of a new sample, in ]0, 1]
+  /// @param max_rate The rate to use when there are almost no losses
+  /// @pre 0 < @p weight <= 1
+  /// @pre @p max_rate > 0
+  explicit gilbert_elliott_rate_controller( double threshold = 0.05, double weight = 0.125
+                                          , std::size_t max_rate = 50)
+  noexcept
+    : m_threshold{threshold}
+    , m_weight{weight}
+    , m_max_rate{max_rate}
+    , m_loss{0, threshold}
+    , m_stay{1, 0.5}
+    , m_state{good}
+  {
+    assert(weight > 0 and weight <= 1);
+    assert(max_rate > 0);
+  }
+
+  /// @brief Compute a new rate
+  std::size_t
+  operator()(const rate_feedback& fb)
+  noexcept
+  {
+    const auto loss = fb.residual_loss();
+    const auto state = loss > m_threshold ? bad : good;
+
+    // Update the probability to stay in the previous state.
+    m_stay[m_state] = m_weight * (state == m_state ? 1 : 0) + (1 - m_weight) * m_stay[m_state];
+
+    // Update the loss rate of the current state.
+    m_loss[state] = m_weight * loss + (1 - m_weight) * m_loss[state];
+    m_state = state;
+
+    return detail::rate_for_loss(expected_loss(), m_max_rate);
+  }
+
+  /// @brief Get the loss rate expected for the next period
+  double
+  expected_loss()
+  const noexcept
+  {
+    const auto other = m_state == good ? bad : good;
+    return m_stay[m_state] * m_loss[m_state] + (1 - m_stay[m_state]) * m_loss[other];
+  }
+
+  /// @brief Tell if the channel is currently considered in a burst of losses
+  bool
+  bursty()
+  const noexcept
+  {
+    return m_state == bad;
+  }
+
+private:
+
+  /// @brief The states of the model
+  enum state_type : unsigned int {good = 0, bad = 1};
+
+  /// @brief The loss rate above which a period is considered bad
+  double m_threshold;
+
+  /// @brief The weight of a new sample
+  double m_weight;
+
+  /// @brief The rate to use when there are almost no losses
+  std::size_t m_max_rate;
+
+  /// @brief The loss rate of each state
+  double m_loss[2];
+
+  /// @brief The probability to stay in each state
+  double m_stay[2];
+
+  /// @brief The current state
+  state_type m_state;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <algorithm> // all_of
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <utility> // forward
+
+#include <boost/container/flat_map.hpp>
+#include <boost/container/map.hpp>
+#include <boost/optional.hpp>
+
+#include "netcode/detail/coefficient.hh"
+#include "netcode/detail/galois_field.hh"
+#include "netcode/detail/mix.hh"
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/packetizer.hh"
+#include "netcode/detail/repair.hh"
+#include "netcode/detail/source.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/coefficient_generator.hh"
+#include "netcode/errors.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The class to interact with on an intermediate node, between an encoder and a decoder
+/// @ingroup ntc_recoder
+/// @tparam PacketHandler The handler of packets ready to be sent on the network
+///
+/// Sources are forwarded as soon as they are received. Each received repair is replaced by a new
+/// one, which is a random linear combination of the sources and repairs received so far, without
+/// decoding anything. The coefficients of the sources it encodes are carried by the new repair (see
+/// coefficient_generator::recoded), thus a decoder needs no configuration. As a recoded repair
+/// also encodes the sources this node missed, losses on both sides of the node are repaired.
+///
+/// The identifiers of recoded repairs, which also seed their coefficients, are made of the node
+/// identifier given to the constructor: they never collide with the ones of the encoder's repairs,
+/// nor with the ones of other recoders, thus a decoder can receive repairs of several nodes.
+///
+/// Forwarded sources keep the session identifier put by the encoder, if any. Recoded repairs carry
+/// the one given to set_session().
+template <typename PacketHandler>
+class NTC_PUBLIC recoder final
+{
+public:
+
+  /// @brief The type of the handler that processes data ready to be sent on the network
+  using packet_handler_type = PacketHandler;
+
+public:
+
+  /// @brief Can't copy-construct a recoder
+  recoder(const recoder&) = delete;
+
+  /// @brief Can't copy a recoder
+  recoder& operator=(const recoder&) = delete;
+
+  /// @brief Can't move-construct a recoder
+  recoder(recoder&&) = delete;
+
+  /// @brief Can't move a recoder
+  recoder& operator=(recoder&&) = delete;
+
+  /// @brief The number of node identifiers
+  static constexpr std::uint32_t nb_node_ids = 1u << 15;
+
+  /// @brief Constructor
+  /// @param galois_field_size The size of the Galois field, the same as the encoder's one
+  /// @param packet_handler The handler of packets ready to be sent on the network
+  /// @param node_id The identifier of this node, different for all recoders whose repairs might
+  /// reach the same decoder
+  /// @pre @p galois_field_size is 1, 4, 8 or 16
+  /// @pre @p node_id < nb_node_ids
+  template <typename PacketHandler_>
+  recoder( std::uint8_t galois_field_size, PacketHandler_&& packet_handler
+         , std::uint16_t node_id = 0)
+    : m_galois_field_size{galois_field_size}
+    , m_gf{galois_field_size}
+    , m_window_size{64}
+    , m_window_start{0}
+    , m_sources{}
+    , m_repairs{}
+    , m_packet_handler(std::forward<PacketHandler_>(packet_handler))
+    , m_packetizer{m_packet_handler, galois_field_size}
+    , m_repair{0}
+    , m_combination{}
+    , m_node_id{node_id}
+    , m_current_repair_id{0}
+    , m_nb_received_sources{0}
+    , m_nb_received_repairs{0}
+    , m_nb_sent_repairs{0}
+  {
+    // Encoded sizes are carried on 16 bits, they can't be recoded with a 32 bits field.
+    assert(galois_field_size != 32 && "Recoding is not supported with a 32 bits field");
+    assert(node_id < nb_node_ids);
+  }
+
+  /// @brief Notify the recoder of an incoming packet
+  std::size_t
+  operator()(const packet& p)
+  {
+    return operator()(packet{p});
+  }
+
+  /// @brief Notify the recoder of an incoming packet
+  /// @throw packet_type_error if @p p is neither a source nor a repair
+  std::size_t
+  operator()(packet&& p)
+  {
+    assert(p.size() != 0 && "empty packet");
+
+    switch (detail::get_packet_type(p))
+    {
+      case detail::packet_type::source:
+      {
+        ++m_nb_received_sources;
+
+        // Forward the source as is.
+        m_packet_handler(p.data(), p.size());
+        m_packet_handler();
+
+        auto res = m_packetizer.read_source(std::move(p));
+        add_source(std::move(res.first));
+        return res.second;
+      }
+
+      case detail::packet_type::repair:
+      {
+        ++m_nb_received_repairs;
+        auto res = m_packetizer.read_repair(std::move(p));
+        add_repair(std::move(res.first));
+        generate_repair();
+        return res.second;
+      }
+
+      default:
+      {
+        throw packet_type_error{p};
+      }
+    }
+  }
+
+  /// @brief Send a new random linear combination of the buffered sources and repairs
+  /// @return false if nothing is buffered, in which case no repair is sent
+  bool
+  generate_repair()
+  {
+    m_combination.clear();
+    m_repair.reset();
+    m_repair.encoded_size() = 0;
+
+    auto counter = std::uint32_t{0};
+    for (const auto& id_src : m_sources)
+    {
+      const auto& src = id_src.second;
+      const auto a = random_coefficient(counter++);
+      if (a != 0)
+      {
+        add_symbol(src.symbol(), src.symbol_size(), src.symbol_size(), a);
+        m_combination[id_src.first] ^= a;
+      }
+    }
+    for (const auto& r : m_repairs)
+    {
+      const auto a = random_coefficient(counter++);
+      if (a != 0)
+      {
+        add_symbol(r.symbol(), r.symbol_size(), r.encoded_size(), a);
+        for (const auto& c : r.coefficients())
+        {
+          m_combination[c.first] ^= m_gf.multiply(a, c.second);
+        }
+      }
+    }
+
+    // Sources whose contributions cancelled each other are not encoded.
+    m_repair.coefficients().clear();
+    for (const auto& c : m_combination)
+    {
+      if (c.second != 0)
+      {
+        m_repair.source_ids().insert(m_repair.source_ids().end(), c.first);
+        m_repair.coefficients().emplace_back(c.first, c.second);
+      }
+    }
+    if (m_repair.source_ids().empty())
+    {
+      return false;
+    }
+
+    m_repair.id() = repair_id();
+    ++m_current_repair_id;
+    m_repair.window_start() = m_window_start;
+    m_repair.generator() = coefficient_generator::recoded;
+    m_packetizer.write_repair(m_repair);
+    ++m_nb_sent_repairs;
+    return true;
+  }
+
+  /// @brief Set the maximal number of sources, and of repairs, to buffer
+  /// @pre @p size > 0
+  recoder&
+  set_window_size(std::size_t size)
+  noexcept
+  {
+    assert(size > 0);
+    m_window_size = size;
+    return *this;
+  }
+
+  /// @brief Get the maximal number of sources, and of repairs, to buffer
+  std::size_t
+  window_size()
+  const noexcept
+  {
+    return m_window_size;
+  }
+
+  /// @brief Set the session identifier to put in all recoded repairs
+  ///
+  /// It should be the one of the encoder, for recoded repairs to reach the same session as its
+  /// sources on a node which shares a socket among many flows.
+  /// @see encoder::set_session
+  recoder&
+  set_session(std::uint32_t id)
+  noexcept
+  {
+    m_packetizer.set_session(id);
+    return *this;
+  }
+
+  /// @brief Get the session identifier put in all recoded repairs, if any
+  boost::optional<std::uint32_t>
+  session()
+  const noexcept
+  {
+    return m_packetizer.session();
+  }
+
+  /// @brief Get the number of buffered sources and repairs
+  std::size_t
+  window()
+  const noexcept
+  {
+    return m_sources.size() + m_repairs.size();
+  }
+
+  /// @brief Get the Galois field size
+  std::uint8_t
+  galois_field_size()
+  const noexcept
+  {
+    return m_galois_field_size;
+  }
+
+  /// @brief Get the identifier of this node
+  std::uint16_t
+  node_id()
+  const noexcept
+  {
+    return m_node_id;
+  }
+
+  /// @brief Get the total number of received sources
+  std::size_t
+  nb_received_sources()
+  const noexcept
+  {
+    return m_nb_received_sources;
+  }
+
+  /// @brief Get the total number of received repairs
+  std::size_t
+  nb_received_repairs()
+  const noexcept
+  {
+    return m_nb_received_repairs;
+  }
+
+  /// @brief Get the total number of sent repairs
+  std::size_t
+  nb_sent_repairs()
+  const noexcept
+  {
+    return m_nb_sent_repairs;
+  }
+
+  /// @brief Get the packet handler
+  const packet_handler_type&
+  packet_handler()
+  const noexcept
+  {
+    return m_packet_handler;
+  }
+
+  /// @brief Get the packet handler
+  packet_handler_type&
+  packet_handler()
+  noexcept
+  {
+    return m_packet_handler;
+  }
+
+private:
+
+  /// @brief Buffer a received source
+  void
+  add_source(detail::decoder_source&& src)
+  {
+    if (src.id() < m_window_start)
+    {
+      return;
+    }
+    const auto id = src.id(); // to force evaluation order in the following call.
+    m_sources.emplace(id, std::move(src));
+    while (m_sources.size() > m_window_size)
+    {
+      m_sources.erase(m_sources.begin());
+    }
+  }
+
+  /// @brief Buffer a received repair, with the coefficients of the sources it encodes
+  void
+  add_repair(detail::decoder_repair&& r)
+  {
+    // Drop what the encoder will never repair again.
+    if (r.window_start() > m_window_start)
+    {
+      m_window_start = r.window_start();
+      m_sources.erase(m_sources.begin(), m_sources.lower_bound(m_window_start));
+      while (not m_repairs.empty() and m_repairs.front().window_start() < m_window_start)
+      {
+        m_repairs.pop_front();
+      }
+    }
+
+    // A repair which only encodes buffered sources brings nothing new.
+    const auto useless = std::all_of( r.source_ids().begin(), r.source_ids().end()
+                                    , [this](std::uint32_t id){return m_sources.count(id);});
+    if (useless)
+    {
+      return;
+    }
+
+    // Keep the coefficients explicitly, as they will be combined with other ones.
+    if (r.generator() != coefficient_generator::recoded)
+    {
+      r.coefficients().clear();
+      r.coefficients().reserve(r.source_ids().size());
+      for (const auto id : r.source_ids())
+      {
+        r.coefficients().emplace_back(id, detail::coefficient(m_gf, r, id));
+      }
+      r.generator() = coefficient_generator::recoded;
+    }
+
+    m_repairs.emplace_back(std::move(r));
+    while (m_repairs.size() > m_window_size)
+    {
+      m_repairs.pop_front();
+    }
+  }
+
+  /// @brief Add a symbol multiplied by a coefficient to the current repair
+  void
+  add_symbol(const char* symbol, std::size_t len, std::uint16_t size, std::uint32_t a)
+  {
+    if (m_repair.symbol().size() < len)
+    {
+      m_repair.symbol().resize(len);
+    }
+    m_gf.multiply_add(symbol, m_repair.symbol().data(), len, a);
+    m_repair.encoded_size()
+      = static_cast<std::uint16_t>(m_gf.multiply_size(size, a) ^ m_repair.encoded_size());
+  }
+
+  /// @brief Get the identifier of the next repair
+  ///
+  /// The encoder's identifiers are a counter from 0: the ones of recoded repairs have their most
+  /// significant bit set, followed by the node identifier. The 16 bits of the counter of a node
+  /// wrap around long after its older repairs were dropped by decoders.
+  std::uint32_t
+  repair_id()
+  const noexcept
+  {
+    return (1u << 31) | (static_cast<std::uint32_t>(m_node_id) << 16)
+         | (m_current_repair_id & 0xffffu);
+  }
+
+  /// @brief Get a pseudo-random coefficient, which might be 0
+  std::uint32_t
+  random_coefficient(std::uint32_t counter)
+  const noexcept
+  {
+    const auto x = static_cast<std::uint32_t>(detail::mix(repair_id(), counter) >> 32);
+    return x & ((1u << m_galois_field_size) - 1);
+  }
+
+private:
+
+  /// @brief The size of the Galois field
+  const std::uint8_t m_galois_field_size;
+
+  /// @brief The Galois field used to combine packets
+  detail::galois_field m_gf;
+
+  /// @brief The maximal number of sources, and of repairs, to buffer
+  std::size_t m_window_size;
+
+  /// @brief The identifier of the oldest source the encoder still holds
+  std::uint32_t m_window_start;
+
+  /// @brief The buffered sources
+  boost::container::map<std::uint32_t, detail::decoder_source> m_sources;
+
+  /// @brief The buffered repairs, with explicit coefficients
+  std::deque<detail::decoder_repair> m_repairs;
+
+  /// @brief The handler of packets ready to be sent on the network
+  packet_handler_type m_packet_handler;
+
+  /// @brief Serialize packets
+  detail::packetizer<packet_handler_type> m_packetizer;
+
+  /// @brief Re-use the same memory for the repairs to send
+  detail::encoder_repair m_repair;
+
+  /// @brief Re-use the same memory to compute the coefficients of a new repair
+  boost::container::flat_map<std::uint32_t, std::uint32_t> m_combination;
+
+  /// @brief The identifier of this node
+  const std::uint16_t m_node_id;
+
+  /// @brief The counter for repair packets identifiers
+  std::uint32_t m_current_repair_id;
+
+  /// @brief The total number of received sources
+  std::size_t m_nb_received_sources;
+
+  /// @brief The total number of received repairs
+  std::size_t m_nb_received_repairs;
+
+  /// @brief The total number of sent repairs
+  std::size_t m_nb_sent_repairs;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>  // unique_ptr
+#include <utility> // move
+#include <vector>
+
+#include "netcode/detail/mix.hh"
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/traits.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/errors.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Dispatch incoming packets of many flows to the encoder and the decoder of their session
+/// @ingroup ntc
+/// @tparam Encoder The type of encoders, an ntc::encoder
+/// @tparam Decoder The type of decoders, an ntc::decoder
+///
+/// Packets of a session end with its identifier (see encoder::set_session), thus many flows can
+/// share the same socket. Sessions are stored in an open-addressing hash table with linear
+/// probing, which keeps lookups to a few contiguous memory accesses with tens of thousands of
+/// sessions.
+template <typename Encoder, typename Decoder>
+class NTC_PUBLIC session_table final
+{
+  static_assert(detail::is_encoder<Encoder>::value, "parameter Encoder is not a ntc::encoder");
+  static_assert(detail::is_decoder<Decoder>::value, "parameter Decoder is not a ntc::decoder");
+
+public:
+
+  /// @brief The type of encoders
+  using encoder_type = Encoder;
+
+  /// @brief The type of decoders
+  using decoder_type = Decoder;
+
+  /// @brief A flow, with an encoder, a decoder, or both
+  struct session
+  {
+    /// @brief The encoder which receives acks of this session, if any
+    std::unique_ptr<Encoder> encoder;
+
+    /// @brief The decoder which receives sources and repairs of this session, if any
+    std::unique_ptr<Decoder> decoder;
+  };
+
+public:
+
+  /// @brief Can't copy-construct a session table
+  session_table(const session_table&) = delete;
+
+  /// @brief Can't copy a session table
+  session_table& operator=(const session_table&) = delete;
+
+  /// @brief Can move-construct a session table
+  session_table(session_table&&) = default;
+
+  /// @brief Can move a session table
+  session_table& operator=(session_table&&) = default;
+
+  /// @brief Constructor
+  /// @param capacity The number of sessions to hold before the table grows
+  explicit session_table(std::size_t capacity = 16)
+    : m_slots(capacity_for(capacity))
+    , m_size{0}
+  {}
+
+  /// @brief Add a session, or replace an existing one
+  /// @param id The identifier of the session
+  /// @param enc The encoder of this session, might be null
+  /// @param dec The decoder of this session, might be null
+  /// @return The added session
+  ///
+  /// The encoder and the decoder are told their session identifier.
+  session&
+  insert(std::uint32_t id, std::unique_ptr<Encoder> enc, std::unique_ptr<Decoder> dec)
+  {
+    if (enc)
+    {
+      enc->set_session(id);
+    }
+    if (dec)
+    {
+      dec->set_session(id);
+    }
+
+    auto& s = m_slots[position(id)];
+    if (not s.value)
+    {
+      // Keep the load factor below 3/4.
+      if ((m_size + 1) * 4 > m_slots.size() * 3)
+      {
+        rehash(m_slots.size() * 2);
+        return insert(id, std::move(enc), std::move(dec));
+      }
+      s.id = id;
+      s.value.reset(new session{});
+      ++m_size;
+    }
+    s.value->encoder = std::move(enc);
+    s.value->decoder = std::move(dec);
+    return *s.value;
+  }
+
+  /// @brief Get a session
+  /// @return A null pointer if the session doesn't exist
+  session*
+  find(std::uint32_t id)
+  noexcept
+  {
+    return m_slots[position(id)].value.get();
+  }
+
+  /// @brief Get a session
+  /// @return A null pointer if the session doesn't exist
+  const session*
+  find(std::uint32_t id)
+  const noexcept
+  {
+    return m_slots[position(id)].value.get();
+  }
+
+  /// @brief Remove a session
+  /// @return false if the session doesn't exist
+  bool
+  erase(std::uint32_t id)
+  noexcept
+  {
+    const auto mask = m_slots.size() - 1;
+    auto hole = position(id);
+    if (not m_slots[hole].value)
+    {
+      return false;
+    }
+    m_slots[hole].value.reset();
+    --m_size;
+
+    // Shift back the following entries of the cluster, so that lookups never need tombstones.
+    for (auto i = (hole + 1) & mask; m_slots[i].value; i = (i + 1) & mask)
+    {
+      const auto home = bucket(m_slots[i].id);
+      // Move the entry if its home bucket is not in the cyclic range ]hole, i].
+      if (((i - home) & mask) >= ((i - hole) & mask))
+      {
+        m_slots[hole] = std::move(m_slots[i]);
+        hole = i;
+      }
+    }
+    return true;
+  }
+
+  /// @brief Dispatch an incoming packet to the encoder or the decoder of its session
+  /// @return The number of bytes that have been read
+  /// @throw packet_type_error if @p p has no session identifier, or if its session has no encoder
+  /// (for acks) or no decoder (for sources and repairs).
+  /// @throw unknown_session_error if the session of @p p doesn't exist
+  std::size_t
+  operator()(packet&& p)
+  {
+    if (not detail::has_session(p))
+    {
+      throw packet_type_error{std::move(p)};
+    }
+    const auto id = detail::get_session(p);
+    const auto s = find(id);
+    if (not s)
+    {
+      throw unknown_session_error{id, std::move(p)};
+    }
+
+    if (detail::get_packet_type(p) == detail::packet_type::ack)
+    {
+      if (not s->encoder)
+      {
+        throw packet_type_error{std::move(p)};
+      }
+      return (*s->encoder)(std::move(p));
+    }
+    else
+    {
+      if (not s->decoder)
+      {
+        throw packet_type_error{std::move(p)};
+      }
+      return (*s->decoder)(std::move(p));
+    }
+  }
+
+  /// @brief Dispatch an incoming packet to the encoder or the decoder of its session
+  std::size_t
+  operator()(const packet& p)
+  {
+    return operator()(packet{p});
+  }
+
+  /// @brief Get the number of sessions
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Tell if there are no sessions
+  bool
+  empty()
+  const noexcept
+  {
+    return m_size == 0;
+  }
+
+  /// @brief Apply a function on all sessions, in no particular order
+  /// @param fn A function called with the identifier of a session and the session
+  template <typename Fn>
+  void
+  for_each(Fn&& fn)
+  {
+    for (auto& s : m_slots)
+    {
+      if (s.value)
+      {
+        fn(s.id, *s.value);
+      }
+    }
+  }
+
+private:
+
+  /// @brief An entry of the hash table, empty when it has no value
+  struct slot
+  {
+    std::uint32_t id;
+    std::unique_ptr<session> value;
+  };
+
+  /// @brief Get the power of two number of slots needed to hold @p capacity sessions
+  static
+  std::size_t
+  capacity_for(std::size_t capacity)
+  noexcept
+  {
+    auto n = std::size_t{8};
+    while (n * 3 < capacity * 4)
+    {
+      n *= 2;
+    }
+    return n;
+  }
+
+  /// @brief Get the home bucket of a session identifier
+  std::size_t
+  bucket(std::uint32_t id)
+  const noexcept
+  {
+    return static_cast<std::size_t>(detail::mix(std::uint64_t{id})) & (m_slots.size() - 1);
+  }
+
+  /// @brief Get the slot of a session identifier, or the empty slot where it would be
+  std::size_t
+  position(std::uint32_t id)
+  const noexcept
+  {
+    const auto mask = m_slots.size() - 1;
+    auto i = bucket(id);
+    while (m_slots[i].value and m_slots[i].id != id)
+    {
+      i = (i + 1) & mask;
+    }
+    return i;
+  }
+
+  /// @brief Move all sessions to a table of @p nb_slots slots
+  void
+  rehash(std::size_t nb_slots)
+  {
+    auto old = std::vector<slot>(nb_slots);
+    std::swap(old, m_slots);
+    for (auto& s : old)
+    {
+      if (s.value)
+      {
+        m_slots[position(s.id)] = std::move(s);
+      }
+    }
+  }
+
+private:
+
+  /// @brief The slots of the hash table, a power of two
+  std::vector<slot> m_slots;
+
+  /// @brief The number of sessions
+  std::size_t m_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
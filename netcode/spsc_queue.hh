@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <thread>  // yield
+#include <utility> // move
+#include <vector>
+
+#include "netcode/detail/cache_line.hh"
+#include "netcode/detail/visibility.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A bounded lock-free queue with a single producer thread and a single consumer thread
+/// @ingroup ntc_threads
+/// @tparam T The type of values, usually ntc::data or ntc::packet
+///
+/// Values are moved in and out, thus handing off a data or a packet to another thread never copies
+/// its content. Each index is written by one side only, and kept away from the other one with the
+/// copy of the other side's index it last read. Thus the cache line of the other side is only read
+/// again when the queue looks full (for the producer) or empty (for the consumer).
+template <typename T>
+class NTC_PUBLIC spsc_queue final
+{
+public:
+
+  /// @brief The type of values
+  using value_type = T;
+
+  /// @brief Can't copy-construct a queue
+  spsc_queue(const spsc_queue&) = delete;
+
+  /// @brief Can't copy a queue
+  spsc_queue& operator=(const spsc_queue&) = delete;
+
+  /// @brief Constructor
+  /// @param capacity The maximal number of values in the queue
+  /// @pre @p capacity is a power of two
+  explicit spsc_queue(std::size_t capacity)
+    : m_slots(capacity)
+    , m_mask{capacity - 1}
+    , m_pad0()
+    , m_tail{0}
+    , m_cached_head{0}
+    , m_pad1()
+    , m_head{0}
+    , m_cached_tail{0}
+    , m_pad2()
+  {
+    assert(capacity > 0 and (capacity & (capacity - 1)) == 0);
+  }
+
+  /// @brief Append a value, from the producer thread
+  /// @return false if the queue is full, in which case @p value is left untouched
+  bool
+  try_push(T&& value)
+  {
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head == m_slots.size())
+    {
+      m_cached_head = m_head.load(std::memory_order_acquire);
+      if (tail - m_cached_head == m_slots.size())
+      {
+        return false;
+      }
+    }
+    m_slots[tail & m_mask] = std::move(value);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Append a value, from the producer thread, wait while the queue is full
+  void
+  push(T&& value)
+  {
+    while (not try_push(std::move(value)))
+    {
+      std::this_thread::yield();
+    }
+  }
+
+  /// @brief Take the oldest value, from the consumer thread
+  /// @return false if the queue is empty
+  bool
+  try_pop(T& value)
+  {
+    const auto head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail)
+    {
+      m_cached_tail = m_tail.load(std::memory_order_acquire);
+      if (head == m_cached_tail)
+      {
+        return false;
+      }
+    }
+    value = std::move(m_slots[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @brief Get the maximal number of values in the queue
+  std::size_t
+  capacity()
+  const noexcept
+  {
+    return m_slots.size();
+  }
+
+private:
+
+  /// @brief The values
+  std::vector<T> m_slots;
+
+  /// @brief The mask of indexes
+  const std::size_t m_mask;
+
+  /// @brief Keep the members of the producer on their own cache line
+  detail::cache_line_pad m_pad0;
+
+  /// @brief The next slot to write, written by the producer
+  std::atomic<std::size_t> m_tail;
+
+  /// @brief The last head read by the producer
+  std::size_t m_cached_head;
+
+  /// @brief Keep the members of the consumer on their own cache line
+  detail::cache_line_pad m_pad1;
+
+  /// @brief The next slot to read, written by the consumer
+  std::atomic<std::size_t> m_head;
+
+  /// @brief The last tail read by the consumer
+  std::size_t m_cached_tail;
+
+  /// @brief Keep the members of the consumer away from the ones of the next object
+  detail::cache_line_pad m_pad2;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm> // copy_n
+#include <vector>
+
+#include "netcode/packet.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Coalesce outgoing packets to send them with a single system call.
+///
+/// The packets are re-used from a batch to the next one, thus sending doesn't allocate memory once
+/// the largest packets have been seen.
+/// @tparam Socket The socket which sends batches, a udp_socket or a uring_socket
+template <typename Socket>
+class send_queue final
+{
+public:
+
+  /// @brief Constructor.
+  /// @pre @p batch_size > 0
+  send_queue(Socket& socket, std::size_t batch_size)
+    : m_socket(socket)
+    , m_packets(batch_size)
+    , m_size{0}
+    , m_nb_sent{0}
+  {}
+
+  /// @brief Append a part of the packet being written.
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    auto& p = m_packets[m_size];
+    const auto size = p.size();
+    p.resize(size + len);
+    std::copy_n(data, len, p.data() + size);
+  }
+
+  /// @brief Queue the packet being written, and send the batch when it's full.
+  void
+  operator()()
+  {
+    ++m_size;
+    if (m_size == m_packets.size())
+    {
+      flush();
+    }
+  }
+
+  /// @brief Send all queued packets.
+  void
+  flush()
+  {
+    if (m_size == 0)
+    {
+      return;
+    }
+    m_socket.send(m_packets.data(), m_size);
+    m_nb_sent += m_size;
+    for (auto i = 0ul; i < m_size; ++i)
+    {
+      m_packets[i].clear();
+    }
+    m_size = 0;
+  }
+
+  /// @brief Get the number of queued packets.
+  std::size_t
+  size()
+  const noexcept
+  {
+    return m_size;
+  }
+
+  /// @brief Get the total number of sent packets.
+  std::size_t
+  nb_sent()
+  const noexcept
+  {
+    return m_nb_sent;
+  }
+
+private:
+
+  /// @brief The socket which sends batches.
+  Socket& m_socket;
+
+  /// @brief The queued packets, followed by the one being written.
+  std::vector<packet> m_packets;
+
+  /// @brief The number of queued packets.
+  std::size_t m_size;
+
+  /// @brief The total number of sent packets.
+  std::size_t m_nb_sent;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The packet handler of encoders and decoders which write to a send queue.
+template <typename Socket>
+class send_queue_handler final
+{
+public:
+
+  /// @brief Constructor.
+  explicit send_queue_handler(send_queue<Socket>& queue)
+    : m_queue(&queue)
+  {}
+
+  /// @brief Append a part of the packet being written.
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    (*m_queue)(data, len);
+  }
+
+  /// @brief Queue the packet being written.
+  void
+  operator()()
+  {
+    (*m_queue)();
+  }
+
+private:
+
+  /// @brief The queue which sends packets.
+  send_queue<Socket>* m_queue;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
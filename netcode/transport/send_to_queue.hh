@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm> // copy_n
+#include <cstring>   // memcmp
+#include <vector>
+
+#include <netinet/in.h> // sockaddr_in, sockaddr_in6
+#include <sys/socket.h> // sockaddr_storage
+
+#include "netcode/transport/udp_socket.hh"
+#include "netcode/packet.hh"
+
+namespace ntc { namespace detail {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Tell if two socket addresses are the same IPv4 or IPv6 address and port.
+///
+/// The bytes of a sockaddr_storage past the address of its family are not significant.
+inline
+bool
+same_address(const ::sockaddr_storage& lhs, const ::sockaddr_storage& rhs)
+noexcept
+{
+  if (lhs.ss_family != rhs.ss_family)
+  {
+    return false;
+  }
+  if (lhs.ss_family == AF_INET)
+  {
+    const auto& l = reinterpret_cast<const ::sockaddr_in&>(lhs);
+    const auto& r = reinterpret_cast<const ::sockaddr_in&>(rhs);
+    return l.sin_port == r.sin_port and l.sin_addr.s_addr == r.sin_addr.s_addr;
+  }
+  const auto& l = reinterpret_cast<const ::sockaddr_in6&>(lhs);
+  const auto& r = reinterpret_cast<const ::sockaddr_in6&>(rhs);
+  return l.sin6_port == r.sin6_port
+     and std::memcmp(&l.sin6_addr, &r.sin6_addr, sizeof(l.sin6_addr)) == 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief Coalesce outgoing packets to many addresses to send them with a single system call.
+///
+/// Like send_queue, the packets are re-used from a batch to the next one.
+class send_to_queue final
+{
+public:
+
+  /// @brief Constructor.
+  /// @pre @p batch_size > 0
+  send_to_queue(udp_socket& socket, std::size_t batch_size)
+    : m_socket(socket)
+    , m_packets(batch_size)
+    , m_destinations(batch_size)
+    , m_size{0}
+    , m_nb_sent{0}
+  {}
+
+  /// @brief Append a part of the packet being written.
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    auto& p = m_packets[m_size];
+    const auto size = p.size();
+    p.resize(size + len);
+    std::copy_n(data, len, p.data() + size);
+  }
+
+  /// @brief Queue the packet being written for @p destination, and send the batch when it's full.
+  void
+  operator()(const ::sockaddr_storage& destination)
+  {
+    m_destinations[m_size] = destination;
+    ++m_size;
+    if (m_size == m_packets.size())
+    {
+      flush();
+    }
+  }
+
+  /// @brief Send all queued packets.
+  void
+  flush()
+  {
+    if (m_size == 0)
+    {
+      return;
+    }
+    m_socket.send_to(m_packets.data(), m_destinations.data(), m_size);
+    m_nb_sent += m_size;
+    for (auto i = 0ul; i < m_size; ++i)
+    {
+      m_packets[i].clear();
+    }
+    m_size = 0;
+  }
+
+  /// @brief Get the total number of sent packets.
+  std::size_t
+  nb_sent()
+  const noexcept
+  {
+    return m_nb_sent;
+  }
+
+private:
+
+  /// @brief The socket which sends batches.
+  udp_socket& m_socket;
+
+  /// @brief The queued packets, followed by the one being written.
+  std::vector<packet> m_packets;
+
+  /// @brief The address of each queued packet.
+  std::vector<::sockaddr_storage> m_destinations;
+
+  /// @brief The number of queued packets.
+  std::size_t m_size;
+
+  /// @brief The total number of sent packets.
+  std::size_t m_nb_sent;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @internal
+/// @brief The packet handler of the encoder and the decoder of a peer, which write to a send
+/// queue shared by many peers.
+class send_to_handler final
+{
+public:
+
+  /// @brief Constructor.
+  send_to_handler(send_to_queue& queue, const ::sockaddr_storage& peer)
+    : m_queue(&queue)
+    , m_peer(peer)
+  {}
+
+  /// @brief Append a part of the packet being written.
+  void
+  operator()(const char* data, std::size_t len)
+  {
+    (*m_queue)(data, len);
+  }
+
+  /// @brief Queue the packet being written.
+  void
+  operator()()
+  {
+    (*m_queue)(m_peer);
+  }
+
+  /// @brief Get the address of the peer.
+  const ::sockaddr_storage&
+  peer()
+  const noexcept
+  {
+    return m_peer;
+  }
+
+private:
+
+  /// @brief The queue which sends packets.
+  send_to_queue* m_queue;
+
+  /// @brief The address of the peer.
+  ::sockaddr_storage m_peer;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace ntc::detail
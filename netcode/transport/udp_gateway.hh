@@ -0,0 +1,509 @@
+#pragma once
+
+#include <algorithm> // max
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <functional>
+#include <memory>  // unique_ptr
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility> // move, swap
+#include <vector>
+
+#include <netinet/in.h> // sockaddr_in, sockaddr_in6
+#include <sys/socket.h> // sockaddr_storage
+
+#include "netcode/detail/mix.hh"
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/transport/send_to_queue.hh"
+#include "netcode/transport/udp_socket.hh"
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/errors.hh"
+#include "netcode/in_order.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The end of the encoded flows of many peers, sharded over worker threads
+/// @ingroup ntc_transport
+/// @tparam DataHandler The handler of decoded data
+/// @tparam RateController How the rate is computed in adaptive mode (see loss_rate_controller)
+///
+/// Each worker thread owns a socket bound to the same address and port with SO_REUSEPORT. The
+/// kernel hashes each flow (its addresses and ports) to one of these sockets, thus all datagrams of
+/// a peer reach the same worker. This worker creates the session of the peer the first time one of
+/// its sources or repairs arrives (see encoder::set_session), and keeps its encoder and decoder in
+/// its own table. Workers share nothing, so throughput grows with their number when there are many
+/// flows.
+///
+/// Sessions are identified by the address of their peer and by their identifier: peers can't reach
+/// the sessions of others, even with the same identifier. A peer whose address changes, e.g. when
+/// its NAT binding expires, starts a new session.
+///
+/// A session which receives nothing for a while is removed, with its encoder, its decoder and its
+/// data handler, thus sessions left behind by peers which changed their address don't pile up. The
+/// number of sessions of a worker is also bounded: once it's reached, datagrams which would open a
+/// new session are dropped until idle ones are removed.
+///
+/// Decoded data is given to the data handler of its session, on the thread of its worker. The
+/// data handler is created with the encoder of the session, through which it can answer the peer.
+/// @note Peers must send packets with a session identifier, other datagrams are dropped.
+template <typename DataHandler, typename RateController = loss_rate_controller>
+class NTC_PUBLIC udp_gateway final
+{
+public:
+
+  /// @brief The type of encoders and decoders packet handler
+  using packet_handler_type = detail::send_to_handler;
+
+  /// @brief The type of the encoders of sessions
+  using encoder_type = ntc::encoder<packet_handler_type, RateController>;
+
+  /// @brief The type of the decoders of sessions
+  using decoder_type = ntc::decoder<packet_handler_type, DataHandler>;
+
+  /// @brief The flow of a peer, with its encoder and its decoder
+  struct session_type
+  {
+    /// @brief The encoder which sends data to the peer and receives its acks
+    std::unique_ptr<encoder_type> encoder;
+
+    /// @brief The decoder which receives sources and repairs of the peer
+    std::unique_ptr<decoder_type> decoder;
+
+    /// @brief When the last datagram of the peer was received
+    std::chrono::steady_clock::time_point last_activity;
+  };
+
+  /// @brief Create the data handler of a new session
+  ///
+  /// It's called with the index of the worker, the identifier of the session, and its encoder. Each
+  /// worker calls its own copy.
+  using factory_type = std::function<DataHandler(std::size_t, std::uint32_t, encoder_type&)>;
+
+public:
+
+  /// @brief Can't copy-construct a gateway
+  udp_gateway(const udp_gateway&) = delete;
+
+  /// @brief Can't copy a gateway
+  udp_gateway& operator=(const udp_gateway&) = delete;
+
+  /// @brief Constructor
+  /// @param address The local IPv4 or IPv6 numeric address
+  /// @param port The local port, 0 to let the system choose one
+  /// @param nb_workers The number of worker threads
+  /// @param galois_field_size The size of the Galois field, see encoder::encoder
+  /// @param ordered Tell decoders if data should be given in order
+  /// @param factory Create the data handler of each new session
+  /// @param batch_size The maximal number of datagrams received or sent by a system call
+  /// @param idle_timeout How long a session is kept without receiving anything from its peer
+  /// @param max_sessions The maximal number of sessions of each worker
+  /// @pre @p nb_workers > 0, @p batch_size > 0, @p idle_timeout > 0 and @p max_sessions > 0
+  ///
+  /// Sockets are bound, but nothing is received until start() is called.
+  udp_gateway( const std::string& address, std::uint16_t port, std::size_t nb_workers
+             , std::uint8_t galois_field_size, in_order ordered, factory_type factory
+             , std::size_t batch_size = 32
+             , std::chrono::milliseconds idle_timeout = std::chrono::seconds{60}
+             , std::size_t max_sessions = 65536)
+    : m_workers()
+    , m_threads()
+    , m_stop{false}
+    , m_port{port}
+  {
+    assert(nb_workers > 0 and batch_size > 0);
+    assert(idle_timeout.count() > 0 and max_sessions > 0);
+    m_workers.reserve(nb_workers);
+    for (auto i = 0ul; i < nb_workers; ++i)
+    {
+      m_workers.emplace_back(new worker{ udp_socket{address, m_port, true}, i, galois_field_size
+                                       , ordered, factory, batch_size, idle_timeout
+                                       , max_sessions});
+      // All sockets must share the port chosen by the system for the first one.
+      m_port = m_workers.front()->socket().local_port();
+    }
+  }
+
+  /// @brief Destructor, stops workers
+  ~udp_gateway()
+  {
+    stop();
+  }
+
+  /// @brief Start worker threads
+  void
+  start()
+  {
+    if (not m_threads.empty())
+    {
+      return;
+    }
+    m_stop.store(false);
+    for (auto& w : m_workers)
+    {
+      const auto ptr = w.get();
+      m_threads.emplace_back([ptr, this]{ptr->run(m_stop);});
+    }
+  }
+
+  /// @brief Stop worker threads, and wait for them
+  ///
+  /// Sessions are kept, start() resumes them.
+  void
+  stop()
+  {
+    m_stop.store(true);
+    for (auto& t : m_threads)
+    {
+      t.join();
+    }
+    m_threads.clear();
+  }
+
+  /// @brief Get the local port shared by all workers
+  std::uint16_t
+  port()
+  const noexcept
+  {
+    return m_port;
+  }
+
+  /// @brief Get the number of workers
+  std::size_t
+  nb_workers()
+  const noexcept
+  {
+    return m_workers.size();
+  }
+
+  /// @brief Apply a function on all sessions, in no particular order
+  /// @param fn A function called with the index of a worker, the identifier of a session and the
+  /// session
+  /// @pre Workers are stopped
+  template <typename Fn>
+  void
+  for_each_session(Fn&& fn)
+  {
+    assert(m_threads.empty());
+    for (auto& w : m_workers)
+    {
+      for (auto& flow_session : w->sessions())
+      {
+        fn(w->index(), flow_session.first.id, flow_session.second);
+      }
+    }
+  }
+
+  /// @brief Get the total number of received datagrams
+  /// @pre Workers are stopped
+  std::size_t
+  nb_received_datagrams()
+  const noexcept
+  {
+    assert(m_threads.empty());
+    auto res = std::size_t{0};
+    for (const auto& w : m_workers)
+    {
+      res += w->nb_received();
+    }
+    return res;
+  }
+
+  /// @brief Get the total number of dropped datagrams
+  /// @pre Workers are stopped
+  std::size_t
+  nb_invalid_datagrams()
+  const noexcept
+  {
+    assert(m_threads.empty());
+    auto res = std::size_t{0};
+    for (const auto& w : m_workers)
+    {
+      res += w->nb_invalid();
+    }
+    return res;
+  }
+
+private:
+
+  /// @brief The address of a peer and the identifier of one of its sessions
+  struct flow
+  {
+    ::sockaddr_storage address;
+    std::uint32_t id;
+
+    bool
+    operator==(const flow& other)
+    const noexcept
+    {
+      return id == other.id and detail::same_address(address, other.address);
+    }
+  };
+
+  /// @brief Hash the significant bytes of a flow
+  struct flow_hash
+  {
+    std::size_t
+    operator()(const flow& f)
+    const noexcept
+    {
+      if (f.address.ss_family == AF_INET)
+      {
+        const auto& a = reinterpret_cast<const ::sockaddr_in&>(f.address);
+        return static_cast<std::size_t>(
+          detail::mix(detail::mix(f.id, a.sin_addr.s_addr) ^ a.sin_port));
+      }
+      const auto& a = reinterpret_cast<const ::sockaddr_in6&>(f.address);
+      std::uint64_t words[2];
+      std::memcpy(words, &a.sin6_addr, sizeof(words));
+      return static_cast<std::size_t>(
+        detail::mix(detail::mix(detail::mix(f.id, a.sin6_port) ^ words[0]) ^ words[1]));
+    }
+  };
+
+  /// @brief The type of the tables of sessions of workers
+  using session_map = std::unordered_map<flow, session_type, flow_hash>;
+
+  /// @brief A worker thread, with its socket and its sessions
+  class worker final
+  {
+  public:
+
+    worker( udp_socket&& socket, std::size_t index, std::uint8_t galois_field_size
+          , in_order ordered, const factory_type& factory, std::size_t batch_size
+          , std::chrono::milliseconds idle_timeout, std::size_t max_sessions)
+      : m_socket{std::move(socket)}
+      , m_queue{m_socket, batch_size}
+      , m_sessions{}
+      , m_index{index}
+      , m_galois_field_size{galois_field_size}
+      , m_in_order{ordered}
+      , m_factory{factory}
+      , m_packets(batch_size)
+      , m_sources(batch_size)
+      , m_idle_timeout{idle_timeout}
+      , m_max_sessions{max_sessions}
+      , m_next_expiration{std::chrono::steady_clock::now() + idle_timeout}
+      , m_nb_received{0}
+      , m_nb_invalid{0}
+    {}
+
+    /// @brief Receive and process batches until @p stop is set
+    void
+    run(const std::atomic<bool>& stop)
+    {
+      while (not stop.load(std::memory_order_relaxed))
+      {
+        poll(std::chrono::milliseconds{50});
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= m_next_expiration)
+        {
+          expire(now);
+        }
+      }
+    }
+
+    const udp_socket&
+    socket()
+    const noexcept
+    {
+      return m_socket;
+    }
+
+    std::size_t
+    index()
+    const noexcept
+    {
+      return m_index;
+    }
+
+    session_map&
+    sessions()
+    noexcept
+    {
+      return m_sessions;
+    }
+
+    std::size_t
+    nb_received()
+    const noexcept
+    {
+      return m_nb_received;
+    }
+
+    std::size_t
+    nb_invalid()
+    const noexcept
+    {
+      return m_nb_invalid;
+    }
+
+  private:
+
+    /// @brief Receive a batch of datagrams and process them, then send queued packets
+    void
+    poll(std::chrono::milliseconds timeout)
+    {
+      const auto nb = m_socket.receive_from(m_packets, m_sources, timeout);
+      m_nb_received += nb;
+      for (auto i = 0ul; i < nb; ++i)
+      {
+        // Decoders might keep packets for a while: give them away, the socket sizes the empty
+        // packets left in their place to its datagrams.
+        auto p = packet{};
+        std::swap(p, m_packets[i]);
+        process(std::move(p), m_sources[i]);
+      }
+      m_queue.flush();
+    }
+
+    /// @brief Give a received datagram to its session, which is created if needed
+    void
+    process(packet&& p, const ::sockaddr_storage& source)
+    {
+      if (not detail::has_session(p))
+      {
+        ++m_nb_invalid;
+        return;
+      }
+      // Anything can come from the network, a malformed datagram must not stop the worker.
+      try
+      {
+        const auto is_ack = detail::get_packet_type(p) == detail::packet_type::ack;
+        auto s = m_sessions.find(flow{source, detail::get_session(p)});
+        if (s == m_sessions.end())
+        {
+          // Only the first sources or repairs of a peer open its session, if there's room left.
+          if (is_ack or m_sessions.size() >= m_max_sessions)
+          {
+            ++m_nb_invalid;
+            return;
+          }
+          s = create(flow{source, detail::get_session(p)});
+        }
+        s->second.last_activity = std::chrono::steady_clock::now();
+        if (is_ack)
+        {
+          (*s->second.encoder)(std::move(p));
+        }
+        else
+        {
+          (*s->second.decoder)(std::move(p));
+        }
+      }
+      catch (const packet_type_error&)
+      {
+        ++m_nb_invalid;
+      }
+      catch (const overflow_error&)
+      {
+        ++m_nb_invalid;
+      }
+    }
+
+    /// @brief Create the session of a new peer
+    typename session_map::iterator
+    create(const flow& f)
+    {
+      auto enc = std::unique_ptr<encoder_type>{
+        new encoder_type{m_galois_field_size, packet_handler_type{m_queue, f.address}}};
+      auto dec = std::unique_ptr<decoder_type>{
+        new decoder_type{ m_galois_field_size, m_in_order, packet_handler_type{m_queue, f.address}
+                        , m_factory(m_index, f.id, *enc)}};
+      enc->set_session(f.id);
+      dec->set_session(f.id);
+      return m_sessions.emplace(f, session_type{std::move(enc), std::move(dec), {}}).first;
+    }
+
+    /// @brief Remove the sessions whose peer has been idle for longer than the timeout
+    ///
+    /// Sessions are checked every half timeout, thus one is removed after at most one and a half.
+    void
+    expire(std::chrono::steady_clock::time_point now)
+    {
+      for (auto it = m_sessions.begin(); it != m_sessions.end();)
+      {
+        if (now - it->second.last_activity > m_idle_timeout)
+        {
+          it = m_sessions.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+      m_next_expiration = now + std::max(m_idle_timeout / 2, std::chrono::milliseconds{1});
+    }
+
+  private:
+
+    /// @brief The socket of this worker, bound to the port of the gateway
+    udp_socket m_socket;
+
+    /// @brief Coalesce the packets of all sessions
+    detail::send_to_queue m_queue;
+
+    /// @brief The sessions of the peers hashed to this worker
+    session_map m_sessions;
+
+    /// @brief The index of this worker
+    std::size_t m_index;
+
+    /// @brief The size of the Galois field of new sessions
+    std::uint8_t m_galois_field_size;
+
+    /// @brief Tell decoders of new sessions if data should be given in order
+    in_order m_in_order;
+
+    /// @brief Create the data handler of new sessions
+    factory_type m_factory;
+
+    /// @brief The packets of received batches
+    std::vector<packet> m_packets;
+
+    /// @brief The addresses of the datagrams of a received batch
+    std::vector<::sockaddr_storage> m_sources;
+
+    /// @brief How long a session is kept without receiving anything from its peer
+    std::chrono::milliseconds m_idle_timeout;
+
+    /// @brief The maximal number of sessions of this worker
+    std::size_t m_max_sessions;
+
+    /// @brief When idle sessions are removed next
+    std::chrono::steady_clock::time_point m_next_expiration;
+
+    /// @brief The total number of received datagrams
+    std::size_t m_nb_received;
+
+    /// @brief The total number of dropped datagrams
+    std::size_t m_nb_invalid;
+  };
+
+private:
+
+  /// @brief The workers, which don't move once their thread is started
+  std::vector<std::unique_ptr<worker>> m_workers;
+
+  /// @brief The threads of the workers, empty when they are stopped
+  std::vector<std::thread> m_threads;
+
+  /// @brief Tell workers to stop
+  std::atomic<bool> m_stop;
+
+  /// @brief The port shared by all workers
+  std::uint16_t m_port;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,731 @@
+#include <algorithm>    // copy_n, min, rotate
+#include <cassert>
+#include <cerrno>
+#include <cstring>      // memcpy, memset
+#include <stdexcept>
+#include <system_error>
+#include <utility>      // swap
+
+#include <arpa/inet.h>  // inet_pton
+#include <netinet/in.h>
+#include <netinet/udp.h> // UDP_GRO, UDP_SEGMENT
+#include <poll.h>
+#include <unistd.h>     // close
+
+#include "netcode/transport/udp_socket.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief The maximal number of segments of a datagram segmented by the kernel
+constexpr auto max_segments = 64ul;
+
+/// @brief The maximal size of a datagram segmented by the kernel, whatever the IP version
+constexpr auto max_segmented_size = 65535ul - 40 - 8;
+
+/// @brief The maximal size of a received datagram, coalesced or not
+constexpr auto max_datagram_size = 65535ul;
+
+/// @brief The size given to packets before any datagram is received, enough for a usual MTU
+constexpr auto initial_packet_size = 2048ul;
+
+/// @brief Report the last error of a system call
+[[noreturn]]
+void
+throw_errno(const char* what)
+{
+  throw std::system_error{errno, std::system_category(), what};
+}
+
+/// @brief Convert a numeric address and a port to a socket address
+socklen_t
+make_address(const std::string& address, std::uint16_t port, ::sockaddr_storage& res)
+{
+  std::memset(&res, 0, sizeof(res));
+
+  auto& in4 = reinterpret_cast<::sockaddr_in&>(res);
+  if (::inet_pton(AF_INET, address.c_str(), &in4.sin_addr) == 1)
+  {
+    in4.sin_family = AF_INET;
+    in4.sin_port = htons(port);
+    return sizeof(::sockaddr_in);
+  }
+
+  auto& in6 = reinterpret_cast<::sockaddr_in6&>(res);
+  if (::inet_pton(AF_INET6, address.c_str(), &in6.sin6_addr) == 1)
+  {
+    in6.sin6_family = AF_INET6;
+    in6.sin6_port = htons(port);
+    return sizeof(::sockaddr_in6);
+  }
+
+  throw std::invalid_argument{"Invalid address " + address};
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+udp_socket::udp_socket(udp_socket&& other)
+noexcept
+  : m_fd{other.m_fd}
+  , m_family{other.m_family}
+  , m_headers{std::move(other.m_headers)}
+  , m_iovecs{std::move(other.m_iovecs)}
+  , m_controls{std::move(other.m_controls)}
+  , m_gso{other.m_gso}
+  , m_max_segment_size{other.m_max_segment_size}
+  , m_gro{other.m_gro}
+  , m_segment_size{other.m_segment_size}
+  , m_group{other.m_group}
+  , m_packet_size{other.m_packet_size}
+  , m_spills{std::move(other.m_spills)}
+  , m_nb_spilled_datagrams{other.m_nb_spilled_datagrams}
+  , m_scratch{std::move(other.m_scratch)}
+  , m_overflow{std::move(other.m_overflow)}
+  , m_nb_copied_segments{other.m_nb_copied_segments}
+  , m_nb_receive_calls{other.m_nb_receive_calls}
+  , m_nb_send_calls{other.m_nb_send_calls}
+{
+  other.m_fd = -1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+udp_socket&
+udp_socket::operator=(udp_socket&& other)
+noexcept
+{
+  std::swap(m_fd, other.m_fd);
+  std::swap(m_family, other.m_family);
+  std::swap(m_headers, other.m_headers);
+  std::swap(m_iovecs, other.m_iovecs);
+  std::swap(m_controls, other.m_controls);
+  std::swap(m_gso, other.m_gso);
+  std::swap(m_max_segment_size, other.m_max_segment_size);
+  std::swap(m_gro, other.m_gro);
+  std::swap(m_segment_size, other.m_segment_size);
+  std::swap(m_group, other.m_group);
+  std::swap(m_packet_size, other.m_packet_size);
+  std::swap(m_spills, other.m_spills);
+  std::swap(m_nb_spilled_datagrams, other.m_nb_spilled_datagrams);
+  std::swap(m_scratch, other.m_scratch);
+  std::swap(m_overflow, other.m_overflow);
+  std::swap(m_nb_copied_segments, other.m_nb_copied_segments);
+  std::swap(m_nb_receive_calls, other.m_nb_receive_calls);
+  std::swap(m_nb_send_calls, other.m_nb_send_calls);
+  return *this;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+udp_socket::udp_socket(const std::string& address, std::uint16_t port, bool reuse_port)
+  : m_fd{-1}
+  , m_family{AF_UNSPEC}
+  , m_headers{}
+  , m_iovecs{}
+  , m_controls{}
+  , m_gso{false}
+  , m_max_segment_size{0}
+  , m_gro{false}
+  , m_segment_size{0}
+  , m_group{1}
+  , m_packet_size{initial_packet_size}
+  , m_spills{}
+  , m_nb_spilled_datagrams{0}
+  , m_scratch{}
+  , m_overflow{}
+  , m_nb_copied_segments{0}
+  , m_nb_receive_calls{0}
+  , m_nb_send_calls{0}
+{
+  ::sockaddr_storage addr;
+  const auto len = make_address(address, port, addr);
+  m_family = addr.ss_family;
+
+  m_fd = ::socket(m_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (m_fd < 0)
+  {
+    throw_errno("socket");
+  }
+  auto one = 1;
+  if (reuse_port and ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)
+  {
+    const auto err = errno;
+    ::close(m_fd);
+    errno = err;
+    throw_errno("setsockopt");
+  }
+  if (::bind(m_fd, reinterpret_cast<const ::sockaddr*>(&addr), len) != 0)
+  {
+    const auto err = errno;
+    ::close(m_fd);
+    errno = err;
+    throw_errno("bind");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+udp_socket::~udp_socket()
+{
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+udp_socket::connect(const std::string& address, std::uint16_t port)
+{
+  ::sockaddr_storage addr;
+  const auto len = make_address(address, port, addr);
+  if (addr.ss_family != m_family)
+  {
+    throw std::invalid_argument{"Address " + address + " is not of the socket's family"};
+  }
+  if (::connect(m_fd, reinterpret_cast<const ::sockaddr*>(&addr), len) != 0)
+  {
+    throw_errno("connect");
+  }
+
+  // The kernel refuses to segment datagrams in segments larger than the path MTU.
+  auto mtu = 0;
+  auto mtu_len = static_cast<socklen_t>(sizeof(mtu));
+  const auto ok = m_family == AF_INET ? ::getsockopt(m_fd, IPPROTO_IP, IP_MTU, &mtu, &mtu_len)
+                                      : ::getsockopt(m_fd, IPPROTO_IPV6, IPV6_MTU, &mtu, &mtu_len);
+  const auto headers = (m_family == AF_INET ? 20 : 40) + 8;
+  m_max_segment_size = ok == 0 and mtu > headers ? static_cast<std::size_t>(mtu - headers) : 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint16_t
+udp_socket::local_port()
+const
+{
+  ::sockaddr_storage addr;
+  auto len = static_cast<socklen_t>(sizeof(addr));
+  if (::getsockname(m_fd, reinterpret_cast<::sockaddr*>(&addr), &len) != 0)
+  {
+    throw_errno("getsockname");
+  }
+  return m_family == AF_INET ? ntohs(reinterpret_cast<const ::sockaddr_in&>(addr).sin_port)
+                             : ntohs(reinterpret_cast<const ::sockaddr_in6&>(addr).sin6_port);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+udp_socket::set_gso(bool enable)
+{
+  // Setting a segment size of 0 doesn't segment anything, it only tells if segmentation exists.
+  auto size = 0;
+  if (enable and ::setsockopt(m_fd, SOL_UDP, UDP_SEGMENT, &size, sizeof(size)) != 0)
+  {
+    return false;
+  }
+  m_gso = enable;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+udp_socket::set_gro(bool enable)
+{
+  auto value = enable ? 1 : 0;
+  if (::setsockopt(m_fd, SOL_UDP, UDP_GRO, &value, sizeof(value)) != 0)
+  {
+    return false;
+  }
+  m_gro = enable;
+  m_segment_size = 0;
+  m_group = 1;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+udp_socket::receive(std::vector<packet>& packets, std::chrono::milliseconds timeout)
+{
+  ::pollfd pfd{m_fd, POLLIN, 0};
+  const auto ready = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+  if (ready < 0 and errno != EINTR)
+  {
+    throw_errno("poll");
+  }
+  if (ready <= 0 or packets.empty())
+  {
+    return 0;
+  }
+  if (m_gro)
+  {
+    return receive_segments(packets);
+  }
+  return receive_datagrams(packets, nullptr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+udp_socket::receive_from( std::vector<packet>& packets, std::vector<::sockaddr_storage>& sources
+                        , std::chrono::milliseconds timeout)
+{
+  assert(not m_gro);
+  sources.resize(packets.size());
+  ::pollfd pfd{m_fd, POLLIN, 0};
+  const auto ready = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+  if (ready < 0 and errno != EINTR)
+  {
+    throw_errno("poll");
+  }
+  if (ready <= 0 or packets.empty())
+  {
+    return 0;
+  }
+  return receive_datagrams(packets, sources.data());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+udp_socket::receive_datagrams(std::vector<packet>& packets, ::sockaddr_storage* sources)
+{
+  // Each datagram is received in its packet, then in its spill buffer.
+  const auto nb = packets.size();
+  prepare(nb, 2 * nb);
+  prepare_receive(packets, nb);
+  for (auto i = 0ul; i < nb; ++i)
+  {
+    m_iovecs[2 * i].iov_base = packets[i].data();
+    m_iovecs[2 * i].iov_len = packets[i].size();
+    m_iovecs[2 * i + 1].iov_base = spill(i);
+    m_iovecs[2 * i + 1].iov_len = max_datagram_size;
+    m_headers[i].msg_hdr.msg_iov = &m_iovecs[2 * i];
+    m_headers[i].msg_hdr.msg_iovlen = 2;
+    if (sources)
+    {
+      m_headers[i].msg_hdr.msg_name = &sources[i];
+      m_headers[i].msg_hdr.msg_namelen = sizeof(::sockaddr_storage);
+    }
+  }
+
+  ++m_nb_receive_calls;
+  const auto res = ::recvmmsg(m_fd, m_headers.data(), static_cast<unsigned int>(nb), MSG_DONTWAIT
+                             , nullptr);
+  if (res < 0)
+  {
+    // A datagram previously sent was refused by the other side, which is not listening yet.
+    if (errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR or errno == ECONNREFUSED)
+    {
+      return 0;
+    }
+    throw_errno("recvmmsg");
+  }
+
+  auto nb_received = std::size_t{0};
+  for (auto i = 0ul; i < static_cast<std::size_t>(res); ++i)
+  {
+    if (m_headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+    {
+      continue;
+    }
+    const auto len = static_cast<std::size_t>(m_headers[i].msg_len);
+    const auto head = packets[i].size();
+    packets[i].resize(len);
+    if (len > head)
+    {
+      std::memcpy(packets[i].data() + head, spill(i), len - head);
+      ++m_nb_spilled_datagrams;
+    }
+    m_packet_size = std::max(m_packet_size, len);
+    if (nb_received != i)
+    {
+      std::swap(packets[nb_received], packets[i]);
+      if (sources)
+      {
+        sources[nb_received] = sources[i];
+      }
+    }
+    ++nb_received;
+  }
+  return nb_received;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+udp_socket::receive_segments(std::vector<packet>& packets)
+{
+  // Each datagram is scattered on a group of packets, one segment per packet if segments have the
+  // size of the previous batch ones. The last packet of a group takes what remains, then the spill
+  // buffer of the datagram.
+  const auto nb = packets.size();
+  const auto group = std::min(m_group, nb);
+  const auto nb_messages = nb / group;
+  const auto control_size = CMSG_SPACE(sizeof(int));
+  prepare(nb_messages, nb_messages * (group + 1));
+  prepare_receive(packets, nb_messages);
+  m_controls.resize(nb_messages * control_size);
+  for (auto m = 0ul; m < nb_messages; ++m)
+  {
+    const auto iovecs = &m_iovecs[m * (group + 1)];
+    auto& hdr = m_headers[m].msg_hdr;
+    hdr.msg_iov = iovecs;
+    hdr.msg_iovlen = group + 1;
+    hdr.msg_control = &m_controls[m * control_size];
+    hdr.msg_controllen = control_size;
+    for (auto j = 0ul; j < group; ++j)
+    {
+      auto& p = packets[m * group + j];
+      iovecs[j].iov_base = p.data();
+      iovecs[j].iov_len = j + 1 < group ? std::min(m_segment_size, p.size()) : p.size();
+    }
+    iovecs[group].iov_base = spill(m);
+    iovecs[group].iov_len = max_datagram_size;
+  }
+
+  ++m_nb_receive_calls;
+  const auto res = ::recvmmsg( m_fd, m_headers.data(), static_cast<unsigned int>(nb_messages)
+                             , MSG_DONTWAIT, nullptr);
+  if (res < 0)
+  {
+    if (errno == EAGAIN or errno == EWOULDBLOCK or errno == EINTR or errno == ECONNREFUSED)
+    {
+      return 0;
+    }
+    throw_errno("recvmmsg");
+  }
+
+  auto nb_received = std::size_t{0};
+  auto nb_overflow = std::size_t{0};
+  auto largest = std::size_t{1};
+  auto largest_segment_size = m_segment_size;
+  for (auto m = 0ul; m < static_cast<std::size_t>(res); ++m)
+  {
+    auto& hdr = m_headers[m].msg_hdr;
+    if (hdr.msg_flags & MSG_TRUNC)
+    {
+      continue;
+    }
+    const auto first = m * group;
+    const auto iovecs = &m_iovecs[m * (group + 1)];
+    const auto len = static_cast<std::size_t>(m_headers[m].msg_len);
+
+    auto segment_size = len;
+    for (auto c = CMSG_FIRSTHDR(&hdr); c != nullptr; c = CMSG_NXTHDR(&hdr, c))
+    {
+      if (c->cmsg_level == SOL_UDP and c->cmsg_type == UDP_GRO)
+      {
+        auto size = 0;
+        std::memcpy(&size, CMSG_DATA(c), sizeof(size));
+        segment_size = static_cast<std::size_t>(size);
+      }
+    }
+    const auto nb_segments = len == 0 ? 1 : (len + segment_size - 1) / segment_size;
+    m_packet_size = std::max(m_packet_size, segment_size);
+
+    // Once a datagram overflowed its group, the segments of the following ones come after the
+    // overflowing segments, so that the batch stays in the order of the datagrams.
+    const auto after_overflow = nb_overflow != 0;
+    const auto overflow_start = nb_overflow;
+
+    auto capacity = std::size_t{0};
+    for (auto j = 0ul; j < group; ++j)
+    {
+      capacity += iovecs[j].iov_len;
+    }
+    const auto in_place = nb_segments <= group and len <= capacity
+                        and (nb_segments == 1 ? len <= iovecs[0].iov_len
+                                              : segment_size == iovecs[0].iov_len);
+    if (in_place)
+    {
+      for (auto j = 0ul; j < nb_segments; ++j)
+      {
+        packets[first + j].resize(std::min(segment_size, len - j * segment_size));
+      }
+    }
+    else
+    {
+      copy_segments(packets, first, group, iovecs, len, segment_size, nb_overflow);
+    }
+
+    const auto nb_in_group = std::min(nb_segments, group);
+    if (after_overflow)
+    {
+      for (auto j = 0ul; j < nb_in_group; ++j)
+      {
+        if (nb_overflow == m_overflow.size())
+        {
+          m_overflow.emplace_back();
+        }
+        std::swap(m_overflow[nb_overflow++], packets[first + j]);
+      }
+      // The segments in the group come before the ones which didn't fit in it.
+      std::rotate( m_overflow.begin() + static_cast<std::ptrdiff_t>(overflow_start)
+                 , m_overflow.begin() + static_cast<std::ptrdiff_t>(nb_overflow - nb_in_group)
+                 , m_overflow.begin() + static_cast<std::ptrdiff_t>(nb_overflow));
+    }
+    else
+    {
+      // Groups are filled from their beginning, so segments only move towards the front.
+      for (auto j = 0ul; j < nb_in_group; ++j)
+      {
+        if (nb_received != first + j)
+        {
+          std::swap(packets[nb_received], packets[first + j]);
+        }
+        ++nb_received;
+      }
+    }
+
+    if (nb_segments > largest)
+    {
+      largest = nb_segments;
+      largest_segment_size = segment_size;
+    }
+  }
+
+  // Segments which didn't fit in their group come last, followed by the ones of later datagrams.
+  for (auto k = 0ul; k < nb_overflow; ++k, ++nb_received)
+  {
+    if (nb_received < packets.size())
+    {
+      std::swap(packets[nb_received], m_overflow[k]);
+    }
+    else
+    {
+      packets.push_back(std::move(m_overflow[k]));
+    }
+  }
+
+  // Prepare the next batch for datagrams like the largest of this one.
+  if (largest > 1)
+  {
+    m_segment_size = largest_segment_size;
+    m_group = largest;
+  }
+  else if (res > 0)
+  {
+    m_group = 1;
+  }
+  return nb_received;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+udp_socket::copy_segments( std::vector<packet>& packets, std::size_t first, std::size_t group
+                         , const ::iovec* iovecs, std::size_t len, std::size_t segment_size
+                         , std::size_t& nb_overflow)
+{
+  // The datagram was scattered on the packets of its group, then on its spill buffer.
+  m_scratch.resize(len);
+  auto pos = std::size_t{0};
+  for (auto j = 0ul; j <= group and pos < len; ++j)
+  {
+    const auto n = std::min(iovecs[j].iov_len, len - pos);
+    std::memcpy(m_scratch.data() + pos, iovecs[j].iov_base, n);
+    pos += n;
+  }
+
+  const auto nb_segments = len == 0 ? 1 : (len + segment_size - 1) / segment_size;
+  for (auto j = 0ul; j < nb_segments; ++j)
+  {
+    auto* p = &packets[first + j];
+    if (j >= group)
+    {
+      if (nb_overflow == m_overflow.size())
+      {
+        m_overflow.emplace_back();
+      }
+      p = &m_overflow[nb_overflow++];
+    }
+    const auto offset = j * segment_size;
+    const auto size = std::min(segment_size, len - offset);
+    p->resize(size);
+    std::copy_n(m_scratch.data() + offset, size, p->data());
+  }
+  m_nb_copied_segments += nb_segments;
+  return nb_segments;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+udp_socket::send(const packet* packets, std::size_t nb)
+{
+  const auto control_size = CMSG_SPACE(sizeof(std::uint16_t));
+  prepare(nb, nb);
+  m_controls.resize(nb * control_size);
+
+  // A run of packets of the same size, except the last one which might be smaller, is sent as one
+  // datagram which the kernel splits.
+  auto nb_messages = std::size_t{0};
+  for (auto i = 0ul; i < nb; ++nb_messages)
+  {
+    const auto size = packets[i].size();
+    auto run = std::size_t{1};
+    if (m_gso and size != 0 and size <= m_max_segment_size)
+    {
+      auto total = size;
+      while (i + run < nb and run < max_segments)
+      {
+        const auto next = packets[i + run].size();
+        if (next == 0 or next > size or total + next > max_segmented_size)
+        {
+          break;
+        }
+        total += next;
+        ++run;
+        if (next < size)
+        {
+          break;
+        }
+      }
+    }
+
+    for (auto j = i; j < i + run; ++j)
+    {
+      m_iovecs[j].iov_base = const_cast<char*>(packets[j].data());
+      m_iovecs[j].iov_len = packets[j].size();
+    }
+    auto& hdr = m_headers[nb_messages].msg_hdr;
+    hdr.msg_iov = &m_iovecs[i];
+    hdr.msg_iovlen = run;
+    if (run > 1)
+    {
+      hdr.msg_control = &m_controls[nb_messages * control_size];
+      hdr.msg_controllen = control_size;
+      auto c = CMSG_FIRSTHDR(&hdr);
+      c->cmsg_level = SOL_UDP;
+      c->cmsg_type = UDP_SEGMENT;
+      c->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+      const auto segment_size = static_cast<std::uint16_t>(size);
+      std::memcpy(CMSG_DATA(c), &segment_size, sizeof(segment_size));
+    }
+    i += run;
+  }
+
+  auto sent = std::size_t{0};
+  while (sent < nb_messages)
+  {
+    ++m_nb_send_calls;
+    const auto res = ::sendmmsg( m_fd, m_headers.data() + sent
+                               , static_cast<unsigned int>(nb_messages - sent), 0);
+    if (res < 0)
+    {
+      // The error of a previous datagram is reported once, the same batch can be sent again.
+      if (errno == EINTR or errno == ECONNREFUSED)
+      {
+        continue;
+      }
+      // The device can't segment datagrams, send the remaining packets one by one.
+      if (errno == EIO and m_gso)
+      {
+        m_gso = false;
+        const auto first = static_cast<std::size_t>(m_headers[sent].msg_hdr.msg_iov - &m_iovecs[0]);
+        send(packets + first, nb - first);
+        return;
+      }
+      throw_errno("sendmmsg");
+    }
+    sent += static_cast<std::size_t>(res);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+udp_socket::send_to(const packet* packets, const ::sockaddr_storage* destinations, std::size_t nb)
+{
+  prepare(nb, nb);
+  for (auto i = 0ul; i < nb; ++i)
+  {
+    m_iovecs[i].iov_base = const_cast<char*>(packets[i].data());
+    m_iovecs[i].iov_len = packets[i].size();
+    auto& hdr = m_headers[i].msg_hdr;
+    hdr.msg_iov = &m_iovecs[i];
+    hdr.msg_iovlen = 1;
+    hdr.msg_name = const_cast<::sockaddr_storage*>(&destinations[i]);
+    hdr.msg_namelen = destinations[i].ss_family == AF_INET ? sizeof(::sockaddr_in)
+                                                           : sizeof(::sockaddr_in6);
+  }
+
+  auto sent = std::size_t{0};
+  while (sent < nb)
+  {
+    ++m_nb_send_calls;
+    const auto res = ::sendmmsg( m_fd, m_headers.data() + sent, static_cast<unsigned int>(nb - sent)
+                               , 0);
+    if (res < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      // Only the first datagram failed, one peer must not stop the others.
+      if (errno == ENETUNREACH or errno == EHOSTUNREACH or errno == EACCES or errno == EPERM)
+      {
+        ++sent;
+        continue;
+      }
+      throw_errno("sendmmsg");
+    }
+    sent += static_cast<std::size_t>(res);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+udp_socket::prepare(std::size_t nb_messages, std::size_t nb)
+{
+  if (m_headers.size() < nb_messages)
+  {
+    m_headers.resize(nb_messages);
+  }
+  if (m_iovecs.size() < nb)
+  {
+    m_iovecs.resize(nb);
+  }
+  std::memset(m_headers.data(), 0, nb_messages * sizeof(::mmsghdr));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+udp_socket::prepare_receive(std::vector<packet>& packets, std::size_t nb_messages)
+{
+  for (auto& p : packets)
+  {
+    if (p.size() < m_packet_size)
+    {
+      p.resize(m_packet_size);
+    }
+  }
+  if (m_spills.size() < nb_messages * max_datagram_size)
+  {
+    m_spills.resize(nb_messages * max_datagram_size);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+char*
+udp_socket::spill(std::size_t message)
+noexcept
+{
+  return m_spills.data() + message * max_datagram_size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
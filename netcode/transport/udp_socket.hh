@@ -0,0 +1,275 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h> // mmsghdr
+#include <sys/uio.h>    // iovec
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A UDP socket which receives and sends datagrams in batches
+/// @ingroup ntc_transport
+///
+/// A whole batch is received with a single recvmmsg(2) call, and sent with a single sendmmsg(2)
+/// call, which makes the cost of system calls negligible even with small packets.
+///
+/// The kernel can also segment and coalesce datagrams (see set_gso() and set_gro()), so that a run
+/// of packets of the same size crosses the network stack only once.
+/// @note Errors are reported with std::system_error.
+class NTC_PUBLIC udp_socket final
+{
+public:
+
+  /// @brief Can't copy-construct a socket
+  udp_socket(const udp_socket&) = delete;
+
+  /// @brief Can't copy a socket
+  udp_socket& operator=(const udp_socket&) = delete;
+
+  /// @brief Move constructor
+  udp_socket(udp_socket&&) noexcept;
+
+  /// @brief Move assignment operator
+  udp_socket& operator=(udp_socket&&) noexcept;
+
+  /// @brief Open a socket bound to a local address
+  /// @param address An IPv4 or an IPv6 numeric address
+  /// @param port The local port, 0 to let the system choose one
+  /// @param reuse_port Let other sockets bind to the same address and port (see SO_REUSEPORT in
+  /// socket(7)), the kernel then spreads incoming flows over all of them
+  udp_socket(const std::string& address, std::uint16_t port, bool reuse_port = false);
+
+  /// @brief Close the socket
+  ~udp_socket();
+
+  /// @brief Set the only remote address to which datagrams are sent and from which they are
+  /// received
+  /// @param address An numeric address of the same family as the local one
+  /// @param port The remote port
+  void
+  connect(const std::string& address, std::uint16_t port);
+
+  /// @brief Get the local port
+  std::uint16_t
+  local_port()
+  const;
+
+  /// @brief Send runs of packets of the same size as one datagram segmented by the kernel
+  /// @return false if the system doesn't support UDP_SEGMENT, in which case nothing changes
+  ///
+  /// If the device later refuses a segmented datagram, segmentation is turned off.
+  bool
+  set_gso(bool enable);
+
+  /// @brief Tell if runs of packets of the same size are sent as one datagram
+  bool
+  gso()
+  const noexcept
+  {
+    return m_gso;
+  }
+
+  /// @brief Receive datagrams coalesced by the kernel
+  /// @return false if the system doesn't support UDP_GRO, in which case nothing changes
+  bool
+  set_gro(bool enable);
+
+  /// @brief Tell if datagrams coalesced by the kernel are received
+  bool
+  gro()
+  const noexcept
+  {
+    return m_gro;
+  }
+
+  /// @brief Receive a batch of datagrams
+  /// @param packets Where to receive datagrams, each one is filled up to its size
+  /// @param timeout How long to wait for the first datagram
+  /// @return The number of received packets, at the beginning of @p packets
+  ///
+  /// Only the wait of the first datagram blocks, the following ones are the ones already queued by
+  /// the system. Each packet is resized to the size of the datagram it received.
+  ///
+  /// Packets smaller than the largest datagram received so far are first grown to its size, thus
+  /// the caller can move received packets out and give empty ones: each packet then only allocates
+  /// about the size of a datagram. The end of a datagram which doesn't fit in its packet is
+  /// received in a buffer of the socket, then copied (see nb_spilled_datagrams()).
+  ///
+  /// When datagrams are coalesced (see set_gro()), each of their segments is given in its own
+  /// packet. Segments are received directly in consecutive packets when their size is the one of
+  /// the previous batch. Otherwise they are copied, and @p packets might grow.
+  std::size_t
+  receive(std::vector<packet>& packets, std::chrono::milliseconds timeout);
+
+  /// @brief Send a batch of datagrams to the connected address
+  /// @param packets The datagrams to send
+  /// @param nb The number of elements of @p packets
+  void
+  send(const packet* packets, std::size_t nb);
+
+  /// @brief Receive a batch of datagrams from any address
+  /// @param packets Where to receive datagrams, each one is filled up to its size
+  /// @param sources Set to the address from which each datagram was received
+  /// @param timeout How long to wait for the first datagram
+  /// @return The number of received packets, at the beginning of @p packets and @p sources
+  /// @pre The socket is not connected, and doesn't receive coalesced datagrams
+  ///
+  /// Like receive(), the wait of the first datagram only blocks. @p sources is resized to the
+  /// size of @p packets.
+  std::size_t
+  receive_from( std::vector<packet>& packets, std::vector<::sockaddr_storage>& sources
+              , std::chrono::milliseconds timeout);
+
+  /// @brief Send a batch of datagrams, each one to its own address
+  /// @param packets The datagrams to send
+  /// @param destinations The address of each datagram
+  /// @param nb The number of elements of @p packets and of @p destinations
+  /// @pre The socket is not connected
+  ///
+  /// Datagrams are never segmented by the kernel. A datagram whose address can't be reached is
+  /// dropped.
+  void
+  send_to(const packet* packets, const ::sockaddr_storage* destinations, std::size_t nb);
+
+  /// @brief Get the total number of system calls which received datagrams
+  std::size_t
+  nb_receive_calls()
+  const noexcept
+  {
+    return m_nb_receive_calls;
+  }
+
+  /// @brief Get the total number of system calls which sent datagrams
+  std::size_t
+  nb_send_calls()
+  const noexcept
+  {
+    return m_nb_send_calls;
+  }
+
+  /// @brief Get the total number of datagrams too large for their packet, whose end was copied
+  std::size_t
+  nb_spilled_datagrams()
+  const noexcept
+  {
+    return m_nb_spilled_datagrams;
+  }
+
+  /// @brief Get the total number of segments of coalesced datagrams which had to be copied
+  std::size_t
+  nb_copied_segments()
+  const noexcept
+  {
+    return m_nb_copied_segments;
+  }
+
+  /// @brief Get the underlying file descriptor
+  int
+  native_handle()
+  const noexcept
+  {
+    return m_fd;
+  }
+
+private:
+
+  /// @brief Prepare the headers of @p nb_messages datagrams for @p nb packets
+  void
+  prepare(std::size_t nb_messages, std::size_t nb);
+
+  /// @brief Grow packets to the size of the largest datagram, and prepare a spill buffer for each
+  /// of the @p nb_messages datagrams to receive
+  void
+  prepare_receive(std::vector<packet>& packets, std::size_t nb_messages);
+
+  /// @brief Get the spill buffer of a datagram
+  char*
+  spill(std::size_t message)
+  noexcept;
+
+  /// @brief Receive one datagram per packet
+  /// @param sources Where to store the addresses of datagrams, if not null
+  std::size_t
+  receive_datagrams(std::vector<packet>& packets, ::sockaddr_storage* sources);
+
+  /// @brief Receive datagrams which might be coalesced
+  std::size_t
+  receive_segments(std::vector<packet>& packets);
+
+  /// @brief Split a coalesced datagram by copying its segments
+  /// @param iovecs Where the datagram was received, the packets of its group then its spill buffer
+  /// @return The number of segments, the ones which don't fit in the packets of its group are put
+  /// in m_overflow, after the first @p nb_overflow ones
+  std::size_t
+  copy_segments( std::vector<packet>& packets, std::size_t first, std::size_t group
+               , const ::iovec* iovecs, std::size_t len, std::size_t segment_size
+               , std::size_t& nb_overflow);
+
+private:
+
+  /// @brief The file descriptor of the socket
+  int m_fd;
+
+  /// @brief The address family of the socket
+  int m_family;
+
+  /// @brief Re-use the same memory for the headers of a batch
+  std::vector<::mmsghdr> m_headers;
+
+  /// @brief Re-use the same memory for the buffers of a batch
+  std::vector<::iovec> m_iovecs;
+
+  /// @brief Re-use the same memory for the control messages of a batch
+  std::vector<char> m_controls;
+
+  /// @brief Send runs of packets of the same size as one datagram
+  bool m_gso;
+
+  /// @brief The size of the largest segment of a datagram which the kernel can segment
+  std::size_t m_max_segment_size;
+
+  /// @brief Receive coalesced datagrams
+  bool m_gro;
+
+  /// @brief The size of the segments of the last coalesced datagram, 0 until one is received
+  std::size_t m_segment_size;
+
+  /// @brief The number of packets given to each coalesced datagram to receive
+  std::size_t m_group;
+
+  /// @brief The size of the largest datagram, or segment, received so far
+  std::size_t m_packet_size;
+
+  /// @brief Where the end of datagrams too large for their packet is received
+  std::vector<char> m_spills;
+
+  /// @brief The total number of datagrams too large for their packet
+  std::size_t m_nb_spilled_datagrams;
+
+  /// @brief Re-use the same memory to split coalesced datagrams which must be copied
+  std::vector<char> m_scratch;
+
+  /// @brief Segments which don't fit in the packets of their group
+  std::vector<packet> m_overflow;
+
+  /// @brief The total number of segments of coalesced datagrams which had to be copied
+  std::size_t m_nb_copied_segments;
+
+  /// @brief The total number of system calls which received datagrams
+  std::size_t m_nb_receive_calls;
+
+  /// @brief The total number of system calls which sent datagrams
+  std::size_t m_nb_send_calls;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
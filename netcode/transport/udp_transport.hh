@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <utility> // forward, move, swap
+#include <vector>
+
+#include "netcode/detail/packet_type.hh"
+#include "netcode/detail/visibility.hh"
+#include "netcode/transport/send_queue.hh"
+#include "netcode/transport/udp_socket.hh"
+#include "netcode/data.hh"
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/errors.hh"
+#include "netcode/in_order.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An encoder and a decoder which exchange packets with the other side through a UDP socket
+/// @ingroup ntc_transport
+/// @tparam DataHandler The handler of decoded data
+/// @tparam RateController How the rate is computed in adaptive mode (see loss_rate_controller)
+/// @tparam Socket How datagrams are received and sent, a udp_socket or a uring_socket
+///
+/// Incoming datagrams are received by batches (see udp_socket::receive), and given to the encoder
+/// (acks) or to the decoder (sources and repairs). Outgoing packets are queued, then sent by
+/// batches when the queue is full, after each received batch, or with flush().
+///
+/// Segmentation offload is configured on the socket before it's given to the transport (see
+/// udp_socket::set_gso() and udp_socket::set_gro()).
+template < typename DataHandler, typename RateController = loss_rate_controller
+         , typename Socket = udp_socket>
+class NTC_PUBLIC udp_transport final
+{
+public:
+
+  /// @brief The type of the socket
+  using socket_type = Socket;
+
+  /// @brief The type of encoders and decoders packet handler
+  using packet_handler_type = detail::send_queue_handler<Socket>;
+
+  /// @brief The type of the encoder
+  using encoder_type = ntc::encoder<packet_handler_type, RateController>;
+
+  /// @brief The type of the decoder
+  using decoder_type = ntc::decoder<packet_handler_type, DataHandler>;
+
+public:
+
+  /// @brief Can't copy-construct a transport
+  udp_transport(const udp_transport&) = delete;
+
+  /// @brief Can't copy a transport
+  udp_transport& operator=(const udp_transport&) = delete;
+
+  /// @brief Can't move-construct a transport
+  udp_transport(udp_transport&&) = delete;
+
+  /// @brief Can't move a transport
+  udp_transport& operator=(udp_transport&&) = delete;
+
+  /// @brief Constructor
+  /// @param socket The socket, connected to the other side
+  /// @param galois_field_size The size of the Galois field, see encoder::encoder
+  /// @param ordered Tell the decoder if data should be given in order
+  /// @param data_handler The handler of decoded data
+  /// @param batch_size The maximal number of datagrams received or sent by a system call
+  /// @pre @p batch_size > 0
+  template <typename DataHandler_>
+  udp_transport( Socket&& socket, std::uint8_t galois_field_size, in_order ordered
+               , DataHandler_&& data_handler, std::size_t batch_size = 32)
+    : m_socket{std::move(socket)}
+    , m_queue{m_socket, batch_size}
+    , m_encoder{galois_field_size, packet_handler_type{m_queue}}
+    , m_decoder{ galois_field_size, ordered, packet_handler_type{m_queue}
+               , std::forward<DataHandler_>(data_handler)}
+    , m_packets(batch_size)
+    , m_nb_received{0}
+    , m_nb_invalid{0}
+  {
+    assert(batch_size > 0);
+  }
+
+  /// @brief Give the encoder a new data
+  /// @note The resulting packets are queued, see flush()
+  void
+  operator()(const data& d)
+  {
+    m_encoder(d);
+  }
+
+  /// @brief Give the encoder a new data
+  /// @note The resulting packets are queued, see flush()
+  void
+  operator()(data&& d)
+  {
+    m_encoder(std::move(d));
+  }
+
+  /// @brief Receive a batch of datagrams and process them, then send queued packets
+  /// @param timeout How long to wait for the first datagram
+  /// @return The number of received datagrams
+  ///
+  /// Received packets are given as is to the encoder or to the decoder, which might keep them for
+  /// a while. They are replaced by empty packets, which the socket sizes to its datagrams.
+  ///
+  /// Empty, truncated and malformed datagrams are dropped.
+  std::size_t
+  poll(std::chrono::milliseconds timeout)
+  {
+    const auto nb = m_socket.receive(m_packets, timeout);
+    m_nb_received += nb;
+    for (auto i = 0ul; i < nb; ++i)
+    {
+      auto p = packet{};
+      std::swap(p, m_packets[i]);
+      process(std::move(p));
+    }
+    flush();
+    return nb;
+  }
+
+  /// @brief Send queued packets
+  void
+  flush()
+  {
+    m_queue.flush();
+  }
+
+  /// @brief Get the socket
+  const socket_type&
+  socket()
+  const noexcept
+  {
+    return m_socket;
+  }
+
+  /// @brief Get the encoder, to configure it
+  encoder_type&
+  encoder()
+  noexcept
+  {
+    return m_encoder;
+  }
+
+  /// @brief Get the encoder
+  const encoder_type&
+  encoder()
+  const noexcept
+  {
+    return m_encoder;
+  }
+
+  /// @brief Get the decoder, to configure it
+  decoder_type&
+  decoder()
+  noexcept
+  {
+    return m_decoder;
+  }
+
+  /// @brief Get the decoder
+  const decoder_type&
+  decoder()
+  const noexcept
+  {
+    return m_decoder;
+  }
+
+  /// @brief Set the session identifier to put in all packets of the encoder and of the decoder
+  ///
+  /// Both are needed by a udp_gateway on the other side: it drops acks without a session too.
+  /// @see encoder::set_session
+  udp_transport&
+  set_session(std::uint32_t id)
+  noexcept
+  {
+    m_encoder.set_session(id);
+    m_decoder.set_session(id);
+    return *this;
+  }
+
+  /// @brief Get the total number of received datagrams
+  std::size_t
+  nb_received_datagrams()
+  const noexcept
+  {
+    return m_nb_received;
+  }
+
+  /// @brief Get the total number of sent datagrams
+  std::size_t
+  nb_sent_datagrams()
+  const noexcept
+  {
+    return m_queue.nb_sent();
+  }
+
+  /// @brief Get the total number of dropped datagrams
+  std::size_t
+  nb_invalid_datagrams()
+  const noexcept
+  {
+    return m_nb_invalid;
+  }
+
+private:
+
+  /// @brief Give a received datagram to the encoder or to the decoder
+  void
+  process(packet&& p)
+  {
+    if (p.empty())
+    {
+      ++m_nb_invalid;
+      return;
+    }
+    // Anything can come from the network, a malformed datagram must not stop the transport.
+    try
+    {
+      if (detail::get_packet_type(p) == detail::packet_type::ack)
+      {
+        m_encoder(std::move(p));
+      }
+      else
+      {
+        m_decoder(std::move(p));
+      }
+    }
+    catch (const packet_type_error&)
+    {
+      ++m_nb_invalid;
+    }
+    catch (const overflow_error&)
+    {
+      ++m_nb_invalid;
+    }
+  }
+
+private:
+
+  /// @brief The socket connected to the other side
+  socket_type m_socket;
+
+  /// @brief Coalesce the packets of the encoder and of the decoder
+  detail::send_queue<Socket> m_queue;
+
+  /// @brief The encoder of outgoing data
+  encoder_type m_encoder;
+
+  /// @brief The decoder of incoming data
+  decoder_type m_decoder;
+
+  /// @brief The packets of received batches
+  std::vector<packet> m_packets;
+
+  /// @brief The total number of received datagrams
+  std::size_t m_nb_received;
+
+  /// @brief The total number of dropped datagrams
+  std::size_t m_nb_invalid;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
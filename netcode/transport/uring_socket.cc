@@ -0,0 +1,523 @@
+#include <algorithm>    // max, swap
+#include <cassert>
+#include <cerrno>
+#include <cstring>      // memset
+#include <system_error>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>     // close, syscall
+
+#include "netcode/transport/uring_socket.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief The number of entries of the submission queue
+constexpr auto nb_entries = 256u;
+
+/// @brief The identifier of the provided buffers group
+constexpr auto buffer_group = std::uint16_t{0};
+
+/// @brief Tag of the completions of the receive request
+constexpr auto receive_tag = std::uint64_t{1};
+
+/// @brief Tag of the completions of sent packets
+constexpr auto send_tag = std::uint64_t{2};
+
+/// @brief Report the last error of a system call
+[[noreturn]]
+void
+throw_errno(const char* what)
+{
+  throw std::system_error{errno, std::system_category(), what};
+}
+
+/// @brief Map memory shared with the kernel
+void*
+map(int fd, std::size_t size, off_t offset)
+{
+  const auto res = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd
+                         , offset);
+  if (res == MAP_FAILED)
+  {
+    throw_errno("mmap");
+  }
+  return res;
+}
+
+/// @brief Get a pointer at an offset of a ring
+template <typename T>
+T*
+at(void* ring, std::uint32_t offset)
+noexcept
+{
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+uring_socket::uring_socket(uring_socket&& other)
+noexcept
+  : m_socket{std::move(other.m_socket)}
+  , m_fd{other.m_fd}
+  , m_nb_entries{other.m_nb_entries}
+  , m_sq_ring{other.m_sq_ring}
+  , m_sq_ring_size{other.m_sq_ring_size}
+  , m_cq_ring{other.m_cq_ring}
+  , m_cq_ring_size{other.m_cq_ring_size}
+  , m_sqes{other.m_sqes}
+  , m_sqes_size{other.m_sqes_size}
+  , m_sq_head{other.m_sq_head}
+  , m_sq_tail{other.m_sq_tail}
+  , m_sq_mask{other.m_sq_mask}
+  , m_sq_array{other.m_sq_array}
+  , m_cq_head{other.m_cq_head}
+  , m_cq_tail{other.m_cq_tail}
+  , m_cq_mask{other.m_cq_mask}
+  , m_cqes{other.m_cqes}
+  , m_nb_queued{other.m_nb_queued}
+  , m_buffer_ring{other.m_buffer_ring}
+  , m_buffer_ring_size{other.m_buffer_ring_size}
+  , m_buffer_tail{other.m_buffer_tail}
+  , m_pool{std::move(other.m_pool)}
+  , m_buffer_size{other.m_buffer_size}
+  , m_pending{std::move(other.m_pending)}
+  , m_rearm{other.m_rearm}
+  , m_nb_sending{other.m_nb_sending}
+  , m_nb_receive_calls{other.m_nb_receive_calls}
+  , m_nb_send_calls{other.m_nb_send_calls}
+{
+  // The packets of the pool keep their memory, which the kernel still refers to.
+  other.m_fd = -1;
+  other.m_sq_ring = nullptr;
+  other.m_cq_ring = nullptr;
+  other.m_sqes = nullptr;
+  other.m_buffer_ring = nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+uring_socket::uring_socket(udp_socket&& socket, std::size_t nb_buffers, std::size_t buffer_size)
+  : m_socket{std::move(socket)}
+  , m_fd{-1}
+  , m_nb_entries{0}
+  , m_sq_ring{nullptr}
+  , m_sq_ring_size{0}
+  , m_cq_ring{nullptr}
+  , m_cq_ring_size{0}
+  , m_sqes{nullptr}
+  , m_sqes_size{0}
+  , m_sq_head{nullptr}
+  , m_sq_tail{nullptr}
+  , m_sq_mask{0}
+  , m_sq_array{nullptr}
+  , m_cq_head{nullptr}
+  , m_cq_tail{nullptr}
+  , m_cq_mask{0}
+  , m_cqes{nullptr}
+  , m_nb_queued{0}
+  , m_buffer_ring{nullptr}
+  , m_buffer_ring_size{0}
+  , m_buffer_tail{0}
+  , m_pool{}
+  , m_buffer_size{buffer_size}
+  , m_pending{}
+  , m_rearm{false}
+  , m_nb_sending{0}
+  , m_nb_receive_calls{0}
+  , m_nb_send_calls{0}
+{
+  assert(nb_buffers > 0 and nb_buffers < 32768 and (nb_buffers & (nb_buffers - 1)) == 0);
+
+  ::io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, nb_entries, &params));
+  if (m_fd < 0)
+  {
+    throw_errno("io_uring_setup");
+  }
+  try
+  {
+    map_rings(params);
+    register_pool(nb_buffers);
+    arm_receive();
+    enter(0, m_nb_receive_calls);
+  }
+  catch (...)
+  {
+    close();
+    throw;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+uring_socket::~uring_socket()
+{
+  close();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+uring_socket::receive(std::vector<packet>& packets, std::chrono::milliseconds timeout)
+{
+  if (packets.empty())
+  {
+    return 0;
+  }
+
+  auto nb = std::size_t{0};
+  auto error = 0;
+  while (nb < packets.size() and not m_pending.empty())
+  {
+    if (received(m_pending.front(), packets, nb, error))
+    {
+      ++nb;
+    }
+    m_pending.pop_front();
+  }
+  if (error != 0)
+  {
+    throw std::system_error{error, std::system_category(), "recv"};
+  }
+  reap(&packets, nb);
+
+  if (nb == 0)
+  {
+    if (m_rearm)
+    {
+      publish_buffers();
+      arm_receive();
+    }
+    enter(0, m_nb_receive_calls);
+
+    // The ring becomes readable when a completion is available.
+    ::pollfd pfd{m_fd, POLLIN, 0};
+    ++m_nb_receive_calls;
+    const auto ready = ::poll(&pfd, 1, static_cast<int>(timeout.count()));
+    if (ready < 0 and errno != EINTR)
+    {
+      throw_errno("poll");
+    }
+    if (ready > 0)
+    {
+      reap(&packets, nb);
+    }
+  }
+
+  // Give back the exchanged packets and restart receiving if the kernel stopped.
+  publish_buffers();
+  if (m_rearm)
+  {
+    arm_receive();
+    enter(0, m_nb_receive_calls);
+  }
+  return nb;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::send(const packet* packets, std::size_t nb)
+{
+  for (auto i = 0ul; i < nb; ++i)
+  {
+    auto& sqe = next_request();
+    sqe.opcode = IORING_OP_SEND;
+    sqe.fd = m_socket.native_handle();
+    sqe.addr = reinterpret_cast<std::uint64_t>(packets[i].data());
+    sqe.len = static_cast<std::uint32_t>(packets[i].size());
+    sqe.user_data = send_tag;
+    queue();
+    ++m_nb_sending;
+  }
+
+  // Packets are re-used by the caller as soon as this function returns, thus their completions
+  // can't be left to the next call. The kernel copies a datagram when its send is submitted, and
+  // posts its completion right away: a single call submits the batch and gets its completions. It
+  // only waits when the socket's buffer is full, in which case the kernel retries the send later
+  // and reads the packet then.
+  auto none = std::size_t{0};
+  while (m_nb_sending > 0)
+  {
+    enter(static_cast<unsigned int>(m_nb_sending), m_nb_send_calls);
+    reap(nullptr, none);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::map_rings(const ::io_uring_params& params)
+{
+  m_nb_entries = params.sq_entries;
+  m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    m_sq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+    m_cq_ring_size = m_sq_ring_size;
+  }
+
+  m_sq_ring = map(m_fd, m_sq_ring_size, IORING_OFF_SQ_RING);
+  m_cq_ring = params.features & IORING_FEAT_SINGLE_MMAP
+            ? m_sq_ring
+            : map(m_fd, m_cq_ring_size, IORING_OFF_CQ_RING);
+  m_sqes_size = params.sq_entries * sizeof(::io_uring_sqe);
+  m_sqes = map(m_fd, m_sqes_size, static_cast<off_t>(IORING_OFF_SQES));
+
+  m_sq_head = at<unsigned int>(m_sq_ring, params.sq_off.head);
+  m_sq_tail = at<unsigned int>(m_sq_ring, params.sq_off.tail);
+  m_sq_mask = *at<unsigned int>(m_sq_ring, params.sq_off.ring_mask);
+  m_sq_array = at<unsigned int>(m_sq_ring, params.sq_off.array);
+  m_cq_head = at<unsigned int>(m_cq_ring, params.cq_off.head);
+  m_cq_tail = at<unsigned int>(m_cq_ring, params.cq_off.tail);
+  m_cq_mask = *at<unsigned int>(m_cq_ring, params.cq_off.ring_mask);
+  m_cqes = at<void>(m_cq_ring, params.cq_off.cqes);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::register_pool(std::size_t nb_buffers)
+{
+  m_buffer_ring_size = nb_buffers * sizeof(::io_uring_buf);
+  m_buffer_ring = ::mmap( nullptr, m_buffer_ring_size, PROT_READ | PROT_WRITE
+                        , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (m_buffer_ring == MAP_FAILED)
+  {
+    m_buffer_ring = nullptr;
+    throw_errno("mmap");
+  }
+
+  ::io_uring_buf_reg reg;
+  std::memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<std::uint64_t>(m_buffer_ring);
+  reg.ring_entries = static_cast<std::uint32_t>(nb_buffers);
+  reg.bgid = buffer_group;
+  if (::syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+  {
+    throw_errno("io_uring_register");
+  }
+
+  m_pool.reserve(nb_buffers);
+  for (auto i = 0ul; i < nb_buffers; ++i)
+  {
+    m_pool.emplace_back(m_buffer_size);
+    provide(static_cast<std::uint16_t>(i));
+  }
+  publish_buffers();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::close()
+noexcept
+{
+  if (m_sqes)
+  {
+    ::munmap(m_sqes, m_sqes_size);
+  }
+  if (m_cq_ring and m_cq_ring != m_sq_ring)
+  {
+    ::munmap(m_cq_ring, m_cq_ring_size);
+  }
+  if (m_sq_ring)
+  {
+    ::munmap(m_sq_ring, m_sq_ring_size);
+  }
+  // Closing the instance stops all requests, the kernel no longer uses the buffers.
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+  }
+  if (m_buffer_ring)
+  {
+    ::munmap(m_buffer_ring, m_buffer_ring_size);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::provide(std::uint16_t id)
+noexcept
+{
+  // In C++, the flexible array of io_uring_buf_ring is shifted by an empty struct, thus the ring
+  // is accessed as an array of buffers.
+  const auto mask = m_buffer_ring_size / sizeof(::io_uring_buf) - 1;
+  auto& buf = static_cast<::io_uring_buf*>(m_buffer_ring)[m_buffer_tail & mask];
+  buf.addr = reinterpret_cast<std::uint64_t>(m_pool[id].data());
+  buf.len = static_cast<std::uint32_t>(m_buffer_size);
+  buf.bid = id;
+  ++m_buffer_tail;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::publish_buffers()
+noexcept
+{
+  // The tail overlays the reserved field of the first buffer.
+  auto& first = *static_cast<::io_uring_buf*>(m_buffer_ring);
+  __atomic_store_n(&first.resv, m_buffer_tail, __ATOMIC_RELEASE);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+::io_uring_sqe&
+uring_socket::next_request()
+{
+  // Submit what is queued to make room.
+  if (*m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) == m_nb_entries)
+  {
+    enter(0, m_nb_send_calls);
+  }
+  const auto index = *m_sq_tail & m_sq_mask;
+  auto& sqe = static_cast<::io_uring_sqe*>(m_sqes)[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  m_sq_array[index] = index;
+  return sqe;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::queue()
+noexcept
+{
+  __atomic_store_n(m_sq_tail, *m_sq_tail + 1, __ATOMIC_RELEASE);
+  ++m_nb_queued;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::arm_receive()
+{
+  auto& sqe = next_request();
+  sqe.opcode = IORING_OP_RECV;
+  sqe.fd = m_socket.native_handle();
+  sqe.ioprio = IORING_RECV_MULTISHOT;
+  sqe.flags = IOSQE_BUFFER_SELECT;
+  sqe.buf_group = buffer_group;
+  sqe.user_data = receive_tag;
+  queue();
+  m_rearm = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::enter(unsigned int min_complete, std::size_t& nb_calls)
+{
+  if (m_nb_queued == 0 and min_complete == 0)
+  {
+    return;
+  }
+  ++nb_calls;
+  const auto flags = min_complete != 0 ? IORING_ENTER_GETEVENTS : 0u;
+  const auto res = ::syscall( __NR_io_uring_enter, m_fd, m_nb_queued, min_complete, flags
+                            , nullptr, 0);
+  if (res < 0)
+  {
+    if (errno == EINTR or errno == EAGAIN or errno == EBUSY)
+    {
+      return;
+    }
+    throw_errno("io_uring_enter");
+  }
+  m_nb_queued -= static_cast<unsigned int>(res);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+uring_socket::received( const completion& c, std::vector<packet>& packets, std::size_t nb
+                      , int& error)
+{
+  if (not (c.flags & IORING_CQE_F_MORE))
+  {
+    m_rearm = true;
+  }
+  if (c.res < 0)
+  {
+    // All buffers are in use, or a datagram sent earlier was refused by the other side.
+    if (c.res == -ENOBUFS or c.res == -ECONNREFUSED or c.res == -EINTR)
+    {
+      return false;
+    }
+    error = -c.res;
+    return false;
+  }
+  if (not (c.flags & IORING_CQE_F_BUFFER))
+  {
+    return false;
+  }
+
+  // The packet the kernel wrote in leaves the pool, the caller's one takes its place.
+  const auto id = static_cast<std::uint16_t>(c.flags >> IORING_CQE_BUFFER_SHIFT);
+  std::swap(m_pool[id], packets[nb]);
+  packets[nb].resize(static_cast<std::size_t>(c.res));
+  m_pool[id].resize(m_buffer_size);
+  provide(id);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+uring_socket::reap(std::vector<packet>* packets, std::size_t& nb)
+{
+  auto head = *m_cq_head;
+  const auto tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+  auto error = 0;
+  for (; head != tail; ++head)
+  {
+    if (packets and nb == packets->size())
+    {
+      break;
+    }
+    const auto& cqe = static_cast<const ::io_uring_cqe*>(m_cqes)[head & m_cq_mask];
+    const auto c = completion{cqe.res, cqe.flags};
+    if (cqe.user_data == receive_tag)
+    {
+      if (not packets)
+      {
+        m_pending.push_back(c);
+      }
+      else if (received(c, *packets, nb, error))
+      {
+        ++nb;
+      }
+    }
+    else
+    {
+      --m_nb_sending;
+      if (c.res < 0 and c.res != -ECONNREFUSED)
+      {
+        error = -c.res;
+      }
+    }
+  }
+  __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+  if (error != 0)
+  {
+    throw std::system_error{error, std::system_category(), "io_uring"};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/transport/udp_socket.hh"
+#include "netcode/packet.hh"
+
+struct io_uring_params;
+struct io_uring_sqe;
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A UDP socket whose datagrams are received and sent through an io_uring(7) instance
+/// @ingroup ntc_transport
+///
+/// Datagrams are received by a single multishot receive request in a pool of packets which are
+/// registered with the kernel as a ring of provided buffers. A received packet is exchanged with
+/// one given by the caller, which takes its place in the pool. Thus the kernel writes datagrams
+/// directly where they are decoded, and receiving a batch requires no system call when datagrams
+/// are already waiting. Sent packets are submitted all at once.
+///
+/// It can replace udp_socket in udp_transport.
+/// @note Segmentation offload of the underlying socket is not used.
+/// @note Errors are reported with std::system_error.
+class NTC_PUBLIC uring_socket final
+{
+public:
+
+  /// @brief Can't copy-construct an io_uring socket
+  uring_socket(const uring_socket&) = delete;
+
+  /// @brief Can't copy an io_uring socket
+  uring_socket& operator=(const uring_socket&) = delete;
+
+  /// @brief Move constructor
+  uring_socket(uring_socket&&) noexcept;
+
+  /// @brief Can't move an io_uring socket
+  uring_socket& operator=(uring_socket&&) = delete;
+
+  /// @brief Constructor
+  /// @param socket The socket, connected to the other side
+  /// @param nb_buffers The number of packets in which datagrams are received, a power of two
+  /// @param buffer_size The size of the largest datagram to receive
+  /// @pre @p nb_buffers is a power of two smaller than 32768
+  /// @throw std::system_error if the system doesn't support io_uring, or if it lacks a feature
+  explicit uring_socket( udp_socket&& socket, std::size_t nb_buffers = 64
+                       , std::size_t buffer_size = 65535);
+
+  /// @brief Destructor
+  ~uring_socket();
+
+  /// @brief Receive a batch of datagrams
+  /// @param packets The packets which replace the received ones in the pool
+  /// @param timeout How long to wait for the first datagram
+  /// @return The number of received packets, at the beginning of @p packets
+  ///
+  /// Datagrams larger than the size of buffers are truncated.
+  std::size_t
+  receive(std::vector<packet>& packets, std::chrono::milliseconds timeout);
+
+  /// @brief Send a batch of datagrams to the connected address
+  /// @param packets The datagrams to send
+  /// @param nb The number of elements of @p packets
+  ///
+  /// The packets can be re-used as soon as this function returns: it waits for the completions of
+  /// their sends, which usually come with their submission, thus in the same system call.
+  void
+  send(const packet* packets, std::size_t nb);
+
+  /// @brief Get the underlying socket
+  const udp_socket&
+  socket()
+  const noexcept
+  {
+    return m_socket;
+  }
+
+  /// @brief Get the total number of system calls made to receive datagrams
+  std::size_t
+  nb_receive_calls()
+  const noexcept
+  {
+    return m_nb_receive_calls;
+  }
+
+  /// @brief Get the total number of system calls made to send datagrams
+  std::size_t
+  nb_send_calls()
+  const noexcept
+  {
+    return m_nb_send_calls;
+  }
+
+private:
+
+  /// @brief A completion of the receive request, kept while sent packets are waited for
+  struct completion
+  {
+    std::int32_t res;
+    std::uint32_t flags;
+  };
+
+  /// @brief Map the rings shared with the kernel
+  void
+  map_rings(const ::io_uring_params& params);
+
+  /// @brief Register the pool of packets as a ring of provided buffers
+  void
+  register_pool(std::size_t nb_buffers);
+
+  /// @brief Release everything given by the kernel
+  void
+  close()
+  noexcept;
+
+  /// @brief Give a packet of the pool to the kernel
+  void
+  provide(std::uint16_t id)
+  noexcept;
+
+  /// @brief Make the provided packets visible to the kernel
+  void
+  publish_buffers()
+  noexcept;
+
+  /// @brief Get a cleared submission queue entry
+  ::io_uring_sqe&
+  next_request();
+
+  /// @brief Make the entry given by next_request() visible to the kernel
+  void
+  queue()
+  noexcept;
+
+  /// @brief Queue a new multishot receive request
+  void
+  arm_receive();
+
+  /// @brief Submit queued requests, and wait for @p min_complete completions
+  void
+  enter(unsigned int min_complete, std::size_t& nb_calls);
+
+  /// @brief Handle a completion of the receive request
+  /// @param error Set to the error carried by the completion, if it can't be ignored
+  /// @return true if @p packets[nb] received a datagram
+  bool
+  received(const completion& c, std::vector<packet>& packets, std::size_t nb, int& error);
+
+  /// @brief Handle all available completions
+  /// @param packets Where to put received packets, none are taken if null
+  /// @param nb The number of received packets
+  void
+  reap(std::vector<packet>* packets, std::size_t& nb);
+
+private:
+
+  /// @brief The socket connected to the other side
+  udp_socket m_socket;
+
+  /// @brief The file descriptor of the io_uring instance
+  int m_fd;
+
+  /// @brief The number of submission queue entries
+  unsigned int m_nb_entries;
+
+  /// @brief The memory of the submission ring
+  void* m_sq_ring;
+
+  /// @brief The size of the memory of the submission ring
+  std::size_t m_sq_ring_size;
+
+  /// @brief The memory of the completion ring, might be the one of the submission ring
+  void* m_cq_ring;
+
+  /// @brief The size of the memory of the completion ring
+  std::size_t m_cq_ring_size;
+
+  /// @brief The submission queue entries
+  void* m_sqes;
+
+  /// @brief The size of the memory of the submission queue entries
+  std::size_t m_sqes_size;
+
+  /// @brief The submission queue head, written by the kernel
+  unsigned int* m_sq_head;
+
+  /// @brief The submission queue tail
+  unsigned int* m_sq_tail;
+
+  /// @brief The mask of submission queue indexes
+  unsigned int m_sq_mask;
+
+  /// @brief The indirection array of the submission queue
+  unsigned int* m_sq_array;
+
+  /// @brief The completion queue head
+  unsigned int* m_cq_head;
+
+  /// @brief The completion queue tail, written by the kernel
+  unsigned int* m_cq_tail;
+
+  /// @brief The mask of completion queue indexes
+  unsigned int m_cq_mask;
+
+  /// @brief The completion queue entries
+  void* m_cqes;
+
+  /// @brief The number of requests queued and not submitted yet
+  unsigned int m_nb_queued;
+
+  /// @brief The ring of provided buffers
+  void* m_buffer_ring;
+
+  /// @brief The size of the memory of the ring of provided buffers
+  std::size_t m_buffer_ring_size;
+
+  /// @brief The tail of the ring of provided buffers, published in batches
+  std::uint16_t m_buffer_tail;
+
+  /// @brief The packets in which datagrams are received
+  std::vector<packet> m_pool;
+
+  /// @brief The size of the largest datagram to receive
+  std::size_t m_buffer_size;
+
+  /// @brief Completions of the receive request met while waiting for sent packets
+  std::deque<completion> m_pending;
+
+  /// @brief Tell if the receive request must be queued again
+  bool m_rearm;
+
+  /// @brief The number of sent packets whose completion is still expected
+  std::size_t m_nb_sending;
+
+  /// @brief The total number of system calls made to receive datagrams
+  std::size_t m_nb_receive_calls;
+
+  /// @brief The total number of system calls made to send datagrams
+  std::size_t m_nb_send_calls;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
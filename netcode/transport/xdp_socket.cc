@@ -0,0 +1,652 @@
+#include <algorithm>    // copy, min
+#include <cassert>
+#include <cerrno>
+#include <cstring>      // memcpy, memset, strncpy
+#include <system_error>
+
+#include <arpa/inet.h>  // htons, inet_pton
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <net/if.h>     // if_nametoindex, ifreq
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>     // close, syscall
+
+#include "netcode/transport/xdp_socket.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief The size of a frame of the UMEM
+constexpr auto frame_size = std::size_t{2048};
+
+/// @brief The size of the Ethernet, IPv4 and UDP headers of a sent frame
+constexpr auto headers_size = std::size_t{14 + 20 + 8};
+
+/// @brief Report the last error of a system call
+[[noreturn]]
+void
+throw_errno(const char* what)
+{
+  throw std::system_error{errno, std::system_category(), what};
+}
+
+/// @brief Map memory shared with the kernel
+void*
+map(int fd, std::size_t size, off_t offset)
+{
+  const auto res = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd
+                         , offset);
+  if (res == MAP_FAILED)
+  {
+    throw_errno("mmap");
+  }
+  return res;
+}
+
+/// @brief Call bpf(2)
+int
+bpf(int cmd, ::bpf_attr& attr)
+noexcept
+{
+  return static_cast<int>(::syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+}
+
+/// @brief Build an instruction of an eBPF program
+::bpf_insn
+insn(std::uint8_t code, std::uint8_t dst, std::uint8_t src, std::int16_t off, std::int32_t imm)
+noexcept
+{
+  ::bpf_insn res;
+  res.code = code;
+  res.dst_reg = dst & 0x0f;
+  res.src_reg = src & 0x0f;
+  res.off = off;
+  res.imm = imm;
+  return res;
+}
+
+/// @brief Read a 16 bits integer in network byte order
+std::uint16_t
+get16(const char* p)
+noexcept
+{
+  const auto u = reinterpret_cast<const unsigned char*>(p);
+  return static_cast<std::uint16_t>((u[0] << 8) | u[1]);
+}
+
+/// @brief Write a 16 bits integer in network byte order
+void
+put16(char* p, std::size_t value)
+noexcept
+{
+  p[0] = static_cast<char>((value >> 8) & 0xff);
+  p[1] = static_cast<char>(value & 0xff);
+}
+
+/// @brief Compute the checksum of an IPv4 header
+std::uint16_t
+ip_checksum(const char* header)
+noexcept
+{
+  auto sum = std::uint32_t{0};
+  for (auto i = 0u; i < 20; i += 2)
+  {
+    sum += get16(header + i);
+  }
+  while (sum >> 16)
+  {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return static_cast<std::uint16_t>(~sum & 0xffff);
+}
+
+/// @brief Get a 32 bits counter of a ring shared with the kernel
+std::uint32_t
+load(const std::uint32_t* counter)
+noexcept
+{
+  return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+}
+
+/// @brief Set a 32 bits counter of a ring shared with the kernel
+void
+store(std::uint32_t* counter, std::uint32_t value)
+noexcept
+{
+  __atomic_store_n(counter, value, __ATOMIC_RELEASE);
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+xdp_socket::xdp_socket(xdp_socket&& other)
+noexcept
+  : m_fd{other.m_fd}
+  , m_ifindex{other.m_ifindex}
+  , m_map_fd{other.m_map_fd}
+  , m_program_fd{other.m_program_fd}
+  , m_link_fd{other.m_link_fd}
+  , m_umem{other.m_umem}
+  , m_nb_frames{other.m_nb_frames}
+  , m_fill(other.m_fill)
+  , m_completion(other.m_completion)
+  , m_rx(other.m_rx)
+  , m_tx(other.m_tx)
+  , m_free_frames{std::move(other.m_free_frames)}
+  , m_headers(other.m_headers)
+  , m_max_payload_size{other.m_max_payload_size}
+  , m_port{other.m_port}
+  , m_ip_id{other.m_ip_id}
+  , m_zero_copy{other.m_zero_copy}
+  , m_native{other.m_native}
+  , m_nb_receive_calls{other.m_nb_receive_calls}
+  , m_nb_send_calls{other.m_nb_send_calls}
+  , m_nb_dropped{other.m_nb_dropped}
+{
+  other.m_fd = -1;
+  other.m_map_fd = -1;
+  other.m_program_fd = -1;
+  other.m_link_fd = -1;
+  other.m_umem = nullptr;
+  other.m_fill.memory = nullptr;
+  other.m_completion.memory = nullptr;
+  other.m_rx.memory = nullptr;
+  other.m_tx.memory = nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+xdp_socket::xdp_socket( const std::string& interface, const xdp_endpoint& local
+                      , const xdp_endpoint& remote, std::size_t nb_frames, std::uint32_t queue)
+  : m_fd{-1}
+  , m_ifindex{::if_nametoindex(interface.c_str())}
+  , m_map_fd{-1}
+  , m_program_fd{-1}
+  , m_link_fd{-1}
+  , m_umem{nullptr}
+  , m_nb_frames{nb_frames}
+  , m_fill()
+  , m_completion()
+  , m_rx()
+  , m_tx()
+  , m_free_frames{}
+  , m_headers()
+  , m_max_payload_size{frame_size - headers_size}
+  , m_port{htons(local.port)}
+  , m_ip_id{0}
+  , m_zero_copy{false}
+  , m_native{false}
+  , m_nb_receive_calls{0}
+  , m_nb_send_calls{0}
+  , m_nb_dropped{0}
+{
+  assert(nb_frames >= 4 and (nb_frames & (nb_frames - 1)) == 0);
+  assert(local.port != 0);
+
+  if (m_ifindex == 0)
+  {
+    throw_errno("if_nametoindex");
+  }
+
+  // The headers of sent frames, lengths and checksum are set for each frame.
+  auto h = m_headers.data();
+  std::copy(remote.mac.begin(), remote.mac.end(), h);
+  std::copy(local.mac.begin(), local.mac.end(), h + 6);
+  put16(h + 12, 0x0800);
+  h[14] = 0x45;
+  put16(h + 20, 0x4000); // Don't fragment
+  h[22] = 64;
+  h[23] = IPPROTO_UDP;
+  if (::inet_pton(AF_INET, local.address.c_str(), h + 26) != 1)
+  {
+    throw std::system_error{EINVAL, std::system_category(), "inet_pton"};
+  }
+  if (::inet_pton(AF_INET, remote.address.c_str(), h + 30) != 1)
+  {
+    throw std::system_error{EINVAL, std::system_category(), "inet_pton"};
+  }
+  put16(h + 34, local.port);
+  put16(h + 36, remote.port);
+
+  // Datagrams must fit in a frame and in the MTU of the interface.
+  {
+    const auto fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+      throw_errno("socket");
+    }
+    ::ifreq request;
+    std::memset(&request, 0, sizeof(request));
+    std::strncpy(request.ifr_name, interface.c_str(), IFNAMSIZ - 1);
+    const auto res = ::ioctl(fd, SIOCGIFMTU, &request);
+    ::close(fd);
+    if (res < 0)
+    {
+      throw_errno("ioctl");
+    }
+    if (request.ifr_mtu > 28)
+    {
+      m_max_payload_size = std::min( m_max_payload_size
+                                   , static_cast<std::size_t>(request.ifr_mtu - 28));
+    }
+  }
+
+  m_fd = ::socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+  if (m_fd < 0)
+  {
+    throw_errno("socket");
+  }
+  try
+  {
+    const auto umem = ::mmap( nullptr, nb_frames * frame_size, PROT_READ | PROT_WRITE
+                            , MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (umem == MAP_FAILED)
+    {
+      throw_errno("mmap");
+    }
+    m_umem = static_cast<char*>(umem);
+
+    ::xdp_umem_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.addr = reinterpret_cast<std::uint64_t>(m_umem);
+    reg.len = nb_frames * frame_size;
+    reg.chunk_size = static_cast<std::uint32_t>(frame_size);
+    if (::setsockopt(m_fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0)
+    {
+      throw_errno("setsockopt");
+    }
+
+    // Half of the frames receive, the other half send, each ring can hold all of them.
+    const auto half = static_cast<int>(nb_frames / 2);
+    for (const auto option : {XDP_UMEM_FILL_RING, XDP_UMEM_COMPLETION_RING, XDP_RX_RING
+                             , XDP_TX_RING})
+    {
+      if (::setsockopt(m_fd, SOL_XDP, option, &half, sizeof(half)) < 0)
+      {
+        throw_errno("setsockopt");
+      }
+    }
+    map_rings();
+
+    const auto fill = static_cast<std::uint64_t*>(m_fill.descriptors);
+    for (auto i = 0ul; i < nb_frames / 2; ++i)
+    {
+      fill[i] = i * frame_size;
+    }
+    store(m_fill.producer, static_cast<std::uint32_t>(nb_frames / 2));
+    m_free_frames.reserve(nb_frames / 2);
+    for (auto i = nb_frames / 2; i < nb_frames; ++i)
+    {
+      m_free_frames.push_back(i * frame_size);
+    }
+
+    // Zero-copy needs the support of the driver, fall back to copies.
+    ::sockaddr_xdp address;
+    std::memset(&address, 0, sizeof(address));
+    address.sxdp_family = AF_XDP;
+    address.sxdp_ifindex = m_ifindex;
+    address.sxdp_queue_id = queue;
+    address.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+    m_zero_copy = true;
+    if (::bind(m_fd, reinterpret_cast<::sockaddr*>(&address), sizeof(address)) < 0)
+    {
+      address.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+      m_zero_copy = false;
+      if (::bind(m_fd, reinterpret_cast<::sockaddr*>(&address), sizeof(address)) < 0)
+      {
+        throw_errno("bind");
+      }
+    }
+
+    attach(queue);
+  }
+  catch (...)
+  {
+    close();
+    throw;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+xdp_socket::~xdp_socket()
+{
+  close();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+xdp_socket::map_rings()
+{
+  ::xdp_mmap_offsets offsets;
+  auto len = static_cast<::socklen_t>(sizeof(offsets));
+  if (::getsockopt(m_fd, SOL_XDP, XDP_MMAP_OFFSETS, &offsets, &len) < 0)
+  {
+    throw_errno("getsockopt");
+  }
+
+  const auto nb = static_cast<std::uint32_t>(m_nb_frames / 2);
+  const auto map_ring = [&](ring& r, const ::xdp_ring_offset& o, std::size_t size, off_t offset)
+  {
+    r.size = o.desc + nb * size;
+    r.memory = map(m_fd, r.size, offset);
+    const auto base = static_cast<char*>(r.memory);
+    r.producer = reinterpret_cast<std::uint32_t*>(base + o.producer);
+    r.consumer = reinterpret_cast<std::uint32_t*>(base + o.consumer);
+    r.flags = reinterpret_cast<std::uint32_t*>(base + o.flags);
+    r.descriptors = base + o.desc;
+    r.mask = nb - 1;
+  };
+  map_ring(m_fill, offsets.fr, sizeof(std::uint64_t), static_cast<off_t>(XDP_UMEM_PGOFF_FILL_RING));
+  map_ring( m_completion, offsets.cr, sizeof(std::uint64_t)
+          , static_cast<off_t>(XDP_UMEM_PGOFF_COMPLETION_RING));
+  map_ring(m_rx, offsets.rx, sizeof(::xdp_desc), XDP_PGOFF_RX_RING);
+  map_ring(m_tx, offsets.tx, sizeof(::xdp_desc), XDP_PGOFF_TX_RING);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+xdp_socket::attach(std::uint32_t queue)
+{
+  ::bpf_attr attr;
+
+  // The map from the queues of the interface to the socket.
+  std::memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_XSKMAP;
+  attr.key_size = sizeof(std::uint32_t);
+  attr.value_size = sizeof(std::uint32_t);
+  attr.max_entries = queue + 1;
+  m_map_fd = bpf(BPF_MAP_CREATE, attr);
+  if (m_map_fd < 0)
+  {
+    throw_errno("bpf");
+  }
+  std::memset(&attr, 0, sizeof(attr));
+  attr.map_fd = static_cast<std::uint32_t>(m_map_fd);
+  attr.key = reinterpret_cast<std::uint64_t>(&queue);
+  attr.value = reinterpret_cast<std::uint64_t>(&m_fd);
+  if (bpf(BPF_MAP_UPDATE_ELEM, attr) < 0)
+  {
+    throw_errno("bpf");
+  }
+
+  // Redirect IPv4 frames without options which carry UDP datagrams to the local port, the network
+  // stack gets the other ones (and all of them if the socket goes away).
+  const auto pass = std::int16_t{20};
+  const ::bpf_insn program[] =
+    { insn(BPF_ALU64 | BPF_MOV | BPF_X, 6, 1, 0, 0)                     // r6 = ctx
+    , insn(BPF_LDX | BPF_MEM | BPF_W, 2, 1, 0, 0)                       // r2 = ctx->data
+    , insn(BPF_LDX | BPF_MEM | BPF_W, 3, 1, 4, 0)                       // r3 = ctx->data_end
+    , insn(BPF_ALU64 | BPF_MOV | BPF_X, 4, 2, 0, 0)                     // r4 = r2
+    , insn(BPF_ALU64 | BPF_ADD | BPF_K, 4, 0, 0, headers_size)          // r4 += headers
+    , insn(BPF_JMP | BPF_JGT | BPF_X, 4, 3, pass - 6, 0)                // if r4 > r3 pass
+    , insn(BPF_LDX | BPF_MEM | BPF_H, 5, 2, 12, 0)                      // r5 = ethertype
+    , insn(BPF_JMP | BPF_JNE | BPF_K, 5, 0, pass - 8, htons(0x0800))    // if r5 != IPv4 pass
+    , insn(BPF_LDX | BPF_MEM | BPF_B, 5, 2, 14, 0)                      // r5 = version, length
+    , insn(BPF_JMP | BPF_JNE | BPF_K, 5, 0, pass - 10, 0x45)            // if options pass
+    , insn(BPF_LDX | BPF_MEM | BPF_B, 5, 2, 23, 0)                      // r5 = protocol
+    , insn(BPF_JMP | BPF_JNE | BPF_K, 5, 0, pass - 12, IPPROTO_UDP)     // if r5 != UDP pass
+    , insn(BPF_LDX | BPF_MEM | BPF_H, 5, 2, 36, 0)                      // r5 = port
+    , insn(BPF_JMP | BPF_JNE | BPF_K, 5, 0, pass - 14, m_port)          // if r5 != port pass
+    , insn(BPF_LDX | BPF_MEM | BPF_W, 2, 6, 16, 0)                      // r2 = rx_queue_index
+    , insn(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, m_map_fd) // r1 = map
+    , insn(0, 0, 0, 0, 0)
+    , insn(BPF_ALU64 | BPF_MOV | BPF_K, 3, 0, 0, XDP_PASS)              // r3 = fallback
+    , insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map)          // redirect_map()
+    , insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+    , insn(BPF_ALU64 | BPF_MOV | BPF_K, 0, 0, 0, XDP_PASS)              // pass: r0 = XDP_PASS
+    , insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+    };
+  static_assert(sizeof(program) / sizeof(::bpf_insn) == pass + 2, "Wrong jump offsets");
+
+  static const char license[] = "Dual BSD/GPL";
+  std::memset(&attr, 0, sizeof(attr));
+  attr.prog_type = BPF_PROG_TYPE_XDP;
+  attr.insn_cnt = sizeof(program) / sizeof(::bpf_insn);
+  attr.insns = reinterpret_cast<std::uint64_t>(program);
+  attr.license = reinterpret_cast<std::uint64_t>(license);
+  attr.expected_attach_type = BPF_XDP;
+  m_program_fd = bpf(BPF_PROG_LOAD, attr);
+  if (m_program_fd < 0)
+  {
+    throw_errno("bpf");
+  }
+
+  // The program is detached when the link is closed. Generic mode works with any driver.
+  for (const auto flags : {XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE})
+  {
+    std::memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = static_cast<std::uint32_t>(m_program_fd);
+    attr.link_create.target_ifindex = m_ifindex;
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = flags;
+    m_link_fd = bpf(BPF_LINK_CREATE, attr);
+    if (m_link_fd >= 0)
+    {
+      m_native = flags == XDP_FLAGS_DRV_MODE;
+      return;
+    }
+  }
+  throw_errno("bpf");
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+xdp_socket::close()
+noexcept
+{
+  for (auto fd : {m_link_fd, m_program_fd, m_map_fd})
+  {
+    if (fd >= 0)
+    {
+      ::close(fd);
+    }
+  }
+  m_link_fd = m_program_fd = m_map_fd = -1;
+  for (auto r : {&m_fill, &m_completion, &m_rx, &m_tx})
+  {
+    if (r->memory)
+    {
+      ::munmap(r->memory, r->size);
+      r->memory = nullptr;
+    }
+  }
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+  if (m_umem)
+  {
+    ::munmap(m_umem, m_nb_frames * frame_size);
+    m_umem = nullptr;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+xdp_socket::receive(std::vector<packet>& packets, std::chrono::milliseconds timeout)
+{
+  if (packets.empty())
+  {
+    return 0;
+  }
+
+  const auto consumer = *m_rx.consumer;
+  auto available = load(m_rx.producer) - consumer;
+  if (available == 0)
+  {
+    ::pollfd fd;
+    fd.fd = m_fd;
+    fd.events = POLLIN;
+    ++m_nb_receive_calls;
+    const auto res = ::poll(&fd, 1, static_cast<int>(timeout.count()));
+    if (res < 0 and errno != EINTR)
+    {
+      throw_errno("poll");
+    }
+    available = load(m_rx.producer) - consumer;
+    if (available == 0)
+    {
+      return 0;
+    }
+  }
+
+  const auto nb_frames = std::min(available, static_cast<std::uint32_t>(packets.size()));
+  const auto descriptors = static_cast<const ::xdp_desc*>(m_rx.descriptors);
+  const auto fill = static_cast<std::uint64_t*>(m_fill.descriptors);
+  const auto fill_producer = *m_fill.producer;
+  auto nb = std::size_t{0};
+  for (auto i = 0u; i < nb_frames; ++i)
+  {
+    const auto& desc = descriptors[(consumer + i) & m_rx.mask];
+    const auto frame = m_umem + desc.addr;
+    const auto len = std::size_t{desc.len};
+
+    // The program only checked the headers it needed to find the port.
+    const auto ip = frame + 14;
+    const auto ip_header_size = static_cast<std::size_t>(ip[0] & 0x0f) * 4;
+    const auto ip_size = std::size_t{get16(ip + 2)};
+    const auto udp = ip + ip_header_size;
+    if ( len < headers_size or get16(frame + 12) != 0x0800 or (ip[0] & 0xf0) != 0x40
+      or ip_header_size < 20 or ip_size < ip_header_size + 8 or 14 + ip_size > len
+      or ip[9] != IPPROTO_UDP or (get16(ip + 6) & 0x3fff) != 0
+      or std::memcmp(udp + 2, &m_port, sizeof(m_port)) != 0
+      or get16(udp + 4) < 8 or get16(udp + 4) > ip_size - ip_header_size)
+    {
+      ++m_nb_dropped;
+    }
+    else
+    {
+      const auto size = std::size_t{get16(udp + 4)} - 8;
+      packets[nb].resize(size);
+      std::memcpy(packets[nb].data(), udp + 8, size);
+      ++nb;
+    }
+    // The offset of the data in the frame is not given back.
+    fill[(fill_producer + i) & m_fill.mask] = desc.addr & ~std::uint64_t{frame_size - 1};
+  }
+  store(m_fill.producer, fill_producer + nb_frames);
+  store(m_rx.consumer, consumer + nb_frames);
+
+  if (load(m_fill.flags) & XDP_RING_NEED_WAKEUP)
+  {
+    ++m_nb_receive_calls;
+    ::recvfrom(m_fd, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+  }
+  return nb;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+xdp_socket::send(const packet* packets, std::size_t nb)
+{
+  reclaim();
+
+  const auto descriptors = static_cast<::xdp_desc*>(m_tx.descriptors);
+  auto producer = *m_tx.producer;
+  for (auto i = 0ul; i < nb; ++i)
+  {
+    const auto& p = packets[i];
+    if (p.size() > m_max_payload_size)
+    {
+      ++m_nb_dropped;
+      continue;
+    }
+    // The transmit ring can hold all frames, there's room in it as long as there's a frame.
+    if (m_free_frames.empty())
+    {
+      store(m_tx.producer, producer);
+      while (m_free_frames.empty())
+      {
+        kick();
+        reclaim();
+      }
+    }
+    const auto addr = m_free_frames.back();
+    m_free_frames.pop_back();
+    write_headers(m_umem + addr, p.size());
+    std::memcpy(m_umem + addr + headers_size, p.data(), p.size());
+    auto& desc = descriptors[producer & m_tx.mask];
+    desc.addr = addr;
+    desc.len = static_cast<std::uint32_t>(headers_size + p.size());
+    desc.options = 0;
+    ++producer;
+  }
+  store(m_tx.producer, producer);
+
+  // Without zero-copy, the kernel sends a limited number of frames for each call.
+  while (load(m_tx.consumer) != producer and not kick())
+  {}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+xdp_socket::reclaim()
+noexcept
+{
+  const auto consumer = *m_completion.consumer;
+  const auto producer = load(m_completion.producer);
+  const auto addresses = static_cast<const std::uint64_t*>(m_completion.descriptors);
+  for (auto i = consumer; i != producer; ++i)
+  {
+    m_free_frames.push_back(addresses[i & m_completion.mask]);
+  }
+  store(m_completion.consumer, producer);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+xdp_socket::kick()
+{
+  // Without zero-copy, only system calls send frames.
+  if (m_zero_copy and not (load(m_tx.flags) & XDP_RING_NEED_WAKEUP))
+  {
+    return true;
+  }
+  ++m_nb_send_calls;
+  if (::sendto(m_fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0)
+  {
+    if (errno == EAGAIN or errno == EBUSY or errno == EINTR)
+    {
+      return false;
+    }
+    throw_errno("sendto");
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+xdp_socket::write_headers(char* frame, std::size_t len)
+noexcept
+{
+  std::memcpy(frame, m_headers.data(), headers_size);
+  const auto ip = frame + 14;
+  put16(ip + 2, 20 + 8 + len);
+  put16(ip + 4, m_ip_id++);
+  put16(ip + 10, ip_checksum(ip));
+  // A null UDP checksum tells it is not computed.
+  put16(ip + 20 + 4, 8 + len);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
@@ -0,0 +1,270 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "netcode/detail/visibility.hh"
+#include "netcode/packet.hh"
+
+namespace ntc {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An end of a UDP flow carried by an AF_XDP socket
+/// @ingroup ntc_transport
+struct NTC_PUBLIC xdp_endpoint
+{
+  /// @brief The hardware address of the interface
+  std::array<std::uint8_t, 6> mac;
+
+  /// @brief An IPv4 numeric address
+  std::string address;
+
+  /// @brief The UDP port
+  std::uint16_t port;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A UDP flow whose frames are exchanged directly with a network interface through an
+/// AF_XDP socket
+/// @ingroup ntc_transport
+///
+/// A small XDP program attached to the interface redirects the frames of the flow (IPv4 and UDP,
+/// to the local port) to the socket, other frames go to the network stack as usual. Frames are
+/// received and sent in a memory area shared with the kernel (the UMEM), without system calls
+/// when the device works in zero-copy mode, and with a single one per batch otherwise. The
+/// Ethernet, IPv4 and UDP headers are parsed and built here.
+///
+/// The program is attached in native mode if the driver supports it, and in generic mode
+/// otherwise, so it works on any interface, for instance a pair of veth(4).
+///
+/// It can replace udp_socket in udp_transport.
+/// @note Requires the CAP_NET_ADMIN and CAP_BPF capabilities (or CAP_SYS_ADMIN).
+/// @note The route to the remote end is not resolved, its hardware address must be given.
+/// @note Errors are reported with std::system_error.
+class NTC_PUBLIC xdp_socket final
+{
+public:
+
+  /// @brief Can't copy-construct an AF_XDP socket
+  xdp_socket(const xdp_socket&) = delete;
+
+  /// @brief Can't copy an AF_XDP socket
+  xdp_socket& operator=(const xdp_socket&) = delete;
+
+  /// @brief Move constructor
+  xdp_socket(xdp_socket&&) noexcept;
+
+  /// @brief Can't move an AF_XDP socket
+  xdp_socket& operator=(xdp_socket&&) = delete;
+
+  /// @brief Constructor
+  /// @param interface The name of the network interface
+  /// @param local The local end of the flow, its port must not be 0
+  /// @param remote The remote end of the flow
+  /// @param nb_frames The number of frames of the UMEM, half to receive and half to send
+  /// @param queue The queue of the interface to bind to
+  /// @pre @p nb_frames is a power of two, at least 4
+  /// @throw std::system_error if the interface doesn't exist, if the system doesn't support
+  /// AF_XDP, or if the process is not allowed to use it
+  xdp_socket( const std::string& interface, const xdp_endpoint& local
+            , const xdp_endpoint& remote, std::size_t nb_frames = 4096, std::uint32_t queue = 0);
+
+  /// @brief Destructor, detaches the XDP program
+  ~xdp_socket();
+
+  /// @brief Receive a batch of datagrams
+  /// @param packets Where to receive datagrams, each one is filled up to its size
+  /// @param timeout How long to wait for the first datagram
+  /// @return The number of received packets, at the beginning of @p packets
+  ///
+  /// The payload of each datagram is copied once from the UMEM to its packet, and its frame is
+  /// given back to the kernel right away. Malformed frames are dropped.
+  std::size_t
+  receive(std::vector<packet>& packets, std::chrono::milliseconds timeout);
+
+  /// @brief Send a batch of datagrams to the remote end
+  /// @param packets The datagrams to send
+  /// @param nb The number of elements of @p packets
+  ///
+  /// Each packet is written after the headers of its frame in the UMEM, all frames are then handed
+  /// to the device at once. Packets larger than max_payload_size() are dropped.
+  void
+  send(const packet* packets, std::size_t nb);
+
+  /// @brief Tell if the device reads and writes the UMEM directly
+  bool
+  zero_copy()
+  const noexcept
+  {
+    return m_zero_copy;
+  }
+
+  /// @brief Tell if the XDP program runs in the driver
+  bool
+  native()
+  const noexcept
+  {
+    return m_native;
+  }
+
+  /// @brief Get the size of the largest datagram which can be sent
+  std::size_t
+  max_payload_size()
+  const noexcept
+  {
+    return m_max_payload_size;
+  }
+
+  /// @brief Get the total number of system calls made to receive datagrams
+  std::size_t
+  nb_receive_calls()
+  const noexcept
+  {
+    return m_nb_receive_calls;
+  }
+
+  /// @brief Get the total number of system calls made to send datagrams
+  std::size_t
+  nb_send_calls()
+  const noexcept
+  {
+    return m_nb_send_calls;
+  }
+
+  /// @brief Get the total number of dropped frames and datagrams
+  std::size_t
+  nb_dropped()
+  const noexcept
+  {
+    return m_nb_dropped;
+  }
+
+private:
+
+  /// @brief A ring shared with the kernel
+  struct ring
+  {
+    /// @brief The memory of the ring
+    void* memory;
+
+    /// @brief The size of the memory of the ring
+    std::size_t size;
+
+    /// @brief The producer index
+    std::uint32_t* producer;
+
+    /// @brief The consumer index
+    std::uint32_t* consumer;
+
+    /// @brief Flags set by the kernel
+    std::uint32_t* flags;
+
+    /// @brief The descriptors
+    void* descriptors;
+
+    /// @brief The mask of indexes
+    std::uint32_t mask;
+  };
+
+  /// @brief Map the rings shared with the kernel
+  void
+  map_rings();
+
+  /// @brief Load the XDP program and attach it to the interface
+  void
+  attach(std::uint32_t queue);
+
+  /// @brief Release everything given by the kernel
+  void
+  close()
+  noexcept;
+
+  /// @brief Take back the frames of sent datagrams
+  void
+  reclaim()
+  noexcept;
+
+  /// @brief Ask the kernel to process the transmit ring
+  /// @return false if the kernel stopped before the end of the ring
+  bool
+  kick();
+
+  /// @brief Write the headers of a datagram of @p len bytes at the beginning of @p frame
+  void
+  write_headers(char* frame, std::size_t len)
+  noexcept;
+
+private:
+
+  /// @brief The file descriptor of the socket
+  int m_fd;
+
+  /// @brief The index of the interface
+  unsigned int m_ifindex;
+
+  /// @brief The file descriptor of the map of sockets used by the program
+  int m_map_fd;
+
+  /// @brief The file descriptor of the program
+  int m_program_fd;
+
+  /// @brief The file descriptor of the link of the program to the interface
+  int m_link_fd;
+
+  /// @brief The memory shared with the kernel in which frames are received and sent
+  char* m_umem;
+
+  /// @brief The number of frames of the UMEM
+  std::size_t m_nb_frames;
+
+  /// @brief The fill ring, frames given to the kernel to receive
+  ring m_fill;
+
+  /// @brief The completion ring, frames given back by the kernel once sent
+  ring m_completion;
+
+  /// @brief The receive ring
+  ring m_rx;
+
+  /// @brief The transmit ring
+  ring m_tx;
+
+  /// @brief The addresses of frames which can be used to send
+  std::vector<std::uint64_t> m_free_frames;
+
+  /// @brief The headers of sent frames, only the lengths and checksums change
+  std::array<char, 42> m_headers;
+
+  /// @brief The size of the largest datagram which can be sent
+  std::size_t m_max_payload_size;
+
+  /// @brief The local port, in network byte order
+  std::uint16_t m_port;
+
+  /// @brief The identifier of the next sent IPv4 packet
+  std::uint16_t m_ip_id;
+
+  /// @brief Tell if the device reads and writes the UMEM directly
+  bool m_zero_copy;
+
+  /// @brief Tell if the XDP program runs in the driver
+  bool m_native;
+
+  /// @brief The total number of system calls made to receive datagrams
+  std::size_t m_nb_receive_calls;
+
+  /// @brief The total number of system calls made to send datagrams
+  std::size_t m_nb_send_calls;
+
+  /// @brief The total number of dropped frames and datagrams
+  std::size_t m_nb_dropped;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace ntc
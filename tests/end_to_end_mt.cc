@@ -2,36 +2,36 @@
 #include <functional>
 #include <iostream>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
 #include <netcode/decoder.hh>
 #include <netcode/encoder.hh>
+#include <netcode/spsc_queue.hh>
 
 #include "tools/loss/burst.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
 static constexpr auto buffer_sz = 4096ul;
-using queue_type = std::queue<std::vector<char>>;
+static constexpr auto queue_sz = 1024ul;
+using queue_type = ntc::spsc_queue<ntc::packet>;
 
 /*------------------------------------------------------------------------------------------------*/
 
 struct packet_handler
 {
-  std::vector<char> buffer;
+  ntc::packet packet;
   loss::burst& loss;
   bool lost_current_packet;
   std::size_t nb_loss;
   queue_type& queue;
-  std::mutex& mutex;
 
-  packet_handler(loss::burst& l, queue_type& q, std::mutex& m)
-    : buffer(), loss(l), lost_current_packet(loss()), nb_loss(lost_current_packet ? 1u : 0u)
-    , queue(q), mutex(m)
+  packet_handler(loss::burst& l, queue_type& q)
+    : packet(), loss(l), lost_current_packet(loss()), nb_loss(lost_current_packet ? 1u : 0u)
+    , queue(q)
   {
-    buffer.reserve(buffer_sz);
+    packet.reserve(buffer_sz);
   }
 
   void
@@ -39,22 +39,23 @@ struct packet_handler
   {
     if (not lost_current_packet)
     {
-      std::copy_n(src, len, std::back_inserter(buffer));
+      const auto size = packet.size();
+      packet.resize(size + len);
+      std::copy_n(src, len, packet.data() + size);
     }
   }
 
   void
   operator()()
   {
+    // The packet is moved to the other thread, it's never copied. A full queue is a congested
+    // link: the packet is lost.
+    if (not lost_current_packet and not queue.try_push(std::move(packet)))
     {
-      std::lock_guard<std::mutex> lock{mutex};
-      if (not lost_current_packet)
-      {
-        queue.push(std::move(buffer));
-      }
+      ++nb_loss;
     }
-    buffer.clear();
-    buffer.reserve(buffer_sz);
+    packet = ntc::packet{};
+    packet.reserve(buffer_sz);
     lost_current_packet = loss();
     nb_loss += lost_current_packet ? 1u : 0u;
   }
@@ -113,30 +114,26 @@ generate_data(std::uint32_t id, std::uint16_t packet_size)
 /*------------------------------------------------------------------------------------------------*/
 
 void
-encoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::mutex& to_enc_mutex
-       , const bool* run, std::uint16_t packet_size)
+encoder( queue_type& to_dec, queue_type& to_enc, std::mutex& out_mutex, const bool* run
+       , std::uint16_t packet_size)
 {
   loss::burst loss{85, 15};
-  ntc::encoder<packet_handler> enc{8, packet_handler{loss, to_dec, to_dec_mutex}};
+  ntc::encoder<packet_handler> enc{8, packet_handler{loss, to_dec}};
   std::uint32_t id = 0;
+  ntc::packet pkt;
 
   while (*run)
   {
     enc(generate_data(id++, packet_size));
 
     // Read ack if any.
+    if (to_enc.try_pop(pkt))
     {
-      std::lock_guard<std::mutex> lock{to_enc_mutex};
-      if (not to_enc.empty())
-      {
-        ntc::packet pkt{to_enc.front().data(), to_enc.front().data() + to_enc.front().size()};
-        enc(std::move(pkt));
-        to_enc.pop();
-      }
+      enc(std::move(pkt));
     }
   }
 
-  std::lock_guard<std::mutex> out_lock{to_enc_mutex}; // to serialize output
+  std::lock_guard<std::mutex> out_lock{out_mutex}; // to serialize output
   std::cout << "Encoder\n";
   std::cout << "Sent " << (id + 1) << '\n';
   std::cout << "Lost " << enc.packet_handler().nb_loss << '\n';
@@ -146,29 +143,24 @@ encoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::
 /*------------------------------------------------------------------------------------------------*/
 
 void
-decoder( queue_type& to_dec, std::mutex& to_dec_mutex, queue_type& to_enc, std::mutex& to_enc_mutex
-       , const bool* run, std::uint16_t packet_size)
+decoder( queue_type& to_dec, queue_type& to_enc, std::mutex& out_mutex, const bool* run
+       , std::uint16_t packet_size)
 {
   loss::burst loss{85, 15};
   ntc::decoder<packet_handler, in_order_data_handler>
-    dec{ 8, ntc::in_order::yes, packet_handler{loss, to_enc, to_enc_mutex}
-       , in_order_data_handler{packet_size}};
+    dec{ 8, ntc::in_order::yes, packet_handler{loss, to_enc}, in_order_data_handler{packet_size}};
+  ntc::packet pkt;
 
   while (*run)
   {
     // Read source or repair if any.
+    if (to_dec.try_pop(pkt))
     {
-      std::lock_guard<std::mutex> lock{to_dec_mutex};
-      if (not to_dec.empty())
-      {
-        ntc::packet pkt{to_dec.front().data(), to_dec.front().data() + to_dec.front().size()};
-        dec(std::move(pkt));
-        to_dec.pop();
-      }
+      dec(std::move(pkt));
     }
   }
 
-  std::lock_guard<std::mutex> out_lock{to_enc_mutex}; // to serialize output
+  std::lock_guard<std::mutex> out_lock{out_mutex}; // to serialize output
   std::cout << "Decoder\n";
   std::cout << "Handled data " << dec.data_handler().nb_received << '\n';
   std::cout << "Received repairs " << dec.nb_received_repairs() << '\n';
@@ -213,16 +205,14 @@ int main(int argc, char** argv)
   bool _run = true;
   bool* run = &_run;
 
-  queue_type to_dec;
-  std::mutex to_dec_mutex;
-
-  queue_type to_enc;
-  std::mutex to_enc_mutex;
+  queue_type to_dec{queue_sz};
+  queue_type to_enc{queue_sz};
+  std::mutex out_mutex;
 
-  std::thread encoder_thread{ encoder, std::ref(to_dec), std::ref(to_dec_mutex), std::ref(to_enc)
-                            , std::ref(to_enc_mutex), run, packet_size};
-  std::thread decoder_thread{ decoder, std::ref(to_dec), std::ref(to_dec_mutex), std::ref(to_enc)
-                            , std::ref(to_enc_mutex), run, packet_size};
+  std::thread encoder_thread{ encoder, std::ref(to_dec), std::ref(to_enc), std::ref(out_mutex), run
+                            , packet_size};
+  std::thread decoder_thread{ decoder, std::ref(to_dec), std::ref(to_enc), std::ref(out_mutex), run
+                            , packet_size};
 
   std::this_thread::sleep_for(std::chrono::seconds{test_time});
 
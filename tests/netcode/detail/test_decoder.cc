@@ -6,7 +6,9 @@
 
 #include "netcode/detail/decoder.hh"
 #include "netcode/detail/encoder.hh"
+#include "netcode/detail/packetizer.hh"
 #include "netcode/detail/source_list.hh"
+#include "netcode/encoder.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -161,6 +163,85 @@ TEST_CASE("Decoder: missing sources")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Decoder: deficits")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::decoder decoder{gf_size, [](const detail::decoder_source&){}, in_order::no};
+    std::vector<detail::deficit> deficits;
+
+    SECTION("Nothing lost")
+    {
+      decoder.deficits(deficits);
+      REQUIRE(deficits.empty());
+
+      decoder(detail::decoder_source{0, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{1, detail::byte_buffer{}, 0});
+      decoder.deficits(deficits);
+      REQUIRE(deficits.empty());
+    }
+
+    SECTION("Holes without repairs")
+    {
+      decoder(detail::decoder_source{0, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{1, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{3, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{4, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{7, detail::byte_buffer{}, 0});
+      decoder.deficits(deficits);
+      REQUIRE(deficits.size() == 2);
+      REQUIRE(deficits[0].first_id == 2);
+      REQUIRE(deficits[0].last_id == 2);
+      REQUIRE(deficits[0].nb_repairs == 1);
+      REQUIRE(deficits[1].first_id == 5);
+      REQUIRE(deficits[1].last_id == 6);
+      REQUIRE(deficits[1].nb_repairs == 2);
+    }
+
+    SECTION("Holes linked by a repair")
+    {
+      detail::source_list sl;
+      sl.emplace(0, detail::byte_buffer{});
+      sl.emplace(1, detail::byte_buffer{});
+      sl.emplace(2, detail::byte_buffer{});
+      sl.emplace(3, detail::byte_buffer{});
+      sl.emplace(4, detail::byte_buffer{});
+      detail::encoder_repair r0{0};
+      detail::encoder{gf_size}(r0, sl);
+
+      decoder(detail::decoder_source{0, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{2, detail::byte_buffer{}, 0});
+      decoder(detail::decoder_source{4, detail::byte_buffer{}, 0});
+      decoder(mk_decoder_repair(r0));
+      decoder.deficits(deficits);
+      REQUIRE(deficits.size() == 1);
+      REQUIRE(deficits[0].first_id == 1);
+      REQUIRE(deficits[0].last_id == 3);
+      REQUIRE(deficits[0].nb_repairs == 1);
+    }
+
+    SECTION("Lost sources after the last received one")
+    {
+      detail::source_list sl;
+      sl.emplace(0, detail::byte_buffer{});
+      sl.emplace(1, detail::byte_buffer{});
+      sl.emplace(2, detail::byte_buffer{});
+      detail::encoder_repair r0{0};
+      detail::encoder{gf_size}(r0, sl);
+
+      decoder(detail::decoder_source{0, detail::byte_buffer{}, 0});
+      decoder(mk_decoder_repair(r0));
+      decoder.deficits(deficits);
+      REQUIRE(deficits.size() == 1);
+      REQUIRE(deficits[0].first_id == 1);
+      REQUIRE(deficits[0].last_id == 2);
+      REQUIRE(deficits[0].nb_repairs == 1);
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Decoder: drop outdated sources")
 {
   launch([](std::uint8_t gf_size)
@@ -984,3 +1065,172 @@ TEST_CASE("Outdating repair, but not reffered sources")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder: independent groups of repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::source_list sl;
+    for (auto i = 0u; i < 6; ++i)
+    {
+      add_source(sl, i, detail::byte_buffer(4, static_cast<char>('a' + i)));
+    }
+
+    // One repair for sources 0 to 2, two repairs for sources 3 to 5.
+    detail::encoder encoder{gf_size};
+    detail::encoder_repair r0{0};
+    encoder(r0, sl.cbegin(), std::next(sl.cbegin(), 3));
+    detail::encoder_repair r1{1};
+    encoder(r1, std::next(sl.cbegin(), 3), sl.cend());
+    detail::encoder_repair r2{3};
+    encoder(r2, std::next(sl.cbegin(), 3), sl.cend());
+
+    // All repairs are sent while sources 0 to 5 are still held by the encoder.
+    const auto mk_repair = [](const detail::encoder_repair& r)
+    {
+      return detail::decoder_repair{ r.id(), r.encoded_size()
+                                   , detail::source_id_list{r.source_ids()}, r.symbol()
+                                   , r.symbol().size(), 0 /* window start */};
+    };
+
+    std::vector<std::uint32_t> decoded;
+    detail::decoder decoder{ gf_size
+                           , [&](const detail::decoder_source& src)
+                             {
+                               REQUIRE(src.symbol_size() == 4);
+                               const auto expected = static_cast<char>('a' + src.id());
+                               REQUIRE(std::all_of( src.symbol(), src.symbol() + 4
+                                                  , [&](char c){return c == expected;}));
+                               decoded.push_back(src.id());
+                             }
+                           , in_order::no};
+
+    // Sources 0, 1, 4 and 5 are lost.
+    decoder(detail::decoder_source{2, detail::byte_buffer(4, 'c'), 4});
+    decoder(detail::decoder_source{3, detail::byte_buffer(4, 'd'), 4});
+    decoder(mk_repair(r0));
+    decoder(mk_repair(r1));
+    REQUIRE(decoder.nb_decoded() == 0);
+
+    // Sources 4 and 5 can be decoded, even if there are not enough repairs for sources 0 and 1.
+    decoder(mk_repair(r2));
+    REQUIRE(decoder.nb_decoded() == 2);
+    REQUIRE(decoder.missing_sources().size() == 2);
+    REQUIRE(decoder.missing_sources().count(0));
+    REQUIRE(decoder.missing_sources().count(1));
+    REQUIRE(decoder.repairs().size() == 1);
+    REQUIRE(decoded == (std::vector<std::uint32_t>{2, 3, 4, 5}));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder: block code re-uses inverses")
+{
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    detail::source_list sl;
+    for (auto i = 0u; i < 8; ++i)
+    {
+      add_source(sl, i, detail::byte_buffer(4, static_cast<char>('a' + i)));
+    }
+
+    // Two blocks of 4 sources, with 2 repairs each.
+    detail::encoder encoder{gf_size};
+    std::vector<detail::decoder_repair> repairs;
+    for (auto block = 0u; block < 2; ++block)
+    {
+      for (auto row = 0u; row < 2; ++row)
+      {
+        detail::encoder_repair r{block * 2 + row};
+        r.generator() = coefficient_generator::block;
+        r.block_row() = static_cast<std::uint16_t>(row);
+        r.window_start() = block * 4;
+        const auto begin = std::next(sl.cbegin(), block * 4);
+        encoder(r, begin, std::next(begin, 4));
+        repairs.emplace_back( r.id(), r.encoded_size(), detail::source_id_list{r.source_ids()}
+                            , r.symbol(), r.symbol().size(), r.window_start());
+        repairs.back().generator() = r.generator();
+        repairs.back().block_row() = r.block_row();
+      }
+    }
+
+    std::vector<std::uint32_t> decoded;
+    detail::decoder decoder{ gf_size
+                           , [&](const detail::decoder_source& src)
+                             {
+                               const auto expected = static_cast<char>('a' + src.id());
+                               REQUIRE(src.symbol_size() == 4);
+                               REQUIRE(std::all_of( src.symbol(), src.symbol() + 4
+                                                  , [&](char c){return c == expected;}));
+                               decoded.push_back(src.id());
+                             }
+                           , in_order::no};
+
+    // The same sources are lost in both blocks: 1 and 2, then 5 and 6.
+    decoder(detail::decoder_source{0, detail::byte_buffer(4, 'a'), 4});
+    decoder(detail::decoder_source{3, detail::byte_buffer(4, 'd'), 4});
+    decoder(std::move(repairs[0]));
+    decoder(std::move(repairs[1]));
+    REQUIRE(decoder.nb_decoded() == 2);
+    REQUIRE(decoder.nb_cached_inverses_hits() == 0);
+
+    decoder(detail::decoder_source{4, detail::byte_buffer(4, 'e'), 4});
+    decoder(detail::decoder_source{7, detail::byte_buffer(4, 'h'), 4});
+    decoder(std::move(repairs[2]));
+    decoder(std::move(repairs[3]));
+    REQUIRE(decoder.nb_decoded() == 4);
+    REQUIRE(decoder.nb_cached_inverses_hits() == 1);
+    REQUIRE(decoder.nb_failed_full_decodings() == 0);
+    REQUIRE(decoded.size() == 8);
+
+    // An ack in the middle of a block doesn't change the coefficients of its repairs.
+    ntc::encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_block_code(4, 2);
+    auto& enc_handler = enc.packet_handler();
+    auto h = packet_handler{};
+    auto packetizer = detail::packetizer<packet_handler>{h};
+    for (auto i = 0u; i < 8; ++i)
+    {
+      enc(data(4, static_cast<char>('a' + i)));
+      // The first source of the second block is acknowledged.
+      if (i == 5)
+      {
+        packetizer.write_ack(detail::ack{{4}, 1});
+        enc(h[h.nb_packets() - 1]);
+      }
+    }
+    REQUIRE(enc_handler.nb_packets() == 12);
+
+    // The same sources are lost in both blocks: 1 and 2, then 5 and 6.
+    decoded.clear();
+    detail::decoder block_decoder{ gf_size
+                                 , [&](const detail::decoder_source& src)
+                                   {
+                                     const auto expected = static_cast<char>('a' + src.id());
+                                     REQUIRE(std::all_of( src.symbol(), src.symbol() + 4
+                                                        , [&](char c){return c == expected;}));
+                                     decoded.push_back(src.id());
+                                   }
+                                 , in_order::no};
+    for (auto i = 0u; i < enc_handler.nb_packets(); ++i)
+    {
+      auto p = packet{enc_handler[i]};
+      if (detail::get_packet_type(p) == detail::packet_type::repair)
+      {
+        block_decoder(packetizer.read_repair(std::move(p)).first);
+        continue;
+      }
+      auto src = packetizer.read_source(std::move(p)).first;
+      if (src.id() != 1 and src.id() != 2 and src.id() != 5 and src.id() != 6)
+      {
+        block_decoder(std::move(src));
+      }
+    }
+    REQUIRE(decoded.size() == 8);
+    REQUIRE(block_decoder.nb_cached_inverses_hits() == 1);
+    REQUIRE(block_decoder.nb_failed_full_decodings() == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -123,3 +123,115 @@ TEST_CASE("Encoder is deterministic")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder: create repairs from a subset of sources")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::source_list sl;
+    sl.emplace(0, detail::byte_buffer(4, 'a'));
+    sl.emplace(1, detail::byte_buffer(4, 'b'));
+    sl.emplace(2, detail::byte_buffer(8, 'c'));
+    sl.emplace(4, detail::byte_buffer(4, 'd'));
+
+    SECTION("Range")
+    {
+      detail::encoder_repair r0{0 /* id */};
+      detail::encoder{gf_size}(r0, std::next(sl.cbegin()), std::prev(sl.cend()));
+      REQUIRE(r0.source_ids().size() == 2);
+      REQUIRE(*(r0.source_ids().begin() + 0) == 1);
+      REQUIRE(*(r0.source_ids().begin() + 1) == 2);
+      REQUIRE(r0.symbol().size() == 8);
+    }
+
+    SECTION("Identifiers")
+    {
+      // Source 3 doesn't exist, thus it's ignored.
+      detail::encoder_repair r0{0 /* id */};
+      detail::encoder{gf_size}(r0, sl, std::vector<std::uint32_t>{1, 3, 4});
+      REQUIRE(r0.source_ids().size() == 2);
+      REQUIRE(*(r0.source_ids().begin() + 0) == 1);
+      REQUIRE(*(r0.source_ids().begin() + 1) == 4);
+      REQUIRE(r0.symbol().size() == 4);
+
+      detail::encoder_repair r1{1 /* id */};
+      detail::encoder{gf_size}(r1, sl, std::vector<std::uint32_t>{3, 5});
+      REQUIRE(r1.source_ids().empty());
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder: create sparse repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::source_list sl;
+    for (auto i = 0u; i < 200; ++i)
+    {
+      sl.emplace(i, detail::byte_buffer(4, 'x'));
+    }
+
+    detail::encoder_repair r0{0 /* id */};
+    detail::encoder{gf_size}(r0, sl.cbegin(), sl.cend(), 0.25);
+    REQUIRE(r0.source_ids().size() > 20);
+    REQUIRE(r0.source_ids().size() < 80);
+
+    // The last source is always encoded.
+    REQUIRE(*r0.source_ids().rbegin() == 199);
+
+    // The choice of sources only depends on identifiers.
+    detail::encoder_repair r1{0 /* id */};
+    detail::encoder{gf_size}(r1, sl.cbegin(), sl.cend(), 0.25);
+    REQUIRE(r0.source_ids() == r1.source_ids());
+
+    detail::encoder_repair r2{1 /* id */};
+    detail::encoder{gf_size}(r2, sl.cbegin(), sl.cend(), 0.25);
+    REQUIRE(r0.source_ids() != r2.source_ids());
+
+    detail::encoder_repair r3{2 /* id */};
+    detail::encoder{gf_size}(r3, sl.cbegin(), sl.cend(), 1);
+    REQUIRE(r3.source_ids().size() == 200);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder: create fountain repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::source_list sl;
+    for (auto i = 0u; i < 200; ++i)
+    {
+      sl.emplace(i, detail::byte_buffer(4, 'x'));
+    }
+
+    detail::soliton_distribution degrees;
+    degrees.resize(200);
+
+    // Most repairs encode only a few sources.
+    detail::encoder encoder{gf_size};
+    auto nb_sources = 0ul;
+    for (auto i = 0u; i < 100; ++i)
+    {
+      detail::encoder_repair r{i};
+      encoder(r, sl.cbegin(), sl.cend(), degrees);
+      REQUIRE(r.source_ids().size() >= 1);
+      REQUIRE(r.source_ids().size() <= 200);
+      REQUIRE(std::is_sorted(r.source_ids().begin(), r.source_ids().end()));
+      nb_sources += r.source_ids().size();
+    }
+    REQUIRE(nb_sources / 100 < 40);
+
+    // The choice of sources only depends on the repair's identifier.
+    detail::encoder_repair r0{42};
+    encoder(r0, sl.cbegin(), sl.cend(), degrees);
+    detail::encoder_repair r1{42};
+    encoder(r1, sl.cbegin(), sl.cend(), degrees);
+    REQUIRE(r0.source_ids() == r1.source_ids());
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
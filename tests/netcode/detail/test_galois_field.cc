@@ -1,10 +1,14 @@
 #include <array>
 #include <algorithm>
+#include <memory> // make_shared
+#include <vector>
 
 #include <catch.hpp>
 #include "tests/netcode/launch.hh"
 
+#include "netcode/detail/buffer.hh"
 #include "netcode/detail/galois_field.hh"
+#include "netcode/parallel_executor.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -26,3 +30,156 @@ TEST_CASE("Verify operations on single elements")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Generated coefficients are valid")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+    const auto max = gf_size == 32 ? 0xffffffffu : (1u << gf_size) - 1;
+
+    for (auto gen : { coefficient_generator::arithmetic, coefficient_generator::xorshift
+                    , coefficient_generator::cauchy})
+    {
+      for (auto r = 0u; r < 16; ++r)
+      {
+        for (auto s = 0u; s < 64; ++s)
+        {
+          const auto c = gf.coefficient(gen, r, s);
+          REQUIRE(c != 0);
+          REQUIRE(c <= max);
+        }
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Cauchy coefficients are never singular")
+{
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+    const auto span = 1u << (gf_size - 1);
+    const auto gen = coefficient_generator::cauchy;
+
+    // Every 2x2 sub-matrix has a non-null determinant.
+    for (auto r0 = 0u; r0 < std::min(span, 8u); ++r0)
+    {
+      for (auto r1 = r0 + 1; r1 < std::min(span, 8u); ++r1)
+      {
+        for (auto s0 = 0u; s0 < std::min(span, 8u); ++s0)
+        {
+          for (auto s1 = s0 + 1; s1 < std::min(span, 8u); ++s1)
+          {
+            const auto det = gf.multiply(gf.coefficient(gen, r0, s0), gf.coefficient(gen, r1, s1))
+                           ^ gf.multiply(gf.coefficient(gen, r0, s1), gf.coefficient(gen, r1, s0));
+            REQUIRE(det != 0);
+          }
+        }
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Binary field")
+{
+  detail::galois_field gf{1};
+  REQUIRE(gf.coefficient(3, 42) == 1);
+  REQUIRE(gf.coefficient(coefficient_generator::cauchy, 3, 42) == 1);
+  REQUIRE(gf.invert(1) == 1);
+  REQUIRE(gf.multiply(1u, 1u) == 1);
+  REQUIRE(gf.multiply(0u, 1u) == 0);
+  REQUIRE(gf.multiply_size(42, 1) == 42);
+
+  // Use a length which is not a multiple of any vector size.
+  const auto src = std::vector<char>(67, 'a');
+  auto dst = std::vector<char>(67, 'b');
+  gf.multiply_add(src.data(), dst.data(), dst.size(), 1);
+  REQUIRE(std::all_of(dst.begin(), dst.end(), [](char c){return c == ('a' ^ 'b');}));
+  gf.multiply_add(src.data(), dst.data(), dst.size(), 1);
+  REQUIRE(dst == std::vector<char>(67, 'b'));
+
+  gf.multiply(src.data(), dst.data(), dst.size(), 1);
+  REQUIRE(dst == src);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Fields of the same size share their tables")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    const gf_t* tables = nullptr;
+    {
+      detail::galois_field gf0{gf_size};
+      detail::galois_field gf1{gf_size};
+      REQUIRE(gf0.implementation() != nullptr);
+      REQUIRE(gf0.implementation() == gf1.implementation());
+      REQUIRE(gf0.multiply(3, 7) == gf1.multiply(3, 7));
+      tables = gf0.implementation();
+
+      detail::galois_field other{static_cast<std::uint8_t>(gf_size == 8 ? 16 : 8)};
+      REQUIRE(other.implementation() != tables);
+    }
+
+    // Tables are built again once all fields are gone.
+    detail::galois_field gf{gf_size};
+    REQUIRE(gf.invert(gf.coefficient(1, 2)) != 0);
+  });
+  REQUIRE(detail::galois_field{1}.implementation() == nullptr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Region operations split by an executor")
+{
+  const auto executor = std::make_shared<parallel_executor>(3);
+  launch({1, 4, 8, 16, 32}, [&](std::uint8_t gf_size)
+  {
+    detail::galois_field seq{gf_size};
+    detail::galois_field par{gf_size};
+    par.set_executor(executor);
+    REQUIRE(par.executor() == executor);
+
+    // Jumbo regions, which are not a multiple of a stripe.
+    const auto len = 60004ul;
+    auto src0 = detail::zero_byte_buffer(len);
+    auto src1 = detail::zero_byte_buffer(len);
+    for (auto i = 0ul; i < len; ++i)
+    {
+      src0[i] = static_cast<char>(i * 7 + 3);
+      src1[i] = static_cast<char>(i * 13 + 1);
+    }
+    const auto c0 = seq.coefficient(1, 2);
+    const auto c1 = seq.coefficient(3, 4);
+
+    auto expected = detail::zero_byte_buffer(len);
+    auto dst = detail::zero_byte_buffer(len);
+    seq.multiply(src0.data(), expected.data(), len, c0);
+    par.multiply(src0.data(), dst.data(), len, c0);
+    REQUIRE(dst == expected);
+
+    seq.multiply_add(src1.data(), expected.data(), len, c1);
+    par.multiply_add(src1.data(), dst.data(), len, c1);
+    REQUIRE(dst == expected);
+
+    // A shorter first region, whose missing bytes are 0.
+    const auto terms = std::vector<detail::region_term>{ {src0.data(), len / 2, c0}
+                                                       , {src1.data(), len, c1}};
+    auto expected_sum = detail::zero_byte_buffer(len);
+    seq.multiply(src0.data(), expected_sum.data(), len / 2, c0);
+    seq.multiply_add(src1.data(), expected_sum.data(), len, c1);
+    auto sum = detail::zero_byte_buffer(len);
+    par.combine(terms, sum.data(), len);
+    REQUIRE(sum == expected_sum);
+    auto seq_sum = detail::zero_byte_buffer(len);
+    seq.combine(terms, seq_sum.data(), len);
+    REQUIRE(seq_sum == expected_sum);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
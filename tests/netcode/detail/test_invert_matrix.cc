@@ -5,6 +5,7 @@
 
 #include "netcode/detail/invert_matrix.hh"
 #include "netcode/detail/square_matrix.hh"
+#include "netcode/parallel_executor.hh"
 
 /*------------------------------------------------------------------------------------------------*/
 
@@ -233,3 +234,57 @@ TEST_CASE("Matrix is correctly inverted")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Large matrix is inverted on several threads")
+{
+  parallel_executor executor{3};
+  launch({8, 16}, [&](std::uint8_t gf_size)
+  {
+    detail::galois_field gf{gf_size};
+
+    // Not a multiple of the blocks of rows and columns.
+    const auto n = 100ul;
+    detail::square_matrix m0{n};
+    for (auto i = 0u; i < n; ++i)
+    {
+      for (auto j = 0u; j < n; ++j)
+      {
+        m0(i, j) = gf.coefficient(coefficient_generator::cauchy, i, j);
+      }
+    }
+    auto m1 = m0;
+
+    detail::square_matrix inv0{n};
+    detail::square_matrix inv1{n};
+
+    REQUIRE(jerasure_invert_matrix(m0, inv0, gf) == 0);
+    REQUIRE(not detail::invert(gf, m1, inv1, executor));
+    for (auto i = 0ul; i < n * n; ++i)
+    {
+      REQUIRE(inv0[i] == inv1[i]);
+      REQUIRE(m0[i] == m1[i]);
+    }
+  });
+
+  // A non-invertible matrix fails on the same column.
+  detail::galois_field gf{8};
+  detail::square_matrix m0{40};
+  for (auto i = 0u; i < 40; ++i)
+  {
+    for (auto j = 0u; j < 40; ++j)
+    {
+      // The last row is the sum of the two first ones.
+      m0(i, j) = i == 39 ? gf.coefficient(coefficient_generator::cauchy, 0, j)
+                         ^ gf.coefficient(coefficient_generator::cauchy, 1, j)
+                         : gf.coefficient(coefficient_generator::cauchy, i, j);
+    }
+  }
+  auto m1 = m0;
+  detail::square_matrix inv0{40};
+  detail::square_matrix inv1{40};
+  const auto col = detail::invert(gf, m0, inv0);
+  REQUIRE(col);
+  REQUIRE(col == detail::invert(gf, m1, inv1, executor));
+}
+
+/*------------------------------------------------------------------------------------------------*/
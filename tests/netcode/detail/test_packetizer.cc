@@ -47,6 +47,140 @@ TEST_CASE("An ack is (de)serialized by packetizer")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("An ack with deficits is (de)serialized by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  const detail::ack a_in{ {0,1,2,3,7}, 33
+                        , std::vector<detail::deficit>{{4, 6, 2}, {1u << 20, (1u << 20) + 3, 1}}};
+
+  serializer.write_ack(a_in);
+
+  const auto a_out = serializer.read_ack(std::move(h.pkt)).first;
+  REQUIRE(a_in.source_ids() == a_out.source_ids());
+  REQUIRE(a_in.nb_packets() == a_out.nb_packets());
+  REQUIRE(a_out.deficits().size() == 2);
+  REQUIRE(a_out.deficits()[0].first_id == 4);
+  REQUIRE(a_out.deficits()[0].last_id == 6);
+  REQUIRE(a_out.deficits()[0].nb_repairs == 2);
+  REQUIRE(a_out.deficits()[1].first_id == 1u << 20);
+  REQUIRE(a_out.deficits()[1].last_id == (1u << 20) + 3);
+  REQUIRE(a_out.deficits()[1].nb_repairs == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("An ack with path counts is (de)serialized by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  detail::ack a_in{{0,1,2,3}, 33};
+  a_in.path_counts() = {12, 0, 1u << 31};
+
+  serializer.write_ack(a_in);
+
+  const auto a_out = serializer.read_ack(std::move(h.pkt)).first;
+  REQUIRE(a_in.source_ids() == a_out.source_ids());
+  REQUIRE(a_out.deficits().empty());
+  REQUIRE(a_out.path_counts() == a_in.path_counts());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("An ack of an older decoder is deserialized by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  const detail::ack a_in{{0,1,2,3}, 33};
+  serializer.write_ack(a_in);
+
+  // Older decoders ended acks with their identifiers, and didn't set the trailer flag.
+  auto old = h.pkt;
+  REQUIRE(detail::has_trailer(old));
+  old.resize(old.size() - sizeof(std::uint16_t) - sizeof(std::uint8_t));
+  old[0] = static_cast<char>(detail::packet_type::ack);
+  REQUIRE(not detail::has_trailer(old));
+
+  const auto res = serializer.read_ack(std::move(old));
+  REQUIRE(res.second == h.pkt.size() - sizeof(std::uint16_t) - sizeof(std::uint8_t));
+  REQUIRE(a_in.source_ids() == res.first.source_ids());
+  REQUIRE(a_in.nb_packets() == res.first.nb_packets());
+  REQUIRE(res.first.deficits().empty());
+  REQUIRE(res.first.path_counts().empty());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("An ack with truncated fields is rejected by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+
+  serializer.write_ack(detail::ack{{0,1,2,3}, 33});
+
+  // The trailer flag tells the fields follow the identifiers: they can't be missing.
+  auto truncated = h.pkt;
+  truncated.resize(truncated.size() - sizeof(std::uint8_t));
+  REQUIRE_THROWS_AS(serializer.read_ack(std::move(truncated)), overflow_error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Packets with a session are (de)serialized by packetizer")
+{
+  handler h;
+  detail::packetizer<handler> serializer{h};
+  serializer.set_session(0xdeadbeef);
+
+  SECTION("ack")
+  {
+    const detail::ack a_in{{0,1,2,3}, 33};
+    serializer.write_ack(a_in);
+    REQUIRE(detail::has_session(h.pkt));
+    REQUIRE(detail::get_session(h.pkt) == 0xdeadbeef);
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::ack);
+
+    const auto sz = h.pkt.size();
+    const auto res = serializer.read_ack(std::move(h.pkt));
+    REQUIRE(res.first.source_ids() == a_in.source_ids());
+    REQUIRE(res.second == sz);
+  }
+
+  SECTION("repair")
+  {
+    detail::encoder_repair r_in{ 0, 33, {10, 11}, detail::zero_byte_buffer{'x'}};
+    r_in.generator() = coefficient_generator::block;
+    r_in.block_row() = 3;
+    serializer.write_repair(r_in);
+    REQUIRE(detail::get_session(h.pkt) == 0xdeadbeef);
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::repair);
+
+    const auto sz = h.pkt.size();
+    const auto res = serializer.read_repair(std::move(h.pkt));
+    REQUIRE(res.first.source_ids() == r_in.source_ids());
+    REQUIRE(res.first.block_row() == 3);
+    REQUIRE(res.second == sz);
+  }
+
+  SECTION("source")
+  {
+    serializer.write_source(detail::encoder_source{42, {'a', 'b', 'c'}});
+    REQUIRE(detail::get_session(h.pkt) == 0xdeadbeef);
+    REQUIRE(detail::get_packet_type(h.pkt) == detail::packet_type::source);
+
+    const auto sz = h.pkt.size();
+    const auto res = serializer.read_source(std::move(h.pkt));
+    REQUIRE(res.first.id() == 42);
+    REQUIRE(res.first.symbol_size() == 3);
+    REQUIRE(res.second == sz);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("A repair is (de)serialized by packetizer")
 {
   handler h;
@@ -113,6 +247,81 @@ TEST_CASE("A repair is (de)serialized by packetizer")
     REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
   }
 
+  SECTION("Window start")
+  {
+    detail::encoder_repair r_in{ 0, 33, {10, 11}, detail::zero_byte_buffer{'x'}};
+    REQUIRE(r_in.window_start() == 10);
+    r_in.window_start() = 3;
+    serializer.write_repair(r_in);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_out.window_start() == 3);
+  }
+
+  SECTION("Coefficient generator")
+  {
+    detail::encoder_repair r_in{ 0, 33, {10, 11}, detail::zero_byte_buffer{'x'}};
+    REQUIRE(r_in.generator() == coefficient_generator::arithmetic);
+    r_in.generator() = coefficient_generator::cauchy;
+    serializer.write_repair(r_in);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_out.generator() == coefficient_generator::cauchy);
+  }
+
+  SECTION("Block row")
+  {
+    detail::encoder_repair r_in{ 0, 33, {10, 11}, detail::zero_byte_buffer{'x'}};
+    r_in.generator() = coefficient_generator::block;
+    r_in.block_row() = 3;
+    serializer.write_repair(r_in);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_out.generator() == coefficient_generator::block);
+    REQUIRE(r_out.block_row() == 3);
+  }
+
+  SECTION("Recoded coefficients")
+  {
+    detail::encoder_repair r_in{ 0, 33, {10, 12}, detail::zero_byte_buffer{'x'}};
+    r_in.generator() = coefficient_generator::recoded;
+    r_in.coefficients() = {{10, 7}, {12, 65535}};
+    serializer.write_repair(r_in);
+
+    const auto r_out = serializer.read_repair(std::move(h.pkt)).first;
+    REQUIRE(r_out.generator() == coefficient_generator::recoded);
+    REQUIRE(r_out.coefficients() == r_in.coefficients());
+  }
+
+  SECTION("Repair of an older encoder")
+  {
+    detail::encoder_repair r_in{ 7, 33, {10, 11}, detail::zero_byte_buffer{'x', 'y'}};
+    r_in.window_start() = 3;
+    serializer.write_repair(r_in);
+
+    // Older encoders ended repairs with a copy of their symbol instead of the window start and of
+    // the generator, and didn't set the trailer flag.
+    auto old = h.pkt;
+    REQUIRE(detail::has_trailer(old));
+    old.resize(old.size() - sizeof(std::uint32_t) - sizeof(std::uint8_t));
+    old[0] = static_cast<char>(detail::packet_type::repair);
+    for (const auto c : {'\0', '\2', 'x', 'y'})
+    {
+      old.push_back(c);
+    }
+    REQUIRE(not detail::has_trailer(old));
+
+    const auto r_out = serializer.read_repair(std::move(old)).first;
+    REQUIRE(r_out.id() == 7);
+    REQUIRE(r_in.source_ids() == r_out.source_ids());
+    REQUIRE(r_in.encoded_size() == r_out.encoded_size());
+    REQUIRE(std::equal(r_in.symbol().begin(), r_in.symbol().end(), r_out.symbol()));
+    REQUIRE(r_out.window_start() == 10);
+    REQUIRE(r_out.generator() == coefficient_generator::arithmetic);
+  }
+
   SECTION("Repair with only one source")
   {
     const detail::encoder_repair r_in{ 0, 33, {4242}, detail::zero_byte_buffer{'x'}};
@@ -123,3 +123,21 @@ TEST_CASE("Error scenario")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("source_list counts bytes")
+{
+  auto sl = detail::source_list{};
+  sl.emplace(0, detail::byte_buffer(10, 'a'));
+  sl.emplace(1, detail::byte_buffer(20, 'b'));
+  sl.emplace(2, detail::byte_buffer(30, 'c'));
+  REQUIRE(sl.nb_bytes() == 60);
+
+  const auto ids = detail::source_id_list{1};
+  sl.erase(begin(ids), end(ids));
+  REQUIRE(sl.nb_bytes() == 40);
+
+  sl.pop_front();
+  REQUIRE(sl.nb_bytes() == 30);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <memory> // make_shared
 #include <thread>
 #include <vector>
 
@@ -9,6 +10,7 @@
 #include "netcode/decoder.hh"
 #include "netcode/encoder.hh"
 #include "netcode/detail/packet_type.hh"
+#include "netcode/parallel_executor.hh"
 
 #include <iostream>
 
@@ -671,6 +673,47 @@ TEST_CASE("In order decoder, missing sources")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("In order decoder, source decoded before an older one")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+    for (auto i = 0u; i < 6; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+
+    // Sources 2 and 3 are lost.
+    for (auto i = 0u; i < 6; ++i)
+    {
+      if (i != 2 and i != 3)
+      {
+        dec(enc_handler[i]);
+      }
+    }
+
+    // Decoding s3 from the second repair decodes s2 from the first one: s3 must still be given.
+    enc.generate_repair(2, 3);
+    enc.generate_repair(3, 3);
+    dec(enc_handler[6]);
+    dec(enc_handler[7]);
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 6);
+    for (auto i = 0u; i < 6; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Decoder rejects ack")
 {
   launch([](std::uint8_t gf_size)
@@ -696,3 +739,99 @@ TEST_CASE("Decoder rejects ack")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder repairs jumbo sources with a parallel executor")
+{
+  const auto executor = std::make_shared<parallel_executor>(3);
+  // A 32 bits field can only decode small sizes, as encoded sizes are carried on 16 bits.
+  launch({4, 8, 16}, [&](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(2);
+    enc.set_parallel_executor(executor);
+    REQUIRE(enc.parallel_executor() == executor);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_parallel_executor(executor);
+    REQUIRE(dec.parallel_executor() == executor);
+
+    const auto sizes = {60000u, 30004u, 59000u, 45000u};
+    auto sent = std::vector<data>{};
+    for (const auto sz : sizes)
+    {
+      sent.emplace_back(sz, static_cast<char>(sz));
+      for (auto i = 0u; i < sz; i += 7)
+      {
+        sent.back()[i] = static_cast<char>(i);
+      }
+      enc(data{sent.back()});
+    }
+
+    // s0 s1 r0 s2 s3 r1, lose both first sources: r1 has to be combined with r0.
+    auto& enc_packet_handler = enc.packet_handler();
+    REQUIRE(enc_packet_handler.nb_packets() == 6);
+    for (const auto i : {2u, 3u, 4u, 5u})
+    {
+      dec(enc_packet_handler[i]);
+    }
+
+    REQUIRE(dec.nb_decoded() == 2);
+    auto& dec_data_handler = dec.data_handler();
+    REQUIRE(dec_data_handler.nb_data() == 4);
+    for (auto i = 0u; i < 4; ++i)
+    {
+      REQUIRE(dec_data_handler[i].size() == sent[i].size());
+      REQUIRE(std::equal(sent[i].begin(), sent[i].end(), dec_data_handler[i].begin()));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder solves a large system with a parallel executor")
+{
+  const auto executor = std::make_shared<parallel_executor>(3);
+  launch({8, 16}, [&](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(1000);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_parallel_executor(executor);
+    dec.set_parallel_dimension(16);
+    REQUIRE(dec.parallel_dimension() == 16);
+
+    const auto nb = 80u;
+    auto sent = std::vector<data>{};
+    for (auto i = 0u; i < nb; ++i)
+    {
+      sent.emplace_back(100 + 4 * i, static_cast<char>(i));
+      enc(data{sent.back()});
+    }
+    for (auto i = 0u; i < nb; ++i)
+    {
+      enc.generate_repair();
+    }
+
+    // All sources are lost, the last repair gives a system of all sources.
+    auto& enc_packet_handler = enc.packet_handler();
+    REQUIRE(enc_packet_handler.nb_packets() == 2 * nb);
+    for (auto i = nb; i < 2 * nb; ++i)
+    {
+      dec(enc_packet_handler[i]);
+    }
+
+    REQUIRE(dec.nb_decoded() == nb);
+    auto& dec_data_handler = dec.data_handler();
+    REQUIRE(dec_data_handler.nb_data() == nb);
+    for (auto i = 0u; i < nb; ++i)
+    {
+      REQUIRE(dec_data_handler[i].size() == sent[i].size());
+      REQUIRE(std::equal(sent[i].begin(), sent[i].end(), dec_data_handler[i].begin()));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
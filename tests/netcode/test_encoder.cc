@@ -4,6 +4,7 @@
 #include "tests/netcode/common.hh"
 #include "tests/netcode/launch.hh"
 
+#include "netcode/decoder.hh"
 #include "netcode/encoder.hh"
 
 /*------------------------------------------------------------------------------------------------*/
@@ -70,6 +71,58 @@ TEST_CASE("Encoder can limit the window size")
 
 /*------------------------------------------------------------------------------------------------*/
 
+TEST_CASE("Encoder can limit the window by bytes and by age")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+
+    auto evicted = std::vector<std::uint32_t>{};
+    enc.set_eviction_handler([&](std::uint32_t id){evicted.push_back(id);});
+
+    SECTION("Bytes")
+    {
+      enc.set_max_window_bytes(64);
+      enc(data(16, 'a'));
+      enc(data(32, 'b'));
+      enc(data(16, 'c'));
+      REQUIRE(enc.window() == 3);
+      REQUIRE(enc.window_bytes() == 64);
+      REQUIRE(enc.nb_evicted_sources() == 0);
+
+      // Sources 0 and 1 are evicted to make room.
+      enc(data(32, 'd'));
+      REQUIRE(enc.window() == 2);
+      REQUIRE(enc.window_bytes() == 48);
+      REQUIRE(enc.nb_evicted_sources() == 2);
+      REQUIRE(evicted == (std::vector<std::uint32_t>{0, 1}));
+
+      // The newest source is kept, even if it's too large.
+      enc(data(128, 'e'));
+      REQUIRE(enc.window() == 1);
+      REQUIRE(enc.window_bytes() == 128);
+      REQUIRE(evicted == (std::vector<std::uint32_t>{0, 1, 2, 3}));
+    }
+
+    SECTION("Age")
+    {
+      enc.set_max_source_age(std::chrono::minutes{1});
+      enc(data(16, 'a'));
+      enc(data(16, 'b'));
+      REQUIRE(not enc.poll(std::chrono::steady_clock::now()));
+      REQUIRE(enc.window() == 2);
+
+      enc.poll(std::chrono::steady_clock::now() + std::chrono::minutes{2});
+      REQUIRE(enc.window() == 0);
+      REQUIRE(enc.nb_evicted_sources() == 2);
+      REQUIRE(evicted == (std::vector<std::uint32_t>{0, 1}));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 TEST_CASE("Encoder generates repairs")
 {
   launch([](std::uint8_t gf_size)
@@ -447,3 +500,539 @@ TEST_CASE("Encoder adapts rate automatically")
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder sends on-demand repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100).set_on_demand_repairs(true);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+    dec.set_ack_period(std::chrono::milliseconds{0}).set_deficit_feedback(true);
+
+    auto& enc_handler = enc.packet_handler();
+    auto& dec_handler = dec.packet_handler();
+
+    for (auto i = 0u; i < 10; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+    REQUIRE(enc.nb_sent_repairs() == 0);
+
+    // Sources 3, 4 and 8 are lost.
+    for (auto i = 0u; i < 10; ++i)
+    {
+      if (i != 3 and i != 4 and i != 8)
+      {
+        dec(enc_handler[i]);
+      }
+    }
+    REQUIRE(dec.data_handler().nb_data() == 3);
+
+    dec.generate_ack();
+    enc(dec_handler[0]);
+
+    // One repair for each source of the first cluster and one for the second cluster.
+    REQUIRE(enc.nb_sent_repairs() == 3);
+    REQUIRE(enc.window() == 3);
+    for (auto i = 10u; i < 13; ++i)
+    {
+      REQUIRE(detail::get_packet_type(enc_handler[i]) == detail::packet_type::repair);
+      dec(enc_handler[i]);
+    }
+    REQUIRE(dec.nb_decoded() == 3);
+    REQUIRE(dec.data_handler().nb_data() == 10);
+    for (auto i = 0u; i < 10; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Binary encoder sends distinct on-demand repairs")
+{
+  encoder<packet_handler> enc{1, packet_handler{}};
+  enc.set_rate(100).set_on_demand_repairs(true);
+
+  decoder<packet_handler, data_handler> dec{1, in_order::yes, packet_handler{}, data_handler{}};
+  dec.set_ack_period(std::chrono::milliseconds{0}).set_deficit_feedback(true);
+
+  auto& enc_handler = enc.packet_handler();
+  auto& dec_handler = dec.packet_handler();
+
+  for (auto i = 0u; i < 6; ++i)
+  {
+    enc(data(16, static_cast<char>('a' + i)));
+  }
+
+  // Sources 2 and 3 are lost.
+  for (auto i = 0u; i < 6; ++i)
+  {
+    if (i != 2 and i != 3)
+    {
+      dec(enc_handler[i]);
+    }
+  }
+  dec.generate_ack();
+  enc(dec_handler[0]);
+
+  // With coefficients which are all 1, the same sum of both sources couldn't rebuild them.
+  REQUIRE(enc.nb_sent_repairs() == 2);
+  dec(enc_handler[6]);
+  dec(enc_handler[7]);
+  REQUIRE(dec.nb_decoded() == 2);
+  REQUIRE(dec.data_handler().nb_data() == 6);
+  for (auto i = 0u; i < 6; ++i)
+  {
+    REQUIRE(dec.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder generates repairs for a subset of sources")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::no, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+
+    for (auto i = 0u; i < 8; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+
+    // Sources 2 and 5 are lost.
+    for (auto i = 0u; i < 8; ++i)
+    {
+      if (i != 2 and i != 5)
+      {
+        dec(enc_handler[i]);
+      }
+    }
+    REQUIRE(dec.data_handler().nb_data() == 6);
+
+    // No source in this range.
+    REQUIRE(not enc.generate_repair(10, 20));
+    REQUIRE(not enc.generate_repair(std::vector<std::uint32_t>{11, 12}));
+    REQUIRE(enc.nb_sent_repairs() == 0);
+
+    REQUIRE(enc.generate_repair(1, 3));
+    REQUIRE(enc.generate_repair(std::vector<std::uint32_t>{5}));
+    REQUIRE(enc.nb_sent_repairs() == 2);
+
+    dec(enc_handler[8]);
+    dec(enc_handler[9]);
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 8);
+    REQUIRE(dec.data_handler()[6] == std::vector<char>(16, 'c'));
+    REQUIRE(dec.data_handler()[7] == std::vector<char>(16, 'f'));
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder sends repairs periodically")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    using namespace std::chrono;
+
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+
+    // Without repair period, there's no need to poll.
+    enc(data(16, 'a'));
+    REQUIRE(enc.next_deadline() == steady_clock::time_point::max());
+    REQUIRE(not enc.poll(steady_clock::now() + hours{1}));
+
+    enc.set_repair_period(minutes{1});
+    const auto deadline = enc.next_deadline();
+    REQUIRE(deadline != steady_clock::time_point::max());
+    REQUIRE(deadline <= steady_clock::now() + minutes{1});
+
+    // A new source doesn't delay the deadline.
+    enc(data(16, 'b'));
+    REQUIRE(enc.next_deadline() == deadline);
+
+    REQUIRE(not enc.poll(deadline - seconds{1}));
+    REQUIRE(enc.nb_sent_repairs() == 0);
+    REQUIRE(enc.poll(deadline));
+    REQUIRE(enc.nb_sent_repairs() == 1);
+    REQUIRE(detail::get_packet_type(enc.packet_handler()[2]) == detail::packet_type::repair);
+
+    // All sources are protected.
+    REQUIRE(enc.next_deadline() == steady_clock::time_point::max());
+    REQUIRE(not enc.poll(deadline + hours{1}));
+
+    // A new source starts a new period.
+    enc(data(16, 'c'));
+    REQUIRE(enc.next_deadline() > deadline);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder limits the coding window")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100).set_coding_window(3);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::no, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+
+    for (auto i = 0u; i < 10; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+
+    // Sources 2 and 8 are lost.
+    for (auto i = 0u; i < 10; ++i)
+    {
+      if (i != 2 and i != 8)
+      {
+        dec(enc_handler[i]);
+      }
+    }
+
+    // The repair only encodes the last 3 sources, but older sources are still in the window.
+    enc.generate_repair();
+    REQUIRE(enc.window() == 10);
+    auto h = packet_handler{};
+    auto reader = detail::packetizer<packet_handler>{h};
+    const auto r = reader.read_repair(packet{enc_handler[10]}).first;
+    REQUIRE(r.source_ids() == (detail::source_id_list{7, 8, 9}));
+    REQUIRE(r.window_start() == 0);
+
+    dec(enc_handler[10]);
+    REQUIRE(dec.nb_decoded() == 1);
+
+    // Source 2 can still be repaired with a targeted repair.
+    REQUIRE(enc.generate_repair(2, 2));
+    dec(enc_handler[11]);
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 10);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder sends sparse repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100).set_density(0.5);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+
+    for (auto i = 0u; i < 20; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+
+    // Sources 5 and 12 are lost.
+    for (auto i = 0u; i < 20; ++i)
+    {
+      if (i != 5 and i != 12)
+      {
+        dec(enc_handler[i]);
+      }
+    }
+
+    // Send repairs until both sources are rebuilt.
+    for (auto i = 0u; i < 20 and dec.data_handler().nb_data() != 20; ++i)
+    {
+      enc.generate_repair();
+      dec(enc_handler[20 + i]);
+    }
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 20);
+    for (auto i = 0u; i < 20; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder uses seeded coefficients")
+{
+  // A 32 bits field always uses arithmetic coefficients.
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    for (auto gen : {coefficient_generator::xorshift, coefficient_generator::cauchy})
+    {
+      encoder<packet_handler> enc{gf_size, packet_handler{}};
+      enc.set_rate(100).set_coefficients(gen);
+      REQUIRE(enc.coefficients() == gen);
+
+      decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                               , data_handler{}};
+
+      auto& enc_handler = enc.packet_handler();
+
+      for (auto i = 0u; i < 6; ++i)
+      {
+        enc(data(16, static_cast<char>('a' + i)));
+      }
+
+      // Sources 1, 2 and 4 are lost.
+      for (auto i : {0u, 3u, 5u})
+      {
+        dec(enc_handler[i]);
+      }
+
+      // Send repairs until all sources are rebuilt.
+      auto nb_repairs = 0u;
+      for (; nb_repairs < 10 and dec.data_handler().nb_data() != 6; ++nb_repairs)
+      {
+        enc.generate_repair();
+        dec(enc_handler[6 + nb_repairs]);
+      }
+      REQUIRE(dec.data_handler().nb_data() == 6);
+      for (auto i = 0u; i < 6; ++i)
+      {
+        REQUIRE(dec.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+      }
+      if (gen == coefficient_generator::cauchy)
+      {
+        // A Cauchy matrix is always invertible.
+        REQUIRE(nb_repairs == 3);
+        REQUIRE(dec.nb_failed_full_decodings() == 0);
+      }
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Binary encoder")
+{
+  encoder<packet_handler> enc{1, packet_handler{}};
+  enc.set_rate(100);
+  REQUIRE(enc.density() == 0.5);
+
+  decoder<packet_handler, data_handler> dec{1, in_order::yes, packet_handler{}, data_handler{}};
+
+  auto& enc_handler = enc.packet_handler();
+
+  for (auto i = 0u; i < 20; ++i)
+  {
+    enc(data(37, static_cast<char>('a' + i)));
+  }
+
+  // Sources 3, 4 and 15 are lost.
+  for (auto i = 0u; i < 20; ++i)
+  {
+    if (i != 3 and i != 4 and i != 15)
+    {
+      dec(enc_handler[i]);
+    }
+  }
+
+  // Send repairs until all sources are rebuilt.
+  for (auto i = 0u; i < 20 and dec.data_handler().nb_data() != 20; ++i)
+  {
+    enc.generate_repair();
+    dec(enc_handler[20 + i]);
+  }
+  REQUIRE(dec.nb_decoded() == 3);
+  REQUIRE(dec.data_handler().nb_data() == 20);
+  for (auto i = 0u; i < 20; ++i)
+  {
+    REQUIRE(dec.data_handler()[i] == std::vector<char>(37, static_cast<char>('a' + i)));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder uses a block code")
+{
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_block_code(4, 2);
+
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+
+    for (auto i = 0u; i < 10; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+    // Two complete blocks, each followed by its 2 repairs, then 2 sources of the third block.
+    REQUIRE(enc.nb_sent_sources() == 10);
+    REQUIRE(enc.nb_sent_repairs() == 4);
+    REQUIRE(enc.window() == 2);
+    REQUIRE(enc_handler.nb_packets() == 14);
+    // The sources of the first two blocks were never acknowledged.
+    REQUIRE(enc.nb_evicted_sources() == 8);
+
+    // Close the last block.
+    enc.generate_repair();
+    REQUIRE(enc.nb_sent_repairs() == 6);
+
+    // 2 packets are lost in each block:
+    // - sources 1 and 3 in the first block;
+    // - source 6 and the first repair in the second block;
+    // - source 9 and the second repair in the last block.
+    for (auto i : {0u, 2u, 4u, 5u, 6u, 7u, 9u, 11u, 12u, 14u})
+    {
+      dec(enc_handler[i]);
+    }
+    REQUIRE(dec.data_handler().nb_data() == 10);
+    for (auto i = 0u; i < 10; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+    }
+    REQUIRE(dec.nb_failed_full_decodings() == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder sends fountain repairs")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(1000).set_fountain(true);
+
+    // Two decoders with different losses receive the same repairs.
+    decoder<packet_handler, data_handler> dec0{ gf_size, in_order::yes, packet_handler{}
+                                              , data_handler{}};
+    decoder<packet_handler, data_handler> dec1{ gf_size, in_order::yes, packet_handler{}
+                                              , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+
+    for (auto i = 0u; i < 30; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+
+    for (auto i = 0u; i < 30; ++i)
+    {
+      if (i % 7 != 3)
+      {
+        dec0(enc_handler[i]);
+      }
+      if (i % 5 != 1)
+      {
+        dec1(enc_handler[i]);
+      }
+    }
+
+    for ( auto i = 0u
+        ; i < 200 and (dec0.data_handler().nb_data() != 30 or dec1.data_handler().nb_data() != 30)
+        ; ++i)
+    {
+      enc.generate_repair();
+      dec0(enc_handler[30 + i]);
+      dec1(enc_handler[30 + i]);
+    }
+    REQUIRE(dec0.data_handler().nb_data() == 30);
+    REQUIRE(dec1.data_handler().nb_data() == 30);
+    for (auto i = 0u; i < 30; ++i)
+    {
+      REQUIRE(dec0.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+      REQUIRE(dec1.data_handler()[i] == std::vector<char>(16, static_cast<char>('a' + i)));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder computes repairs asynchronously")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    for (const auto density : {1.0, 0.5})
+    {
+      encoder<packet_handler> sync{gf_size, packet_handler{}};
+      encoder<packet_handler> async{gf_size, packet_handler{}};
+      for (auto enc : {&sync, &async})
+      {
+        enc->set_rate(3).set_coding_window(20).set_density(density);
+      }
+      async.set_async_repairs(true);
+      REQUIRE(async.async_repairs());
+
+      // Acks remove sources which repairs being computed still read.
+      decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                               , data_handler{}};
+      for (auto i = 0u; i < 200; ++i)
+      {
+        // Sizes are multiples of 4, as required by 32 bits fields.
+        const auto d = data(static_cast<std::size_t>(16 + 4 * (i % 12)), static_cast<char>(i));
+        sync(d);
+        async(d);
+        if (i % 25 == 24)
+        {
+          for ( auto j = dec.nb_received_sources() + dec.nb_received_repairs()
+              ; j < sync.packet_handler().nb_packets(); ++j)
+          {
+            dec(sync.packet_handler()[j]);
+          }
+          dec.generate_ack();
+          const auto& ack = dec.packet_handler()[dec.packet_handler().nb_packets() - 1];
+          sync(ack);
+          async(ack);
+        }
+      }
+      async.wait_repairs();
+      REQUIRE(async.nb_pending_repairs() == 0);
+
+      // Sources and repairs are the same, only when repairs are sent differs.
+      REQUIRE(async.nb_sent_repairs() == sync.nb_sent_repairs());
+      const auto split = [](const packet_handler& h, detail::packet_type type)
+      {
+        auto res = std::vector<packet>{};
+        for (auto j = 0u; j < h.nb_packets(); ++j)
+        {
+          if (detail::get_packet_type(h[j]) == type)
+          {
+            res.push_back(h[j]);
+          }
+        }
+        return res;
+      };
+      for (const auto type : {detail::packet_type::source, detail::packet_type::repair})
+      {
+        const auto expected = split(sync.packet_handler(), type);
+        const auto got = split(async.packet_handler(), type);
+        REQUIRE(got.size() == expected.size());
+        for (auto j = 0u; j < expected.size(); ++j)
+        {
+          REQUIRE(got[j].size() == expected[j].size());
+          REQUIRE(std::equal(got[j].begin(), got[j].end(), expected[j].begin()));
+        }
+      }
+
+      async.set_async_repairs(false);
+      REQUIRE(not async.async_repairs());
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,193 @@
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/multipath.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Multipath encoder learns the losses of paths")
+{
+  multipath_encoder<packet_handler> enc{8, {packet_handler{}, packet_handler{}}};
+  enc.encoder().set_rate(4);
+  REQUIRE(enc.nb_paths() == 2);
+
+  decoder<packet_handler, data_handler> dec{8, in_order::no, packet_handler{}, data_handler{}};
+  dec.set_ack_period(std::chrono::milliseconds{0});
+  dec.set_ack_nb_packets(8);
+
+  // Without any feedback, both paths are used evenly.
+  for (auto i = 0u; i < 4; ++i)
+  {
+    enc(data(32, 'x'));
+  }
+  REQUIRE(enc.nb_sent_sources(0) == 2);
+  REQUIRE(enc.nb_sent_sources(1) == 2);
+
+  // Every other packet is lost on path 1.
+  auto sent = std::vector<std::size_t>(enc.nb_paths(), 0);
+  auto nb_acks = 0ul;
+  auto deliver = [&]
+  {
+    for (auto p = 0ul; p < enc.nb_paths(); ++p)
+    {
+      for (; sent[p] < enc.path(p).nb_packets(); ++sent[p])
+      {
+        if (p == 0 or sent[p] % 2 == 0)
+        {
+          dec(enc.path(p)[sent[p]], p);
+        }
+      }
+    }
+    for (; nb_acks < dec.packet_handler().nb_packets(); ++nb_acks)
+    {
+      enc(dec.packet_handler()[nb_acks]);
+    }
+  };
+  deliver();
+
+  for (auto i = 0u; i < 400; ++i)
+  {
+    enc(data(32, static_cast<char>('a' + i % 26)));
+    deliver();
+  }
+
+  REQUIRE(enc.loss(0) < 0.1);
+  REQUIRE(enc.loss(1) > 0.3);
+  // Measured round-trip times weigh on the scheduling, thus the share varies a bit between runs.
+  REQUIRE(enc.loss_share(1) > 0.8);
+  REQUIRE(enc.nb_sent_sources(0) > enc.nb_sent_sources(1));
+  REQUIRE(enc.nb_sent_repairs(0) > 2 * enc.nb_sent_repairs(1));
+  REQUIRE(enc.rtt(0) != std::chrono::steady_clock::duration::zero());
+
+  // The encoder got the acks read for the paths.
+  REQUIRE(enc.encoder().nb_received_acks() == nb_acks);
+  REQUIRE(enc.encoder().window() < 16);
+
+  // The decoder received packets of both paths.
+  REQUIRE(dec.nb_decoded() > 0);
+  REQUIRE(dec.nb_received_sources() > 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Multipath encoder with a session")
+{
+  multipath_encoder<packet_handler> enc{8, {packet_handler{}, packet_handler{}}};
+  enc.encoder().set_rate(4);
+  enc.encoder().set_session(7);
+
+  decoder<packet_handler, data_handler> dec{8, in_order::no, packet_handler{}, data_handler{}};
+  dec.set_session(7);
+  dec.set_ack_period(std::chrono::milliseconds{0});
+  dec.set_ack_nb_packets(3);
+
+  // The session flag doesn't make sources look like repairs.
+  for (auto i = 0u; i < 4; ++i)
+  {
+    enc(data(32, 'x'));
+  }
+  REQUIRE(enc.nb_sent_sources(0) == 2);
+  REQUIRE(enc.nb_sent_sources(1) == 2);
+  REQUIRE(enc.nb_sent_repairs(0) + enc.nb_sent_repairs(1) == 1);
+
+  // Round-trip times are sampled from the sources acked by the decoder.
+  for (auto p = 0ul; p < enc.nb_paths(); ++p)
+  {
+    for (auto i = 0ul; i < enc.path(p).nb_packets(); ++i)
+    {
+      dec(enc.path(p)[i], p);
+    }
+  }
+  REQUIRE(dec.packet_handler().nb_packets() > 0);
+  for (auto i = 0ul; i < dec.packet_handler().nb_packets(); ++i)
+  {
+    enc(dec.packet_handler()[i]);
+  }
+  REQUIRE(( enc.rtt(0) != std::chrono::steady_clock::duration::zero()
+         or enc.rtt(1) != std::chrono::steady_clock::duration::zero()));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Multipath encoder credits late packets back to their path")
+{
+  multipath_encoder<packet_handler> enc{8, {packet_handler{}, packet_handler{}}};
+  enc.encoder().set_rate(4);
+
+  decoder<packet_handler, data_handler> dec{8, in_order::no, packet_handler{}, data_handler{}};
+  dec.set_ack_period(std::chrono::milliseconds{0});
+  dec.set_ack_nb_packets(1);
+
+  // Path 1 loses nothing, but delivers its packets in bursts, after several acks were sent.
+  std::size_t sent[2] = {0, 0};
+  auto nb_acks = 0ul;
+  auto max_loss = 0.0;
+  for (auto i = 0u; i < 200; ++i)
+  {
+    enc(data(32, static_cast<char>('a' + i % 26)));
+    for (auto p = 0u; p < 2; ++p)
+    {
+      if (p == 1 and i % 4 != 3)
+      {
+        continue;
+      }
+      for (; sent[p] < enc.path(p).nb_packets(); ++sent[p])
+      {
+        dec(enc.path(p)[sent[p]], p);
+      }
+    }
+    for (; nb_acks < dec.packet_handler().nb_packets(); ++nb_acks)
+    {
+      enc(dec.packet_handler()[nb_acks]);
+    }
+    if (i >= 100)
+    {
+      max_loss = std::max(max_loss, enc.loss(1));
+    }
+  }
+
+  REQUIRE(nb_acks > 0);
+  REQUIRE(enc.loss(0) < 0.1);
+  REQUIRE(max_loss < 0.1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Multipath encoder notices a path which delivers nothing")
+{
+  multipath_encoder<packet_handler> enc{8, {packet_handler{}, packet_handler{}}};
+  enc.encoder().set_rate(4);
+
+  decoder<packet_handler, data_handler> dec{8, in_order::no, packet_handler{}, data_handler{}};
+  dec.set_ack_period(std::chrono::milliseconds{0});
+  dec.set_ack_nb_packets(8);
+
+  // Path 1 is down, the decoder never hears of it.
+  auto sent = 0ul;
+  auto nb_acks = 0ul;
+  for (auto i = 0u; i < 200; ++i)
+  {
+    enc(data(32, static_cast<char>('a' + i % 26)));
+    for (; sent < enc.path(0).nb_packets(); ++sent)
+    {
+      dec(enc.path(0)[sent], 0);
+    }
+    for (; nb_acks < dec.packet_handler().nb_packets(); ++nb_acks)
+    {
+      enc(dec.packet_handler()[nb_acks]);
+    }
+  }
+
+  REQUIRE(nb_acks > 0);
+  REQUIRE(enc.loss(0) < 0.1);
+  REQUIRE(enc.loss(1) > 0.5);
+  REQUIRE(enc.loss_share(1) > 0.5);
+  REQUIRE(enc.nb_sent_sources(0) > enc.nb_sent_sources(1));
+}
+
+/*------------------------------------------------------------------------------------------------*/
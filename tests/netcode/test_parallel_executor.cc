@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "netcode/parallel_executor.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Executor splits a region in stripes")
+{
+  parallel_executor executor{3};
+  REQUIRE(executor.nb_workers() == 3);
+  REQUIRE(executor.threshold() == parallel_executor::default_threshold);
+
+  for (const auto len : {100ul, 5000ul, 65535ul})
+  {
+    // Catch can't check from other threads.
+    std::atomic<bool> aligned{true};
+    auto seen = std::vector<std::uint8_t>(len, 0);
+    executor(len, [&](std::size_t begin, std::size_t end)
+    {
+      if (begin >= end or begin % 64 != 0)
+      {
+        aligned.store(false);
+      }
+      for (; begin != end; ++begin)
+      {
+        seen[begin] += 1;
+      }
+    });
+    REQUIRE(aligned.load());
+    REQUIRE(std::all_of(seen.begin(), seen.end(), [](std::uint8_t x){return x == 1;}));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Executor runs each task once")
+{
+  parallel_executor executor{3};
+
+  for (const auto nb : {0ul, 1ul, 7ul, 1000ul})
+  {
+    auto seen = std::vector<std::atomic<int>>(nb);
+    for (auto& x : seen)
+    {
+      x.store(0);
+    }
+    // The first tasks are longer, thus they are stolen from the first thread.
+    executor.for_each(nb, [&](std::size_t task)
+    {
+      if (task < nb / 4)
+      {
+        std::this_thread::yield();
+      }
+      seen[task].fetch_add(1);
+    });
+    REQUIRE(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& x){return x == 1;}));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Executor shared by several threads")
+{
+  parallel_executor executor{2};
+
+  // When the executor is busy, the other thread computes its operation alone.
+  const auto run = [&](bool& ok)
+  {
+    ok = true;
+    for (auto i = 0; i < 200; ++i)
+    {
+      std::atomic<std::size_t> sum{0};
+      executor.for_each(100, [&](std::size_t task){sum.fetch_add(task);});
+      ok = ok and sum.load() == 4950;
+
+      auto seen = std::vector<char>(10000, 0);
+      executor(seen.size(), [&](std::size_t begin, std::size_t end)
+      {
+        std::fill( seen.begin() + static_cast<std::ptrdiff_t>(begin)
+                 , seen.begin() + static_cast<std::ptrdiff_t>(end), 1);
+      });
+      ok = ok and std::count(seen.begin(), seen.end(), 1) == 10000;
+    }
+  };
+  auto other_ok = false;
+  std::thread other{[&]{run(other_ok);}};
+  auto ok = false;
+  run(ok);
+  other.join();
+  REQUIRE(ok);
+  REQUIRE(other_ok);
+}
+
+/*------------------------------------------------------------------------------------------------*/
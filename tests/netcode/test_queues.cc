@@ -0,0 +1,244 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/mpsc_queue.hh"
+#include "netcode/pooled_queue.hh"
+#include "netcode/spsc_queue.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("SPSC queue is bounded and ordered")
+{
+  spsc_queue<packet> q{4};
+  REQUIRE(q.capacity() == 4);
+
+  auto p = packet{};
+  REQUIRE(not q.try_pop(p));
+  for (auto i = 0; i < 4; ++i)
+  {
+    REQUIRE(q.try_push(packet{static_cast<char>(i)}));
+  }
+  auto last = packet{'x'};
+  REQUIRE(not q.try_push(std::move(last)));
+  REQUIRE(last.size() == 1); // Left untouched.
+
+  for (auto i = 0; i < 6; ++i)
+  {
+    REQUIRE(q.try_pop(p));
+    REQUIRE(p[0] == static_cast<char>(i));
+    REQUIRE(q.try_push(packet{static_cast<char>(i + 4)}));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("MPSC queue is bounded and ordered")
+{
+  mpsc_queue<data> q{4};
+  REQUIRE(q.capacity() == 4);
+
+  auto d = data{};
+  REQUIRE(not q.try_pop(d));
+  for (auto i = 0; i < 4; ++i)
+  {
+    REQUIRE(q.try_push(data(10, static_cast<char>(i))));
+  }
+  auto last = data(10, 'x');
+  REQUIRE(not q.try_push(std::move(last)));
+  REQUIRE(last.size() == 10);
+
+  for (auto i = 0; i < 6; ++i)
+  {
+    REQUIRE(q.try_pop(d));
+    REQUIRE(d[0] == static_cast<char>(i));
+    REQUIRE(q.try_push(data(10, static_cast<char>(i + 4))));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("SPSC queue hands off values between two threads")
+{
+  const auto nb = 100000u;
+  spsc_queue<std::uint32_t> q{64};
+
+  std::thread producer{[&]
+  {
+    for (auto i = 0u; i < nb; ++i)
+    {
+      q.push(std::uint32_t{i});
+    }
+  }};
+
+  auto expected = 0u;
+  auto value = 0u;
+  while (expected != nb)
+  {
+    if (q.try_pop(value))
+    {
+      REQUIRE(value == expected);
+      ++expected;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  REQUIRE(not q.try_pop(value));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("MPSC queue keeps the order of each producer")
+{
+  const auto nb_producers = 4u;
+  const auto nb = 20000u;
+  mpsc_queue<std::uint32_t> q{64};
+
+  auto producers = std::vector<std::thread>{};
+  for (auto p = 0u; p < nb_producers; ++p)
+  {
+    producers.emplace_back([&q, p]
+    {
+      for (auto i = 0u; i < nb; ++i)
+      {
+        q.push(p << 24 | i);
+      }
+    });
+  }
+
+  auto next = std::vector<std::uint32_t>(nb_producers, 0);
+  auto value = 0u;
+  for (auto total = 0u; total != nb_producers * nb;)
+  {
+    if (q.try_pop(value))
+    {
+      const auto p = value >> 24;
+      REQUIRE(p < nb_producers);
+      REQUIRE((value & 0xffffff) == next[p]);
+      ++next[p];
+      ++total;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  for (auto& t : producers)
+  {
+    t.join();
+  }
+  REQUIRE(not q.try_pop(value));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Pooled queue re-uses memory")
+{
+  pooled_queue<packet> q{4};
+
+  auto p = q.acquire();
+  REQUIRE(p.size() == 0);
+  p.resize(1000);
+  const auto ptr = p.data();
+  q.push(std::move(p));
+
+  REQUIRE(q.try_pop(p));
+  REQUIRE(p.data() == ptr);
+  q.release(std::move(p));
+
+  p = q.acquire();
+  REQUIRE(p.data() == ptr);
+  REQUIRE(p.capacity() >= 1000);
+
+  // Nothing left to re-use.
+  REQUIRE(q.acquire().capacity() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder and decoder on their own threads")
+{
+  using handler_type = queue_packet_handler<mpsc_queue<packet>>;
+
+  const auto nb_data = 2000u;
+  handler_type::queue_type to_network{256};
+  spsc_queue<packet> to_encoder{256};
+  spsc_queue<packet> to_decoder{256};
+
+  encoder<handler_type> enc{8, handler_type{to_network}};
+  decoder<handler_type, data_handler>
+    dec{8, in_order::yes, handler_type{to_network}, data_handler{}};
+
+  // The network thread gives packets of the encoder to the decoder, and acks to the encoder.
+  std::atomic<bool> stop{false};
+  std::thread network{[&]
+  {
+    auto p = packet{};
+    while (not stop.load())
+    {
+      if (not to_network.try_pop(p))
+      {
+        std::this_thread::yield();
+      }
+      else if (detail::get_packet_type(p) == detail::packet_type::ack)
+      {
+        // Like the network, drop acks rather than waiting for a busy encoder.
+        to_encoder.try_push(std::move(p));
+      }
+      else
+      {
+        to_decoder.push(std::move(p));
+      }
+    }
+  }};
+
+  std::thread decoding{[&]
+  {
+    auto p = packet{};
+    while (dec.data_handler().nb_data() != nb_data)
+    {
+      if (to_decoder.try_pop(p))
+      {
+        dec(std::move(p));
+        dec.generate_ack();
+      }
+      else
+      {
+        std::this_thread::yield();
+      }
+    }
+  }};
+
+  auto ack = packet{};
+  for (auto i = 0u; i < nb_data; ++i)
+  {
+    enc(data(100, static_cast<char>(i)));
+    while (to_encoder.try_pop(ack))
+    {
+      enc(std::move(ack));
+    }
+  }
+  decoding.join();
+  stop.store(true);
+  network.join();
+
+  REQUIRE(dec.data_handler().nb_data() == nb_data);
+  for (auto i = 0u; i < nb_data; ++i)
+  {
+    REQUIRE(dec.data_handler()[i][0] == static_cast<char>(i));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
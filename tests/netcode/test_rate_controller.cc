@@ -0,0 +1,160 @@
+#include <chrono>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/encoder.hh"
+#include "netcode/rate_controller.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+rate_feedback
+mk_feedback(std::size_t nb_sent, std::size_t nb_received, std::size_t nb_unrecovered = 0)
+{
+  return {nb_sent, nb_received, nb_unrecovered, std::chrono::steady_clock::duration::zero()};
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Rate feedback")
+{
+  REQUIRE(mk_feedback(0, 0).loss() == 0.0);
+  REQUIRE(mk_feedback(10, 12).loss() == 0.0);
+  REQUIRE(mk_feedback(10, 5).loss() == 0.5);
+  REQUIRE(mk_feedback(10, 5, 1).residual_loss() == 0.5);
+  REQUIRE(mk_feedback(10, 9, 3).residual_loss() == Approx(0.3));
+  REQUIRE(mk_feedback(10, 0, 5).residual_loss() == 1.0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Loss rate controller")
+{
+  loss_rate_controller rc;
+  REQUIRE(rc(mk_feedback(100, 100)) == 50);
+  REQUIRE(rc(mk_feedback(100, 50)) == 1);
+  REQUIRE(rc(mk_feedback(100, 90)) == 5);
+  // Decoding failures are ignored.
+  REQUIRE(rc(mk_feedback(100, 100, 50)) == 50);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("EWMA rate controller")
+{
+  SECTION("Smoothing")
+  {
+    ewma_rate_controller rc{0.5};
+    REQUIRE(rc(mk_feedback(100, 100)) == 50);
+
+    // A single burst of losses doesn't make the rate drop as much as the loss rate controller.
+    REQUIRE(rc(mk_feedback(100, 80)) == 5);
+    REQUIRE(rc.loss() == Approx(0.1));
+    REQUIRE(rc(mk_feedback(100, 100)) == 10);
+    REQUIRE(rc.loss() == Approx(0.05));
+  }
+
+  SECTION("Decoding failures")
+  {
+    ewma_rate_controller rc{1};
+    REQUIRE(rc(mk_feedback(100, 95)) == 10);
+    // Sources lost before this ack which could not be decoded.
+    REQUIRE(rc(mk_feedback(100, 95, 20)) == 3);
+  }
+
+  SECTION("Delay")
+  {
+    ewma_rate_controller rc{1};
+    rc.set_max_delay(std::chrono::milliseconds{100});
+    auto fb = mk_feedback(100, 90);
+    fb.delay = std::chrono::milliseconds{50};
+    REQUIRE(rc(fb) == 5);
+    fb.delay = std::chrono::milliseconds{200};
+    REQUIRE(rc(fb) == 2);
+    REQUIRE(rc.delay() == std::chrono::milliseconds{200});
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Gilbert-Elliott rate controller")
+{
+  gilbert_elliott_rate_controller rc{0.05, 0.5};
+  REQUIRE(rc(mk_feedback(100, 100)) == 50);
+  REQUIRE(not rc.bursty());
+
+  // A burst begins.
+  const auto r0 = rc(mk_feedback(100, 70));
+  REQUIRE(rc.bursty());
+
+  // The burst lasts, thus the channel is more likely to stay in the bad state.
+  const auto r1 = rc(mk_feedback(100, 70));
+  REQUIRE(rc.bursty());
+  REQUIRE(r1 < r0);
+
+  // The burst ends, the rate goes up again.
+  const auto r2 = rc(mk_feedback(100, 100));
+  REQUIRE(not rc.bursty());
+  REQUIRE(r2 > r1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Encoder gives feedback to its rate controller")
+{
+  launch([](std::uint8_t gf_size)
+  {
+    encoder<packet_handler, ewma_rate_controller> enc{gf_size, packet_handler{}};
+    enc.set_rate(100).set_adaptive(true);
+    enc.rate_controller() = ewma_rate_controller{1};
+
+    // Simulate decoder.
+    packet_handler h_decoder;
+    detail::packetizer<packet_handler> serializer{h_decoder};
+
+    for (auto i = 0ul; i < 10; ++i)
+    {
+      enc(data(32, 'x'));
+    }
+
+    // Sources 2 and 3 are lost, but they are still waiting for a repair.
+    auto ids = detail::source_id_list{};
+    for (auto i = 0u; i < 10; ++i)
+    {
+      if (i != 2 and i != 3)
+      {
+        ids.insert(i);
+      }
+    }
+    serializer.write_ack(detail::ack{std::move(ids), 8});
+    enc(packet{h_decoder[0]});
+    REQUIRE(enc.rate_controller().loss() == Approx(0.2));
+    REQUIRE(enc.rate() == 3);
+
+    // The repair is lost too: sources 2 and 3 could not be decoded.
+    enc.generate_repair();
+    enc(data(32, 'x'));
+    serializer.write_ack(detail::ack{detail::source_id_list{10}, 1});
+    enc(packet{h_decoder[1]});
+    REQUIRE(enc.rate_controller().loss() == Approx(1.0));
+    REQUIRE(enc.rate() == 1);
+
+    // Sources 2 and 3 are not counted twice. With a rate of 1, source 11 is followed by a repair.
+    enc(data(32, 'x'));
+    serializer.write_ack(detail::ack{detail::source_id_list{11}, 2});
+    enc(packet{h_decoder[2]});
+    REQUIRE(enc.rate_controller().loss() == Approx(0.0));
+    REQUIRE(enc.rate() == 50);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,251 @@
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+#include "tests/netcode/launch.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/recoder.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Recoder forwards sources and recodes repairs")
+{
+  launch({1, 4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(5);
+    enc.set_density(1);
+
+    recoder<packet_handler> rec{gf_size, packet_handler{}};
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    auto& enc_handler = enc.packet_handler();
+    auto& rec_handler = rec.packet_handler();
+
+    // Sizes are even, as required by 16 bits fields.
+    for (auto i = 0u; i < 10; ++i)
+    {
+      enc(data(20 + 2 * i, static_cast<char>('a' + i)));
+    }
+    // 10 sources and 2 repairs.
+    REQUIRE(enc_handler.nb_packets() == 12);
+
+    // Source 2 is lost between the encoder and the recoder.
+    for (auto i = 0u; i < enc_handler.nb_packets(); ++i)
+    {
+      if (i != 2)
+      {
+        rec(enc_handler[i]);
+      }
+    }
+    REQUIRE(rec.nb_received_sources() == 9);
+    REQUIRE(rec.nb_received_repairs() == 2);
+    REQUIRE(rec.nb_sent_repairs() == 2);
+    REQUIRE(rec_handler.nb_packets() == 11);
+
+    // Source 7 is lost between the recoder and the decoder.
+    for (auto i = 0u; i < rec_handler.nb_packets(); ++i)
+    {
+      if (i != 7)
+      {
+        dec(rec_handler[i]);
+      }
+    }
+
+    // Binary coefficients might give a useless combination, ask for more.
+    for (auto i = 0u; i < 8 and dec.data_handler().nb_data() != 10; ++i)
+    {
+      REQUIRE(rec.generate_repair());
+      dec(rec_handler[rec_handler.nb_packets() - 1]);
+    }
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 10);
+    for (auto i = 0u; i < 10; ++i)
+    {
+      REQUIRE(dec.data_handler()[i] == std::vector<char>(20 + 2 * i, static_cast<char>('a' + i)));
+    }
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Recoder drops what the encoder no longer holds")
+{
+  encoder<packet_handler> enc{8, packet_handler{}};
+  enc.set_rate(2);
+  enc.set_window_size(2);
+
+  recoder<packet_handler> rec{8, packet_handler{}};
+  REQUIRE(not rec.generate_repair());
+
+  auto& enc_handler = enc.packet_handler();
+  for (auto i = 0u; i < 6; ++i)
+  {
+    enc(data(8, 'x'));
+  }
+
+  // Repairs are lost, only sources reach the recoder. They are all kept.
+  for (auto i = 0u; i < enc_handler.nb_packets(); i += 3)
+  {
+    rec(enc_handler[i]);
+    rec(enc_handler[i + 1]);
+  }
+  REQUIRE(rec.window() == 6);
+
+  // A repair brings the start of the encoder's window.
+  rec(enc_handler[enc_handler.nb_packets() - 1]);
+  REQUIRE(rec.window() == 2);
+  REQUIRE(rec.nb_sent_repairs() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Recoder doesn't move the window of the encoder")
+{
+  encoder<packet_handler> enc{8, packet_handler{}};
+  enc.set_rate(2);
+
+  recoder<packet_handler> rec{8, packet_handler{}};
+
+  // Sources 0 and 2 are lost, the recoder doesn't know the encoder still holds source 0.
+  auto& enc_handler = enc.packet_handler();
+  for (auto i = 0u; i < 4; ++i)
+  {
+    enc(data(8, 'x'));
+  }
+  rec(enc_handler[1]);
+  rec(enc_handler[4]);
+  REQUIRE(rec.generate_repair());
+
+  // Only the encoder's window start tells the decoder which sources are gone.
+  auto& rec_handler = rec.packet_handler();
+  auto h = packet_handler{};
+  auto reader = detail::packetizer<packet_handler>{h};
+  const auto r = reader.read_repair(packet{rec_handler[rec_handler.nb_packets() - 1]}).first;
+  REQUIRE(*r.source_ids().begin() > 0);
+  REQUIRE(r.window_start() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Recoder puts its session in recoded repairs")
+{
+  encoder<packet_handler> enc{8, packet_handler{}};
+  enc.set_rate(2);
+  enc.set_session(42);
+
+  recoder<packet_handler> rec{8, packet_handler{}};
+  REQUIRE(not rec.session());
+  rec.set_session(42);
+  REQUIRE(*rec.session() == 42);
+
+  // 2 sources and 1 repair.
+  auto& enc_handler = enc.packet_handler();
+  enc(data(8, 'x'));
+  enc(data(8, 'y'));
+  for (auto i = 0u; i < enc_handler.nb_packets(); ++i)
+  {
+    rec(enc_handler[i]);
+  }
+
+  // Forwarded sources keep the encoder's session, as well as the recoded repair.
+  auto& rec_handler = rec.packet_handler();
+  REQUIRE(rec_handler.nb_packets() == 3);
+  for (auto i = 0u; i < rec_handler.nb_packets(); ++i)
+  {
+    REQUIRE(detail::has_session(rec_handler[i]));
+    REQUIRE(detail::get_session(rec_handler[i]) == 42);
+  }
+  REQUIRE(detail::get_packet_type(rec_handler[2]) == detail::packet_type::repair);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder gets distinct repairs from two recoders")
+{
+  launch({4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    encoder<packet_handler> enc{gf_size, packet_handler{}};
+    enc.set_rate(100);
+
+    recoder<packet_handler> rec0{gf_size, packet_handler{}, 1};
+    recoder<packet_handler> rec1{gf_size, packet_handler{}, 2};
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::no, packet_handler{}
+                                             , data_handler{}};
+
+    // Both recoders receive the same packets.
+    auto& enc_handler = enc.packet_handler();
+    for (auto i = 0u; i < 6; ++i)
+    {
+      enc(data(16, static_cast<char>('a' + i)));
+    }
+    enc.generate_repair();
+    for (auto i = 0u; i < enc_handler.nb_packets(); ++i)
+    {
+      rec0(enc_handler[i]);
+      rec1(enc_handler[i]);
+    }
+    REQUIRE(rec0.nb_sent_repairs() == 1);
+    REQUIRE(rec1.nb_sent_repairs() == 1);
+
+    // Sources 2 and 3 are lost, each recoder brings one of the repairs needed.
+    auto& handler0 = rec0.packet_handler();
+    auto& handler1 = rec1.packet_handler();
+    for (auto i = 0u; i < 6; ++i)
+    {
+      if (i != 2 and i != 3)
+      {
+        dec(handler0[i]);
+      }
+    }
+    dec(handler0[handler0.nb_packets() - 1]);
+    dec(handler1[handler1.nb_packets() - 1]);
+    REQUIRE(dec.nb_decoded() == 2);
+    REQUIRE(dec.data_handler().nb_data() == 6);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Decoder and recoder reject forged recoded repairs")
+{
+  launch({1, 4, 8, 16}, [](std::uint8_t gf_size)
+  {
+    recoder<packet_handler> rec{gf_size, packet_handler{}};
+    decoder<packet_handler, data_handler> dec{ gf_size, in_order::yes, packet_handler{}
+                                             , data_handler{}};
+
+    auto h = packet_handler{};
+    auto writer = detail::packetizer<packet_handler>{h};
+    detail::encoder_repair r{ 1u << 31, 16, {0, 1}, detail::zero_byte_buffer(16, 'x')};
+    r.generator() = coefficient_generator::recoded;
+
+    // A coefficient which is 0, or which doesn't belong to the field.
+    for (const auto c : {0u, 1u << gf_size})
+    {
+      r.coefficients() = {{0, 1}, {1, c}};
+      writer.write_repair(r);
+      const auto& forged = h[h.nb_packets() - 1];
+      REQUIRE_THROWS_AS(dec(forged), overflow_error);
+      REQUIRE_THROWS_AS(rec(forged), overflow_error);
+    }
+
+    // An unknown generator, which is the last byte of a repair without coefficients.
+    r.generator() = coefficient_generator::arithmetic;
+    writer.write_repair(r);
+    auto forged = h[h.nb_packets() - 1];
+    forged[forged.size() - 1] = 42;
+    REQUIRE_THROWS_AS(dec(forged), packet_type_error);
+    REQUIRE_THROWS_AS(rec(forged), packet_type_error);
+
+    REQUIRE(dec.nb_decoded() == 0);
+    REQUIRE(rec.nb_sent_repairs() == 0);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,114 @@
+#include <memory>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/decoder.hh"
+#include "netcode/encoder.hh"
+#include "netcode/session_table.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+namespace /* unnamed */ {
+
+using encoder_type = encoder<packet_handler>;
+using decoder_type = decoder<packet_handler, data_handler>;
+using table_type = session_table<encoder_type, decoder_type>;
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table stores sessions")
+{
+  table_type table{4};
+  REQUIRE(table.empty());
+
+  for (auto i = 0u; i < 1000; ++i)
+  {
+    table.insert(i * 7, std::unique_ptr<encoder_type>{new encoder_type{8, packet_handler{}}}, {});
+  }
+  REQUIRE(table.size() == 1000);
+  REQUIRE(*table.find(7 * 10)->encoder->session() == 7u * 10);
+  REQUIRE(table.find(7 * 10)->decoder == nullptr);
+  REQUIRE(table.find(1) == nullptr);
+
+  // Removing sessions doesn't hide the other ones.
+  for (auto i = 0u; i < 1000; i += 2)
+  {
+    REQUIRE(table.erase(i * 7));
+  }
+  REQUIRE(not table.erase(0));
+  REQUIRE(table.size() == 500);
+  for (auto i = 0u; i < 1000; ++i)
+  {
+    REQUIRE((table.find(i * 7) != nullptr) == (i % 2 == 1));
+  }
+
+  auto nb = 0ul;
+  table.for_each([&](std::uint32_t id, table_type::session& s)
+  {
+    REQUIRE(*s.encoder->session() == id);
+    ++nb;
+  });
+  REQUIRE(nb == 500);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("Session table dispatches packets of several flows")
+{
+  table_type sender;
+  table_type receiver;
+  for (auto id : {3u, 1u << 30})
+  {
+    std::unique_ptr<encoder_type> enc{new encoder_type{8, packet_handler{}}};
+    enc->set_rate(2);
+    std::unique_ptr<decoder_type> dec{new decoder_type{ 8, in_order::yes, packet_handler{}
+                                                      , data_handler{}}};
+    sender.insert(id, std::move(enc), {});
+    receiver.insert(id, {}, std::move(dec));
+  }
+
+  auto& enc0 = *sender.find(3)->encoder;
+  auto& enc1 = *sender.find(1u << 30)->encoder;
+  enc0(data(16, 'a'));
+  enc1(data(16, 'b'));
+  enc0(data(16, 'c'));
+
+  // Packets of both flows go through the same receiver table, source 0 of flow 0 is lost.
+  for (auto i = 1ul; i < enc0.packet_handler().nb_packets(); ++i)
+  {
+    receiver(enc0.packet_handler()[i]);
+  }
+  for (auto i = 0ul; i < enc1.packet_handler().nb_packets(); ++i)
+  {
+    receiver(enc1.packet_handler()[i]);
+  }
+
+  auto& dec0 = *receiver.find(3)->decoder;
+  auto& dec1 = *receiver.find(1u << 30)->decoder;
+  REQUIRE(dec0.data_handler().nb_data() == 2);
+  REQUIRE(dec0.data_handler()[0] == std::vector<char>(16, 'a'));
+  REQUIRE(dec0.data_handler()[1] == std::vector<char>(16, 'c'));
+  REQUIRE(dec1.data_handler().nb_data() == 1);
+  REQUIRE(dec1.data_handler()[0] == std::vector<char>(16, 'b'));
+
+  // Acks go back to the right encoder.
+  dec0.generate_ack();
+  sender(dec0.packet_handler()[0]);
+  REQUIRE(enc0.nb_received_acks() == 1);
+  REQUIRE(enc1.nb_received_acks() == 0);
+
+  // Packets of an unknown session, without session, or with no one to process them are rejected.
+  REQUIRE_THROWS_AS(sender(enc0.packet_handler()[1]), packet_type_error);
+  receiver.erase(3);
+  REQUIRE_THROWS_AS(receiver(enc0.packet_handler()[1]), unknown_session_error);
+  encoder_type enc{8, packet_handler{}};
+  enc(data(16, 'x'));
+  REQUIRE_THROWS_AS(receiver(enc.packet_handler()[0]), packet_type_error);
+}
+
+/*------------------------------------------------------------------------------------------------*/
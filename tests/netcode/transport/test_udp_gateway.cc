@@ -0,0 +1,335 @@
+#include <map>
+#include <memory>
+#include <set>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/transport/udp_gateway.hh"
+#include "netcode/transport/udp_transport.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief Send decoded data back to the peer, through the encoder of its session
+struct echo_handler
+{
+  using encoder_type = udp_gateway<echo_handler>::encoder_type;
+
+  encoder_type* encoder;
+  std::size_t nb_data;
+
+  void
+  operator()(const char* d, std::size_t len)
+  {
+    ++nb_data;
+    (*encoder)(data(d, d + len));
+  }
+};
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP gateway shards many flows over workers")
+{
+  using gateway_type = udp_gateway<echo_handler>;
+  using transport = udp_transport<data_handler>;
+
+  const auto nb_flows = 64u;
+  const auto nb_data = 20u;
+
+  gateway_type gateway{ "127.0.0.1", 0, 4, 8, in_order::no
+                      , [](std::size_t, std::uint32_t, gateway_type::encoder_type& enc)
+                        {
+                          return echo_handler{&enc, 0};
+                        }};
+  gateway.start();
+
+  // Each flow is a peer with its own socket and session.
+  auto flows = std::vector<std::unique_ptr<transport>>{};
+  for (auto i = 0u; i < nb_flows; ++i)
+  {
+    udp_socket socket{"127.0.0.1", 0};
+    socket.connect("127.0.0.1", gateway.port());
+    flows.emplace_back(new transport{std::move(socket), 8, in_order::no, data_handler{}});
+    flows.back()->set_session(1000 + i);
+  }
+  for (auto j = 0u; j < nb_data; ++j)
+  {
+    for (auto i = 0u; i < nb_flows; ++i)
+    {
+      (*flows[i])(data(100, static_cast<char>(i + j)));
+      flows[i]->flush();
+    }
+  }
+
+  // Wait for all echoes.
+  const auto done = [&]
+  {
+    for (const auto& f : flows)
+    {
+      if (f->decoder().data_handler().nb_data() != nb_data)
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+  for (auto k = 0u; k < 200 and not done(); ++k)
+  {
+    for (auto& f : flows)
+    {
+      // A burst can overflow the buffer of a worker socket, losing the last sources with the
+      // repair that protects them: keep sending repairs until the echoes are back.
+      if (f->decoder().data_handler().nb_data() != nb_data)
+      {
+        f->encoder().generate_repair();
+      }
+      f->poll(std::chrono::milliseconds{0});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+  }
+  gateway.stop();
+  REQUIRE(done());
+  for (auto i = 0u; i < nb_flows; ++i)
+  {
+    for (auto j = 0u; j < nb_data; ++j)
+    {
+      const auto& d = flows[i]->decoder().data_handler()[j];
+      REQUIRE(d.size() == 100);
+    }
+  }
+
+  // Each session lives in exactly one worker, and flows are spread over several workers.
+  auto sessions = std::map<std::uint32_t, std::size_t>{};
+  auto workers = std::set<std::size_t>{};
+  gateway.for_each_session([&](std::size_t w, std::uint32_t id, gateway_type::session_type& s)
+  {
+    REQUIRE(sessions.emplace(id, w).second);
+    REQUIRE(s.decoder->data_handler().nb_data == nb_data);
+    workers.insert(w);
+  });
+  REQUIRE(sessions.size() == nb_flows);
+  REQUIRE(sessions.begin()->first == 1000);
+  REQUIRE(workers.size() > 1);
+  REQUIRE(gateway.nb_invalid_datagrams() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP gateway drops datagrams without session")
+{
+  using gateway_type = udp_gateway<echo_handler>;
+
+  gateway_type gateway{ "127.0.0.1", 0, 2, 8, in_order::no
+                      , [](std::size_t, std::uint32_t, gateway_type::encoder_type& enc)
+                        {
+                          return echo_handler{&enc, 0};
+                        }};
+  gateway.start();
+
+  udp_socket socket{"127.0.0.1", 0};
+  socket.connect("127.0.0.1", gateway.port());
+  const auto garbage = std::vector<packet>{packet{0x01, 0x02, 0x03}, packet{'\x80', 0x00}};
+  socket.send(garbage.data(), garbage.size());
+
+  for (auto k = 0u; k < 100; ++k)
+  {
+    gateway.stop();
+    if (gateway.nb_received_datagrams() == garbage.size())
+    {
+      break;
+    }
+    gateway.start();
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+  }
+  REQUIRE(gateway.nb_received_datagrams() == garbage.size());
+  REQUIRE(gateway.nb_invalid_datagrams() == garbage.size());
+  auto nb_sessions = 0u;
+  gateway.for_each_session([&](std::size_t, std::uint32_t, gateway_type::session_type&)
+  {
+    ++nb_sessions;
+  });
+  REQUIRE(nb_sessions == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP gateway keeps apart peers with the same session")
+{
+  using gateway_type = udp_gateway<echo_handler>;
+  using transport = udp_transport<data_handler>;
+
+  gateway_type gateway{ "127.0.0.1", 0, 1, 8, in_order::yes
+                      , [](std::size_t, std::uint32_t, gateway_type::encoder_type& enc)
+                        {
+                          return echo_handler{&enc, 0};
+                        }};
+  gateway.start();
+
+  // A second peer uses the session identifier of the first one.
+  auto peers = std::vector<std::unique_ptr<transport>>{};
+  for (auto i = 0u; i < 2; ++i)
+  {
+    udp_socket socket{"127.0.0.1", 0};
+    socket.connect("127.0.0.1", gateway.port());
+    peers.emplace_back(new transport{std::move(socket), 8, in_order::yes, data_handler{}});
+    peers.back()->set_session(7);
+  }
+  const auto nb_data = 10u;
+  for (auto j = 0u; j < nb_data; ++j)
+  {
+    for (auto i = 0u; i < 2; ++i)
+    {
+      (*peers[i])(data(100, static_cast<char>('a' + i)));
+      peers[i]->flush();
+    }
+  }
+
+  const auto done = [&]
+  {
+    return peers[0]->decoder().data_handler().nb_data() == nb_data
+       and peers[1]->decoder().data_handler().nb_data() == nb_data;
+  };
+  for (auto k = 0u; k < 1000 and not done(); ++k)
+  {
+    for (auto& p : peers)
+    {
+      p->poll(std::chrono::milliseconds{0});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+  }
+  gateway.stop();
+  REQUIRE(done());
+
+  // Each peer only gets its own echoes.
+  for (auto i = 0u; i < 2; ++i)
+  {
+    for (auto j = 0u; j < nb_data; ++j)
+    {
+      REQUIRE( peers[i]->decoder().data_handler()[j]
+            == std::vector<char>(100, static_cast<char>('a' + i)));
+    }
+  }
+  auto nb_sessions = 0u;
+  gateway.for_each_session([&](std::size_t, std::uint32_t id, gateway_type::session_type& s)
+  {
+    REQUIRE(id == 7);
+    REQUIRE(s.decoder->data_handler().nb_data == nb_data);
+    ++nb_sessions;
+  });
+  REQUIRE(nb_sessions == 2);
+  REQUIRE(gateway.nb_invalid_datagrams() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP gateway removes idle sessions")
+{
+  using gateway_type = udp_gateway<echo_handler>;
+  using transport = udp_transport<data_handler>;
+
+  gateway_type gateway{ "127.0.0.1", 0, 1, 8, in_order::no
+                      , [](std::size_t, std::uint32_t, gateway_type::encoder_type& enc)
+                        {
+                          return echo_handler{&enc, 0};
+                        }
+                      , 32, std::chrono::milliseconds{100}};
+  gateway.start();
+
+  // The first peer goes silent, the second one keeps sending.
+  auto peers = std::vector<std::unique_ptr<transport>>{};
+  for (auto i = 0u; i < 2; ++i)
+  {
+    udp_socket socket{"127.0.0.1", 0};
+    socket.connect("127.0.0.1", gateway.port());
+    peers.emplace_back(new transport{std::move(socket), 8, in_order::no, data_handler{}});
+    peers.back()->set_session(1 + i);
+    (*peers.back())(data(100, 'x'));
+    peers.back()->flush();
+  }
+
+  const auto session_ids = [&]
+  {
+    auto ids = std::set<std::uint32_t>{};
+    gateway.for_each_session([&](std::size_t, std::uint32_t id, gateway_type::session_type&)
+    {
+      ids.insert(id);
+    });
+    return ids;
+  };
+  auto created = false;
+  for (auto k = 0u; k < 200; ++k)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    (*peers[1])(data(100, 'y'));
+    peers[1]->flush();
+    gateway.stop();
+    const auto ids = session_ids();
+    created = created or ids.size() == 2;
+    if (created and ids.size() == 1)
+    {
+      break;
+    }
+    gateway.start();
+  }
+  gateway.stop();
+  REQUIRE(created);
+  REQUIRE(session_ids() == std::set<std::uint32_t>{2});
+  REQUIRE(gateway.nb_invalid_datagrams() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP gateway bounds the number of sessions")
+{
+  using gateway_type = udp_gateway<echo_handler>;
+  using transport = udp_transport<data_handler>;
+
+  const auto max_sessions = 3u;
+  gateway_type gateway{ "127.0.0.1", 0, 1, 8, in_order::no
+                      , [](std::size_t, std::uint32_t, gateway_type::encoder_type& enc)
+                        {
+                          return echo_handler{&enc, 0};
+                        }
+                      , 32, std::chrono::seconds{60}, max_sessions};
+  gateway.start();
+
+  // Each peer waits for its echo before the next one sends, thus the first ones get a session.
+  const auto nb_peers = 5u;
+  auto peers = std::vector<std::unique_ptr<transport>>{};
+  for (auto i = 0u; i < nb_peers; ++i)
+  {
+    udp_socket socket{"127.0.0.1", 0};
+    socket.connect("127.0.0.1", gateway.port());
+    peers.emplace_back(new transport{std::move(socket), 8, in_order::no, data_handler{}});
+    peers.back()->set_session(1 + i);
+    (*peers.back())(data(100, 'x'));
+    peers.back()->flush();
+    for (auto k = 0u; k < 100 and peers.back()->decoder().data_handler().nb_data() == 0; ++k)
+    {
+      peers.back()->poll(std::chrono::milliseconds{10});
+    }
+  }
+  gateway.stop();
+
+  for (auto i = 0u; i < nb_peers; ++i)
+  {
+    REQUIRE(peers[i]->decoder().data_handler().nb_data() == (i < max_sessions ? 1 : 0));
+  }
+  auto ids = std::set<std::uint32_t>{};
+  gateway.for_each_session([&](std::size_t, std::uint32_t id, gateway_type::session_type&)
+  {
+    ids.insert(id);
+  });
+  REQUIRE(ids == std::set<std::uint32_t>{1, 2, 3});
+  REQUIRE(gateway.nb_invalid_datagrams() >= nb_peers - max_sessions);
+}
+
+/*------------------------------------------------------------------------------------------------*/
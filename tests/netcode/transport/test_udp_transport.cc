@@ -0,0 +1,241 @@
+#include <algorithm> // equal, max, rotate
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/transport/udp_transport.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief Two connected sockets on the loopback interface
+std::pair<udp_socket, udp_socket>
+make_socket_pair()
+{
+  udp_socket s0{"127.0.0.1", 0};
+  udp_socket s1{"127.0.0.1", 0};
+  s0.connect("127.0.0.1", s1.local_port());
+  s1.connect("127.0.0.1", s0.local_port());
+  return std::make_pair(std::move(s0), std::move(s1));
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP socket receives and sends batches")
+{
+  auto sockets = make_socket_pair();
+
+  auto out = std::vector<packet>{};
+  for (auto i = 0u; i < 10; ++i)
+  {
+    out.emplace_back(10 + i, static_cast<char>('a' + i));
+  }
+  sockets.first.send(out.data(), out.size());
+  REQUIRE(sockets.first.nb_send_calls() == 1);
+
+  auto in = std::vector<packet>(16, packet(64));
+  const auto nb = sockets.second.receive(in, std::chrono::milliseconds{1000});
+  REQUIRE(nb == 10);
+  REQUIRE(sockets.second.nb_receive_calls() == 1);
+  for (auto i = 0u; i < nb; ++i)
+  {
+    REQUIRE(in[i].size() == out[i].size());
+    REQUIRE(std::equal(in[i].begin(), in[i].end(), out[i].begin()));
+  }
+
+  // Nothing left to receive.
+  REQUIRE(sockets.second.receive(in, std::chrono::milliseconds{0}) == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP socket sizes packets to their datagrams")
+{
+  auto sockets = make_socket_pair();
+
+  const auto exchange = [&](std::size_t size)
+  {
+    const auto out = std::vector<packet>{packet(size, 'x'), packet(10, 'y')};
+    sockets.first.send(out.data(), out.size());
+
+    // Empty packets, like the ones left by packets moved out of a previous batch.
+    auto in = std::vector<packet>(4);
+    REQUIRE(sockets.second.receive(in, std::chrono::milliseconds{1000}) == 2);
+    for (auto i = 0u; i < 2; ++i)
+    {
+      REQUIRE(in[i].size() == out[i].size());
+      REQUIRE(std::equal(in[i].begin(), in[i].end(), out[i].begin()));
+      // A packet doesn't pin much more memory than its datagram.
+      REQUIRE(in[i].capacity() < 2 * std::max(size, std::size_t{2048}));
+    }
+  };
+
+  // Small datagrams fit in packets.
+  exchange(1000);
+  REQUIRE(sockets.second.nb_spilled_datagrams() == 0);
+
+  // The end of a larger datagram is copied, then packets are given its size.
+  exchange(10000);
+  REQUIRE(sockets.second.nb_spilled_datagrams() == 1);
+  exchange(10000);
+  REQUIRE(sockets.second.nb_spilled_datagrams() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP socket segments and coalesces datagrams")
+{
+  auto sockets = make_socket_pair();
+  if (not sockets.first.set_gso(true) or not sockets.second.set_gro(true))
+  {
+    WARN("UDP segmentation offload is not supported");
+    return;
+  }
+
+  // A run of packets of the same size, the last one might be smaller.
+  auto out = std::vector<packet>{};
+  for (auto i = 0u; i < 20; ++i)
+  {
+    out.emplace_back(200, static_cast<char>('a' + i));
+  }
+  out.emplace_back(100, 'z');
+
+  auto in = std::vector<packet>{};
+  const auto exchange = [&]
+  {
+    in.assign(32, packet(65535));
+    sockets.first.send(out.data(), out.size());
+    auto nb = std::size_t{0};
+    for (auto i = 0u; i < 10 and nb < out.size(); ++i)
+    {
+      const auto res = sockets.second.receive(in, std::chrono::milliseconds{1000});
+      // Packets received by previous iterations are kept out of the way.
+      std::rotate(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(res), in.end());
+      nb += res;
+    }
+    REQUIRE(nb == out.size());
+    std::rotate(in.begin(), in.end() - static_cast<std::ptrdiff_t>(nb), in.end());
+    for (auto i = 0u; i < nb; ++i)
+    {
+      REQUIRE(in[i].size() == out[i].size());
+      REQUIRE(std::equal(in[i].begin(), in[i].end(), out[i].begin()));
+    }
+  };
+
+  exchange();
+  REQUIRE(sockets.first.nb_send_calls() == 1);
+  REQUIRE(sockets.second.nb_receive_calls() == 1);
+  REQUIRE(sockets.second.nb_copied_segments() == out.size());
+
+  // The receiver now expects segments of this size, they are no longer copied.
+  const auto nb_copied = sockets.second.nb_copied_segments();
+  exchange();
+  REQUIRE(sockets.second.nb_copied_segments() == nb_copied);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP socket keeps the order of coalesced datagrams")
+{
+  auto sockets = make_socket_pair();
+  if (not sockets.first.set_gso(true) or not sockets.second.set_gro(true))
+  {
+    WARN("UDP segmentation offload is not supported");
+    return;
+  }
+
+  // Two runs of different sizes, thus two datagrams whose segments overflow their group.
+  auto out = std::vector<packet>{};
+  for (auto i = 0u; i < 10; ++i)
+  {
+    out.emplace_back(200, static_cast<char>('a' + i));
+  }
+  for (auto i = 0u; i < 10; ++i)
+  {
+    out.emplace_back(300, static_cast<char>('A' + i));
+  }
+  sockets.first.send(out.data(), out.size());
+
+  auto in = std::vector<packet>(32, packet(65535));
+  auto nb = std::size_t{0};
+  for (auto i = 0u; i < 10 and nb < out.size(); ++i)
+  {
+    const auto res = sockets.second.receive(in, std::chrono::milliseconds{1000});
+    std::rotate(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(res), in.end());
+    nb += res;
+  }
+  REQUIRE(nb == out.size());
+  std::rotate(in.begin(), in.end() - static_cast<std::ptrdiff_t>(nb), in.end());
+  for (auto i = 0u; i < nb; ++i)
+  {
+    REQUIRE(in[i].size() == out[i].size());
+    REQUIRE(std::equal(in[i].begin(), in[i].end(), out[i].begin()));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport exchanges data by batches")
+{
+  // Without and with segmentation offload.
+  for (const auto offload : {false, true})
+  {
+    auto sockets = make_socket_pair();
+    sockets.first.set_gso(offload);
+    sockets.second.set_gso(offload);
+    sockets.first.set_gro(offload);
+    sockets.second.set_gro(offload);
+    udp_transport<data_handler> t0{std::move(sockets.first), 8, in_order::no, data_handler{}};
+    udp_transport<data_handler> t1{std::move(sockets.second), 8, in_order::no, data_handler{}};
+    t1.decoder().set_ack_period(std::chrono::milliseconds{0});
+
+    for (auto i = 0u; i < 100; ++i)
+    {
+      t0(data(100, static_cast<char>(i)));
+    }
+    t0.flush();
+    const auto& enc = t0.encoder();
+    REQUIRE(t0.nb_sent_datagrams() == enc.nb_sent_sources() + enc.nb_sent_repairs());
+    REQUIRE(t0.socket().nb_send_calls() < t0.nb_sent_datagrams());
+
+    for (auto i = 0u; i < 100 and t1.decoder().data_handler().nb_data() != 100; ++i)
+    {
+      t1.poll(std::chrono::milliseconds{100});
+    }
+    REQUIRE(t1.decoder().data_handler().nb_data() == 100);
+    REQUIRE(t1.socket().nb_receive_calls() < t1.nb_received_datagrams());
+
+    // Acks go back to the encoder.
+    t1.decoder().generate_ack();
+    t1.flush();
+    REQUIRE(t0.poll(std::chrono::milliseconds{1000}) == t1.decoder().nb_sent_acks());
+    REQUIRE(t0.encoder().nb_received_acks() == t1.decoder().nb_sent_acks());
+    REQUIRE(t0.encoder().window() == 0);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport drops malformed datagrams")
+{
+  udp_socket s0{"127.0.0.1", 0};
+  udp_socket s1{"127.0.0.1", 0};
+  s0.connect("127.0.0.1", s1.local_port());
+  udp_transport<data_handler> t{std::move(s1), 8, in_order::no, data_handler{}};
+
+  // An unknown type, a truncated source, and a repair which encodes no source.
+  const auto garbage = std::vector<packet>{ packet{'\x7f', 'x'}, packet{'\x02'}
+                                          , packet{ '\x01', 0, 0, 0, 0, 0, 1, 'x', 0, 0, 0, 1}};
+  s0.send(garbage.data(), garbage.size());
+  REQUIRE(t.poll(std::chrono::milliseconds{1000}) == 3);
+  REQUIRE(t.nb_invalid_datagrams() == 3);
+}
+
+/*------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,139 @@
+#include <algorithm> // equal
+#include <system_error>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/transport/udp_transport.hh"
+#include "netcode/transport/uring_socket.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief Two connected sockets on the loopback interface
+std::pair<udp_socket, udp_socket>
+make_socket_pair()
+{
+  udp_socket s0{"127.0.0.1", 0};
+  udp_socket s1{"127.0.0.1", 0};
+  s0.connect("127.0.0.1", s1.local_port());
+  s1.connect("127.0.0.1", s0.local_port());
+  return std::make_pair(std::move(s0), std::move(s1));
+}
+
+/// @brief Receive exactly @p nb datagrams
+template <typename Socket>
+std::vector<packet>
+receive(Socket& socket, std::size_t nb)
+{
+  auto res = std::vector<packet>{};
+  auto batch = std::vector<packet>(8, packet(2048));
+  for (auto i = 0u; i < 100 and res.size() < nb; ++i)
+  {
+    const auto n = socket.receive(batch, std::chrono::milliseconds{100});
+    for (auto j = 0ul; j < n; ++j)
+    {
+      res.push_back(std::move(batch[j]));
+      batch[j] = packet(2048);
+    }
+  }
+  return res;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("io_uring socket receives in its pool and sends batches")
+{
+  auto sockets = make_socket_pair();
+  std::unique_ptr<uring_socket> uring;
+  try
+  {
+    uring.reset(new uring_socket{std::move(sockets.second), 16, 2048});
+  }
+  catch (const std::system_error& e)
+  {
+    WARN("io_uring is not usable: " << e.what());
+    return;
+  }
+
+  auto out = std::vector<packet>{};
+  for (auto i = 0u; i < 40; ++i)
+  {
+    out.emplace_back(10 + i, static_cast<char>('a' + i));
+  }
+
+  // More datagrams than buffers in the pool, exchanged packets take their place.
+  sockets.first.send(out.data(), out.size());
+  const auto in = receive(*uring, out.size());
+  REQUIRE(in.size() == out.size());
+  for (auto i = 0u; i < in.size(); ++i)
+  {
+    REQUIRE(in[i].size() == out[i].size());
+    REQUIRE(std::equal(in[i].begin(), in[i].end(), out[i].begin()));
+  }
+
+  uring->send(out.data(), 10);
+  REQUIRE(uring->nb_send_calls() == 1);
+  const auto back = receive(sockets.first, 10);
+  REQUIRE(back.size() == 10);
+  for (auto i = 0u; i < back.size(); ++i)
+  {
+    REQUIRE(std::equal(back[i].begin(), back[i].end(), out[i].begin()));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport over io_uring")
+{
+  using transport = udp_transport<data_handler, loss_rate_controller, uring_socket>;
+
+  auto sockets = make_socket_pair();
+  std::unique_ptr<transport> t0;
+  std::unique_ptr<transport> t1;
+  try
+  {
+    t0.reset(new transport{ uring_socket{std::move(sockets.first)}, 8, in_order::no
+                          , data_handler{}});
+    t1.reset(new transport{ uring_socket{std::move(sockets.second)}, 8, in_order::no
+                          , data_handler{}});
+  }
+  catch (const std::system_error& e)
+  {
+    WARN("io_uring is not usable: " << e.what());
+    return;
+  }
+
+  for (auto i = 0u; i < 100; ++i)
+  {
+    (*t0)(data(100, static_cast<char>(i)));
+  }
+  t0->flush();
+
+  for (auto i = 0u; i < 100 and t1->decoder().data_handler().nb_data() != 100; ++i)
+  {
+    t1->poll(std::chrono::milliseconds{100});
+  }
+  REQUIRE(t1->decoder().data_handler().nb_data() == 100);
+  for (auto i = 0u; i < 100; ++i)
+  {
+    REQUIRE(t1->decoder().data_handler()[i] == std::vector<char>(100, static_cast<char>(i)));
+  }
+
+  t1->decoder().generate_ack();
+  t1->flush();
+  for (auto i = 0u; i < 100 and t0->encoder().window() != 0; ++i)
+  {
+    t0->poll(std::chrono::milliseconds{100});
+  }
+  REQUIRE(t0->encoder().window() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/
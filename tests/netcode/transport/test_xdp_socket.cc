@@ -0,0 +1,193 @@
+#include <algorithm> // equal
+#include <cstdio>    // sscanf
+#include <cstdlib>   // system
+#include <fstream>
+#include <system_error>
+
+#include <catch.hpp>
+#include "tests/netcode/common.hh"
+
+#include "netcode/transport/udp_transport.hh"
+#include "netcode/transport/xdp_socket.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+using namespace ntc;
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+/// @brief A pair of veth interfaces, removed when destroyed
+struct veth_pair
+{
+  bool ok;
+  xdp_endpoint end0;
+  xdp_endpoint end1;
+
+  veth_pair()
+    : ok{false}, end0(), end1()
+  {
+    ok = std::system("ip link add ntcxdp0 type veth peer name ntcxdp1 2> /dev/null") == 0
+     and std::system("ip link set ntcxdp0 up && ip link set ntcxdp1 up") == 0
+     and read_mac("ntcxdp0", end0) and read_mac("ntcxdp1", end1);
+    end0.address = "10.11.12.1";
+    end0.port = 4000;
+    end1.address = "10.11.12.2";
+    end1.port = 4001;
+  }
+
+  ~veth_pair()
+  {
+    if (ok)
+    {
+      static_cast<void>(std::system("ip link del ntcxdp0"));
+    }
+  }
+
+  static bool
+  read_mac(const std::string& name, xdp_endpoint& end)
+  {
+    std::ifstream file{"/sys/class/net/" + name + "/address"};
+    auto address = std::string{};
+    unsigned int m[6];
+    if (not (file >> address) or std::sscanf( address.c_str(), "%x:%x:%x:%x:%x:%x"
+                                              , &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) != 6)
+    {
+      return false;
+    }
+    std::copy(m, m + 6, end.mac.begin());
+    return true;
+  }
+};
+
+/// @brief Receive exactly @p nb datagrams
+std::vector<packet>
+receive(xdp_socket& socket, std::size_t nb)
+{
+  auto res = std::vector<packet>{};
+  auto batch = std::vector<packet>(8, packet(2048));
+  for (auto i = 0u; i < 100 and res.size() < nb; ++i)
+  {
+    const auto n = socket.receive(batch, std::chrono::milliseconds{100});
+    for (auto j = 0ul; j < n; ++j)
+    {
+      res.push_back(std::move(batch[j]));
+      batch[j] = packet(2048);
+    }
+  }
+  return res;
+}
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("AF_XDP socket exchanges datagrams over a veth pair")
+{
+  veth_pair veth;
+  if (not veth.ok)
+  {
+    WARN("Can't create a veth pair");
+    return;
+  }
+  std::unique_ptr<xdp_socket> s0;
+  std::unique_ptr<xdp_socket> s1;
+  try
+  {
+    s0.reset(new xdp_socket{"ntcxdp0", veth.end0, veth.end1, 64});
+    s1.reset(new xdp_socket{"ntcxdp1", veth.end1, veth.end0, 64});
+  }
+  catch (const std::system_error& e)
+  {
+    WARN("AF_XDP is not usable: " << e.what());
+    return;
+  }
+  REQUIRE(s0->max_payload_size() == 1472);
+
+  auto out = std::vector<packet>{};
+  for (auto i = 0u; i < 24; ++i)
+  {
+    out.emplace_back(10 + i, static_cast<char>('a' + i));
+  }
+
+  // Twice as many frames as the ones to send, which must then be reclaimed.
+  for (auto round = 0u; round < 2; ++round)
+  {
+    s0->send(out.data(), out.size());
+    const auto in = receive(*s1, out.size());
+    REQUIRE(in.size() == out.size());
+    for (auto i = 0u; i < in.size(); ++i)
+    {
+      REQUIRE(in[i].size() == out[i].size());
+      REQUIRE(std::equal(in[i].begin(), in[i].end(), out[i].begin()));
+    }
+  }
+
+  s1->send(out.data(), 10);
+  const auto back = receive(*s0, 10);
+  REQUIRE(back.size() == 10);
+  for (auto i = 0u; i < back.size(); ++i)
+  {
+    REQUIRE(std::equal(back[i].begin(), back[i].end(), out[i].begin()));
+  }
+
+  // Too large for the MTU.
+  const auto large = packet(1473, 'x');
+  s0->send(&large, 1);
+  REQUIRE(s0->nb_dropped() == 1);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+TEST_CASE("UDP transport over AF_XDP")
+{
+  using transport = udp_transport<data_handler, loss_rate_controller, xdp_socket>;
+
+  veth_pair veth;
+  if (not veth.ok)
+  {
+    WARN("Can't create a veth pair");
+    return;
+  }
+  std::unique_ptr<transport> t0;
+  std::unique_ptr<transport> t1;
+  try
+  {
+    t0.reset(new transport{ xdp_socket{"ntcxdp0", veth.end0, veth.end1}, 8, in_order::no
+                          , data_handler{}});
+    t1.reset(new transport{ xdp_socket{"ntcxdp1", veth.end1, veth.end0}, 8, in_order::no
+                          , data_handler{}});
+  }
+  catch (const std::system_error& e)
+  {
+    WARN("AF_XDP is not usable: " << e.what());
+    return;
+  }
+
+  for (auto i = 0u; i < 100; ++i)
+  {
+    (*t0)(data(100, static_cast<char>(i)));
+  }
+  t0->flush();
+
+  for (auto i = 0u; i < 100 and t1->decoder().data_handler().nb_data() != 100; ++i)
+  {
+    t1->poll(std::chrono::milliseconds{100});
+  }
+  REQUIRE(t1->decoder().data_handler().nb_data() == 100);
+  for (auto i = 0u; i < 100; ++i)
+  {
+    REQUIRE(t1->decoder().data_handler()[i] == std::vector<char>(100, static_cast<char>(i)));
+  }
+
+  t1->decoder().generate_ack();
+  t1->flush();
+  for (auto i = 0u; i < 100 and t0->encoder().window() != 0; ++i)
+  {
+    t0->poll(std::chrono::milliseconds{100});
+  }
+  REQUIRE(t0->encoder().window() == 0);
+}
+
+/*------------------------------------------------------------------------------------------------*/